@@ -0,0 +1,130 @@
+/***********************************************************************
+AdaptiveCodebook - Class to train Huffman codebooks from histograms of
+symbols encoded in a live stream.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "AdaptiveCodebook.h"
+
+#include <stdexcept>
+
+/*********************************
+Methods of class AdaptiveCodebook:
+*********************************/
+
+AdaptiveCodebook::AdaptiveCodebook(unsigned int sNumSymbols,const HuffmanBuilder::Code* sDefaultCodebook,size_t sWindowSize)
+	:numSymbols(sNumSymbols),defaultCodebook(sDefaultCodebook),windowSize(sWindowSize),
+	 histogram(new size_t[numSymbols]),numSamples(0),
+	 codebookId(0),frequencies(0),codebook(0)
+	{
+	/* Clear the histogram: */
+	for(unsigned int i=0;i<numSymbols;++i)
+		histogram[i]=0;
+	}
+
+AdaptiveCodebook::~AdaptiveCodebook(void)
+	{
+	delete[] histogram;
+	delete[] frequencies;
+	delete[] codebook;
+	}
+
+void AdaptiveCodebook::addSamples(const size_t* sampleHistogram)
+	{
+	/* Add the given histogram to the training window: */
+	for(unsigned int i=0;i<numSymbols;++i)
+		{
+		histogram[i]+=sampleHistogram[i];
+		numSamples+=sampleHistogram[i];
+		}
+	}
+
+bool AdaptiveCodebook::update(void)
+	{
+	/* Bail out if the training window is not full yet: */
+	if(numSamples<windowSize)
+		return false;
+	
+	/* Normalize the histogram, giving each symbol a non-zero frequency so that every symbol remains encodable: */
+	Misc::UInt32* newFrequencies=new Misc::UInt32[numSymbols];
+	for(unsigned int i=0;i<numSymbols;++i)
+		newFrequencies[i]=Misc::UInt32((histogram[i]*frequencyScale)/numSamples+1U);
+	
+	/* Build a codebook from the normalized frequencies: */
+	HuffmanBuilder::Code* newCodebook=0;
+	try
+		{
+		HuffmanBuilder builder;
+		initBuilder(builder,numSymbols,newFrequencies);
+		newCodebook=builder.buildEncodingCodebook();
+		}
+	catch(const std::runtime_error& err)
+		{
+		/* Keep the current codebook: */
+		}
+	
+	/* Compare the encoded sizes of the training window using the current and new codebooks: */
+	bool changed=false;
+	if(newCodebook!=0)
+		{
+		const HuffmanBuilder::Code* currentCodebook=getCodebook();
+		size_t currentBits=0;
+		size_t newBits=0;
+		for(unsigned int i=0;i<numSymbols;++i)
+			{
+			currentBits+=histogram[i]*currentCodebook[i].numBits;
+			newBits+=histogram[i]*newCodebook[i].numBits;
+			}
+		
+		/* Switch to the new codebook if it saves at least 2% plus the cost of sending it: */
+		if(newBits+size_t(numSymbols)*32U<currentBits-currentBits/50U)
+			{
+			delete[] frequencies;
+			frequencies=newFrequencies;
+			newFrequencies=0;
+			delete[] codebook;
+			codebook=newCodebook;
+			newCodebook=0;
+			
+			/* Assign a new non-zero codebook ID: */
+			codebookId=(codebookId+1U)&0xffffU;
+			if(codebookId==0U)
+				codebookId=1U;
+			
+			changed=true;
+			}
+		}
+	delete[] newFrequencies;
+	delete[] newCodebook;
+	
+	/* Start a new training window: */
+	for(unsigned int i=0;i<numSymbols;++i)
+		histogram[i]=0;
+	numSamples=0;
+	
+	return changed;
+	}
+
+void AdaptiveCodebook::initBuilder(HuffmanBuilder& builder,unsigned int numSymbols,const Misc::UInt32* frequencies)
+	{
+	/* Add one leaf per symbol and build the code tree: */
+	for(unsigned int i=0;i<numSymbols;++i)
+		builder.addLeaf(frequencies[i]);
+	builder.buildTree();
+	}
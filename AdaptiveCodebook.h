@@ -0,0 +1,72 @@
+/***********************************************************************
+AdaptiveCodebook - Class to train Huffman codebooks from histograms of
+symbols encoded in a live stream.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef ADAPTIVECODEBOOK_INCLUDED
+#define ADAPTIVECODEBOOK_INCLUDED
+
+#include <stddef.h>
+#include <Misc/SizedTypes.h>
+
+#include "HuffmanBuilder.h"
+
+class AdaptiveCodebook
+	{
+	/* Elements: */
+	private:
+	static const size_t frequencyScale=size_t(1U)<<20; // Approximate total of normalized symbol frequencies, which limits code lengths to well below maxNumBits
+	unsigned int numSymbols; // Number of symbols in the Huffman code
+	const HuffmanBuilder::Code* defaultCodebook; // Built-in codebook used while the codebook ID is zero
+	size_t windowSize; // Number of encoded symbols to collect before considering a new codebook
+	size_t* histogram; // Histogram of symbols encoded since the last codebook update
+	size_t numSamples; // Total number of symbols in the histogram
+	unsigned int codebookId; // ID of the current codebook, or zero for the default codebook
+	Misc::UInt32* frequencies; // Normalized symbol frequencies from which the current trained codebook was built
+	HuffmanBuilder::Code* codebook; // The current trained codebook, or null while using the default codebook
+	
+	/* Constructors and destructors: */
+	public:
+	AdaptiveCodebook(unsigned int sNumSymbols,const HuffmanBuilder::Code* sDefaultCodebook,size_t sWindowSize); // Creates an adaptive codebook for the given number of symbols, starting from the given default codebook and collecting the given number of symbols between updates
+	~AdaptiveCodebook(void);
+	
+	/* Methods: */
+	unsigned int getNumSymbols(void) const // Returns the number of symbols in the Huffman code
+		{
+		return numSymbols;
+		}
+	unsigned int getCodebookId(void) const // Returns the ID of the current codebook, or zero for the default codebook
+		{
+		return codebookId;
+		}
+	const HuffmanBuilder::Code* getCodebook(void) const // Returns the current codebook
+		{
+		return codebook!=0?codebook:defaultCodebook;
+		}
+	const Misc::UInt32* getFrequencies(void) const // Returns the normalized symbol frequencies from which the current codebook was built, or null for the default codebook
+		{
+		return frequencies;
+		}
+	void addSamples(const size_t* sampleHistogram); // Adds a histogram of encoded symbols of numSymbols entries to the training window
+	bool update(void); // Builds a new codebook if the training window is full and the new codebook encodes the window notably better than the current one; returns true if the current codebook changed
+	static void initBuilder(HuffmanBuilder& builder,unsigned int numSymbols,const Misc::UInt32* frequencies); // Initializes the given empty Huffman builder from the given normalized symbol frequencies, so that encoders and decoders build identical codes
+	};
+
+#endif
@@ -28,17 +28,30 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 class BitSink
 	{
-	/* Elements: */
+	/* Embedded classes: */
 	private:
+	typedef Misc::UInt64 Buffer; // Type for the bit accumulator, holding up to two words' worth of bits
+	
+	/* Elements: */
+	static const unsigned int wordBufferSize=1024; // Number of words collected before they are written to the file in bulk
 	IO::FilePtr file; // File to which to write code stream
-	Bits buffer; // The bit buffer
-	unsigned int freeBits; // Number of currently unused bits in the buffer
+	Buffer buffer; // The bit accumulator, holding not-yet completed bits aligned with the LSB
+	unsigned int numBits; // Number of bits currently in the accumulator; always less than maxNumBits between calls
+	Bits words[wordBufferSize]; // Completed words waiting to be written to the file
+	unsigned int numWords; // Number of completed words in the word buffer
+	
+	/* Private methods: */
+	void writeWords(void) // Writes all completed words to the file
+		{
+		file->write(words,numWords);
+		numWords=0;
+		}
 	
 	/* Constructors and destructors: */
 	public:
 	BitSink(IO::File& sFile)
 		:file(&sFile),
-		 buffer(0x0U),freeBits(maxNumBits)
+		 buffer(0x0U),numBits(0),numWords(0)
 		{
 		}
 	~BitSink(void)
@@ -48,55 +61,51 @@ class BitSink
 		}
 	
 	/* Methods: */
-	void flush(void) // Empties the current bit buffer
+	void flush(void) // Empties the current bit buffer and writes all pending words to the file
 		{
-		/* Check whether the buffer has bits in it, which it always will except immediately after creation: */
-		if(freeBits!=maxNumBits)
+		/* Check whether the accumulator has bits in it: */
+		if(numBits!=0U)
 			{
-			/* Shift the buffer's current contents to the MSB: */
-			buffer<<=freeBits;
-			
-			/* Write the new buffer contents to the file: */
-			file->write(buffer);
+			/* Complete a final word by shifting the accumulator's current contents to the MSB: */
+			words[numWords]=Bits(buffer<<(maxNumBits-numBits));
+			++numWords;
 			
-			/* Clear the buffer: */
-			buffer=Bits(0x0U);
-			freeBits=maxNumBits;
+			/* Clear the accumulator: */
+			buffer=Buffer(0x0U);
+			numBits=0U;
 			}
+		
+		/* Write all completed words to the file: */
+		if(numWords!=0U)
+			writeWords();
 		}
-	void write(Bits bits,unsigned int numBits) // Writes a number of bits, starting from LSB in the given value, to the buffer; assumes numBits<=bufferSize
+	void write(Bits bits,unsigned int numNewBits) // Writes a number of bits, starting from LSB in the given value, to the buffer; assumes numNewBits<=maxNumBits and that the given value has no bits set above numNewBits
 		{
-		/* Check whether the given bits fit into the buffer: */
-		if(freeBits>=numBits)
+		/* Append the given bits to the accumulator: */
+		buffer=(buffer<<numNewBits)|Buffer(bits);
+		numBits+=numNewBits;
+		
+		/* Check if the accumulator holds a complete word: */
+		if(numBits>=maxNumBits)
 			{
-			/* Append the given bits to the buffer: */
-			buffer<<=numBits;
-			buffer|=bits;
-			freeBits-=numBits;
+			/* Move the accumulator's oldest word into the word buffer; bits above it are stale and will be shifted out: */
+			numBits-=maxNumBits;
+			words[numWords]=Bits(buffer>>numBits);
+			if(++numWords==wordBufferSize)
+				writeWords();
 			}
-		else if(freeBits==0U)
+		}
+	void writeLong(Misc::UInt64 bits,unsigned int numNewBits) // Writes up to 2*maxNumBits bits, starting from LSB in the given value, to the buffer; assumes that the given value has no bits set above numNewBits
+		{
+		/* Split the given bits into at most two words' worth: */
+		if(numNewBits>maxNumBits)
 			{
-			/* Write the previous buffer contents to the file: */
-			file->write(buffer);
-			
-			/* Restart the buffer with the given bits: */
-			buffer=bits;
-			freeBits=maxNumBits-numBits;
+			unsigned int lsb=numNewBits-maxNumBits;
+			write(Bits(bits>>lsb),maxNumBits);
+			write(Bits(bits&((Misc::UInt64(0x1U)<<lsb)-1U)),lsb);
 			}
 		else
-			{
-			/* Append the MSB part of the given bits to the buffer: */
-			buffer<<=freeBits;
-			unsigned int lsb=numBits-freeBits;
-			buffer|=bits>>lsb;
-			
-			/* Write the new buffer contents to the file: */
-			file->write(buffer);
-			
-			/* Restart the buffer with the LSB part of the given bits: */
-			buffer=bits&((Bits(0x1U)<<lsb)-Bits(1U)); // Technically it's not necessary to null out the MSB bits, they'll be shifted out before the buffer is written anyway
-			freeBits=maxNumBits-lsb;
-			}
+			write(Bits(bits),numNewBits);
 		}
 	};
 
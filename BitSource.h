@@ -28,12 +28,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 class BitSource // Class to read variable-size codes from a file
 	{
-	/* Elements: */
+	/* Embedded classes: */
 	private:
-	static const Bits msbMask=Bits(0x1U)<<(maxNumBits-1U); // Mask to extract the MSB from the buffer
+	typedef Misc::UInt64 Buffer; // Type for the bit accumulator, holding up to two words' worth of bits
+	
+	/* Elements: */
+	static const unsigned int bufferBits=sizeof(Buffer)*8U; // Number of bits in the accumulator
 	IO::FilePtr file; // File from which to read code stream
-	Bits buffer; // The bit buffer
-	unsigned int usedBits; // Number of currently used bits in the buffer
+	Buffer buffer; // The bit accumulator, holding unread bits aligned with the MSB; bits below the unread bits are always zero
+	unsigned int usedBits; // Number of currently unread bits in the accumulator
 	
 	/* Constructors and destructors: */
 	public:
@@ -50,68 +53,57 @@ class BitSource // Class to read variable-size codes from a file
 	void flush(void) // Empties the current bit buffer
 		{
 		/* Clear the buffer: */
-		buffer=Bits(0x0U);
+		buffer=Buffer(0x0U);
 		usedBits=0U;
 		}
-	Bits read(unsigned int numBits) // Reads a number of bits and returns them in the LSB part of the result; assumes numBits<=bufferSize
+	void refill(void) // Appends the next word from the file to the accumulator; assumes getNumBufferedBits()<=bufferBits-maxNumBits
 		{
-		Bits result;
-		if(usedBits>=numBits)
-			{
-			/* Copy the buffer into the result: */
-			result=buffer;
-			
-			/* Shift the extracted bits out of the buffer: */
-			buffer<<=numBits;
-			usedBits-=numBits;
-			}
-		else if(usedBits==0U)
-			{
-			/* Read new buffer contents from the file: */
-			file->read(buffer);
-			
-			/* Copy the buffer into the result: */
-			result=buffer;
-			
-			/* Shift the extracted bits out of the buffer: */
-			buffer<<=numBits;
-			usedBits=maxNumBits-numBits;
-			}
-		else
-			{
-			/* Copy the buffer's remaining bits into the result: */
-			result=buffer;
-			
-			/* Read new buffer contents from the file: */
-			file->read(buffer);
-			
-			/* Append the new buffer's MSB portion to the result: */
-			result|=buffer>>usedBits;
-			
-			/* Shift the extracted bits out of the buffer: */
-			unsigned int lsb=numBits-usedBits;
-			buffer<<=lsb;
-			usedBits=maxNumBits-lsb;
-			}
+		/* Read the next word and place it right below the accumulator's unread bits: */
+		Bits word;
+		file->read(word);
+		buffer|=Buffer(word)<<(bufferBits-maxNumBits-usedBits);
+		usedBits+=maxNumBits;
+		}
+	Bits read(unsigned int numBits) // Reads a number of bits and returns them in the LSB part of the result; assumes 0<numBits<=maxNumBits
+		{
+		/* Read another word from the file if the accumulator does not hold enough bits: */
+		if(usedBits<numBits)
+			refill();
 		
-		/* Shift the result to the LSB: */
-		result>>=maxNumBits-numBits;
+		/* Extract the requested bits from the accumulator's MSB: */
+		Bits result=Bits(buffer>>(bufferBits-numBits));
+		buffer<<=numBits;
+		usedBits-=numBits;
 		
 		return result;
 		}
+	unsigned int getNumBufferedBits(void) const // Returns the number of unread bits in the buffer
+		{
+		return usedBits;
+		}
+	Bits peek(unsigned int numBits) // Returns the next numBits bits in the LSB part of the result without consuming them; refills the buffer only if it is empty, and pads bits beyond the buffer with zeros; assumes 0<numBits<=maxNumBits
+		{
+		/* Fill the buffer if it is currently empty: */
+		if(usedBits==0U)
+			refill();
+		
+		/* Return the accumulator's MSB portion: */
+		return Bits(buffer>>(bufferBits-numBits));
+		}
+	void skip(unsigned int numBits) // Consumes the given number of bits from the buffer; assumes numBits<=getNumBufferedBits()
+		{
+		/* Shift the skipped bits out of the buffer: */
+		buffer<<=numBits;
+		usedBits-=numBits;
+		}
 	Bits readBit(void) // Reads a single bit and returns it in the LSB of the result
 		{
 		/* Fill the buffer if it is currently empty: */
 		if(usedBits==0U)
-			{
-			/* Read new buffer contents from the file: */
-			file->read(buffer);
-			
-			usedBits=maxNumBits;
-			}
+			refill();
 		
-		/* Return the buffer's MSB: */
-		Bits result=buffer>>(maxNumBits-1U);
+		/* Return the accumulator's MSB: */
+		Bits result=Bits(buffer>>(bufferBits-1U));
 		
 		/* Shift the MSB out of the buffer: */
 		buffer<<=1;
@@ -0,0 +1,111 @@
+/***********************************************************************
+BoxcarTemporalFilter - Temporal filter calculating running means and
+variances of each pixel's depth value over a fixed-length window of
+past frames.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "BoxcarTemporalFilter.h"
+
+/*************************************
+Methods of class BoxcarTemporalFilter:
+*************************************/
+
+BoxcarTemporalFilter::BoxcarTemporalFilter(const Size& sSize,unsigned int sNumAveragingSlots)
+	:TemporalFilter(sSize),
+	 numAveragingSlots(sNumAveragingSlots),
+	 averagingBuffer(0),statBuffer(0),
+	 temporalKernel(FrameFilterKernels::findTemporalKernel("auto"))
+	{
+	/* Initialize the averaging buffer: */
+	averagingBuffer=new RawDepth[numAveragingSlots*size[1]*size[0]];
+	RawDepth* abPtr=averagingBuffer;
+	for(unsigned int i=0;i<numAveragingSlots;++i)
+		for(unsigned int y=0;y<size[1];++y)
+			for(unsigned int x=0;x<size[0];++x,++abPtr)
+				*abPtr=FrameFilterKernels::invalidDepth; // Mark sample as invalid
+	averagingSlotIndex=0U;
+	
+	/* Initialize the statistics buffer's planes of numbers of samples, sums, and sums of squares: */
+	statBuffer=new unsigned int[3*size[1]*size[0]];
+	unsigned int* sbPtr=statBuffer;
+	for(int i=0;i<3;++i)
+		for(unsigned int y=0;y<size[1];++y)
+			for(unsigned int x=0;x<size[0];++x,++sbPtr)
+				*sbPtr=0;
+	}
+
+BoxcarTemporalFilter::~BoxcarTemporalFilter(void)
+	{
+	delete[] averagingBuffer;
+	delete[] statBuffer;
+	}
+
+const char* BoxcarTemporalFilter::getName(void) const
+	{
+	return "boxcar";
+	}
+
+size_t BoxcarTemporalFilter::getStateSize(void) const
+	{
+	return numAveragingSlots*sizeof(RawDepth)+3*sizeof(unsigned int);
+	}
+
+void BoxcarTemporalFilter::setTemporalKernel(FrameFilterKernels::TemporalKernel newTemporalKernel)
+	{
+	/* Set the new kernel; kernels are stateless, so they can be swapped between frames: */
+	temporalKernel=newTemporalKernel;
+	}
+
+void BoxcarTemporalFilter::filterBand(const TemporalFilter::Parameters& parameters,const TemporalFilter::Band& band)
+	{
+	/* Enter the band of the new frame into the averaging buffer and calculate the band's output pixel values one row at a time: */
+	size_t bandOffset=size_t(band.yBegin)*size_t(size[0]);
+	size_t planeSize=size_t(size[1])*size_t(size[0]);
+	FrameFilterKernels::Row row;
+	row.input=band.input+bandOffset;
+	row.pixelDepthCorrection=band.pixelDepthCorrection+bandOffset;
+	row.averaging=averagingBuffer+averagingSlotIndex*planeSize+bandOffset;
+	row.numSamples=statBuffer+bandOffset;
+	row.sums=statBuffer+planeSize+bandOffset;
+	row.sumSquares=statBuffer+planeSize*2+bandOffset;
+	row.valid=band.valid+bandOffset;
+	row.output=band.output+bandOffset;
+	for(row.y=band.yBegin;row.y<band.yEnd;++row.y)
+		{
+		temporalKernel(parameters,row);
+		
+		/* Go to the next row: */
+		row.input+=size[0];
+		row.pixelDepthCorrection+=size[0];
+		row.averaging+=size[0];
+		row.numSamples+=size[0];
+		row.sums+=size[0];
+		row.sumSquares+=size[0];
+		row.valid+=size[0];
+		row.output+=size[0];
+		}
+	}
+
+void BoxcarTemporalFilter::finishFrame(void)
+	{
+	/* Go to the next averaging slot: */
+	if(++averagingSlotIndex==numAveragingSlots)
+		averagingSlotIndex=0U;
+	}
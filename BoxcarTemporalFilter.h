@@ -0,0 +1,52 @@
+/***********************************************************************
+BoxcarTemporalFilter - Temporal filter calculating running means and
+variances of each pixel's depth value over a fixed-length window of
+past frames.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef BOXCARTEMPORALFILTER_INCLUDED
+#define BOXCARTEMPORALFILTER_INCLUDED
+
+#include "TemporalFilter.h"
+
+class BoxcarTemporalFilter:public TemporalFilter
+	{
+	/* Elements: */
+	private:
+	unsigned int numAveragingSlots; // Number of slots in each pixel's averaging buffer
+	RawDepth* averagingBuffer; // Buffer to calculate running averages of each pixel's depth value
+	unsigned int averagingSlotIndex; // Index of averaging slot in which to store the next frame's depth values
+	unsigned int* statBuffer; // Buffer retaining the running means and variances of each pixel's depth value, as separate planes of numbers of samples, sums, and sums of squares
+	FrameFilterKernels::TemporalKernel temporalKernel; // Kernel to update the filter state and calculate output values for one row of pixels
+	
+	/* Constructors and destructors: */
+	public:
+	BoxcarTemporalFilter(const Size& sSize,unsigned int sNumAveragingSlots); // Creates a filter for frames of the given size and the given running average length
+	virtual ~BoxcarTemporalFilter(void);
+	
+	/* Methods from class TemporalFilter: */
+	virtual const char* getName(void) const;
+	virtual size_t getStateSize(void) const;
+	virtual void setTemporalKernel(FrameFilterKernels::TemporalKernel newTemporalKernel);
+	virtual void filterBand(const Parameters& parameters,const Band& band);
+	virtual void finishFrame(void);
+	};
+
+#endif
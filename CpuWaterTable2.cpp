@@ -0,0 +1,1164 @@
+/***********************************************************************
+CpuWaterTable2 - Class to run the same shallow water flow simulation as
+WaterTable2 on the CPU, using multiple threads, to serve as a headless
+benchmark, a reference for regression tests, and a fallback on systems
+without suitable GPUs.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "CpuWaterTable2.h"
+
+#include <string.h>
+#include <algorithm>
+#include <Misc/StdError.h>
+#include <Math/Math.h>
+
+/* Check whether SIMD flux kernels can be compiled for the target architecture: */
+#if defined(__GNUC__)&&(defined(__x86_64__)||defined(__i386__))
+#define CPUWATERTABLE2_X86 1
+#include <immintrin.h>
+#else
+#define CPUWATERTABLE2_X86 0
+#endif
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline int clampIndex(int index,int max) // Clamps the given index to [0, max] in the same way as nearest-neighbor texture sampling
+	{
+	return index<0?0:index>max?max:index;
+	}
+
+inline GLfloat calcMinmodSlope(GLfloat q0,GLfloat q1,GLfloat q2,GLfloat thetaOverCellSize,GLfloat halfOverCellSize)
+	{
+	/* Calculate the left, central, and right differences: */
+	GLfloat d01=(q1-q0)*thetaOverCellSize;
+	GLfloat d02=(q2-q0)*halfOverCellSize;
+	GLfloat d12=(q2-q1)*thetaOverCellSize;
+	
+	/* Calculate the minmod-limited slope; at most one of the two terms is non-zero, so the sum equals the selected difference exactly: */
+	GLfloat dMin=Math::min(Math::min(d01,d02),d12);
+	GLfloat dMax=Math::max(Math::max(d01,d02),d12);
+	return Math::max(dMin,0.0f)+Math::min(dMax,0.0f);
+	}
+
+inline GLfloat calcLevelSlope(GLfloat q0,GLfloat q1,GLfloat q2,GLfloat thetaOverCellSize,GLfloat halfOverCellSize,GLfloat halfCellSize,GLfloat b0,GLfloat b1)
+	{
+	/* Calculate the minmod-limited slope: */
+	GLfloat slope=calcMinmodSlope(q0,q1,q2,thetaOverCellSize,halfOverCellSize);
+	
+	/* Check the calculated slope against the left and right face-centered bathymetry values, using selects instead of branches: */
+	slope=q1-slope*halfCellSize<b0?(q1-b0)/halfCellSize:slope;
+	slope=q1+slope*halfCellSize<b1?(b1-q1)/halfCellSize:slope;
+	
+	return slope;
+	}
+
+inline GLfloat calcPartialFlux(const GLfloat ql[3],const GLfloat qr[3],GLfloat b,GLfloat g,GLfloat epsilon,GLfloat maxPropagationSpeed,GLfloat flux[3])
+	{
+	/*********************************************************************
+	Calculate the flux across a face between the left-side quantity ql and
+	the right-side quantity qr, each given as (water level, discharge
+	normal to the face, discharge tangential to the face), and return the
+	larger absolute local speed of propagation.
+	*********************************************************************/
+	
+	/* Calculate one-sided water column heights: */
+	GLfloat hl=Math::max(ql[0]-b,0.0f);
+	GLfloat hr=Math::max(qr[0]-b,0.0f);
+	
+	/* Calculate one-sided velocities using a desingularizing division operator, and recalculate discharges based on desingularized velocities: */
+	GLfloat hl4=hl*hl*hl*hl;
+	GLfloat fl=1.41421356237309f*hl/Math::sqrt(hl4+Math::max(hl4,epsilon));
+	GLfloat unl=ql[1]*fl;
+	GLfloat utl=ql[2]*fl;
+	GLfloat nl=unl*hl;
+	GLfloat tl=utl*hl;
+	GLfloat hr4=hr*hr*hr*hr;
+	GLfloat fr=1.41421356237309f*hr/Math::sqrt(hr4+Math::max(hr4,epsilon));
+	GLfloat unr=qr[1]*fr;
+	GLfloat utr=qr[2]*fr;
+	GLfloat nr=unr*hr;
+	GLfloat tr=utr*hr;
+	
+	/* Calculate one-sided local speeds of propagation, limited to guarantee minimum step size: */
+	GLfloat sghl=Math::sqrt(g*hl);
+	GLfloat sghr=Math::sqrt(g*hr);
+	GLfloat aMinus=Math::min(Math::max(Math::min(unl-sghl,unr-sghr),-maxPropagationSpeed),0.0f); // aMinus is always <=0.0
+	GLfloat aPlus=Math::min(Math::max(Math::max(unl+sghl,unr+sghr),0.0f),maxPropagationSpeed); // aPlus is always >=0.0
+	
+	/* Calculate the complete flux from the one-sided flux quadratures: */
+	GLfloat aDiff=aPlus-aMinus;
+	if(aDiff!=0.0f)
+		{
+		GLfloat aProd=aPlus*aMinus;
+		flux[0]=((nl*aPlus-nr*aMinus)+(qr[0]-ql[0])*aProd)/aDiff;
+		flux[1]=(((unl*nl+0.5f*g*hl*hl)*aPlus-(unr*nr+0.5f*g*hr*hr)*aMinus)+(nr-nl)*aProd)/aDiff;
+		flux[2]=((utl*nl*aPlus-utr*nr*aMinus)+(tr-tl)*aProd)/aDiff;
+		}
+	else
+		flux[0]=flux[1]=flux[2]=0.0f;
+	
+	return Math::max(-aMinus,aPlus);
+	}
+
+inline GLfloat calcRunFlux(int face,const GLfloat* const ql[3],const GLfloat* const qr[3],const GLfloat* b,GLfloat g,GLfloat epsilon,GLfloat maxPropagationSpeed,GLfloat* const flux[3]) // Calculates the flux across one face of a run of faces
+	{
+	GLfloat fql[3]={ql[0][face],ql[1][face],ql[2][face]};
+	GLfloat fqr[3]={qr[0][face],qr[1][face],qr[2][face]};
+	GLfloat fFlux[3];
+	GLfloat speed=calcPartialFlux(fql,fqr,b[face],g,epsilon,maxPropagationSpeed,fFlux);
+	for(int i=0;i<3;++i)
+		flux[i][face]=fFlux[i];
+	
+	return speed;
+	}
+
+inline GLfloat smoothstep(GLfloat edge0,GLfloat edge1,GLfloat x) // Same as the GLSL function of the same name
+	{
+	GLfloat t=Math::min(Math::max((x-edge0)/(edge1-edge0),0.0f),1.0f);
+	return t*t*(3.0f-2.0f*t);
+	}
+
+inline void appendRun(std::vector<int>& runs,int begin,int end) // Appends the given half-open index range to the given list of runs, merging it with the last run if adjacent
+	{
+	if(!runs.empty()&&runs.back()==begin)
+		runs.back()=end;
+	else
+		{
+		runs.push_back(begin);
+		runs.push_back(end);
+		}
+	}
+
+/*********************************************************************
+Flux kernels calculate the partial fluxes across a run of faces from
+the left- and right-side quantities (water level, discharge normal to
+the face, discharge tangential to the face) and the bathymetry of each
+face, store the fluxes in the same component order, and return the
+largest absolute local speed of propagation along the run.
+*********************************************************************/
+
+typedef GLfloat (*FluxKernel)(int numFaces,const GLfloat* const ql[3],const GLfloat* const qr[3],const GLfloat* b,GLfloat g,GLfloat epsilon,GLfloat maxPropagationSpeed,GLfloat* const flux[3]);
+
+/**************
+Scalar kernel:
+**************/
+
+GLfloat fluxKernelScalar(int numFaces,const GLfloat* const ql[3],const GLfloat* const qr[3],const GLfloat* b,GLfloat g,GLfloat epsilon,GLfloat maxPropagationSpeed,GLfloat* const flux[3])
+	{
+	GLfloat maxSpeed=0.0f;
+	for(int face=0;face<numFaces;++face)
+		maxSpeed=Math::max(maxSpeed,calcRunFlux(face,ql,qr,b,g,epsilon,maxPropagationSpeed,flux));
+	return maxSpeed;
+	}
+
+bool isScalarSupported(void)
+	{
+	return true;
+	}
+
+#if CPUWATERTABLE2_X86
+
+/*********************************************************************
+The SIMD kernels below replicate calcPartialFlux operation by
+operation, without fused multiply-adds and in the same evaluation
+order. Square roots and divisions are correctly rounded, and the
+min/max instructions return their second operand unless the first is
+strictly smaller/larger, like Math::min/max. The kernels' results are
+therefore bit-identical to the scalar kernel's. Faces with a zero
+speed difference divide by one and mask the result to zero instead of
+branching around the division.
+*********************************************************************/
+
+/*****************
+SSE4.1 kernel:
+*****************/
+
+__attribute__((target("sse4.1")))
+GLfloat fluxKernelSSE41(int numFaces,const GLfloat* const ql[3],const GLfloat* const qr[3],const GLfloat* b,GLfloat g,GLfloat epsilon,GLfloat maxPropagationSpeed,GLfloat* const flux[3])
+	{
+	/* Broadcast the simulation parameters: */
+	__m128 zero=_mm_setzero_ps();
+	__m128 one=_mm_set1_ps(1.0f);
+	__m128 signMask=_mm_set1_ps(-0.0f);
+	__m128 sqrt2=_mm_set1_ps(1.41421356237309f);
+	__m128 vg=_mm_set1_ps(g);
+	__m128 halfG=_mm_set1_ps(0.5f*g);
+	__m128 eps=_mm_set1_ps(epsilon);
+	__m128 maxSpeed=_mm_set1_ps(maxPropagationSpeed);
+	__m128 negMaxSpeed=_mm_set1_ps(-maxPropagationSpeed);
+	__m128 runMaxSpeed=zero;
+	
+	/* Process the run four faces at a time: */
+	int face;
+	for(face=0;face+4<=numFaces;face+=4)
+		{
+		__m128 vb=_mm_loadu_ps(b+face);
+		__m128 ql0=_mm_loadu_ps(ql[0]+face);
+		__m128 qr0=_mm_loadu_ps(qr[0]+face);
+		
+		/* Calculate one-sided water column heights: */
+		__m128 hl=_mm_max_ps(_mm_sub_ps(ql0,vb),zero);
+		__m128 hr=_mm_max_ps(_mm_sub_ps(qr0,vb),zero);
+		
+		/* Calculate one-sided velocities using a desingularizing division operator, and recalculate discharges based on desingularized velocities: */
+		__m128 hl4=_mm_mul_ps(_mm_mul_ps(_mm_mul_ps(hl,hl),hl),hl);
+		__m128 fl=_mm_div_ps(_mm_mul_ps(sqrt2,hl),_mm_sqrt_ps(_mm_add_ps(hl4,_mm_max_ps(hl4,eps))));
+		__m128 unl=_mm_mul_ps(_mm_loadu_ps(ql[1]+face),fl);
+		__m128 utl=_mm_mul_ps(_mm_loadu_ps(ql[2]+face),fl);
+		__m128 nl=_mm_mul_ps(unl,hl);
+		__m128 tl=_mm_mul_ps(utl,hl);
+		__m128 hr4=_mm_mul_ps(_mm_mul_ps(_mm_mul_ps(hr,hr),hr),hr);
+		__m128 fr=_mm_div_ps(_mm_mul_ps(sqrt2,hr),_mm_sqrt_ps(_mm_add_ps(hr4,_mm_max_ps(hr4,eps))));
+		__m128 unr=_mm_mul_ps(_mm_loadu_ps(qr[1]+face),fr);
+		__m128 utr=_mm_mul_ps(_mm_loadu_ps(qr[2]+face),fr);
+		__m128 nr=_mm_mul_ps(unr,hr);
+		__m128 tr=_mm_mul_ps(utr,hr);
+		
+		/* Calculate one-sided local speeds of propagation, limited to guarantee minimum step size: */
+		__m128 sghl=_mm_sqrt_ps(_mm_mul_ps(vg,hl));
+		__m128 sghr=_mm_sqrt_ps(_mm_mul_ps(vg,hr));
+		__m128 aMinus=_mm_min_ps(_mm_max_ps(_mm_min_ps(_mm_sub_ps(unl,sghl),_mm_sub_ps(unr,sghr)),negMaxSpeed),zero);
+		__m128 aPlus=_mm_min_ps(_mm_max_ps(_mm_max_ps(_mm_add_ps(unl,sghl),_mm_add_ps(unr,sghr)),zero),maxSpeed);
+		
+		/* Calculate the complete flux from the one-sided flux quadratures: */
+		__m128 aDiff=_mm_sub_ps(aPlus,aMinus);
+		__m128 moving=_mm_cmpneq_ps(aDiff,zero);
+		__m128 divisor=_mm_blendv_ps(one,aDiff,moving);
+		__m128 aProd=_mm_mul_ps(aPlus,aMinus);
+		__m128 f0=_mm_add_ps(_mm_sub_ps(_mm_mul_ps(nl,aPlus),_mm_mul_ps(nr,aMinus)),_mm_mul_ps(_mm_sub_ps(qr0,ql0),aProd));
+		_mm_storeu_ps(flux[0]+face,_mm_and_ps(_mm_div_ps(f0,divisor),moving));
+		__m128 pl=_mm_add_ps(_mm_mul_ps(unl,nl),_mm_mul_ps(_mm_mul_ps(halfG,hl),hl));
+		__m128 pr=_mm_add_ps(_mm_mul_ps(unr,nr),_mm_mul_ps(_mm_mul_ps(halfG,hr),hr));
+		__m128 f1=_mm_add_ps(_mm_sub_ps(_mm_mul_ps(pl,aPlus),_mm_mul_ps(pr,aMinus)),_mm_mul_ps(_mm_sub_ps(nr,nl),aProd));
+		_mm_storeu_ps(flux[1]+face,_mm_and_ps(_mm_div_ps(f1,divisor),moving));
+		__m128 f2=_mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(utl,nl),aPlus),_mm_mul_ps(_mm_mul_ps(utr,nr),aMinus)),_mm_mul_ps(_mm_sub_ps(tr,tl),aProd));
+		_mm_storeu_ps(flux[2]+face,_mm_and_ps(_mm_div_ps(f2,divisor),moving));
+		
+		/* Update the run's maximum propagation speed: */
+		runMaxSpeed=_mm_max_ps(runMaxSpeed,_mm_max_ps(_mm_xor_ps(aMinus,signMask),aPlus));
+		}
+	
+	/* Reduce the maximum propagation speed and process the remaining faces: */
+	GLfloat speeds[4];
+	_mm_storeu_ps(speeds,runMaxSpeed);
+	GLfloat result=Math::max(Math::max(speeds[0],speeds[1]),Math::max(speeds[2],speeds[3]));
+	for(;face<numFaces;++face)
+		result=Math::max(result,calcRunFlux(face,ql,qr,b,g,epsilon,maxPropagationSpeed,flux));
+	return result;
+	}
+
+bool isSSE41Supported(void)
+	{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.1");
+	}
+
+/*************
+AVX kernel:
+*************/
+
+__attribute__((target("avx")))
+GLfloat fluxKernelAVX(int numFaces,const GLfloat* const ql[3],const GLfloat* const qr[3],const GLfloat* b,GLfloat g,GLfloat epsilon,GLfloat maxPropagationSpeed,GLfloat* const flux[3])
+	{
+	/* Broadcast the simulation parameters: */
+	__m256 zero=_mm256_setzero_ps();
+	__m256 one=_mm256_set1_ps(1.0f);
+	__m256 signMask=_mm256_set1_ps(-0.0f);
+	__m256 sqrt2=_mm256_set1_ps(1.41421356237309f);
+	__m256 vg=_mm256_set1_ps(g);
+	__m256 halfG=_mm256_set1_ps(0.5f*g);
+	__m256 eps=_mm256_set1_ps(epsilon);
+	__m256 maxSpeed=_mm256_set1_ps(maxPropagationSpeed);
+	__m256 negMaxSpeed=_mm256_set1_ps(-maxPropagationSpeed);
+	__m256 runMaxSpeed=zero;
+	
+	/* Process the run eight faces at a time: */
+	int face;
+	for(face=0;face+8<=numFaces;face+=8)
+		{
+		__m256 vb=_mm256_loadu_ps(b+face);
+		__m256 ql0=_mm256_loadu_ps(ql[0]+face);
+		__m256 qr0=_mm256_loadu_ps(qr[0]+face);
+		
+		/* Calculate one-sided water column heights: */
+		__m256 hl=_mm256_max_ps(_mm256_sub_ps(ql0,vb),zero);
+		__m256 hr=_mm256_max_ps(_mm256_sub_ps(qr0,vb),zero);
+		
+		/* Calculate one-sided velocities using a desingularizing division operator, and recalculate discharges based on desingularized velocities: */
+		__m256 hl4=_mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(hl,hl),hl),hl);
+		__m256 fl=_mm256_div_ps(_mm256_mul_ps(sqrt2,hl),_mm256_sqrt_ps(_mm256_add_ps(hl4,_mm256_max_ps(hl4,eps))));
+		__m256 unl=_mm256_mul_ps(_mm256_loadu_ps(ql[1]+face),fl);
+		__m256 utl=_mm256_mul_ps(_mm256_loadu_ps(ql[2]+face),fl);
+		__m256 nl=_mm256_mul_ps(unl,hl);
+		__m256 tl=_mm256_mul_ps(utl,hl);
+		__m256 hr4=_mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(hr,hr),hr),hr);
+		__m256 fr=_mm256_div_ps(_mm256_mul_ps(sqrt2,hr),_mm256_sqrt_ps(_mm256_add_ps(hr4,_mm256_max_ps(hr4,eps))));
+		__m256 unr=_mm256_mul_ps(_mm256_loadu_ps(qr[1]+face),fr);
+		__m256 utr=_mm256_mul_ps(_mm256_loadu_ps(qr[2]+face),fr);
+		__m256 nr=_mm256_mul_ps(unr,hr);
+		__m256 tr=_mm256_mul_ps(utr,hr);
+		
+		/* Calculate one-sided local speeds of propagation, limited to guarantee minimum step size: */
+		__m256 sghl=_mm256_sqrt_ps(_mm256_mul_ps(vg,hl));
+		__m256 sghr=_mm256_sqrt_ps(_mm256_mul_ps(vg,hr));
+		__m256 aMinus=_mm256_min_ps(_mm256_max_ps(_mm256_min_ps(_mm256_sub_ps(unl,sghl),_mm256_sub_ps(unr,sghr)),negMaxSpeed),zero);
+		__m256 aPlus=_mm256_min_ps(_mm256_max_ps(_mm256_max_ps(_mm256_add_ps(unl,sghl),_mm256_add_ps(unr,sghr)),zero),maxSpeed);
+		
+		/* Calculate the complete flux from the one-sided flux quadratures: */
+		__m256 aDiff=_mm256_sub_ps(aPlus,aMinus);
+		__m256 moving=_mm256_cmp_ps(aDiff,zero,_CMP_NEQ_UQ);
+		__m256 divisor=_mm256_blendv_ps(one,aDiff,moving);
+		__m256 aProd=_mm256_mul_ps(aPlus,aMinus);
+		__m256 f0=_mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(nl,aPlus),_mm256_mul_ps(nr,aMinus)),_mm256_mul_ps(_mm256_sub_ps(qr0,ql0),aProd));
+		_mm256_storeu_ps(flux[0]+face,_mm256_and_ps(_mm256_div_ps(f0,divisor),moving));
+		__m256 pl=_mm256_add_ps(_mm256_mul_ps(unl,nl),_mm256_mul_ps(_mm256_mul_ps(halfG,hl),hl));
+		__m256 pr=_mm256_add_ps(_mm256_mul_ps(unr,nr),_mm256_mul_ps(_mm256_mul_ps(halfG,hr),hr));
+		__m256 f1=_mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(pl,aPlus),_mm256_mul_ps(pr,aMinus)),_mm256_mul_ps(_mm256_sub_ps(nr,nl),aProd));
+		_mm256_storeu_ps(flux[1]+face,_mm256_and_ps(_mm256_div_ps(f1,divisor),moving));
+		__m256 f2=_mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(utl,nl),aPlus),_mm256_mul_ps(_mm256_mul_ps(utr,nr),aMinus)),_mm256_mul_ps(_mm256_sub_ps(tr,tl),aProd));
+		_mm256_storeu_ps(flux[2]+face,_mm256_and_ps(_mm256_div_ps(f2,divisor),moving));
+		
+		/* Update the run's maximum propagation speed: */
+		runMaxSpeed=_mm256_max_ps(runMaxSpeed,_mm256_max_ps(_mm256_xor_ps(aMinus,signMask),aPlus));
+		}
+	
+	/* Reduce the maximum propagation speed and process the remaining faces: */
+	GLfloat speeds[8];
+	_mm256_storeu_ps(speeds,runMaxSpeed);
+	GLfloat result=0.0f;
+	for(int i=0;i<8;++i)
+		result=Math::max(result,speeds[i]);
+	for(;face<numFaces;++face)
+		result=Math::max(result,calcRunFlux(face,ql,qr,b,g,epsilon,maxPropagationSpeed,flux));
+	return result;
+	}
+
+bool isAVXSupported(void)
+	{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx");
+	}
+
+#endif
+
+/*******************************
+Table of compiled-in kernels:
+*******************************/
+
+struct FluxKernelEntry // Structure describing a flux kernel
+	{
+	/* Elements: */
+	public:
+	const char* name; // Kernel name for command lines and reports
+	FluxKernel kernel; // Kernel function
+	bool (*isSupported)(void); // Function to check whether the current CPU can execute the kernel
+	};
+
+/* Kernels in order of increasing performance: */
+const FluxKernelEntry fluxKernels[]=
+	{
+	{"scalar",fluxKernelScalar,isScalarSupported}
+	#if CPUWATERTABLE2_X86
+	,{"sse4.1",fluxKernelSSE41,isSSE41Supported}
+	,{"avx",fluxKernelAVX,isAVXSupported}
+	#endif
+	};
+
+const unsigned int numFluxKernels=sizeof(fluxKernels)/sizeof(FluxKernelEntry);
+
+}
+
+/***************************************
+Static elements of class CpuWaterTable2:
+***************************************/
+
+const unsigned int CpuWaterTable2::bandHeight;
+
+/*******************************
+Methods of class CpuWaterTable2:
+*******************************/
+
+void CpuWaterTable2::init(void)
+	{
+	size_t numCells=size_t(size[1])*size_t(size[0]);
+	
+	/* Create a flat bathymetry at elevation zero: */
+	bathymetry.resize(size_t(size[1]-1)*size_t(size[0]-1),0.0f);
+	cellBathymetry.resize(numCells,0.0f);
+	xFaceBathymetry.resize(size_t(size[1])*size_t(size[0]+3),0.0f);
+	yFaceBathymetry.resize(size_t(size[1]+3)*size_t(size[0]),0.0f);
+	
+	/* Create dry conserved quantity grids and an empty snow pack: */
+	for(int i=0;i<3;++i)
+		{
+		quantity[i].resize(numCells,0.0f);
+		quantityStar[i].resize(numCells,0.0f);
+		}
+	snow.resize(numCells,0.0f);
+	
+	/* Initialize the property grid to the default roughness coefficient and absorption rate: */
+	properties[0].resize(numCells,0.01f);
+	properties[1].resize(numCells,0.0f);
+	
+	/* Create the flux grids: */
+	for(int i=0;i<3;++i)
+		{
+		xFlux[i].resize(size_t(size[1])*size_t(size[0]+1),0.0f);
+		yFlux[i].resize(size_t(size[1]+1)*size_t(size[0]),0.0f);
+		}
+	
+	/* Create scratch buffers for the bands of grid rows processed in parallel: */
+	numBands=(size[1]+bandHeight-1)/bandHeight;
+	rowBufferSize=size_t(size[0]+4)*3+size_t(size[0]+2)*6;
+	rowBuffers.resize(size_t(numBands)*rowBufferSize);
+	bandMaxSpeeds.resize(size_t(numBands)*2,0.0f);
+	
+	/* Create the tile flags; all tiles are initially dry and active: */
+	numTiles[0]=(size[0]+bandHeight-1)/bandHeight;
+	numTiles[1]=numBands;
+	size_t totalNumTiles=size_t(numTiles[1])*size_t(numTiles[0]);
+	tileWet.resize(totalNumTiles,0);
+	tileWetValid=true;
+	tileActive.resize(totalNumTiles,1);
+	numActiveTiles=(unsigned int)(totalNumTiles);
+	cellRuns.resize(numBands);
+	faceRuns.resize(numBands);
+	
+	/* Select the fastest flux kernel supported by the current CPU: */
+	setFluxKernel("auto");
+	}
+
+void CpuWaterTable2::updateTileWetness(void)
+	{
+	if(!tileWetValid)
+		{
+		/* Recalculate the tile wetness flags from the conserved quantities and the snow pack: */
+		int width=int(size[0]);
+		std::fill(tileWet.begin(),tileWet.end(),0);
+		for(int y=0;y<int(size[1]);++y)
+			{
+			unsigned char* wetRow=&tileWet[(y/bandHeight)*numTiles[0]];
+			size_t rowBase=size_t(y)*size_t(width);
+			for(int x=0;x<width;++x)
+				if(quantity[0][rowBase+x]-cellBathymetry[rowBase+x]>dryDepth||snow[rowBase+x]>0.0f)
+					wetRow[x/bandHeight]=1;
+			}
+		tileWetValid=true;
+		}
+	}
+
+void CpuWaterTable2::updateActiveTiles(void)
+	{
+	int tw=int(numTiles[0]);
+	int th=int(numTiles[1]);
+	
+	/* Simulate all tiles unless in sparse mode, or if water is deposited everywhere: */
+	if(sparse&&waterDeposit<=0.0f)
+		{
+		updateTileWetness();
+		
+		/* Activate all wet tiles, all tiles containing water sources, and all their neighbours: */
+		std::fill(tileActive.begin(),tileActive.end(),0);
+		for(int ty=0;ty<th;++ty)
+			for(int tx=0;tx<tw;++tx)
+				if(tileWet[ty*tw+tx]||(!tileSource.empty()&&tileSource[ty*tw+tx]))
+					{
+					for(int y=Math::max(ty-1,0);y<=Math::min(ty+1,th-1);++y)
+						for(int x=Math::max(tx-1,0);x<=Math::min(tx+1,tw-1);++x)
+							tileActive[y*tw+x]=1;
+					}
+		}
+	else
+		std::fill(tileActive.begin(),tileActive.end(),1);
+	
+	updateTileRuns();
+	
+	/*********************************************************************
+	Both integration steps reconstruct active cells from up to two cells
+	in inactive neighbouring tiles. Copy the conserved quantities of
+	inactive tiles bordering active tiles into the intermediate
+	quantities, so that the Runge-Kutta step reads the same values as the
+	Euler step.
+	*********************************************************************/
+	
+	if(numActiveTiles<numTiles[0]*numTiles[1])
+		{
+		int width=int(size[0]);
+		int height=int(size[1]);
+		for(int ty=0;ty<th;++ty)
+			for(int tx=0;tx<tw;++tx)
+				if(isHaloTile(tx,ty))
+					{
+					int x0=tx*int(bandHeight);
+					int x1=Math::min(x0+int(bandHeight),width);
+					int y1=Math::min((ty+1)*int(bandHeight),height);
+					for(int y=ty*int(bandHeight);y<y1;++y)
+						for(int i=0;i<3;++i)
+							{
+							const GLfloat* qRow=&quantity[i][size_t(y)*size_t(width)];
+							std::copy(qRow+x0,qRow+x1,&quantityStar[i][size_t(y)*size_t(width)+x0]);
+							}
+					}
+		}
+	}
+
+bool CpuWaterTable2::isHaloTile(int tileX,int tileY) const
+	{
+	int tw=int(numTiles[0]);
+	int th=int(numTiles[1]);
+	if(tileActive[tileY*tw+tileX])
+		return false;
+	
+	/* Check if the tile borders an active tile: */
+	for(int y=Math::max(tileY-1,0);y<=Math::min(tileY+1,th-1);++y)
+		for(int x=Math::max(tileX-1,0);x<=Math::min(tileX+1,tw-1);++x)
+			if(tileActive[y*tw+x])
+				return true;
+	return false;
+	}
+
+void CpuWaterTable2::updateTileRuns(void)
+	{
+	int width=int(size[0]);
+	int tw=int(numTiles[0]);
+	int th=int(numTiles[1]);
+	
+	/* Collect each band's runs of active cells, and its runs of bottom faces bordering active cells in the band or the band below: */
+	numActiveTiles=0;
+	for(int ty=0;ty<th;++ty)
+		{
+		const unsigned char* active=&tileActive[ty*tw];
+		const unsigned char* below=ty>0?active-tw:0;
+		cellRuns[ty].clear();
+		faceRuns[ty].clear();
+		for(int tx=0;tx<tw;++tx)
+			{
+			int x0=tx*int(bandHeight);
+			int x1=Math::min(x0+int(bandHeight),width);
+			if(active[tx])
+				{
+				++numActiveTiles;
+				appendRun(cellRuns[ty],x0,x1);
+				}
+			if(active[tx]||(below!=0&&below[tx]))
+				appendRun(faceRuns[ty],x0,x1);
+			}
+		}
+	}
+
+void CpuWaterTable2::calcFluxes(unsigned int jobIndex,void* userData)
+	{
+	CpuWaterTable2* thisPtr=static_cast<CpuWaterTable2*>(userData);
+	
+	/* Retrieve the band's range of grid rows and simulation parameters: */
+	int width=int(thisPtr->size[0]);
+	int height=int(thisPtr->size[1]);
+	int y0=int(jobIndex*bandHeight);
+	int y1=Math::min(y0+int(bandHeight),height);
+	const std::vector<GLfloat>* source=thisPtr->passSource;
+	GLfloat g=thisPtr->g;
+	GLfloat epsilon=thisPtr->epsilon;
+	GLfloat thetaOverCellSize[2],halfOverCellSize[2],halfCellSize[2];
+	for(int i=0;i<2;++i)
+		{
+		thetaOverCellSize[i]=thisPtr->theta/thisPtr->cellSize[i];
+		halfOverCellSize[i]=1.0f/(2.0f*thisPtr->cellSize[i]);
+		halfCellSize[i]=thisPtr->cellSize[i]*0.5f;
+		}
+	FluxKernel fluxKernel=fluxKernels[thisPtr->fluxKernel].kernel;
+	GLfloat maxSpeeds[2]={0.0f,0.0f};
+	
+	/* Split the band's scratch buffer into a padded row of conserved quantities and the east and west reconstructions of each cell: */
+	GLfloat* padded[3];
+	GLfloat* east[3];
+	GLfloat* west[3];
+	GLfloat* bufPtr=&thisPtr->rowBuffers[jobIndex*thisPtr->rowBufferSize];
+	for(int i=0;i<3;++i,bufPtr+=width+4)
+		padded[i]=bufPtr;
+	for(int i=0;i<3;++i,bufPtr+=(width+2)*2)
+		{
+		east[i]=bufPtr;
+		west[i]=bufPtr+(width+2);
+		}
+	
+	/*********************************************************************
+	Calculate fluxes across the vertical faces of the band's grid rows.
+	Face x lies between cells x-1 and x; cells outside the grid are
+	clamped to the grid's edges, in the same way as the GPU's texture
+	samplers clamp texture coordinates.
+	*********************************************************************/
+	
+	const std::vector<int>& cellRuns=thisPtr->cellRuns[jobIndex];
+	for(int y=y0;y<y1;++y)
+		{
+		const GLfloat* bx=&thisPtr->xFaceBathymetry[y*(width+3)]; // bx[x+1] is the bathymetry of face x
+		size_t fluxBase=size_t(y)*size_t(width+1);
+		for(std::vector<int>::const_iterator rIt=cellRuns.begin();rIt!=cellRuns.end();rIt+=2)
+			{
+			int xBegin=rIt[0];
+			int xEnd=rIt[1];
+			
+			/* Copy the run of cells into the padded row, with two clamped ghost cells on either side: */
+			for(int i=0;i<3;++i)
+				{
+				const GLfloat* sRow=&source[i][y*width];
+				for(int x=xBegin-2;x<xEnd+2;++x)
+					padded[i][x+2]=sRow[clampIndex(x,width-1)];
+				}
+			
+			/* Reconstruct the east and west face values of cells xBegin-1 to xEnd: */
+			for(int x=xBegin;x<xEnd+2;++x)
+				{
+				GLfloat slope=calcLevelSlope(padded[0][x],padded[0][x+1],padded[0][x+2],thetaOverCellSize[0],halfOverCellSize[0],halfCellSize[0],bx[x],bx[x+1]);
+				east[0][x]=padded[0][x+1]+slope*halfCellSize[0];
+				west[0][x]=padded[0][x+1]-slope*halfCellSize[0];
+				}
+			for(int i=1;i<3;++i)
+				for(int x=xBegin;x<xEnd+2;++x)
+					{
+					GLfloat slope=calcMinmodSlope(padded[i][x],padded[i][x+1],padded[i][x+2],thetaOverCellSize[0],halfOverCellSize[0]);
+					east[i][x]=padded[i][x+1]+slope*halfCellSize[0];
+					west[i][x]=padded[i][x+1]-slope*halfCellSize[0];
+					}
+			
+			/* Calculate the fluxes across faces xBegin to xEnd: */
+			const GLfloat* ql[3]={east[0]+xBegin,east[1]+xBegin,east[2]+xBegin};
+			const GLfloat* qr[3]={west[0]+xBegin+1,west[1]+xBegin+1,west[2]+xBegin+1};
+			GLfloat* flux[3];
+			for(int i=0;i<3;++i)
+				flux[i]=&thisPtr->xFlux[i][fluxBase+xBegin];
+			maxSpeeds[0]=Math::max(maxSpeeds[0],fluxKernel(xEnd+1-xBegin,ql,qr,bx+xBegin+1,g,epsilon,thisPtr->maxPropagationSpeed[0],flux));
+			}
+		}
+	
+	/*********************************************************************
+	Calculate fluxes across the horizontal faces of the band's grid rows,
+	and across the top face of the grid if this is the last band. Face y
+	lies between grid rows y-1 and y. The band's bottom faces also border
+	the band below, and are calculated wherever either band is active.
+	*********************************************************************/
+	
+	int faceY1=y1<height?y1:height+1;
+	for(int y=y0;y<faceY1;++y)
+		{
+		const std::vector<int>& runs=y==y0?thisPtr->faceRuns[jobIndex]:cellRuns;
+		
+		/* Get pointers to the grid rows on which the face's north and south reconstructions depend: */
+		const GLfloat* rows[4][3];
+		for(int j=0;j<4;++j)
+			for(int i=0;i<3;++i)
+				rows[j][i]=&source[i][clampIndex(y-2+j,height-1)*width];
+		const GLfloat* by0=&thisPtr->yFaceBathymetry[y*width]; // Bathymetry of face y-1
+		const GLfloat* by1=by0+width; // Bathymetry of face y
+		const GLfloat* by2=by1+width; // Bathymetry of face y+1
+		
+		size_t fluxBase=size_t(y)*size_t(width);
+		for(std::vector<int>::const_iterator rIt=runs.begin();rIt!=runs.end();rIt+=2)
+			{
+			int xBegin=rIt[0];
+			int xEnd=rIt[1];
+			
+			/* Reconstruct the north face values of grid row y-1 into the east buffers and the south face values of grid row y into the west buffers, swapping discharges to make hv normal to the face: */
+			for(int x=xBegin;x<xEnd;++x)
+				{
+				east[0][x-xBegin]=rows[1][0][x]+calcLevelSlope(rows[0][0][x],rows[1][0][x],rows[2][0][x],thetaOverCellSize[1],halfOverCellSize[1],halfCellSize[1],by0[x],by1[x])*halfCellSize[1];
+				west[0][x-xBegin]=rows[2][0][x]-calcLevelSlope(rows[1][0][x],rows[2][0][x],rows[3][0][x],thetaOverCellSize[1],halfOverCellSize[1],halfCellSize[1],by1[x],by2[x])*halfCellSize[1];
+				}
+			for(int i=1;i<3;++i)
+				for(int x=xBegin;x<xEnd;++x)
+					{
+					east[3-i][x-xBegin]=rows[1][i][x]+calcMinmodSlope(rows[0][i][x],rows[1][i][x],rows[2][i][x],thetaOverCellSize[1],halfOverCellSize[1])*halfCellSize[1];
+					west[3-i][x-xBegin]=rows[2][i][x]-calcMinmodSlope(rows[1][i][x],rows[2][i][x],rows[3][i][x],thetaOverCellSize[1],halfOverCellSize[1])*halfCellSize[1];
+					}
+			
+			/* Calculate the fluxes across the run of faces, swapping the discharge components back: */
+			const GLfloat* ql[3]={east[0],east[1],east[2]};
+			const GLfloat* qr[3]={west[0],west[1],west[2]};
+			GLfloat* flux[3]={&thisPtr->yFlux[0][fluxBase+xBegin],&thisPtr->yFlux[2][fluxBase+xBegin],&thisPtr->yFlux[1][fluxBase+xBegin]};
+			maxSpeeds[1]=Math::max(maxSpeeds[1],fluxKernel(xEnd-xBegin,ql,qr,by1+xBegin,g,epsilon,thisPtr->maxPropagationSpeed[1],flux));
+			}
+		}
+	
+	/* Store the band's maximum propagation speeds: */
+	for(int i=0;i<2;++i)
+		thisPtr->bandMaxSpeeds[jobIndex*2+i]=maxSpeeds[i];
+	}
+
+void CpuWaterTable2::integrate(unsigned int jobIndex,void* userData)
+	{
+	CpuWaterTable2* thisPtr=static_cast<CpuWaterTable2*>(userData);
+	
+	/* Retrieve the band's range of grid rows and simulation parameters: */
+	int width=int(thisPtr->size[0]);
+	int height=int(thisPtr->size[1]);
+	int y0=int(jobIndex*bandHeight);
+	int y1=Math::min(y0+int(bandHeight),height);
+	const std::vector<GLfloat>* source=thisPtr->passSource;
+	std::vector<GLfloat>* dest=thisPtr->passFinal?thisPtr->quantity:thisPtr->quantityStar;
+	bool engineering=thisPtr->mode==WaterTable2::Engineering;
+	GLfloat g=thisPtr->g;
+	GLfloat epsilon=thisPtr->epsilon;
+	GLfloat invCellSize[2];
+	for(int i=0;i<2;++i)
+		invCellSize[i]=1.0f/thisPtr->cellSize[i];
+	GLfloat stepSize=thisPtr->passStepSize;
+	GLfloat attenuation=thisPtr->passAttenuation;
+	GLfloat deposit=thisPtr->waterDeposit*stepSize;
+	GLfloat maxSnowMelt=thisPtr->snowMelt*stepSize;
+	const std::vector<int>& cellRuns=thisPtr->cellRuns[jobIndex];
+	
+	/* Track the wetness of the band's active tiles during the final integration step in sparse mode: */
+	unsigned char* wetRow=0;
+	GLfloat dryDepth=thisPtr->dryDepth;
+	if(thisPtr->sparse&&thisPtr->passFinal)
+		{
+		wetRow=&thisPtr->tileWet[jobIndex*thisPtr->numTiles[0]];
+		for(std::vector<int>::const_iterator rIt=cellRuns.begin();rIt!=cellRuns.end();rIt+=2)
+			for(int tx=rIt[0]/int(bandHeight);tx*int(bandHeight)<rIt[1];++tx)
+				wetRow[tx]=0;
+		}
+	
+	for(int y=y0;y<y1;++y)
+		{
+		const GLfloat* bx=&thisPtr->xFaceBathymetry[y*(width+3)+1]; // bx[x] and bx[x+1] are the bathymetry of the cell's west and east faces
+		const GLfloat* by0=&thisPtr->yFaceBathymetry[(y+1)*width]; // by0[x] is the bathymetry of the cell's south face
+		const GLfloat* by1=by0+width; // by1[x] is the bathymetry of the cell's north face
+		size_t rowBase=size_t(y)*size_t(width);
+		size_t xFluxBase=size_t(y)*size_t(width+1);
+		bool boundaryRow=thisPtr->dryBoundary&&(y==0||y==height-1);
+		for(std::vector<int>::const_iterator rIt=cellRuns.begin();rIt!=cellRuns.end();rIt+=2)
+			for(int x=rIt[0];x<rIt[1];++x)
+				{
+				size_t index=rowBase+x;
+				GLfloat q[3];
+				for(int i=0;i<3;++i)
+					q[i]=source[i][index];
+				
+				/* Calculate the water column height at the cell center: */
+				GLfloat h=Math::max(q[0]-(bx[x]+bx[x+1])*0.5f,0.0f);
+				
+				/* Calculate equation source terms at the cell center: */
+				GLfloat qt[3];
+				qt[0]=0.0f;
+				qt[1]=-g*h*(bx[x+1]-bx[x])*invCellSize[0];
+				qt[2]=-g*h*(by1[x]-by0[x])*invCellSize[1];
+				if(engineering)
+					{
+					/* Calculate bed friction and absorption: */
+					GLfloat cz=Math::pow(h,1.0f/6.0f)/thisPtr->properties[0][index];
+					GLfloat h4=h*h*h*h;
+					GLfloat f=1.41421356237309f*h/Math::sqrt(h4+Math::max(h4,epsilon));
+					GLfloat u=q[1]*f;
+					GLfloat v=q[2]*f;
+					GLfloat vcz2=Math::sqrt(u*u+v*v)/Math::max(cz*cz,epsilon*0.01f);
+					qt[0]-=thisPtr->properties[1][index];
+					qt[1]-=g*u*vcz2;
+					qt[2]-=g*v*vcz2;
+					}
+				
+				/* Calculate the temporal derivative: */
+				for(int i=0;i<3;++i)
+					qt[i]-=(thisPtr->xFlux[i][xFluxBase+x+1]-thisPtr->xFlux[i][xFluxBase+x])*invCellSize[0]+(thisPtr->yFlux[i][index+width]-thisPtr->yFlux[i][index])*invCellSize[1];
+				
+				/* Perform the Euler or Runge-Kutta integration step: */
+				GLfloat newQ[3];
+				if(thisPtr->passFinal)
+					{
+					for(int i=0;i<3;++i)
+						newQ[i]=(thisPtr->quantity[i][index]+q[i]+qt[i]*stepSize)*0.5f;
+					}
+				else
+					{
+					for(int i=0;i<3;++i)
+						newQ[i]=q[i]+qt[i]*stepSize;
+					}
+				newQ[1]*=attenuation;
+				newQ[2]*=attenuation;
+				
+				/* Enforce dry boundary conditions on the outermost layer of cells: */
+				if(thisPtr->passFinal&&(boundaryRow||(thisPtr->dryBoundary&&(x==0||x==width-1))))
+					{
+					newQ[0]=thisPtr->cellBathymetry[index];
+					newQ[1]=newQ[2]=0.0f;
+					}
+				
+				if(thisPtr->passUpdateWater)
+					{
+					/* Calculate the effective changes in water and snow level: */
+					GLfloat b=thisPtr->cellBathymetry[index];
+					GLfloat s=thisPtr->snow[index];
+					GLfloat hOld=newQ[0]-b;
+					GLfloat precip=deposit;
+					if(!thisPtr->waterSource.empty())
+						precip+=thisPtr->waterSource[index]*stepSize;
+					GLfloat dWater=precip;
+					GLfloat dSnow=precip*4.0f; // Snow is four times fluffier than water
+					
+					/* Make it rain or snow depending on bathymetry elevation: */
+					if(precip>0.0f)
+						{
+						GLfloat waterSnowFactor=smoothstep(thisPtr->snowLine-0.25f,thisPtr->snowLine+0.25f,b);
+						dWater=dWater*(1.0f-waterSnowFactor);
+						dSnow=dSnow*waterSnowFactor;
+						}
+					
+					/* Melt snow into water: */
+					GLfloat melt=Math::min(maxSnowMelt,s);
+					dSnow-=melt;
+					dWater+=melt/4.0f; // Snow is four times fluffier than water
+					
+					/* Update the snow height: */
+					thisPtr->snow[index]=Math::max(s+dSnow,0.0f);
+					
+					/* Update the conserved quantities: */
+					if(dWater>=0.0f)
+						{
+						/* Update the water surface level, and leave the partial discharges alone, as new water is added with zero velocity: */
+						newQ[0]=(hOld+dWater)+b;
+						}
+					else
+						{
+						/* Update the water surface height and the partial discharges, as water is removed at current velocity: */
+						GLfloat hNew=Math::max(hOld+dWater,0.0f);
+						newQ[0]=hNew+b;
+						GLfloat scale=hOld>0.0f?hNew/hOld:0.0f;
+						newQ[1]*=scale;
+						newQ[2]*=scale;
+						}
+					}
+				
+				/* Store the new conserved quantities: */
+				for(int i=0;i<3;++i)
+					dest[i][index]=newQ[i];
+				
+				if(wetRow!=0&&(newQ[0]-thisPtr->cellBathymetry[index]>dryDepth||thisPtr->snow[index]>0.0f))
+					wetRow[x/bandHeight]=1;
+				}
+		}
+	}
+
+void CpuWaterTable2::runFluxPass(const std::vector<GLfloat>* source)
+	{
+	/* Calculate partial fluxes across all cell faces of active tiles: */
+	passSource=source;
+	simulationPool.runJobs(numBands,&CpuWaterTable2::calcFluxes,this);
+	}
+
+GLfloat CpuWaterTable2::calcStepSize(void) const
+	{
+	/* Gather the maximum propagation speeds in x and y from all bands: */
+	GLfloat maxSpeeds[2]={0.0f,0.0f};
+	for(unsigned int band=0;band<numBands;++band)
+		for(int i=0;i<2;++i)
+			maxSpeeds[i]=Math::max(maxSpeeds[i],bandMaxSpeeds[band*2+i]);
+	
+	/* Calculate the maximum step size and limit it to the client-specified range: */
+	GLfloat stepSize=maxStepSize;
+	for(int i=0;i<2;++i)
+		if(maxSpeeds[i]>0.0f)
+			stepSize=Math::min(stepSize,0.5f*cellSize[i]/maxSpeeds[i]);
+	
+	return stepSize;
+	}
+
+void CpuWaterTable2::runIntegrationPass(GLfloat stepSize,bool final)
+	{
+	/* Calculate temporal derivatives and perform the integration step on all active tiles: */
+	passSource=final?quantityStar:quantity;
+	passFinal=final;
+	passStepSize=stepSize;
+	passAttenuation=mode==WaterTable2::Traditional?Math::pow(attenuation,stepSize):1.0f;
+	passUpdateWater=final&&(waterDeposit!=0.0f||!waterSource.empty());
+	simulationPool.runJobs(numBands,&CpuWaterTable2::integrate,this);
+	}
+
+CpuWaterTable2::CpuWaterTable2(const Size& sSize,const GLfloat sCellSize[2],unsigned int numThreads)
+	:size(sSize),
+	 mode(WaterTable2::Traditional),
+	 dryBoundary(true),sparse(false),dryDepth(0.0f),
+	 simulationPool(numThreads)
+	{
+	/* Initialize the water table cell size: */
+	for(int i=0;i<2;++i)
+		cellSize[i]=sCellSize[i];
+	
+	/* Initialize simulation parameters in the same way as WaterTable2: */
+	theta=1.3f;
+	g=9.81f;
+	epsilon=0.01f*Math::max(Math::max(cellSize[0],cellSize[1]),1.0f);
+	maxPropagationSpeed[1]=maxPropagationSpeed[0]=1.0e10; // Ridiculously large
+	attenuation=127.0f/128.0f;
+	maxStepSize=1.0f;
+	snowLine=1000.0f;
+	snowMelt=0.1f;
+	waterDeposit=0.0f;
+	
+	/* Allocate all grids: */
+	init();
+	}
+
+CpuWaterTable2::CpuWaterTable2(const WaterTable2& waterTable,unsigned int numThreads)
+	:size(waterTable.size),
+	 theta(waterTable.theta),g(waterTable.g),epsilon(waterTable.epsilon),
+	 mode(waterTable.mode),attenuation(waterTable.attenuation),maxStepSize(waterTable.maxStepSize),
+	 snowLine(waterTable.snowLine),snowMelt(waterTable.snowMelt),waterDeposit(waterTable.waterDeposit),
+	 dryBoundary(waterTable.dryBoundary),sparse(false),dryDepth(0.0f),
+	 simulationPool(numThreads)
+	{
+	/* Copy the water table's cell size and maximum propagation speeds: */
+	for(int i=0;i<2;++i)
+		{
+		cellSize[i]=waterTable.cellSize[i];
+		maxPropagationSpeed[i]=waterTable.maxPropagationSpeed[i];
+		}
+	
+	/* Allocate all grids: */
+	init();
+	}
+
+void CpuWaterTable2::setMode(WaterTable2::Mode newMode)
+	{
+	mode=newMode;
+	}
+
+void CpuWaterTable2::setAttenuation(GLfloat newAttenuation)
+	{
+	attenuation=newAttenuation;
+	}
+
+void CpuWaterTable2::forceMinStepSize(GLfloat newMinStepSize)
+	{
+	/* Calculate the maximum propagation speeds in x and y, or remove the limit: */
+	for(int i=0;i<2;++i)
+		maxPropagationSpeed[i]=newMinStepSize>0.0f?cellSize[i]/(2.0f*newMinStepSize):1.0e10; // Ridiculously large
+	}
+
+void CpuWaterTable2::setMaxStepSize(GLfloat newMaxStepSize)
+	{
+	maxStepSize=newMaxStepSize;
+	}
+
+void CpuWaterTable2::setSnowLine(GLfloat newSnowLine)
+	{
+	snowLine=newSnowLine;
+	}
+
+void CpuWaterTable2::setSnowMelt(GLfloat newSnowMelt)
+	{
+	snowMelt=newSnowMelt;
+	}
+
+void CpuWaterTable2::setWaterDeposit(GLfloat newWaterDeposit)
+	{
+	waterDeposit=newWaterDeposit;
+	}
+
+void CpuWaterTable2::setDryBoundary(bool newDryBoundary)
+	{
+	dryBoundary=newDryBoundary;
+	}
+
+void CpuWaterTable2::setParameters(const WaterTable2& waterTable)
+	{
+	mode=waterTable.mode;
+	attenuation=waterTable.attenuation;
+	for(int i=0;i<2;++i)
+		maxPropagationSpeed[i]=waterTable.maxPropagationSpeed[i];
+	snowLine=waterTable.snowLine;
+	snowMelt=waterTable.snowMelt;
+	waterDeposit=waterTable.waterDeposit;
+	dryBoundary=waterTable.dryBoundary;
+	}
+
+void CpuWaterTable2::setFluxKernel(const char* kernelName)
+	{
+	if(strcasecmp(kernelName,"auto")==0)
+		{
+		/* Select the last, i.e., fastest, supported kernel: */
+		fluxKernel=numFluxKernels;
+		while(fluxKernel>1&&!fluxKernels[fluxKernel-1].isSupported())
+			--fluxKernel;
+		--fluxKernel;
+		}
+	else
+		{
+		/* Find the supported kernel of the given name: */
+		unsigned int index;
+		for(index=0;index<numFluxKernels&&strcasecmp(kernelName,fluxKernels[index].name)!=0;++index)
+			;
+		if(index==numFluxKernels||!fluxKernels[index].isSupported())
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Flux kernel %s is unknown or not supported by this CPU",kernelName);
+		fluxKernel=index;
+		}
+	}
+
+const char* CpuWaterTable2::getFluxKernelName(void) const
+	{
+	return fluxKernels[fluxKernel].name;
+	}
+
+void CpuWaterTable2::setSparse(bool newSparse,GLfloat newDryDepth)
+	{
+	sparse=newSparse;
+	dryDepth=newDryDepth;
+	
+	/* Tile wetness is not tracked outside sparse mode, and depends on the dry depth: */
+	tileWetValid=false;
+	}
+
+void CpuWaterTable2::setPropertyGrid(const GLfloat* propertyGrid)
+	{
+	/* De-interleave the roughness coefficients and absorption rates: */
+	const GLfloat* pgPtr=propertyGrid;
+	for(size_t index=0;index<properties[0].size();++index,pgPtr+=2)
+		for(int i=0;i<2;++i)
+			properties[i][index]=pgPtr[i];
+	}
+
+void CpuWaterTable2::setWaterSource(const GLfloat* waterSourceGrid)
+	{
+	waterSource.clear();
+	tileSource.clear();
+	if(waterSourceGrid!=0)
+		{
+		/* Flag all tiles containing cells that add water, as they can become wet at any time, and check for cells that remove water: */
+		int width=int(size[0]);
+		tileSource.assign(tileWet.size(),0);
+		bool haveSinks=false;
+		for(int y=0;y<int(size[1]);++y)
+			{
+			unsigned char* sourceRow=&tileSource[(y/bandHeight)*numTiles[0]];
+			const GLfloat* wsRow=waterSourceGrid+size_t(y)*size_t(width);
+			for(int x=0;x<width;++x)
+				{
+				if(wsRow[x]>0.0f)
+					sourceRow[x/bandHeight]=1;
+				else if(wsRow[x]<0.0f)
+					haveSinks=true;
+				}
+			}
+		
+		/* Keep the grid only if it adds or removes water anywhere, so that all-zero grids, e.g., from hands not currently over the sandbox, cost nothing: */
+		if(haveSinks||std::find(tileSource.begin(),tileSource.end(),1)!=tileSource.end())
+			waterSource.assign(waterSourceGrid,waterSourceGrid+snow.size());
+		else
+			tileSource.clear();
+		}
+	}
+
+void CpuWaterTable2::updateBathymetry(const GLfloat* bathymetryGrid)
+	{
+	/* Copy the new bathymetry grid: */
+	int width=int(size[0]);
+	int height=int(size[1]);
+	bathymetry.assign(bathymetryGrid,bathymetryGrid+bathymetry.size());
+	
+	/* Calculate the bathymetry elevations of all vertical faces, including ghost faces: */
+	int bMaxX=width-2;
+	int bMaxY=height-2;
+	GLfloat* bxPtr=&xFaceBathymetry[0];
+	for(int y=0;y<height;++y)
+		{
+		const GLfloat* b0=&bathymetry[clampIndex(y-1,bMaxY)*(width-1)];
+		const GLfloat* b1=&bathymetry[clampIndex(y,bMaxY)*(width-1)];
+		for(int x=-1;x<=width+1;++x,++bxPtr)
+			*bxPtr=(b0[clampIndex(x-1,bMaxX)]+b1[clampIndex(x-1,bMaxX)])*0.5f;
+		}
+	
+	/* Calculate the bathymetry elevations of all horizontal faces, including ghost faces: */
+	GLfloat* byPtr=&yFaceBathymetry[0];
+	for(int y=-1;y<=height+1;++y)
+		{
+		const GLfloat* b=&bathymetry[clampIndex(y-1,bMaxY)*(width-1)];
+		for(int x=0;x<width;++x,++byPtr)
+			*byPtr=(b[clampIndex(x-1,bMaxX)]+b[clampIndex(x,bMaxX)])*0.5f;
+		}
+	
+	/* Update the cell-centered bathymetry elevations and the water surface heights: */
+	for(int y=0;y<height;++y)
+		{
+		const GLfloat* b0=&bathymetry[clampIndex(y-1,bMaxY)*(width-1)];
+		const GLfloat* b1=&bathymetry[clampIndex(y,bMaxY)*(width-1)];
+		for(int x=0;x<width;++x)
+			{
+			size_t index=size_t(y)*size_t(width)+x;
+			GLfloat bNew=(b0[clampIndex(x-1,bMaxX)]+b0[clampIndex(x,bMaxX)]+b1[clampIndex(x-1,bMaxX)]+b1[clampIndex(x,bMaxX)])*0.25f;
+			quantity[0][index]=Math::max(quantity[0][index]-cellBathymetry[index],0.0f)+bNew;
+			cellBathymetry[index]=bNew;
+			}
+		}
+	}
+
+void CpuWaterTable2::setWaterLevel(const GLfloat* waterGrid)
+	{
+	/* Adjust the given water levels to the current bathymetry and reset the partial discharges: */
+	for(size_t index=0;index<cellBathymetry.size();++index)
+		{
+		quantity[0][index]=Math::max(waterGrid[index],cellBathymetry[index]);
+		quantity[1][index]=quantity[2][index]=0.0f;
+		}
+	
+	/* Recalculate the tile wetness flags before the next simulation step: */
+	tileWetValid=false;
+	}
+
+void CpuWaterTable2::setQuantityGrid(const GLfloat* quantityGrid,const GLfloat* snowGrid)
+	{
+	/* De-interleave the conserved quantity components and copy the snow heights: */
+	const GLfloat* qgPtr=quantityGrid;
+	for(size_t index=0;index<cellBathymetry.size();++index,qgPtr+=3)
+		for(int i=0;i<3;++i)
+			quantity[i][index]=qgPtr[i];
+	snow.assign(snowGrid,snowGrid+snow.size());
+	
+	/* Recalculate the tile wetness flags before the next simulation step: */
+	tileWetValid=false;
+	}
+
+GLfloat CpuWaterTable2::runSimulationStep(bool forceStepSize)
+	{
+	/* Select the tiles to simulate in this step; water can only spread by a few cells per step, well inside one tile: */
+	updateActiveTiles();
+	
+	/* Calculate the temporal derivative of the most recent quantities and perform the tentative Euler integration step: */
+	runFluxPass(quantity);
+	GLfloat stepSize=forceStepSize?maxStepSize:calcStepSize();
+	runIntegrationPass(stepSize,false);
+	
+	/* Calculate the temporal derivative of the intermediate quantities and perform the final Runge-Kutta integration step: */
+	runFluxPass(quantityStar);
+	runIntegrationPass(stepSize,true);
+	
+	/* Return the Runge-Kutta step's step size: */
+	return stepSize;
+	}
+
+void CpuWaterTable2::readQuantityGrid(GLfloat* buffer) const
+	{
+	/* Interleave the conserved quantity components: */
+	GLfloat* bPtr=buffer;
+	for(size_t index=0;index<cellBathymetry.size();++index,bPtr+=3)
+		for(int i=0;i<3;++i)
+			bPtr[i]=quantity[i][index];
+	}
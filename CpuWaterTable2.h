@@ -0,0 +1,165 @@
+/***********************************************************************
+CpuWaterTable2 - Class to run the same shallow water flow simulation as
+WaterTable2 on the CPU, using multiple threads, to serve as a headless
+benchmark, a reference for regression tests, and a fallback on systems
+without suitable GPUs.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef CPUWATERTABLE2_INCLUDED
+#define CPUWATERTABLE2_INCLUDED
+
+#include <vector>
+#include <GL/gl.h>
+
+#include "Types.h"
+#include "JobPool.h"
+#include "WaterTable2.h"
+
+class CpuWaterTable2
+	{
+	friend class NestedWaterTable2;
+	
+	/* Elements: */
+	private:
+	static const unsigned int bandHeight=16; // Number of grid rows processed by each job of a simulation pass, and width and height of the tiles tracked in sparse mode
+	Size size; // Width and height of water table in cells
+	GLfloat cellSize[2]; // Width and height of water table cells in world coordinate units
+	GLfloat theta; // Coefficient for minmod flux-limiting differential operator
+	GLfloat g; // Gravitiational acceleration constant
+	GLfloat epsilon; // Coefficient for desingularizing division operator
+	GLfloat maxPropagationSpeed[2]; // Maximum propagation speeds in x and y to guarantee minimum step size
+	WaterTable2::Mode mode; // Current water simulation mode
+	GLfloat attenuation; // Attenuation factor for partial discharges
+	GLfloat maxStepSize; // Maximum step size for each Runge-Kutta integration step
+	GLfloat snowLine; // The elevation of the snow line relative to the base plane
+	GLfloat snowMelt; // The rate of snow melt in elevation units per second
+	GLfloat waterDeposit; // A fixed amount of water added at every iteration of the flow simulation, for evaporation etc.
+	bool dryBoundary; // Flag whether to enforce dry boundary conditions at the end of each simulation step
+	bool sparse; // Flag whether to only simulate tiles containing water, snow, or water sources, and their neighbours
+	GLfloat dryDepth; // Water column height up to which a cell is considered dry in sparse mode
+	std::vector<GLfloat> bathymetry; // Vertex-centered bathymetry grid of grid size minus 1
+	std::vector<GLfloat> cellBathymetry; // Cell-centered bathymetry elevations
+	std::vector<GLfloat> xFaceBathymetry; // Bathymetry elevations at the centers of the vertical faces of each grid row, including one clamped ghost face on either side
+	std::vector<GLfloat> yFaceBathymetry; // Bathymetry elevations at the centers of the horizontal faces of each grid column, including one clamped ghost face row on either side
+	std::vector<GLfloat> quantity[3]; // Cell-centered conserved quantity grids (w, hu, hv)
+	std::vector<GLfloat> quantityStar[3]; // Cell-centered conserved quantity grids after the tentative Euler integration step
+	std::vector<GLfloat> snow; // Cell-centered snow height grid
+	std::vector<GLfloat> properties[2]; // Cell-centered roughness coefficients and absorption rates used in engineering mode
+	std::vector<GLfloat> waterSource; // Cell-centered rates at which water is added or removed in elevation units per second, or empty
+	std::vector<GLfloat> xFlux[3]; // Fluxes across the vertical faces of each grid row
+	std::vector<GLfloat> yFlux[3]; // Fluxes across the horizontal faces of each grid column
+	unsigned int numBands; // Number of bands of grid rows processed in parallel by each simulation pass
+	size_t rowBufferSize; // Size of each band's scratch buffer for reconstructing one grid row
+	std::vector<GLfloat> rowBuffers; // Scratch buffers for row reconstruction, one per band
+	std::vector<GLfloat> bandMaxSpeeds; // Maximum propagation speeds in x and y gathered by each band during the most recent flux pass
+	unsigned int numTiles[2]; // Number of tiles in x and y; each row of tiles is one band
+	std::vector<unsigned char> tileWet; // Per-tile flags whether a tile contained water or snow at the end of the most recent simulation step
+	bool tileWetValid; // Flag whether the tile wetness flags reflect the current conserved quantities
+	std::vector<unsigned char> tileSource; // Per-tile flags whether a tile contains positive water sources
+	std::vector<unsigned char> tileActive; // Per-tile flags whether a tile is simulated in the current simulation step
+	unsigned int numActiveTiles; // Number of tiles simulated in the current simulation step
+	std::vector<std::vector<int> > cellRuns; // Per band, list of begin and end indices of horizontal runs of cells in active tiles
+	std::vector<std::vector<int> > faceRuns; // Per band, list of begin and end indices of horizontal runs of faces along the band's bottom edge adjacent to active tiles
+	JobPool simulationPool; // Pool of threads running simulation passes on bands of grid rows in parallel
+	unsigned int fluxKernel; // Index of the scalar or SIMD kernel calculating partial fluxes across runs of faces
+	
+	/* Parameters of the currently running simulation pass: */
+	const std::vector<GLfloat>* passSource; // Conserved quantities from which to calculate fluxes and temporal derivatives
+	bool passFinal; // Flag whether the integration pass performs the final Runge-Kutta step instead of the Euler step
+	GLfloat passStepSize; // Step size of the integration pass
+	GLfloat passAttenuation; // Attenuation factor for partial discharges applied by the integration pass
+	bool passUpdateWater; // Flag whether the integration pass adds water and updates the snow pack
+	
+	/* Private methods: */
+	void init(void); // Allocates all grids and scratch buffers
+	void updateTileWetness(void); // Recalculates the tile wetness flags if they are out of date
+	void updateActiveTiles(void); // Calculates the set of tiles to simulate in the next simulation step
+	bool isHaloTile(int tileX,int tileY) const; // Returns true if the given tile is inactive but borders an active tile
+	void updateTileRuns(void); // Collects the runs of cells and faces to process from the active tile flags
+	static void calcFluxes(unsigned int jobIndex,void* userData); // Calculates partial fluxes across the faces of one band of grid rows
+	static void integrate(unsigned int jobIndex,void* userData); // Calculates temporal derivatives and performs an integration step for one band of grid rows
+	void runFluxPass(const std::vector<GLfloat>* source); // Calculates partial fluxes from the given conserved quantities
+	GLfloat calcStepSize(void) const; // Returns the largest stable step size for the most recent flux pass
+	void runIntegrationPass(GLfloat stepSize,bool final); // Runs the Euler or final Runge-Kutta integration pass with the given step size
+	
+	/* Constructors and destructors: */
+	public:
+	CpuWaterTable2(const Size& sSize,const GLfloat sCellSize[2],unsigned int numThreads); // Creates a water table of the given size and cell size with the same simulation parameters as an offline WaterTable2, using the given total number of threads; the bathymetry is initially flat and dry at elevation zero
+	CpuWaterTable2(const WaterTable2& waterTable,unsigned int numThreads); // Creates a water table with the same grid layout and simulation parameters as the given water table, using the given total number of threads; the bathymetry is initially flat and dry at elevation zero
+	
+	/* Methods: */
+	const Size& getSize(void) const // Returns the size of the water table
+		{
+		return size;
+		}
+	const GLfloat* getCellSize(void) const // Returns the water table's cell size
+		{
+		return cellSize;
+		}
+	unsigned int getNumThreads(void) const // Returns the total number of threads running the simulation
+		{
+		return simulationPool.getNumThreads();
+		}
+	WaterTable2::Mode getMode(void) const // Returns the current water simulation mode
+		{
+		return mode;
+		}
+	void setMode(WaterTable2::Mode newMode); // Sets the water simulation mode
+	void setAttenuation(GLfloat newAttenuation); // Sets the attenuation factor for partial discharges
+	void forceMinStepSize(GLfloat newMinStepSize); // Forces the given minimum step size for all subsequent integration steps by limiting cell fluxes; removes the limit if the step size is zero
+	void setMaxStepSize(GLfloat newMaxStepSize); // Sets the maximum step size for all subsequent integration steps
+	void setSnowLine(GLfloat newSnowLine); // Sets the elevation of the snow line relative to the base plane
+	void setSnowMelt(GLfloat newSnowMelt); // Sets the snow melt rate in elevation units per second
+	void setWaterDeposit(GLfloat newWaterDeposit); // Sets the amount of deposited water
+	void setDryBoundary(bool newDryBoundary); // Enables or disables enforcement of dry boundaries
+	void setParameters(const WaterTable2& waterTable); // Copies the simulation mode and all simulation parameters that can change at run-time from the given water table of the same grid layout
+	void setFluxKernel(const char* kernelName); // Selects the flux kernel of the given name (scalar, sse4.1, or avx), or the fastest one supported by the current CPU if name is "auto"
+	const char* getFluxKernelName(void) const; // Returns the name of the current flux kernel
+	void setSparse(bool newSparse,GLfloat newDryDepth); // Enables or disables simulating only tiles containing water deeper than the given depth, snow, or water sources, and their neighbours
+	unsigned int getNumTiles(void) const // Returns the total number of tiles
+		{
+		return numTiles[0]*numTiles[1];
+		}
+	unsigned int getNumActiveTiles(void) const // Returns the number of tiles simulated in the most recent simulation step
+		{
+		return numActiveTiles;
+		}
+	void setPropertyGrid(const GLfloat* propertyGrid); // Sets the per-cell roughness coefficients and absorption rates used in engineering mode from an interleaved two-component grid
+	void setWaterSource(const GLfloat* waterSourceGrid); // Sets per-cell rates at which water is added (positive) or removed (negative) after each simulation step in elevation units per second; removes all water sources if null
+	void updateBathymetry(const GLfloat* bathymetryGrid); // Updates the bathymetry with a vertex-centered elevation grid of grid size minus 1, keeping water column heights
+	void setWaterLevel(const GLfloat* waterGrid); // Sets the current water level to the given grid, and resets flux components to zero
+	void setQuantityGrid(const GLfloat* quantityGrid,const GLfloat* snowGrid); // Sets the conserved quantities from a grid in the interleaved layout of readQuantityGrid, and the snow heights from a cell-centered grid, e.g., to continue a simulation run elsewhere
+	GLfloat runSimulationStep(bool forceStepSize); // Runs a water flow simulation step, always uses maxStepSize if flag is true (may lead to instability); returns step size taken by Runge-Kutta integration step
+	const GLfloat* getBathymetryGrid(void) const // Returns the vertex-centered bathymetry grid
+		{
+		return &bathymetry[0];
+		}
+	const GLfloat* getSnowGrid(void) const // Returns the cell-centered snow height grid
+		{
+		return &snow[0];
+		}
+	const GLfloat* getQuantityGrid(int component) const // Returns the given component (0: w, 1: hu, 2: hv) of the cell-centered conserved quantity grid
+		{
+		return &quantity[component][0];
+		}
+	void readQuantityGrid(GLfloat* buffer) const; // Writes the conserved quantity grid into the given buffer in the interleaved layout of WaterTable2::readQuantityTexture with GL_RGB components
+	};
+
+#endif
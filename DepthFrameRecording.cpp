@@ -0,0 +1,218 @@
+/***********************************************************************
+DepthFrameRecording - Class to load a pre-recorded stream of raw depth
+frames into memory, or to synthesize one, to feed them through the
+processing pipeline without a live camera for benchmarking and
+regression testing.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "DepthFrameRecording.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <Misc/StdError.h>
+#include <Misc/FunctionCalls.h>
+#include <Math/Math.h>
+#include <Math/Constants.h>
+#include <IO/OpenFile.h>
+#include <Kinect/FileFrameSource.h>
+
+namespace {
+
+/* Depth conversion formula of first-generation Kinect cameras, distance in m=1/(a*raw depth+b): */
+const double kinectA=-0.0030711016;
+const double kinectB=3.3309495161;
+
+/**************
+Helper classes:
+**************/
+
+class SyntheticNoise // Linear congruential generator, to create the same synthetic frames on every platform
+	{
+	/* Elements: */
+	private:
+	unsigned int state; // Current generator state
+	
+	/* Constructors and destructors: */
+	public:
+	SyntheticNoise(unsigned int sState)
+		:state(sState)
+		{
+		}
+	
+	/* Methods: */
+	float next(void) // Returns a uniformly distributed number in [0, 1)
+		{
+		state=state*1664525U+1013904223U;
+		
+		/* Use only the high-order bits, which have the longest period: */
+		return float((state>>8)&0xffffffU)/16777216.0f;
+		}
+	};
+
+}
+
+/************************************
+Methods of class DepthFrameRecording:
+************************************/
+
+void DepthFrameRecording::createNeutralDepthCorrection(void)
+	{
+	pixelDepthCorrection=new PixelDepthCorrection[frameSize[1]*frameSize[0]];
+	PixelDepthCorrection* pdcPtr=pixelDepthCorrection;
+	for(unsigned int y=0;y<frameSize[1];++y)
+		for(unsigned int x=0;x<frameSize[0];++x,++pdcPtr)
+			{
+			pdcPtr->scale=1.0f;
+			pdcPtr->offset=0.0f;
+			}
+	}
+
+void DepthFrameRecording::depthFrameCallback(const Kinect::FrameBuffer& frame)
+	{
+	/* Create a private copy of the frame, as the frame source might re-use its buffers: */
+	size_t frameDataSize=size_t(frameSize[1])*size_t(frameSize[0])*sizeof(RawDepth);
+	Kinect::FrameBuffer copy(frameSize,frameDataSize);
+	memcpy(copy.getData<void>(),frame.getData<void>(),frameDataSize);
+	copy.timeStamp=frame.timeStamp;
+	
+	/* Store the copy: */
+	Threads::Mutex::Lock framesLock(framesMutex);
+	if(frames.size()<maxNumFrames)
+		frames.push_back(copy);
+	}
+
+DepthFrameRecording::DepthFrameRecording(const char* frameFilePrefix,unsigned int sMaxNumFrames)
+	:pixelDepthCorrection(0),
+	 maxNumFrames(sMaxNumFrames)
+	{
+	/* Open the pre-recorded 3D video files: */
+	std::string colorFileName=frameFilePrefix;
+	colorFileName.append(".color");
+	std::string depthFileName=frameFilePrefix;
+	depthFileName.append(".depth");
+	Kinect::FileFrameSource source(IO::openFile(colorFileName.c_str()),IO::openFile(depthFileName.c_str()));
+	frameSize=source.getActualFrameSize(Kinect::FrameSource::DEPTH);
+	
+	/* Get the camera's per-pixel depth correction parameters and evaluate it on the depth frame's pixel grid: */
+	Kinect::FrameSource::DepthCorrection* depthCorrection=source.getDepthCorrectionParameters();
+	if(depthCorrection!=0)
+		{
+		pixelDepthCorrection=depthCorrection->getPixelCorrection(frameSize);
+		delete depthCorrection;
+		}
+	else
+		{
+		/* Create dummy per-pixel depth correction parameters: */
+		createNeutralDepthCorrection();
+		}
+	
+	/* Get the camera's intrinsic parameters: */
+	intrinsics=source.getIntrinsicParameters();
+	
+	/* Play back the recording until the requested number of frames has arrived, or the recording runs dry: */
+	source.startStreaming(0,Misc::createFunctionCall(this,&DepthFrameRecording::depthFrameCallback));
+	size_t lastNumFrames=0;
+	unsigned int numIdlePolls=0;
+	while(numIdlePolls<20)
+		{
+		/* Check the number of received frames every 100ms: */
+		usleep(100000);
+		size_t numFrames;
+		{
+		Threads::Mutex::Lock framesLock(framesMutex);
+		numFrames=frames.size();
+		}
+		if(numFrames>=maxNumFrames)
+			break;
+		
+		/* Give up after two seconds without new frames: */
+		if(numFrames==lastNumFrames)
+			++numIdlePolls;
+		else
+			numIdlePolls=0;
+		lastNumFrames=numFrames;
+		}
+	source.stopStreaming();
+	
+	if(frames.empty())
+		{
+		delete[] pixelDepthCorrection;
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"No depth frames in recording %s",frameFilePrefix);
+		}
+	}
+
+DepthFrameRecording::DepthFrameRecording(const Size& sFrameSize,unsigned int sNumFrames)
+	:frameSize(sFrameSize),
+	 pixelDepthCorrection(0),
+	 maxNumFrames(sNumFrames)
+	{
+	createNeutralDepthCorrection();
+	
+	/* Create a pinhole camera with a 580 pixel focal length centered on the frame, using centimeters as camera-space unit: */
+	double focalLength=580.0;
+	intrinsics.depthProjection=PTransform::identity;
+	PTransform::Matrix& dpm=intrinsics.depthProjection.getMatrix();
+	dpm(0,3)=-double(frameSize[0])*0.5;
+	dpm(1,3)=-double(frameSize[1])*0.5;
+	dpm(2,2)=0.0;
+	dpm(2,3)=-focalLength;
+	dpm(3,2)=focalLength*kinectA/100.0;
+	dpm(3,3)=focalLength*kinectB/100.0;
+	intrinsics.colorProjection=PTransform::identity;
+	
+	/* Calculate the noise-free raw depth of a tilted surface with smooth hills and valleys, about one meter from the camera: */
+	size_t numPixels=size_t(frameSize[1])*size_t(frameSize[0]);
+	float* surface=new float[numPixels];
+	float* sPtr=surface;
+	for(unsigned int y=0;y<frameSize[1];++y)
+		for(unsigned int x=0;x<frameSize[0];++x,++sPtr)
+			{
+			double u=(double(x)+0.5)/double(frameSize[0]);
+			double v=(double(y)+0.5)/double(frameSize[1]);
+			double elevation=6.0*Math::sin(Math::Constants<double>::pi*(2.6*u+0.2))*Math::sin(Math::Constants<double>::pi*1.8*v);
+			elevation+=3.0*Math::cos(Math::Constants<double>::pi*(4.2*u+3.4*v))+8.0*(u-0.5);
+			*sPtr=float((100.0/(100.0-elevation)-kinectB)/kinectA);
+			}
+	
+	/* Create the frames by adding up to one unit of sensor noise to each pixel, and dropping 5% of pixels: */
+	SyntheticNoise noise(0x5341524eU);
+	size_t frameDataSize=numPixels*sizeof(RawDepth);
+	for(unsigned int frameIndex=0;frameIndex<maxNumFrames;++frameIndex)
+		{
+		Kinect::FrameBuffer frame(frameSize,frameDataSize);
+		RawDepth* fPtr=frame.getData<RawDepth>();
+		for(size_t i=0;i<numPixels;++i,++fPtr)
+			{
+			if(noise.next()<0.05f)
+				*fPtr=RawDepth(2047);
+			else
+				*fPtr=RawDepth(Math::floor(surface[i]+noise.next()*2.0f-1.0f+0.5f));
+			}
+		frame.timeStamp=double(frameIndex)/30.0;
+		frames.push_back(frame);
+		}
+	delete[] surface;
+	}
+
+DepthFrameRecording::~DepthFrameRecording(void)
+	{
+	delete[] pixelDepthCorrection;
+	}
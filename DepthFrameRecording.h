@@ -0,0 +1,84 @@
+/***********************************************************************
+DepthFrameRecording - Class to load a pre-recorded stream of raw depth
+frames into memory, or to synthesize one, to feed them through the
+processing pipeline without a live camera for benchmarking and
+regression testing.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef DEPTHFRAMERECORDING_INCLUDED
+#define DEPTHFRAMERECORDING_INCLUDED
+
+#include <vector>
+#include <Threads/Mutex.h>
+#include <Kinect/FrameBuffer.h>
+#include <Kinect/FrameSource.h>
+
+#include "Types.h"
+
+class DepthFrameRecording
+	{
+	/* Embedded classes: */
+	public:
+	typedef unsigned short RawDepth; // Data type for raw depth values
+	typedef Kinect::FrameSource::DepthCorrection::PixelCorrection PixelDepthCorrection; // Type for per-pixel depth correction factors
+	
+	/* Elements: */
+	private:
+	Size frameSize; // Width and height of all recorded depth frames
+	PixelDepthCorrection* pixelDepthCorrection; // Buffer of per-pixel depth correction coefficients
+	Kinect::FrameSource::IntrinsicParameters intrinsics; // Intrinsic parameters of the recording camera
+	unsigned int maxNumFrames; // Maximum number of frames to load
+	Threads::Mutex framesMutex; // Mutex protecting the frame list during loading
+	std::vector<Kinect::FrameBuffer> frames; // List of loaded depth frames
+	
+	/* Private methods: */
+	void createNeutralDepthCorrection(void); // Creates per-pixel depth correction coefficients that leave raw depth values unchanged
+	void depthFrameCallback(const Kinect::FrameBuffer& frame); // Called when a new depth frame arrives from the recording
+	
+	/* Constructors and destructors: */
+	public:
+	DepthFrameRecording(const char* frameFilePrefix,unsigned int sMaxNumFrames); // Loads up to the given number of depth frames from the pair of color/depth files of the given file name prefix
+	DepthFrameRecording(const Size& sFrameSize,unsigned int sNumFrames); // Synthesizes the given number of depth frames of the given size, showing a noisy sand surface seen by a first-generation Kinect from one meter; results are identical on every run
+	~DepthFrameRecording(void);
+	
+	/* Methods: */
+	const Size& getFrameSize(void) const // Returns the size of all recorded depth frames
+		{
+		return frameSize;
+		}
+	const PixelDepthCorrection* getPixelDepthCorrection(void) const // Returns the per-pixel depth correction coefficients
+		{
+		return pixelDepthCorrection;
+		}
+	const Kinect::FrameSource::IntrinsicParameters& getIntrinsics(void) const // Returns the intrinsic parameters of the recording camera
+		{
+		return intrinsics;
+		}
+	unsigned int getNumFrames(void) const // Returns the number of loaded depth frames
+		{
+		return (unsigned int)(frames.size());
+		}
+	const Kinect::FrameBuffer& getFrame(unsigned int index) const // Returns the loaded depth frame of the given index
+		{
+		return frames[index];
+		}
+	};
+
+#endif
@@ -72,8 +72,34 @@ GLint DepthImageRenderer::bindDepthTexture(DepthImageRenderer::DataItem* dataIte
 	/* Check if the texture is outdated: */
 	if(dataItem->depthTextureVersion!=depthImageVersion)
 		{
-		/* Upload the new depth texture: */
-		glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,depthImageSize,GL_LUMINANCE,GL_FLOAT,depthImage.getData<GLfloat>());
+		/* Upload all runs of horizontally adjacent tiles that changed since the texture was last updated: */
+		glPixelStorei(GL_UNPACK_ROW_LENGTH,depthImageSize[0]);
+		const GLfloat* depthImageData=depthImage.getData<GLfloat>();
+		const unsigned int* tvRow=tileVersions;
+		for(unsigned int ty=0;ty<numTiles[1];++ty,tvRow+=numTiles[0])
+			{
+			unsigned int y0=ty*tileSize;
+			unsigned int y1=y0+tileSize<=depthImageSize[1]?y0+tileSize:depthImageSize[1];
+			unsigned int tx=0;
+			while(tx<numTiles[0])
+				{
+				/* Find the next run of changed tiles: */
+				while(tx<numTiles[0]&&tvRow[tx]<=dataItem->depthTextureVersion)
+					++tx;
+				unsigned int txBegin=tx;
+				while(tx<numTiles[0]&&tvRow[tx]>dataItem->depthTextureVersion)
+					++tx;
+				
+				/* Upload the run: */
+				if(txBegin<tx)
+					{
+					unsigned int x0=txBegin*tileSize;
+					unsigned int x1=tx*tileSize<=depthImageSize[0]?tx*tileSize:depthImageSize[0];
+					glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,x0,y0,x1-x0,y1-y0,GL_LUMINANCE,GL_FLOAT,depthImageData+size_t(y0)*size_t(depthImageSize[0])+x0);
+					}
+				}
+			}
+		glPixelStorei(GL_UNPACK_ROW_LENGTH,0);
 		
 		/* Mark the depth texture as current: */
 		dataItem->depthTextureVersion=depthImageVersion;
@@ -82,9 +108,37 @@ GLint DepthImageRenderer::bindDepthTexture(DepthImageRenderer::DataItem* dataIte
 	return unit;
 	}
 
-DepthImageRenderer::DepthImageRenderer(const Size& sDepthImageSize)
+void DepthImageRenderer::getTemplateVertex(unsigned int x,unsigned int y,Scalar position[2]) const
+	{
+	if(lensDistortion.isIdentity())
+		{
+		/* Return the uncorrected pixel position: */
+		position[0]=Scalar(x)+Scalar(0.5);
+		position[1]=Scalar(y)+Scalar(0.5);
+		}
+	else
+		{
+		/* Transform the depth-image point to depth tangent space: */
+		LensDistortion::Point dp(LensDistortion::Scalar(x)+LensDistortion::Scalar(0.5),LensDistortion::Scalar(y)+LensDistortion::Scalar(0.5));
+		LensDistortion::Point dtp=i2t.transform(dp);
+		
+		/* Undistort the point: */
+		LensDistortion::Point utp=lensDistortion.undistort(dtp);
+		
+		/* Transform the undistorted tangent-space point to depth image space: */
+		LensDistortion::Point up=t2i.transform(utp);
+		position[0]=Scalar(up[0]);
+		position[1]=Scalar(up[1]);
+		}
+	}
+
+DepthImageRenderer::DepthImageRenderer(const Size& sDepthImageSize,unsigned int sTileSize)
 	:depthImageSize(sDepthImageSize),
-	 depthImageVersion(0)
+	 tileSize(sTileSize),
+	 numTiles((depthImageSize[0]+tileSize-1)/tileSize,(depthImageSize[1]+tileSize-1)/tileSize),
+	 depthImageVersion(0),
+	 tileStamps(new unsigned int[numTiles[1]*numTiles[0]]),
+	 tileVersions(new unsigned int[numTiles[1]*numTiles[0]])
 	{
 	/* Initialize the depth image: */
 	depthImage=Kinect::FrameBuffer(depthImageSize,depthImageSize[1]*depthImageSize[0]*sizeof(float));
@@ -92,6 +146,19 @@ DepthImageRenderer::DepthImageRenderer(const Size& sDepthImageSize)
 	for(unsigned int i=depthImageSize[1]*depthImageSize[0];i>0;--i,++diPtr)
 		*diPtr=0.0f;
 	++depthImageVersion;
+	
+	/* Mark all tiles as changed in the initial depth image: */
+	for(unsigned int i=0;i<numTiles[1]*numTiles[0];++i)
+		{
+		tileStamps[i]=~0U;
+		tileVersions[i]=depthImageVersion;
+		}
+	}
+
+DepthImageRenderer::~DepthImageRenderer(void)
+	{
+	delete[] tileStamps;
+	delete[] tileVersions;
 	}
 
 void DepthImageRenderer::initContext(GLContextData& contextData) const
@@ -129,19 +196,10 @@ void DepthImageRenderer::initContext(GLContextData& contextData) const
 		for(unsigned int y=0;y<depthImageSize[1];++y)
 			for(unsigned int x=0;x<depthImageSize[0];++x,++vPtr)
 				{
-				/* Transform the depth-image point to depth tangent space: */
-				LensDistortion::Point dp(LensDistortion::Scalar(x)+LensDistortion::Scalar(0.5),LensDistortion::Scalar(y)+LensDistortion::Scalar(0.5));
-				LensDistortion::Point dtp=i2t.transform(dp);
-				
-				/* Undistort the point: */
-				LensDistortion::Point utp=lensDistortion.undistort(dtp);
-				
-				/* Transform the undistorted tangent-space point to depth image space: */
-				LensDistortion::Point up=t2i.transform(utp);
-				
-				/* Store the undistorted point: */
-				vPtr->position[0]=Scalar(up[0]);
-				vPtr->position[1]=Scalar(up[1]);
+				Scalar position[2];
+				getTemplateVertex(x,y,position);
+				vPtr->position[0]=position[0];
+				vPtr->position[1]=position[1];
 				}
 		}
 	glUnmapBufferARB(GL_ARRAY_BUFFER_ARB);
@@ -249,6 +307,113 @@ void DepthImageRenderer::setDepthImage(const Kinect::FrameBuffer& newDepthImage)
 	/* Update the depth image: */
 	depthImage=newDepthImage;
 	++depthImageVersion;
+	
+	/* Mark all tiles as changed and invalidate their change stamps: */
+	for(unsigned int i=0;i<numTiles[1]*numTiles[0];++i)
+		{
+		tileStamps[i]=~0U;
+		tileVersions[i]=depthImageVersion;
+		}
+	}
+
+void DepthImageRenderer::setDepthImage(const Kinect::FrameBuffer& newDepthImage,const unsigned int* newTileStamps)
+	{
+	/* Update the depth image: */
+	depthImage=newDepthImage;
+	
+	/* Mark all tiles whose change stamps differ from the previous depth image's as changed: */
+	bool changed=false;
+	for(unsigned int i=0;i<numTiles[1]*numTiles[0];++i)
+		if(tileStamps[i]!=newTileStamps[i])
+			{
+			tileStamps[i]=newTileStamps[i];
+			tileVersions[i]=depthImageVersion+1;
+			changed=true;
+			}
+	
+	/* Only bump the depth image version if anything changed, so that dependent state can be kept: */
+	if(changed)
+		++depthImageVersion;
+	}
+
+bool DepthImageRenderer::getDirtyRegion(unsigned int sinceVersion,Scalar region[4]) const
+	{
+	if(sinceVersion==depthImageVersion)
+		return false;
+	
+	/* Find the bounding box of all tiles that changed since the given version: */
+	unsigned int tileMin[2]={numTiles[0],numTiles[1]};
+	unsigned int tileMax[2]={0,0};
+	const unsigned int* tvPtr=tileVersions;
+	for(unsigned int ty=0;ty<numTiles[1];++ty)
+		for(unsigned int tx=0;tx<numTiles[0];++tx,++tvPtr)
+			if(*tvPtr>sinceVersion)
+				{
+				if(tileMin[0]>tx)
+					tileMin[0]=tx;
+				if(tileMax[0]<tx+1)
+					tileMax[0]=tx+1;
+				if(tileMin[1]>ty)
+					tileMin[1]=ty;
+				if(tileMax[1]<ty+1)
+					tileMax[1]=ty+1;
+				}
+	if(tileMin[0]>=tileMax[0])
+		return false;
+	
+	/* Calculate the box of pixels whose template vertices belong to triangles touching any changed pixel: */
+	unsigned int pixelMin[2],pixelMax[2];
+	for(int i=0;i<2;++i)
+		{
+		pixelMin[i]=tileMin[i]*tileSize;
+		if(pixelMin[i]>0)
+			--pixelMin[i];
+		pixelMax[i]=tileMax[i]*tileSize;
+		if(pixelMax[i]>depthImageSize[i]-1)
+			pixelMax[i]=depthImageSize[i]-1;
+		}
+	
+	if(lensDistortion.isIdentity())
+		{
+		/* Return the box of uncorrected pixel positions: */
+		for(int i=0;i<2;++i)
+			{
+			region[i]=Scalar(pixelMin[i])+Scalar(0.5);
+			region[2+i]=Scalar(pixelMax[i])+Scalar(0.5);
+			}
+		}
+	else
+		{
+		/* Bound the corrected template vertices along the pixel box's boundary, which bound all corrected template vertices inside the box: */
+		Scalar position[2];
+		getTemplateVertex(pixelMin[0],pixelMin[1],position);
+		for(int i=0;i<2;++i)
+			region[i]=region[2+i]=position[i];
+		for(unsigned int y=pixelMin[1];y<=pixelMax[1];++y)
+			{
+			unsigned int xStep=y==pixelMin[1]||y==pixelMax[1]||pixelMax[0]==pixelMin[0]?1:pixelMax[0]-pixelMin[0];
+			for(unsigned int x=pixelMin[0];x<=pixelMax[0];x+=xStep)
+				{
+				getTemplateVertex(x,y,position);
+				for(int i=0;i<2;++i)
+					{
+					if(region[i]>position[i])
+						region[i]=position[i];
+					if(region[2+i]<position[i])
+						region[2+i]=position[i];
+					}
+				}
+			}
+		
+		/* Account for the corrected boundary bulging between template vertices: */
+		for(int i=0;i<2;++i)
+			{
+			region[i]-=Scalar(1);
+			region[2+i]+=Scalar(1);
+			}
+		}
+	
+	return true;
 	}
 
 Scalar DepthImageRenderer::intersectLine(const Point& p0,const Point& p1,Scalar elevationMin,Scalar elevationMax) const
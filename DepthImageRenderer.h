@@ -67,6 +67,8 @@ class DepthImageRenderer:public GLObject
 	
 	/* Elements: */
 	Size depthImageSize; // Size of depth image texture
+	unsigned int tileSize; // Width and height of the square tiles in which changes to the depth image are tracked
+	Size numTiles; // Number of tiles covering the depth image
 	LensDistortion lensDistortion; // 2D lens distortion parameters
 	PTransform depthProjection; // Projection matrix from depth image space into 3D camera space
 	PixelTransform i2t,t2i; // Transformations between depth image space and depth tangent space
@@ -78,13 +80,17 @@ class DepthImageRenderer:public GLObject
 	/* Transient state: */
 	Kinect::FrameBuffer depthImage; // The most recent float-pixel depth image
 	unsigned int depthImageVersion; // Version number of the depth image
+	unsigned int* tileStamps; // Per-tile change stamps attached to the most recent depth image by its producer
+	unsigned int* tileVersions; // Version number of the depth image in which each tile last changed
 	
 	/* Private methods: */
+	void getTemplateVertex(unsigned int x,unsigned int y,Scalar position[2]) const; // Returns the lens distortion-corrected position of the template vertex for the given depth image pixel
 	GLint bindDepthTexture(DataItem* dataItem,TextureTracker& textureTracker) const; // Binds the up-to-date depth texture image to the next available texture unit in the given texture tracker and returns that unit's index
 	
 	/* Constructors and destructors: */
 	public:
-	DepthImageRenderer(const Size& sDepthImageSize); // Creates an elevation renderer for the given depth image size
+	DepthImageRenderer(const Size& sDepthImageSize,unsigned int sTileSize); // Creates an elevation renderer for the given depth image size, tracking changes in square tiles of the given size
+	virtual ~DepthImageRenderer(void);
 	
 	/* Methods from GLObject: */
 	virtual void initContext(GLContextData& contextData) const;
@@ -110,11 +116,13 @@ class DepthImageRenderer:public GLObject
 	void setIntrinsics(const Kinect::FrameSource::IntrinsicParameters& ips); // Sets a new depth unprojection matrix and, if present, 2D lens distortion parameters
 	void setBasePlane(const Plane& newBasePlane); // Sets a new base plane for elevation rendering
 	void setDepthImage(const Kinect::FrameBuffer& newDepthImage); // Sets a new depth image for subsequent surface rendering
+	void setDepthImage(const Kinect::FrameBuffer& newDepthImage,const unsigned int* newTileStamps); // Ditto, only updating the tiles whose change stamps differ from the previous depth image's
 	Scalar intersectLine(const Point& p0,const Point& p1,Scalar elevationMin,Scalar elevationMax) const; // Intersects a line segment with the current depth image in camera space; returns intersection point's parameter along line
 	unsigned int getDepthImageVersion(void) const // Returns the version number of the current depth image
 		{
 		return depthImageVersion;
 		}
+	bool getDirtyRegion(unsigned int sinceVersion,Scalar region[4]) const; // Calculates the bounding box (min x, min y, max x, max y) in depth image space of all template vertices affected by changes to the depth image since the given version; returns false if nothing changed
 	void uploadDepthProjection(Shader& shader) const; // Uploads the depth unprojection matrix into a GLSL 4x4 matrix at the next uniform location in the given shader
 	GLint bindDepthTexture(GLContextData& contextData,TextureTracker& textureTracker) const // Binds the up-to-date depth texture image to the next available texture unit in the given texture tracker and returns that unit's index
 		{
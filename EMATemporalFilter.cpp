@@ -0,0 +1,108 @@
+/***********************************************************************
+EMATemporalFilter - Temporal filter calculating exponentially weighted
+moving means and variances of each pixel's depth value, and restarting
+a pixel's averages when its depth value changes abruptly.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "EMATemporalFilter.h"
+
+/**********************************
+Methods of class EMATemporalFilter:
+**********************************/
+
+EMATemporalFilter::EMATemporalFilter(const Size& sSize,unsigned int numAveragingSlots)
+	:TemporalFilter(sSize),
+	 weight(2.0f/float(numAveragingSlots+1)),
+	 changeThreshold(9.0f),
+	 states(new PixelState[size[1]*size[0]])
+	{
+	/* Initialize the filter state: */
+	PixelState* sPtr=states;
+	for(unsigned int y=0;y<size[1];++y)
+		for(unsigned int x=0;x<size[0];++x,++sPtr)
+			{
+			sPtr->mean=0.0f;
+			sPtr->variance=0.0f;
+			sPtr->numSamples=0;
+			}
+	}
+
+EMATemporalFilter::~EMATemporalFilter(void)
+	{
+	delete[] states;
+	}
+
+const char* EMATemporalFilter::getName(void) const
+	{
+	return "ema";
+	}
+
+size_t EMATemporalFilter::getStateSize(void) const
+	{
+	return sizeof(PixelState);
+	}
+
+void EMATemporalFilter::filterBand(const TemporalFilter::Parameters& parameters,const TemporalFilter::Band& band)
+	{
+	float maxVariance=float(parameters.maxVariance);
+	size_t bandOffset=size_t(band.yBegin)*size_t(size[0]);
+	const RawDepth* iPtr=band.input+bandOffset;
+	const PixelDepthCorrection* pdcPtr=band.pixelDepthCorrection+bandOffset;
+	PixelState* sPtr=states+bandOffset;
+	float* vPtr=band.valid+bandOffset;
+	float* oPtr=band.output+bandOffset;
+	for(unsigned int y=band.yBegin;y<band.yEnd;++y)
+		{
+		float py=float(y)+0.5f;
+		for(unsigned int x=0;x<size[0];++x,++iPtr,++pdcPtr,++sPtr,++vPtr,++oPtr)
+			{
+			float newVal=float(*iPtr);
+			if(isValid(parameters,float(x)+0.5f,py,pdcPtr->correct(newVal)))
+				{
+				float diff=newVal-sPtr->mean;
+				if(sPtr->numSamples==0||diff*diff>changeThreshold*(sPtr->variance+maxVariance))
+					{
+					/* Restart the pixel's averages from the new sample: */
+					sPtr->mean=newVal;
+					sPtr->variance=0.0f;
+					sPtr->numSamples=1;
+					}
+				else
+					{
+					/* Update the pixel's moving averages: */
+					float increment=weight*diff;
+					sPtr->mean+=increment;
+					sPtr->variance=(1.0f-weight)*(sPtr->variance+diff*increment);
+					if(sPtr->numSamples<parameters.minNumSamples)
+						++sPtr->numSamples;
+					}
+				}
+			else if(!parameters.retainValids)
+				{
+				/* Invalidate the pixel's averages: */
+				sPtr->numSamples=0;
+				}
+			
+			/* Check if the pixel is considered "stable" and update its output value: */
+			bool stable=sPtr->numSamples>=parameters.minNumSamples&&sPtr->numSamples>0&&sPtr->variance<=maxVariance;
+			updateOutput(parameters,stable,pdcPtr->correct(sPtr->mean),*vPtr,*oPtr);
+			}
+		}
+	}
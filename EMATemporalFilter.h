@@ -0,0 +1,59 @@
+/***********************************************************************
+EMATemporalFilter - Temporal filter calculating exponentially weighted
+moving means and variances of each pixel's depth value, and restarting
+a pixel's averages when its depth value changes abruptly.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef EMATEMPORALFILTER_INCLUDED
+#define EMATEMPORALFILTER_INCLUDED
+
+#include "TemporalFilter.h"
+
+class EMATemporalFilter:public TemporalFilter
+	{
+	/* Embedded classes: */
+	private:
+	struct PixelState // Structure holding a pixel's filter state
+		{
+		/* Elements: */
+		public:
+		float mean; // Exponentially weighted moving mean of raw depth values
+		float variance; // Exponentially weighted moving variance of raw depth values
+		unsigned int numSamples; // Number of valid samples since the averages were last restarted
+		};
+	
+	/* Elements: */
+	private:
+	float weight; // Weight of a new sample in the moving averages
+	float changeThreshold; // Squared number of standard deviations by which a new sample must differ from the mean to restart the averages
+	PixelState* states; // Array of per-pixel filter states
+	
+	/* Constructors and destructors: */
+	public:
+	EMATemporalFilter(const Size& sSize,unsigned int numAveragingSlots); // Creates a filter for frames of the given size whose moving averages have the same center of mass as a running average of the given length
+	virtual ~EMATemporalFilter(void);
+	
+	/* Methods from class TemporalFilter: */
+	virtual const char* getName(void) const;
+	virtual size_t getStateSize(void) const;
+	virtual void filterBand(const Parameters& parameters,const Band& band);
+	};
+
+#endif
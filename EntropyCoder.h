@@ -0,0 +1,53 @@
+/***********************************************************************
+EntropyCoder - Declarations of the entropy coding back-ends that can be
+used to compress bathymetry and water level grid streams.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef ENTROPYCODER_INCLUDED
+#define ENTROPYCODER_INCLUDED
+
+#include <string.h>
+
+namespace EntropyCoder {
+
+enum Type // Enumerated type for entropy coding back-ends; values are used in the remote grid streaming protocol
+	{
+	HUFFMAN=0, // Static or adaptive Huffman codes written through a bit sink
+	RANS, // Two-way interleaved range asymmetric numeral system coder with per-frame symbol frequencies
+	NUM_TYPES
+	};
+
+inline const char* getName(Type type) // Returns the name of the given entropy coding back-end
+	{
+	static const char* names[NUM_TYPES]={"huffman","rans"};
+	return names[type];
+	}
+
+inline Type findType(const char* name) // Returns the entropy coding back-end of the given name, or NUM_TYPES if there is no such back-end
+	{
+	int result;
+	for(result=0;result<NUM_TYPES&&strcasecmp(name,getName(Type(result)))!=0;++result)
+		;
+	return Type(result);
+	}
+
+}
+
+#endif
@@ -23,180 +23,168 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "FrameFilter.h"
 
+#include <string.h>
+#include <Misc/StdError.h>
 #include <Misc/FunctionCalls.h>
 #include <Geometry/HVector.h>
 #include <Geometry/Matrix.h>
 
+#include "TemporalFilter.h"
+
 /****************************
 Methods of class FrameFilter:
 ****************************/
 
-void* FrameFilter::filterThreadMethod(void)
+void FrameFilter::findChangedTiles(unsigned int yBegin,unsigned int yEnd)
 	{
-	unsigned int lastInputFrameVersion=0;
-	
-	while(true)
+	for(unsigned int y=yBegin;y<yEnd;++y)
 		{
-		Kinect::FrameBuffer frame;
+		const float* outRow=filterOutput+size_t(y)*size_t(size[0]);
+		unsigned char* rtcRow=rowTileChanges+size_t(y)*size_t(numTiles[0]);
+		if(previousOutput!=0)
+			{
+			/* Compare each tile-wide segment of the row against the same segment of the previous output frame: */
+			const float* prevRow=previousOutput+size_t(y)*size_t(size[0]);
+			for(unsigned int tx=0;tx<numTiles[0];++tx)
+				{
+				unsigned int x0=tx*tileSize;
+				unsigned int x1=x0+tileSize<=size[0]?x0+tileSize:size[0];
+				rtcRow[tx]=memcmp(outRow+x0,prevRow+x0,(x1-x0)*sizeof(float))!=0?1U:0U;
+				}
+			}
+		else
+			{
+			/* Mark all segments as changed for the very first output frame: */
+			memset(rtcRow,1,numTiles[0]);
+			}
+		}
+	}
+
+void FrameFilter::filterBand(unsigned int bandIndex)
+	{
+	unsigned int yBegin=bandRows[bandIndex];
+	unsigned int yEnd=bandRows[bandIndex+1];
+	
+	/* Enter the band of the new frame into the temporal filter and calculate the band's output pixel values: */
+	TemporalFilter::Band band;
+	band.yBegin=yBegin;
+	band.yEnd=yEnd;
+	band.input=inputMailbox.getLockedFrame().getData<RawDepth>();
+	band.pixelDepthCorrection=pixelDepthCorrection;
+	band.valid=validBuffer;
+	band.output=filterOutput;
+	temporalFilter->filterBand(filterParameters,band);
+	
+	/* Apply a spatial filter if requested: */
+	if(spatialFilter)
 		{
-		Threads::MutexCond::Lock inputLock(inputCond);
+		const float* haloAbove=0;
+		const float* haloBelow=0;
+		if(numFilterThreads>1)
+			{
+			/* Save unfiltered copies of the band's first two and last two rows for the neighboring bands: */
+			float* halo=haloBuffer+bandIndex*4*size[0];
+			memcpy(halo,filterOutput+size_t(yBegin)*size_t(size[0]),2*size[0]*sizeof(float));
+			memcpy(halo+2*size[0],filterOutput+size_t(yEnd-2)*size_t(size[0]),2*size[0]*sizeof(float));
+			
+			/* Wait until all bands have saved their halo rows: */
+			frameBarrier.synchronize();
+			
+			/* Retrieve the neighboring bands' halo rows: */
+			if(bandIndex>0)
+				haloAbove=haloBuffer+((bandIndex-1)*4+2)*size[0];
+			if(bandIndex<numFilterThreads-1)
+				haloBelow=haloBuffer+(bandIndex+1)*4*size[0];
+			}
 		
+		/* Low-pass filter the band in-place: */
+		FrameFilterKernels::spatialFilterBand(size[0],size[1],yBegin,yEnd,haloAbove,haloBelow,spatialFilterBuffer+bandIndex*4*size[0],filterOutput);
+		}
+	
+	/* Find which parts of the band changed since the previous output frame: */
+	findChangedTiles(yBegin,yEnd);
+	}
+
+void* FrameFilter::filterThreadMethod(void)
+	{
+	while(true)
+		{
 		/* Wait until a new frame arrives or the program shuts down: */
-		while(runFilterThread&&lastInputFrameVersion==inputFrameVersion)
-			inputCond.wait(inputLock);
+		inputMailbox.wait();
 		
 		/* Bail out if the program is shutting down: */
 		if(!runFilterThread)
 			break;
 		
-		/* Work on the new frame: */
-		frame=inputFrame;
-		lastInputFrameVersion=inputFrameVersion;
+		/* Work on the new frame, unless it has already been picked up after an earlier wake-up: */
+		if(!inputMailbox.lockNewFrame())
+			continue;
+		
+		/* Install a new temporal filter if one was requested: */
+		{
+		Threads::Mutex::Lock temporalFilterLock(temporalFilterMutex);
+		if(newTemporalFilter!=0)
+			{
+			delete temporalFilter;
+			temporalFilter=newTemporalFilter;
+			newTemporalFilter=0;
+			}
+		if(newTemporalKernel!=0)
+			{
+			temporalFilter->setTemporalKernel(newTemporalKernel);
+			newTemporalKernel=0;
+			}
 		}
 		
 		/* Prepare a new output frame: */
 		Kinect::FrameBuffer& newOutputFrame=outputFrames.startNewValue();
+		filterOutput=newOutputFrame.getData<float>();
 		
-		/* Enter the new frame into the averaging buffer and calculate the output frame's pixel values: */
-		const RawDepth* ifPtr=inputFrame.getData<RawDepth>();
-		RawDepth* abPtr=averagingBuffer+averagingSlotIndex*size[1]*size[0];
-		unsigned int* sPtr=statBuffer;
-		float* ofPtr=validBuffer;
-		float* nofPtr=newOutputFrame.getData<float>();
-		const PixelDepthCorrection* pdcPtr=pixelDepthCorrection;
-		for(unsigned int y=0;y<size[1];++y)
+		/* Gather the filter parameters for this frame: */
+		filterParameters.width=size[0];
+		for(int i=0;i<4;++i)
 			{
-			float py=float(y)+0.5f;
-			for(unsigned int x=0;x<size[0];++x,++ifPtr,++pdcPtr,++abPtr,sPtr+=3,++ofPtr,++nofPtr)
-				{
-				float px=float(x)+0.5f;
-				
-				unsigned int oldVal=*abPtr;
-				unsigned int newVal=*ifPtr;
-				
-				/* Depth-correct the new value: */
-				float newCVal=pdcPtr->correct(newVal);
-				
-				/* Plug the depth-corrected new value into the minimum and maximum plane equations to determine its validity: */
-				float minD=minPlane[0]*px+minPlane[1]*py+minPlane[2]*newCVal+minPlane[3];
-				float maxD=maxPlane[0]*px+maxPlane[1]*py+maxPlane[2]*newCVal+maxPlane[3];
-				if(minD>=0.0f&&maxD<=0.0f)
-					{
-					/* Store the new input value: */
-					*abPtr=newVal;
-					
-					/* Update the pixel's statistics: */
-					++sPtr[0]; // Number of valid samples
-					sPtr[1]+=newVal; // Sum of valid samples
-					sPtr[2]+=newVal*newVal; // Sum of squares of valid samples
-					
-					/* Check if the previous value in the averaging buffer was valid: */
-					if(oldVal!=2048U)
-						{
-						--sPtr[0]; // Number of valid samples
-						sPtr[1]-=oldVal; // Sum of valid samples
-						sPtr[2]-=oldVal*oldVal; // Sum of squares of valid samples
-						}
-					}
-				else if(!retainValids)
-					{
-					/* Store an invalid input value: */
-					*abPtr=2048U;
-					
-					/* Check if the previous value in the averaging buffer was valid: */
-					if(oldVal!=2048U)
-						{
-						--sPtr[0]; // Number of valid samples
-						sPtr[1]-=oldVal; // Sum of valid samples
-						sPtr[2]-=oldVal*oldVal; // Sum of squares of valid samples
-						}
-					}
-				
-				/* Check if the pixel is considered "stable": */
-				if(sPtr[0]>=minNumSamples&&sPtr[2]*sPtr[0]<=maxVariance*sPtr[0]*sPtr[0]+sPtr[1]*sPtr[1])
-					{
-					/* Check if the new depth-corrected running mean is outside the previous value's envelope: */
-					float newFiltered=pdcPtr->correct(float(sPtr[1])/float(sPtr[0]));
-					if(Math::abs(newFiltered-*ofPtr)>=hysteresis)
-						{
-						/* Set the output pixel value to the depth-corrected running mean: */
-						*nofPtr=*ofPtr=newFiltered;
-						}
-					else
-						{
-						/* Leave the pixel at its previous value: */
-						*nofPtr=*ofPtr;
-						}
-					}
-				else if(retainValids)
-					{
-					/* Leave the pixel at its previous value: */
-					*nofPtr=*ofPtr;
-					}
-				else
-					{
-					/* Assign default value to instable pixels: */
-					*nofPtr=instableValue;
-					}
-				}
+			filterParameters.minPlane[i]=minPlane[i];
+			filterParameters.maxPlane[i]=maxPlane[i];
 			}
+		filterParameters.minNumSamples=minNumSamples;
+		filterParameters.maxVariance=maxVariance;
+		filterParameters.hysteresis=hysteresis;
+		filterParameters.retainValids=retainValids;
+		filterParameters.instableValue=instableValue;
+		
+		/* Process the first band of rows, and let the worker threads process the others: */
+		if(numFilterThreads>1)
+			frameBarrier.synchronize();
+		filterBand(0);
+		if(numFilterThreads>1)
+			frameBarrier.synchronize();
 		
-		/* Go to the next averaging slot: */
-		if(++averagingSlotIndex==numAveragingSlots)
-			averagingSlotIndex=0U;
+		/* Finish the frame in the temporal filter: */
+		temporalFilter->finishFrame();
 		
-		/* Apply a spatial filter if requested: */
-		if(spatialFilter)
+		/* Stamp all tiles in which any row segment changed with the new frame's index: */
+		++outputFrameIndex;
+		unsigned int* tsPtr=tileStamps;
+		for(unsigned int ty=0;ty<numTiles[1];++ty)
 			{
-			for(int filterPass=0;filterPass<2;++filterPass)
+			unsigned int y0=ty*tileSize;
+			unsigned int y1=y0+tileSize<=size[1]?y0+tileSize:size[1];
+			for(unsigned int tx=0;tx<numTiles[0];++tx,++tsPtr)
 				{
-				/* Low-pass filter the entire output frame in-place: */
-				for(unsigned int x=0;x<size[0];++x)
-					{
-					/* Get a pointer to the current column: */
-					float* colPtr=newOutputFrame.getData<float>()+x;
-					
-					/* Filter the first pixel in the column: */
-					float lastVal=*colPtr;
-					*colPtr=(colPtr[0]*2.0f+colPtr[size[0]])/3.0f;
-					colPtr+=size[0];
-					
-					/* Filter the interior pixels in the column: */
-					for(unsigned int y=1;y<size[1]-1;++y,colPtr+=size[0])
-						{
-						/* Filter the pixel: */
-						float nextLastVal=*colPtr;
-						*colPtr=(lastVal+colPtr[0]*2.0f+colPtr[size[0]])*0.25f;
-						lastVal=nextLastVal;
-						}
-					
-					/* Filter the last pixel in the column: */
-					*colPtr=(lastVal+colPtr[0]*2.0f)/3.0f;
-					}
-				float* rowPtr=newOutputFrame.getData<float>();
-				for(unsigned int y=0;y<size[1];++y)
-					{
-					/* Filter the first pixel in the row: */
-					float lastVal=*rowPtr;
-					*rowPtr=(rowPtr[0]*2.0f+rowPtr[1])/3.0f;
-					++rowPtr;
-					
-					/* Filter the interior pixels in the row: */
-					for(unsigned int x=1;x<size[0]-1;++x,++rowPtr)
-						{
-						/* Filter the pixel: */
-						float nextLastVal=*rowPtr;
-						*rowPtr=(lastVal+rowPtr[0]*2.0f+rowPtr[1])*0.25f;
-						lastVal=nextLastVal;
-						}
-					
-					/* Filter the last pixel in the row: */
-					*rowPtr=(lastVal+rowPtr[0]*2.0f)/3.0f;
-					++rowPtr;
-					}
+				const unsigned char* rtcPtr=rowTileChanges+size_t(y0)*size_t(numTiles[0])+tx;
+				bool changed=false;
+				for(unsigned int y=y0;y<y1&&!changed;++y,rtcPtr+=numTiles[0])
+					changed=*rtcPtr!=0U;
+				if(changed)
+					*tsPtr=outputFrameIndex;
 				}
 			}
 		
+		/* Attach the tile stamps to the new output frame: */
+		memcpy(filterOutput+size_t(size[1])*size_t(size[0]),tileStamps,numTiles[1]*numTiles[0]*sizeof(unsigned int));
+		previousOutput=filterOutput;
+		
 		/* Finalize the new output frame in the output buffer: */
 		outputFrames.postNewValue();
 		
@@ -205,39 +193,52 @@ void* FrameFilter::filterThreadMethod(void)
 			(*outputFrameFunction)(newOutputFrame);
 		}
 	
+	/* Release the worker threads so they can check the shutdown flag: */
+	if(numFilterThreads>1)
+		frameBarrier.synchronize();
+	
 	return 0;
 	}
 
-FrameFilter::FrameFilter(const Size& sSize,unsigned int sNumAveragingSlots,const FrameFilter::PixelDepthCorrection* sPixelDepthCorrection,const PTransform& depthProjection,const Plane& basePlane)
+void* FrameFilter::workerThreadMethod(unsigned int bandIndex)
+	{
+	while(true)
+		{
+		/* Wait for the background filtering thread to start a new frame or shut down: */
+		frameBarrier.synchronize();
+		if(!runFilterThread)
+			break;
+		
+		/* Process this thread's band of rows: */
+		filterBand(bandIndex);
+		
+		/* Signal completion of the band to the background filtering thread: */
+		frameBarrier.synchronize();
+		}
+	
+	return 0;
+	}
+
+FrameFilter::FrameFilter(const Size& sSize,unsigned int sNumAveragingSlots,const FrameFilter::PixelDepthCorrection* sPixelDepthCorrection,const PTransform& depthProjection,const Plane& basePlane,unsigned int sNumFilterThreads,const char* temporalFilterName)
 	:size(sSize),
 	 pixelDepthCorrection(sPixelDepthCorrection),
-	 averagingBuffer(0),
-	 statBuffer(0),
+	 numFilterThreads(sNumFilterThreads>=1?(sNumFilterThreads<=size[1]/2?sNumFilterThreads:size[1]/2):1),
+	 workerThreads(0),
+	 frameBarrier(numFilterThreads),
+	 bandRows(0),haloBuffer(0),spatialFilterBuffer(0),
+	 filterOutput(0),previousOutput(0),
+	 numTiles(getNumTiles(size)),rowTileChanges(0),outputFrameIndex(0),tileStamps(0),
+	 numAveragingSlots(sNumAveragingSlots),
+	 temporalFilter(0),newTemporalFilter(0),newTemporalKernel(0),
 	 outputFrameFunction(0)
 	{
-	/* Initialize the input frame slot: */
-	inputFrameVersion=0;
-	
 	/* Initialize the valid depth range: */
 	setValidDepthInterval(0U,2046U);
 	
-	/* Initialize the averaging buffer: */
-	numAveragingSlots=sNumAveragingSlots;
-	averagingBuffer=new RawDepth[numAveragingSlots*size[1]*size[0]];
-	RawDepth* abPtr=averagingBuffer;
-	for(unsigned int i=0;i<numAveragingSlots;++i)
-		for(unsigned int y=0;y<size[1];++y)
-			for(unsigned int x=0;x<size[0];++x,++abPtr)
-				*abPtr=2048U; // Mark sample as invalid
-	averagingSlotIndex=0U;
-	
-	/* Initialize the statistics buffer: */
-	statBuffer=new unsigned int[size[1]*size[0]*3];
-	unsigned int* sbPtr=statBuffer;
-	for(unsigned int y=0;y<size[1];++y)
-		for(unsigned int x=0;x<size[0];++x)
-			for(int i=0;i<3;++i,++sbPtr)
-				*sbPtr=0;
+	/* Create the requested temporal filter: */
+	temporalKernel=FrameFilterKernels::findTemporalKernel("auto");
+	temporalFilter=TemporalFilter::create(temporalFilterName,size,numAveragingSlots);
+	temporalFilter->setTemporalKernel(temporalKernel);
 	
 	/* Initialize the stability criterion: */
 	minNumSamples=(numAveragingSlots+1)/2;
@@ -262,29 +263,59 @@ FrameFilter::FrameFilter(const Size& sSize,unsigned int sNumAveragingSlots,const
 		for(unsigned int x=0;x<size[0];++x,++vbPtr)
 			*vbPtr=float(-((double(x)+0.5)*basePlaneDic[0]+(double(y)+0.5)*basePlaneDic[1]+basePlaneDic[3])/basePlaneDic[2]);
 	
-	/* Initialize the output frame buffer: */
+	/* Initialize the output frame buffer, with room for the per-tile change stamps behind each frame's pixels: */
 	for(int i=0;i<3;++i)
-		outputFrames.getBuffer(i)=Kinect::FrameBuffer(size,size[1]*size[0]*sizeof(float));
+		outputFrames.getBuffer(i)=Kinect::FrameBuffer(size,size[1]*size[0]*sizeof(float)+numTiles[1]*numTiles[0]*sizeof(unsigned int));
+	
+	/* Initialize the change tracking state: */
+	rowTileChanges=new unsigned char[size[1]*numTiles[0]];
+	tileStamps=new unsigned int[numTiles[1]*numTiles[0]];
+	for(unsigned int i=0;i<numTiles[1]*numTiles[0];++i)
+		tileStamps[i]=0U;
+	
+	/* Split the frame into bands of rows of approximately equal height: */
+	bandRows=new unsigned int[numFilterThreads+1];
+	for(unsigned int i=0;i<=numFilterThreads;++i)
+		bandRows[i]=(size[1]*i)/numFilterThreads;
 	
-	/* Start the filtering thread: */
+	/* Allocate the halo buffer holding each band's first two and last two rows, and each band's spatial filter scratch rows: */
+	if(numFilterThreads>1)
+		haloBuffer=new float[numFilterThreads*4*size[0]];
+	spatialFilterBuffer=new float[numFilterThreads*4*size[0]];
+	
+	/* Start the filtering thread and the worker threads: */
 	runFilterThread=true;
 	filterThread.start(this,&FrameFilter::filterThreadMethod);
+	if(numFilterThreads>1)
+		{
+		workerThreads=new Threads::Thread[numFilterThreads-1];
+		for(unsigned int i=1;i<numFilterThreads;++i)
+			workerThreads[i-1].start(this,&FrameFilter::workerThreadMethod,i);
+		}
 	}
 
 FrameFilter::~FrameFilter(void)
 	{
 	/* Shut down the filtering thread: */
-	{
-	Threads::MutexCond::Lock inputLock(inputCond);
 	runFilterThread=false;
-	inputCond.signal();
-	}
+	inputMailbox.wakeup();
 	filterThread.join();
+	if(workerThreads!=0)
+		{
+		for(unsigned int i=1;i<numFilterThreads;++i)
+			workerThreads[i-1].join();
+		delete[] workerThreads;
+		}
 	
 	/* Release all allocated buffers: */
-	delete[] averagingBuffer;
-	delete[] statBuffer;
+	delete[] bandRows;
+	delete[] haloBuffer;
+	delete[] spatialFilterBuffer;
+	delete temporalFilter;
+	delete newTemporalFilter;
 	delete[] validBuffer;
+	delete[] rowTileChanges;
+	delete[] tileStamps;
 	delete outputFrameFunction;
 	}
 
@@ -346,6 +377,44 @@ void FrameFilter::setSpatialFilter(bool newSpatialFilter)
 	spatialFilter=newSpatialFilter;
 	}
 
+void FrameFilter::setTemporalFilter(const char* filterName)
+	{
+	/* Create the new temporal filter: */
+	TemporalFilter* filter=TemporalFilter::create(filterName,size,numAveragingSlots);
+	
+	/* Hand the new filter to the background filtering thread: */
+	Threads::Mutex::Lock temporalFilterLock(temporalFilterMutex);
+	filter->setTemporalKernel(temporalKernel);
+	delete newTemporalFilter;
+	newTemporalFilter=filter;
+	}
+
+const char* FrameFilter::getTemporalFilterName(void)
+	{
+	Threads::Mutex::Lock temporalFilterLock(temporalFilterMutex);
+	return newTemporalFilter!=0?newTemporalFilter->getName():temporalFilter->getName();
+	}
+
+void FrameFilter::setTemporalKernel(const char* kernelName)
+	{
+	/* Find the requested kernel: */
+	FrameFilterKernels::TemporalKernel kernel=FrameFilterKernels::findTemporalKernel(kernelName);
+	if(kernel==0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Temporal filter kernel %s is unknown or not supported by this CPU",kernelName);
+	
+	/* Set the new kernel in any pending temporal filter, and hand it to the background filtering thread to install in the current filter before the next frame: */
+	Threads::Mutex::Lock temporalFilterLock(temporalFilterMutex);
+	temporalKernel=kernel;
+	if(newTemporalFilter!=0)
+		newTemporalFilter->setTemporalKernel(temporalKernel);
+	newTemporalKernel=temporalKernel;
+	}
+
+const char* FrameFilter::getTemporalKernelName(void) const
+	{
+	return FrameFilterKernels::getTemporalKernelName(temporalKernel);
+	}
+
 void FrameFilter::setOutputFrameFunction(FrameFilter::OutputFrameFunction* newOutputFrameFunction)
 	{
 	delete outputFrameFunction;
@@ -354,12 +423,6 @@ void FrameFilter::setOutputFrameFunction(FrameFilter::OutputFrameFunction* newOu
 
 void FrameFilter::receiveRawFrame(const Kinect::FrameBuffer& newFrame)
 	{
-	Threads::MutexCond::Lock inputLock(inputCond);
-	
-	/* Store the new buffer in the input buffer: */
-	inputFrame=newFrame;
-	++inputFrameVersion;
-	
-	/* Signal the background thread: */
-	inputCond.signal();
+	/* Post the new frame to the background thread without copying it, overwriting any frame the background thread did not pick up yet: */
+	inputMailbox.post(newFrame);
 	}
@@ -25,43 +25,61 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #define FRAMEFILTER_INCLUDED
 
 #include <Threads/Thread.h>
-#include <Threads/MutexCond.h>
+#include <Threads/Mutex.h>
+#include <Threads/Barrier.h>
 #include <Threads/TripleBuffer.h>
 #include <Kinect/FrameBuffer.h>
 #include <Kinect/FrameSource.h>
 
 #include "Types.h"
+#include "FrameFilterKernels.h"
+#include "FrameMailbox.h"
 
 /* Forward declarations: */
 namespace Misc {
 template <class ParameterParam>
 class FunctionCall;
 }
+class TemporalFilter;
 
 class FrameFilter
 	{
 	/* Embedded classes: */
 	public:
-	typedef unsigned short RawDepth; // Data type for raw depth values
+	typedef FrameFilterKernels::RawDepth RawDepth; // Data type for raw depth values
 	typedef float FilteredDepth; // Data type for filtered depth values
 	typedef Misc::FunctionCall<const Kinect::FrameBuffer&> OutputFrameFunction; // Type for functions called when a new output frame is ready
-	typedef Kinect::FrameSource::DepthCorrection::PixelCorrection PixelDepthCorrection; // Type for per-pixel depth correction factors
+	typedef FrameFilterKernels::PixelDepthCorrection PixelDepthCorrection; // Type for per-pixel depth correction factors
+	
+	static const unsigned int tileSize=32; // Width and height of the square tiles in which changes between subsequent output frames are tracked
 	
 	/* Elements: */
 	private:
 	Size size; // Width and height of processed frames
 	const PixelDepthCorrection* pixelDepthCorrection; // Buffer of per-pixel depth correction coefficients
-	Threads::MutexCond inputCond; // Condition variable to signal arrival of a new input frame
-	Kinect::FrameBuffer inputFrame; // The most recent input frame
-	unsigned int inputFrameVersion; // Version number of input frame
+	FrameMailbox inputMailbox; // Lock-free mailbox handing the most recent input frame to the background filtering thread
 	volatile bool runFilterThread; // Flag to keep the background filtering thread running
 	Threads::Thread filterThread; // The background filtering thread
+	unsigned int numFilterThreads; // Number of threads cooperating on each frame, including the background filtering thread
+	Threads::Thread* workerThreads; // Array of additional worker threads
+	Threads::Barrier frameBarrier; // Barrier to synchronize the background filtering thread and the worker threads while processing a frame
+	unsigned int* bandRows; // Array of row indices delimiting the bands of rows processed by each thread
+	float* haloBuffer; // Buffer holding unfiltered copies of each band's first two and last two rows for the spatial filter
+	float* spatialFilterBuffer; // Buffer holding each band's scratch rows for the spatial filter
+	FrameFilterKernels::Parameters filterParameters; // Filter parameters for the frame currently being processed
+	float* filterOutput; // Pixel buffer of the output frame currently being processed
+	const float* previousOutput; // Pixel buffer of the most recently posted output frame, or null before the first frame
+	Size numTiles; // Number of change tracking tiles in each output frame
+	unsigned char* rowTileChanges; // Buffer of flags whether any pixel in each tile-wide segment of each row changed since the previous output frame
+	unsigned int outputFrameIndex; // Index of the most recently posted output frame
+	unsigned int* tileStamps; // Index of the most recent output frame in which any pixel in each tile changed
 	float minPlane[4]; // Plane equation of the lower bound of valid depth values in depth image space
 	float maxPlane[4]; // Plane equation of the upper bound of valid depth values in depth image space
-	unsigned int numAveragingSlots; // Number of slots in each pixel's averaging buffer
-	RawDepth* averagingBuffer; // Buffer to calculate running averages of each pixel's depth value
-	unsigned int averagingSlotIndex; // Index of averaging slot in which to store the next frame's depth values
-	unsigned int* statBuffer; // Buffer retaining the running means and variances of each pixel's depth value
+	unsigned int numAveragingSlots; // Length of the temporal filter's averaging window in frames
+	TemporalFilter* temporalFilter; // Filter removing temporal noise and detecting unstable pixels
+	Threads::Mutex temporalFilterMutex; // Mutex protecting changes to the temporal filter
+	TemporalFilter* newTemporalFilter; // New temporal filter to be installed before the next frame is processed
+	FrameFilterKernels::TemporalKernel newTemporalKernel; // New temporal kernel to be installed in the current temporal filter before the next frame is processed, or null
 	unsigned int minNumSamples; // Minimum number of valid samples needed to consider a pixel stable
 	unsigned int maxVariance; // Maximum variance to consider a pixel stable
 	float hysteresis; // Amount by which a new filtered value has to differ from the current value to update
@@ -69,18 +87,30 @@ class FrameFilter
 	float instableValue; // Value to assign to instable pixels if retainValids is false
 	bool spatialFilter; // Flag whether to apply a spatial filter to time-averaged depth values
 	float* validBuffer; // Buffer holding the most recent stable depth value for each pixel
+	FrameFilterKernels::TemporalKernel temporalKernel; // Kernel to update the boxcar temporal filter's state and calculate output values for one row of pixels
 	Threads::TripleBuffer<Kinect::FrameBuffer> outputFrames; // Triple buffer of output frames
 	OutputFrameFunction* outputFrameFunction; // Function called when a new output frame is ready
 	
 	/* Private methods: */
+	void filterBand(unsigned int bandIndex); // Processes one band of rows of the current frame
+	void findChangedTiles(unsigned int yBegin,unsigned int yEnd); // Compares the given band of rows of the current output frame against the previous output frame
 	void* filterThreadMethod(void); // Method for the background filtering thread
+	void* workerThreadMethod(unsigned int bandIndex); // Method for the worker threads
 	
 	/* Constructors and destructors: */
 	public:
-	FrameFilter(const Size& sSize,unsigned int sNumAveragingSlots,const PixelDepthCorrection* sPixelDepthCorrection,const PTransform& depthProjection,const Plane& basePlane); // Creates a filter for frames of the given size and the given running average length
+	FrameFilter(const Size& sSize,unsigned int sNumAveragingSlots,const PixelDepthCorrection* sPixelDepthCorrection,const PTransform& depthProjection,const Plane& basePlane,unsigned int sNumFilterThreads =1,const char* temporalFilterName ="boxcar"); // Creates a filter for frames of the given size and the given running average length, splitting each frame into bands processed by the given number of threads and using the temporal filter of the given name
 	~FrameFilter(void); // Destroys the frame filter
 	
 	/* Methods: */
+	static Size getNumTiles(const Size& frameSize) // Returns the number of change tracking tiles in an output frame of the given size
+		{
+		return Size((frameSize[0]+tileSize-1)/tileSize,(frameSize[1]+tileSize-1)/tileSize);
+		}
+	static const unsigned int* getTileStamps(const Kinect::FrameBuffer& outputFrame) // Returns the per-tile change stamps stored behind the pixels of an output frame, i.e., the index of the most recent output frame in which any pixel in each tile changed
+		{
+		return reinterpret_cast<const unsigned int*>(outputFrame.getData<float>()+size_t(outputFrame.getSize(1))*size_t(outputFrame.getSize(0)));
+		}
 	void setValidDepthInterval(unsigned int newMinDepth,unsigned int newMaxDepth); // Sets the interval of depth values considered by the depth image filter
 	void setValidElevationInterval(const PTransform& depthProjection,const Plane& basePlane,double newMinElevation,double newMaxElevation); // Sets the interval of elevations relative to the given base plane considered by the depth image filter
 	void setStableParameters(unsigned int newMinNumSamples,unsigned int newMaxVariance); // Sets the statistical properties to consider a pixel stable
@@ -88,8 +118,20 @@ class FrameFilter
 	void setRetainValids(bool newRetainValids); // Sets whether the filter retains previous stable values for instable pixels
 	void setInstableValue(float newInstableValue); // Sets the depth value to assign to instable pixels
 	void setSpatialFilter(bool newSpatialFilter); // Sets the spatial filtering flag
+	void setTemporalFilter(const char* filterName); // Replaces the temporal filter with a new one of the given name, starting with the next frame
+	const char* getTemporalFilterName(void); // Returns the name of the current temporal filter
+	void setTemporalKernel(const char* kernelName); // Selects the temporal filter kernel of the given name, or the fastest supported one if name is "auto"
+	const char* getTemporalKernelName(void) const; // Returns the name of the current temporal filter kernel
 	void setOutputFrameFunction(OutputFrameFunction* newOutputFrameFunction); // Sets the output function; adopts given functor object
-	void receiveRawFrame(const Kinect::FrameBuffer& newFrame); // Called to receive a new raw depth frame
+	void receiveRawFrame(const Kinect::FrameBuffer& newFrame); // Called to receive a new raw depth frame; never blocks
+	unsigned int getNumReceivedFrames(void) const // Returns the number of raw depth frames received so far
+		{
+		return inputMailbox.getNumPostedFrames();
+		}
+	unsigned int getNumDroppedFrames(void) const // Returns the number of received raw depth frames that were dropped because the filter was busy
+		{
+		return inputMailbox.getNumDroppedFrames();
+		}
 	bool lockNewFrame(void) // Locks the most recently produced output frame for reading; returns true if the locked frame is new
 		{
 		return outputFrames.lockNewValue();
@@ -0,0 +1,565 @@
+/***********************************************************************
+FrameFilterBenchmark - Utility to benchmark the temporal depth frame
+filter kernels against each other on pre-recorded or synthetic depth
+streams, and to verify that all kernels produce bit-identical results.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <Misc/SelfDestructPointer.h>
+#include <Math/Math.h>
+#include <Realtime/Time.h>
+
+#include "FrameFilterKernels.h"
+#include "TemporalFilter.h"
+#include "DepthFrameRecording.h"
+
+namespace {
+
+/* Number of bytes read or written per pixel by a temporal kernel: raw depth value, depth correction coefficients, averaging slot (read and written), statistics (read and written), valid value (read and written), and output value: */
+const size_t bytesPerPixel=sizeof(FrameFilterKernels::RawDepth)+sizeof(FrameFilterKernels::PixelDepthCorrection)+2*sizeof(FrameFilterKernels::RawDepth)+2*3*sizeof(unsigned int)+2*sizeof(float)+sizeof(float);
+
+/**************
+Helper classes:
+**************/
+
+class FilterState // Class holding the complete temporal filter state for one kernel
+	{
+	/* Elements: */
+	public:
+	Size size; // Frame size
+	unsigned int numAveragingSlots; // Number of slots in each pixel's averaging buffer
+	FrameFilterKernels::RawDepth* averagingBuffer; // Buffer to calculate running averages of each pixel's depth value
+	unsigned int averagingSlotIndex; // Index of averaging slot in which to store the next frame's depth values
+	unsigned int* statBuffer; // Buffer retaining the running means and variances of each pixel's depth value, as three consecutive planes
+	float* validBuffer; // Buffer holding the most recent stable depth value for each pixel
+	float* outputBuffer; // Buffer holding the most recent output frame
+	
+	/* Constructors and destructors: */
+	FilterState(const Size& sSize,unsigned int sNumAveragingSlots)
+		:size(sSize),numAveragingSlots(sNumAveragingSlots),
+		 averagingBuffer(new FrameFilterKernels::RawDepth[numAveragingSlots*size[1]*size[0]]),
+		 statBuffer(new unsigned int[size[1]*size[0]*3]),
+		 validBuffer(new float[size[1]*size[0]]),
+		 outputBuffer(new float[size[1]*size[0]])
+		{
+		reset();
+		}
+	~FilterState(void)
+		{
+		delete[] averagingBuffer;
+		delete[] statBuffer;
+		delete[] validBuffer;
+		delete[] outputBuffer;
+		}
+	
+	/* Methods: */
+	void reset(void) // Resets the filter state to its initial configuration
+		{
+		size_t numPixels=size_t(size[1])*size_t(size[0]);
+		for(size_t i=0;i<numAveragingSlots*numPixels;++i)
+			averagingBuffer[i]=FrameFilterKernels::invalidDepth;
+		averagingSlotIndex=0;
+		memset(statBuffer,0,numPixels*3*sizeof(unsigned int));
+		memset(validBuffer,0,numPixels*sizeof(float));
+		memset(outputBuffer,0,numPixels*sizeof(float));
+		}
+	void filterFrame(FrameFilterKernels::TemporalKernel kernel,const FrameFilterKernels::Parameters& parameters,const FrameFilterKernels::RawDepth* frame,const FrameFilterKernels::PixelDepthCorrection* pixelDepthCorrection) // Enters the given frame into the filter state
+		{
+		FrameFilterKernels::Row row;
+		row.input=frame;
+		row.pixelDepthCorrection=pixelDepthCorrection;
+		row.averaging=averagingBuffer+averagingSlotIndex*size[1]*size[0];
+		size_t planeSize=size_t(size[1])*size_t(size[0]);
+		row.numSamples=statBuffer;
+		row.sums=statBuffer+planeSize;
+		row.sumSquares=statBuffer+planeSize*2;
+		row.valid=validBuffer;
+		row.output=outputBuffer;
+		for(row.y=0;row.y<size[1];++row.y)
+			{
+			kernel(parameters,row);
+			row.input+=size[0];
+			row.pixelDepthCorrection+=size[0];
+			row.averaging+=size[0];
+			row.numSamples+=size[0];
+			row.sums+=size[0];
+			row.sumSquares+=size[0];
+			row.valid+=size[0];
+			row.output+=size[0];
+			}
+		if(++averagingSlotIndex==numAveragingSlots)
+			averagingSlotIndex=0U;
+		}
+	bool operator==(const FilterState& other) const // Returns true if the two filter states are bit-identical
+		{
+		size_t numPixels=size_t(size[1])*size_t(size[0]);
+		return averagingSlotIndex==other.averagingSlotIndex&&
+		       memcmp(averagingBuffer,other.averagingBuffer,numAveragingSlots*numPixels*sizeof(FrameFilterKernels::RawDepth))==0&&
+		       memcmp(statBuffer,other.statBuffer,numPixels*3*sizeof(unsigned int))==0&&
+		       memcmp(validBuffer,other.validBuffer,numPixels*sizeof(float))==0&&
+		       memcmp(outputBuffer,other.outputBuffer,numPixels*sizeof(float))==0;
+		}
+	};
+
+void spatialFilterReference(const Size& size,float* frame) // Applies the original column-by-column and row-by-row spatial filter to the given frame in-place
+	{
+	for(int filterPass=0;filterPass<2;++filterPass)
+		{
+		/* Low-pass filter the entire frame in-place: */
+		for(unsigned int x=0;x<size[0];++x)
+			{
+			/* Get a pointer to the current column: */
+			float* colPtr=frame+x;
+			
+			/* Filter the first pixel in the column: */
+			float lastVal=*colPtr;
+			*colPtr=(colPtr[0]*2.0f+colPtr[size[0]])/3.0f;
+			colPtr+=size[0];
+			
+			/* Filter the interior pixels in the column: */
+			for(unsigned int y=1;y<size[1]-1;++y,colPtr+=size[0])
+				{
+				/* Filter the pixel: */
+				float nextLastVal=*colPtr;
+				*colPtr=(lastVal+colPtr[0]*2.0f+colPtr[size[0]])*0.25f;
+				lastVal=nextLastVal;
+				}
+			
+			/* Filter the last pixel in the column: */
+			*colPtr=(lastVal+colPtr[0]*2.0f)/3.0f;
+			}
+		float* rowPtr=frame;
+		for(unsigned int y=0;y<size[1];++y)
+			{
+			/* Filter the first pixel in the row: */
+			float lastVal=*rowPtr;
+			*rowPtr=(rowPtr[0]*2.0f+rowPtr[1])/3.0f;
+			++rowPtr;
+			
+			/* Filter the interior pixels in the row: */
+			for(unsigned int x=1;x<size[0]-1;++x,++rowPtr)
+				{
+				/* Filter the pixel: */
+				float nextLastVal=*rowPtr;
+				*rowPtr=(lastVal+rowPtr[0]*2.0f+rowPtr[1])*0.25f;
+				lastVal=nextLastVal;
+				}
+			
+			/* Filter the last pixel in the row: */
+			*rowPtr=(lastVal+rowPtr[0]*2.0f)/3.0f;
+			++rowPtr;
+			}
+		}
+	}
+
+void printUsage(void)
+	{
+	std::cout<<"Usage: FrameFilterBenchmark [option 1] ... [option n] [<frame file name prefix>]"<<std::endl;
+	std::cout<<"  Options:"<<std::endl;
+	std::cout<<"  -h"<<std::endl;
+	std::cout<<"     Prints this help message"<<std::endl;
+	std::cout<<"  -n <max num frames>"<<std::endl;
+	std::cout<<"     Maximum number of depth frames to load from the recording, or number of"<<std::endl;
+	std::cout<<"     synthetic depth frames"<<std::endl;
+	std::cout<<"     Default: 300"<<std::endl;
+	std::cout<<"  -synthetic <width> <height>"<<std::endl;
+	std::cout<<"     Runs on a synthetic noisy depth stream of the given frame size instead of"<<std::endl;
+	std::cout<<"     a recording; the synthetic stream is the same on every run"<<std::endl;
+	std::cout<<"  -r <num repetitions>"<<std::endl;
+	std::cout<<"     Number of times the loaded frames are run through each kernel"<<std::endl;
+	std::cout<<"     Default: 10"<<std::endl;
+	std::cout<<"  -nas <num averaging slots>"<<std::endl;
+	std::cout<<"     Sets the number of averaging slots in the frame filter"<<std::endl;
+	std::cout<<"     Default: 30"<<std::endl;
+	std::cout<<"  -sp <min num samples> <max variance>"<<std::endl;
+	std::cout<<"     Sets the frame filter parameters minimum number of valid samples and"<<std::endl;
+	std::cout<<"     maximum sample variance before convergence"<<std::endl;
+	std::cout<<"     Default: 10 2"<<std::endl;
+	std::cout<<"  -he <hysteresis envelope>"<<std::endl;
+	std::cout<<"     Sets the size of the hysteresis envelope used for jitter removal"<<std::endl;
+	std::cout<<"     Default: 0.1"<<std::endl;
+	std::cout<<"  -dr <min depth> <max depth>"<<std::endl;
+	std::cout<<"     Sets the interval of valid raw depth values"<<std::endl;
+	std::cout<<"     Default: 0 2046"<<std::endl;
+	std::cout<<"  -hf <num hand frames>"<<std::endl;
+	std::cout<<"     Number of frames during which a simulated hand digs a hole into the"<<std::endl;
+	std::cout<<"     surface in the temporal filter settling test"<<std::endl;
+	std::cout<<"     Default: 30"<<std::endl;
+	std::cout<<"  -st <settling tolerance>"<<std::endl;
+	std::cout<<"     Maximum difference between output values with and without the simulated"<<std::endl;
+	std::cout<<"     hand at which the surface is considered settled"<<std::endl;
+	std::cout<<"     Default: 1.0"<<std::endl;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Process command line parameters: */
+	const char* frameFilePrefix=0;
+	Size syntheticSize(0,0);
+	unsigned int maxNumFrames=300;
+	unsigned int numRepetitions=10;
+	unsigned int numAveragingSlots=30;
+	unsigned int minNumSamples=10;
+	unsigned int maxVariance=2;
+	float hysteresis=0.1f;
+	unsigned int minDepth=0;
+	unsigned int maxDepth=2046;
+	unsigned int numHandFrames=30;
+	float settlingTolerance=1.0f;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"h")==0)
+				{
+				printUsage();
+				return 0;
+				}
+			else if(strcasecmp(argv[i]+1,"n")==0)
+				{
+				++i;
+				maxNumFrames=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"synthetic")==0)
+				{
+				for(int j=0;j<2;++j)
+					{
+					++i;
+					syntheticSize[j]=atoi(argv[i]);
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"r")==0)
+				{
+				++i;
+				numRepetitions=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"nas")==0)
+				{
+				++i;
+				numAveragingSlots=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"sp")==0)
+				{
+				++i;
+				minNumSamples=atoi(argv[i]);
+				++i;
+				maxVariance=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"he")==0)
+				{
+				++i;
+				hysteresis=float(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"dr")==0)
+				{
+				++i;
+				minDepth=atoi(argv[i]);
+				++i;
+				maxDepth=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"hf")==0)
+				{
+				++i;
+				numHandFrames=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"st")==0)
+				{
+				++i;
+				settlingTolerance=float(atof(argv[i]));
+				}
+			else
+				std::cerr<<"Ignoring unrecognized command line switch "<<argv[i]<<std::endl;
+			}
+		else if(frameFilePrefix==0)
+			frameFilePrefix=argv[i];
+		else
+			std::cerr<<"Ignoring extra command line argument "<<argv[i]<<std::endl;
+		}
+	if(frameFilePrefix==0&&(syntheticSize[0]<3U||syntheticSize[1]<3U))
+		{
+		printUsage();
+		return 1;
+		}
+	
+	try
+		{
+		/* Load the recorded depth frames, or synthesize a depth stream: */
+		Misc::SelfDestructPointer<DepthFrameRecording> recordingPtr;
+		if(frameFilePrefix!=0)
+			{
+			std::cout<<"Loading up to "<<maxNumFrames<<" depth frames from "<<frameFilePrefix<<"..."<<std::flush;
+			recordingPtr.setTarget(new DepthFrameRecording(frameFilePrefix,maxNumFrames));
+			}
+		else
+			{
+			std::cout<<"Synthesizing "<<maxNumFrames<<" depth frames..."<<std::flush;
+			recordingPtr.setTarget(new DepthFrameRecording(syntheticSize,maxNumFrames));
+			}
+		DepthFrameRecording& recording=*recordingPtr;
+		const Size& size=recording.getFrameSize();
+		std::cout<<" done, "<<recording.getNumFrames()<<" frames of "<<size[0]<<"x"<<size[1]<<" pixels"<<std::endl;
+		
+		/* Set up the filter parameters in the same way as FrameFilter::setValidDepthInterval: */
+		FrameFilterKernels::Parameters parameters;
+		parameters.width=size[0];
+		for(int i=0;i<2;++i)
+			{
+			parameters.minPlane[i]=0.0f;
+			parameters.maxPlane[i]=0.0f;
+			}
+		parameters.minPlane[2]=1.0f;
+		parameters.minPlane[3]=-float(minDepth)+0.5f;
+		parameters.maxPlane[2]=1.0f;
+		parameters.maxPlane[3]=-float(maxDepth)-0.5f;
+		parameters.minNumSamples=minNumSamples;
+		parameters.maxVariance=maxVariance;
+		parameters.hysteresis=hysteresis;
+		parameters.retainValids=true;
+		parameters.instableValue=0.0f;
+		
+		/* Verify all supported kernels against the scalar reference kernel, frame by frame: */
+		unsigned int numKernels=FrameFilterKernels::getNumTemporalKernels();
+		FilterState reference(size,numAveragingSlots);
+		FilterState test(size,numAveragingSlots);
+		bool allExact=true;
+		for(unsigned int kernelIndex=1;kernelIndex<numKernels;++kernelIndex)
+			{
+			if(!FrameFilterKernels::isTemporalKernelSupported(kernelIndex))
+				continue;
+			FrameFilterKernels::TemporalKernel kernel=FrameFilterKernels::getTemporalKernel(kernelIndex);
+			
+			/* Run both kernels with retained and reset instable values: */
+			unsigned int firstMismatch=~0U;
+			for(int retain=0;retain<2&&firstMismatch==~0U;++retain)
+				{
+				parameters.retainValids=retain!=0;
+				reference.reset();
+				test.reset();
+				for(unsigned int frameIndex=0;frameIndex<recording.getNumFrames()&&firstMismatch==~0U;++frameIndex)
+					{
+					const FrameFilterKernels::RawDepth* frame=recording.getFrame(frameIndex).getData<FrameFilterKernels::RawDepth>();
+					reference.filterFrame(FrameFilterKernels::getTemporalKernel(0),parameters,frame,recording.getPixelDepthCorrection());
+					test.filterFrame(kernel,parameters,frame,recording.getPixelDepthCorrection());
+					if(!(test==reference))
+						firstMismatch=frameIndex;
+					}
+				}
+			parameters.retainValids=true;
+			
+			std::cout<<"Kernel "<<FrameFilterKernels::getTemporalKernelName(kernelIndex)<<": ";
+			if(firstMismatch==~0U)
+				std::cout<<"bit-identical to scalar kernel"<<std::endl;
+			else
+				{
+				std::cout<<"MISMATCH against scalar kernel in frame "<<firstMismatch<<std::endl;
+				allExact=false;
+				}
+			}
+		
+		/* Time all supported kernels: */
+		std::cout<<std::endl<<"Filter state: "<<std::fixed<<std::setprecision(1)<<double(size_t(size[1])*size_t(size[0])*(numAveragingSlots*sizeof(FrameFilterKernels::RawDepth)+3*sizeof(unsigned int)+sizeof(float)))/(1024.0*1024.0)<<" MB";
+		std::cout<<", memory traffic per frame: "<<double(size_t(size[1])*size_t(size[0])*bytesPerPixel)/(1024.0*1024.0)<<" MB"<<std::endl;
+		std::cout<<std::endl<<std::setw(10)<<"Kernel"<<std::setw(14)<<"ms/frame"<<std::setw(14)<<"Mpixel/s"<<std::setw(10)<<"GB/s"<<std::setw(10)<<"Speedup"<<std::endl;
+		double scalarTime=0.0;
+		size_t numPixels=size_t(recording.getNumFrames())*size_t(numRepetitions)*size_t(size[1])*size_t(size[0]);
+		for(unsigned int kernelIndex=0;kernelIndex<numKernels;++kernelIndex)
+			{
+			if(!FrameFilterKernels::isTemporalKernelSupported(kernelIndex))
+				{
+				std::cout<<std::setw(10)<<FrameFilterKernels::getTemporalKernelName(kernelIndex)<<"  not supported by this CPU"<<std::endl;
+				continue;
+				}
+			FrameFilterKernels::TemporalKernel kernel=FrameFilterKernels::getTemporalKernel(kernelIndex);
+			test.reset();
+			Realtime::TimePointMonotonic timer;
+			for(unsigned int repetition=0;repetition<numRepetitions;++repetition)
+				for(unsigned int frameIndex=0;frameIndex<recording.getNumFrames();++frameIndex)
+					test.filterFrame(kernel,parameters,recording.getFrame(frameIndex).getData<FrameFilterKernels::RawDepth>(),recording.getPixelDepthCorrection());
+			double elapsed=timer.setAndDiff();
+			if(kernelIndex==0)
+				scalarTime=elapsed;
+			
+			std::cout<<std::setw(10)<<FrameFilterKernels::getTemporalKernelName(kernelIndex);
+			std::cout<<std::setw(14)<<std::fixed<<std::setprecision(3)<<elapsed*1000.0/double(recording.getNumFrames()*numRepetitions);
+			std::cout<<std::setw(14)<<std::setprecision(1)<<double(numPixels)/(elapsed*1.0e6);
+			std::cout<<std::setw(10)<<std::setprecision(2)<<double(numPixels*bytesPerPixel)/(elapsed*1.0e9);
+			std::cout<<std::setw(9)<<std::setprecision(2)<<scalarTime/elapsed<<'x'<<std::endl;
+			}
+		
+		/* Verify and time the fused spatial filter against the original separable filter, using the most recent temporal filter output as input: */
+		size_t frameSize=size_t(size[1])*size_t(size[0]);
+		float* referenceFrame=new float[frameSize];
+		float* testFrame=new float[frameSize];
+		float* scratch=new float[4*size[0]];
+		memcpy(referenceFrame,test.outputBuffer,frameSize*sizeof(float));
+		spatialFilterReference(size,referenceFrame);
+		memcpy(testFrame,test.outputBuffer,frameSize*sizeof(float));
+		FrameFilterKernels::spatialFilterBand(size[0],size[1],0,size[1],0,0,scratch,testFrame);
+		bool spatialExact=memcmp(testFrame,referenceFrame,frameSize*sizeof(float))==0;
+		std::cout<<std::endl<<"Fused spatial filter: "<<(spatialExact?"bit-identical to separable filter":"MISMATCH against separable filter")<<std::endl;
+		allExact=allExact&&spatialExact;
+		
+		unsigned int numSpatialRuns=recording.getNumFrames()*numRepetitions;
+		std::cout<<std::endl<<std::setw(10)<<"Filter"<<std::setw(14)<<"ms/frame"<<std::setw(14)<<"Mpixel/s"<<std::setw(10)<<"Speedup"<<std::endl;
+		double separableTime=0.0;
+		for(int fused=0;fused<2;++fused)
+			{
+			memcpy(testFrame,test.outputBuffer,frameSize*sizeof(float));
+			Realtime::TimePointMonotonic timer;
+			for(unsigned int run=0;run<numSpatialRuns;++run)
+				{
+				if(fused)
+					FrameFilterKernels::spatialFilterBand(size[0],size[1],0,size[1],0,0,scratch,testFrame);
+				else
+					spatialFilterReference(size,testFrame);
+				}
+			double elapsed=timer.setAndDiff();
+			if(!fused)
+				separableTime=elapsed;
+			
+			std::cout<<std::setw(10)<<(fused?"fused":"separable");
+			std::cout<<std::setw(14)<<std::fixed<<std::setprecision(3)<<elapsed*1000.0/double(numSpatialRuns);
+			std::cout<<std::setw(14)<<std::setprecision(1)<<double(frameSize)*double(numSpatialRuns)/(elapsed*1.0e6);
+			std::cout<<std::setw(9)<<std::setprecision(2)<<separableTime/elapsed<<'x'<<std::endl;
+			}
+		delete[] referenceFrame;
+		delete[] testFrame;
+		delete[] scratch;
+		
+		/* Compare the settling behavior of all temporal filters after a simulated hand reshapes the surface and leaves the box: */
+		unsigned int handStart=numAveragingSlots*2;
+		unsigned int handEnd=handStart+numHandFrames;
+		unsigned int maxSettlingFrames=numAveragingSlots*10;
+		unsigned int handRect[2][2]; // Pixel rectangle covered by the simulated hand
+		for(int i=0;i<2;++i)
+			{
+			handRect[i][0]=size[i]*3/8;
+			handRect[i][1]=size[i]*5/8;
+			}
+		std::cout<<std::endl<<"Settling test: hand digs a "<<(handRect[0][1]-handRect[0][0])<<"x"<<(handRect[1][1]-handRect[1][0])<<" pixel hole for "<<numHandFrames<<" frames"<<std::endl;
+		unsigned int numHandPixels=(handRect[0][1]-handRect[0][0])*(handRect[1][1]-handRect[1][0]);
+		std::cout<<std::endl<<std::setw(10)<<"Filter"<<std::setw(14)<<"bytes/pixel"<<std::setw(14)<<"ms/frame"<<std::setw(28)<<"Frames to settle 99%/100%"<<std::endl;
+		static const char* temporalFilterNames[]={"boxcar","ema","kalman"};
+		FrameFilterKernels::RawDepth* handFrame=new FrameFilterKernels::RawDepth[frameSize];
+		FrameFilterKernels::RawDepth* dugFrame=new FrameFilterKernels::RawDepth[frameSize];
+		float* buffers[4]; // Valid and output buffers for the filters with and without the hand
+		for(int i=0;i<4;++i)
+			buffers[i]=new float[frameSize];
+		for(int filterIndex=0;filterIndex<3;++filterIndex)
+			{
+			/* Create two instances of the temporal filter, one seeing the hand dig the hole, and one seeing the hole from the start: */
+			TemporalFilter* filters[2];
+			for(int i=0;i<2;++i)
+				{
+				filters[i]=TemporalFilter::create(temporalFilterNames[filterIndex],size,numAveragingSlots);
+				memset(buffers[i*2],0,frameSize*sizeof(float));
+				}
+			
+			/* Run the filters until the output with the hand settles to the output without the hand: */
+			unsigned int mostlySettlingFrames=~0U; // Number of frames until 99% of pixels settled
+			unsigned int settlingFrames=~0U; // Number of frames until all pixels settled
+			double filterTime=0.0;
+			unsigned int frameIndex;
+			for(frameIndex=0;frameIndex<handEnd+maxSettlingFrames&&settlingFrames==~0U;++frameIndex)
+				{
+				const FrameFilterKernels::RawDepth* frame=recording.getFrame(frameIndex%recording.getNumFrames()).getData<FrameFilterKernels::RawDepth>();
+				
+				/* Dig a hole into the surface under the hand rectangle, and move the simulated hand up and down over it: */
+				memcpy(dugFrame,frame,frameSize*sizeof(FrameFilterKernels::RawDepth));
+				memcpy(handFrame,frame,frameSize*sizeof(FrameFilterKernels::RawDepth));
+				unsigned int handHeight=40+(frameIndex*37U)%80U; // Same pseudo-random hand motion on every platform
+				for(unsigned int y=handRect[1][0];y<handRect[1][1];++y)
+					for(unsigned int x=handRect[0][0];x<handRect[0][1];++x)
+						{
+						FrameFilterKernels::RawDepth d=frame[y*size[0]+x];
+						dugFrame[y*size[0]+x]=d+20U<maxDepth?d+20U:d;
+						if(frameIndex>=handEnd)
+							handFrame[y*size[0]+x]=dugFrame[y*size[0]+x];
+						else if(frameIndex>=handStart)
+							handFrame[y*size[0]+x]=d>handHeight?d-handHeight:0;
+						}
+				
+				/* Run both filters on the entire frame: */
+				for(int i=0;i<2;++i)
+					{
+					TemporalFilter::Band band;
+					band.yBegin=0;
+					band.yEnd=size[1];
+					band.input=i==0?handFrame:dugFrame;
+					band.pixelDepthCorrection=recording.getPixelDepthCorrection();
+					band.valid=buffers[i*2+0];
+					band.output=buffers[i*2+1];
+					Realtime::TimePointMonotonic timer;
+					filters[i]->filterBand(parameters,band);
+					filters[i]->finishFrame();
+					if(i==0)
+						filterTime+=timer.setAndDiff();
+					}
+				
+				/* Count the pixels under the hand rectangle whose output has not yet settled after the hand left: */
+				if(frameIndex>=handEnd)
+					{
+					unsigned int numUnsettled=0;
+					for(unsigned int y=handRect[1][0];y<handRect[1][1];++y)
+						for(unsigned int x=handRect[0][0];x<handRect[0][1];++x)
+							if(Math::abs(buffers[1][y*size[0]+x]-buffers[3][y*size[0]+x])>settlingTolerance)
+								++numUnsettled;
+					if(mostlySettlingFrames==~0U&&numUnsettled*100U<=numHandPixels)
+						mostlySettlingFrames=frameIndex+1-handEnd;
+					if(numUnsettled==0U)
+						settlingFrames=frameIndex+1-handEnd;
+					}
+				}
+			
+			std::cout<<std::setw(10)<<filters[0]->getName();
+			std::cout<<std::setw(14)<<filters[0]->getStateSize();
+			std::cout<<std::setw(14)<<std::fixed<<std::setprecision(3)<<filterTime*1000.0/double(frameIndex);
+			for(int i=0;i<2;++i)
+				{
+				unsigned int frames=i==0?mostlySettlingFrames:settlingFrames;
+				if(frames!=~0U)
+					std::cout<<std::setw(14)<<frames;
+				else
+					std::cout<<std::setw(10)<<">"<<maxSettlingFrames;
+				}
+			std::cout<<std::endl;
+			
+			for(int i=0;i<2;++i)
+				delete filters[i];
+			}
+		delete[] handFrame;
+		delete[] dugFrame;
+		for(int i=0;i<4;++i)
+			delete[] buffers[i];
+		
+		return allExact?0:1;
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Terminated program due to exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	}
@@ -0,0 +1,553 @@
+/***********************************************************************
+FrameFilterKernels - Per-row kernels implementing the temporal part of
+the depth frame filter, i.e., running averages, stability tests, and
+hysteresis, in scalar and SIMD versions selected at run-time, and
+per-band kernels implementing the spatial part of the depth frame
+filter.
+Copyright (c) 2012-2025 Oliver Kreylos
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "FrameFilterKernels.h"
+
+#include <string.h>
+#include <Math/Math.h>
+
+/* Check whether SIMD kernels can be compiled for the target architecture: */
+#if defined(__GNUC__)&&(defined(__x86_64__)||defined(__i386__))
+#define FRAMEFILTERKERNELS_X86 1
+#include <immintrin.h>
+#else
+#define FRAMEFILTERKERNELS_X86 0
+#endif
+
+namespace FrameFilterKernels {
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline void filterPixel(const Parameters& p,float px,float py,RawDepth input,const PixelDepthCorrection& pdc,RawDepth& averaging,unsigned int& numSamples,unsigned int& sum,unsigned int& sumSquares,float& valid,float& output)
+	{
+	unsigned int oldVal=averaging;
+	unsigned int newVal=input;
+	
+	/* Depth-correct the new value: */
+	float newCVal=pdc.correct(newVal);
+	
+	/* Plug the depth-corrected new value into the minimum and maximum plane equations to determine its validity: */
+	float minD=p.minPlane[0]*px+p.minPlane[1]*py+p.minPlane[2]*newCVal+p.minPlane[3];
+	float maxD=p.maxPlane[0]*px+p.maxPlane[1]*py+p.maxPlane[2]*newCVal+p.maxPlane[3];
+	if(minD>=0.0f&&maxD<=0.0f)
+		{
+		/* Store the new input value: */
+		averaging=newVal;
+		
+		/* Update the pixel's statistics: */
+		++numSamples;
+		sum+=newVal;
+		sumSquares+=newVal*newVal;
+		
+		/* Check if the previous value in the averaging buffer was valid: */
+		if(oldVal!=invalidDepth)
+			{
+			--numSamples;
+			sum-=oldVal;
+			sumSquares-=oldVal*oldVal;
+			}
+		}
+	else if(!p.retainValids)
+		{
+		/* Store an invalid input value: */
+		averaging=invalidDepth;
+		
+		/* Check if the previous value in the averaging buffer was valid: */
+		if(oldVal!=invalidDepth)
+			{
+			--numSamples;
+			sum-=oldVal;
+			sumSquares-=oldVal*oldVal;
+			}
+		}
+	
+	/* Check if the pixel is considered "stable": */
+	if(numSamples>=p.minNumSamples&&sumSquares*numSamples<=p.maxVariance*numSamples*numSamples+sum*sum)
+		{
+		/* Check if the new depth-corrected running mean is outside the previous value's envelope: */
+		float newFiltered=pdc.correct(float(sum)/float(numSamples));
+		if(Math::abs(newFiltered-valid)>=p.hysteresis)
+			{
+			/* Set the output pixel value to the depth-corrected running mean: */
+			output=valid=newFiltered;
+			}
+		else
+			{
+			/* Leave the pixel at its previous value: */
+			output=valid;
+			}
+		}
+	else if(p.retainValids)
+		{
+		/* Leave the pixel at its previous value: */
+		output=valid;
+		}
+	else
+		{
+		/* Assign default value to instable pixels: */
+		output=p.instableValue;
+		}
+	}
+
+inline void filterPixels(const Parameters& p,const Row& row,unsigned int xBegin,unsigned int xEnd)
+	{
+	/* Process the given pixel range one pixel at a time: */
+	float py=float(row.y)+0.5f;
+	for(unsigned int x=xBegin;x<xEnd;++x)
+		filterPixel(p,float(x)+0.5f,py,row.input[x],row.pixelDepthCorrection[x],row.averaging[x],row.numSamples[x],row.sums[x],row.sumSquares[x],row.valid[x],row.output[x]);
+	}
+
+inline void filterVertical(unsigned int width,const float* above,const float* center,const float* below,float* result)
+	{
+	/* Low-pass filter the row against its neighbors, using edge weights if either neighbor does not exist: */
+	unsigned int x;
+	if(above!=0&&below!=0)
+		{
+		for(x=0;x<width;++x)
+			result[x]=(above[x]+center[x]*2.0f+below[x])*0.25f;
+		}
+	else if(below!=0)
+		{
+		for(x=0;x<width;++x)
+			result[x]=(center[x]*2.0f+below[x])/3.0f;
+		}
+	else
+		{
+		for(x=0;x<width;++x)
+			result[x]=(above[x]+center[x]*2.0f)/3.0f;
+		}
+	}
+
+inline void filterHorizontal(unsigned int width,const float* row,float* result)
+	{
+	/* Low-pass filter the row, using edge weights for its first and last pixels: */
+	result[0]=(row[0]*2.0f+row[1])/3.0f;
+	for(unsigned int x=1;x<width-1;++x)
+		result[x]=(row[x-1]+row[x]*2.0f+row[x+1])*0.25f;
+	result[width-1]=(row[width-2]+row[width-1]*2.0f)/3.0f;
+	}
+
+inline const float* unfilteredRow(unsigned int width,unsigned int yBegin,unsigned int yEnd,const float* haloAbove,const float* haloBelow,const float* frame,unsigned int y)
+	{
+	/* Return the row from the halo buffers if it is outside the band: */
+	if(y<yBegin)
+		return haloAbove+(y+2-yBegin)*width;
+	else if(y>=yEnd)
+		return haloBelow+(y-yEnd)*width;
+	else
+		return frame+y*width;
+	}
+
+/**************
+Scalar kernel:
+**************/
+
+void temporalKernelScalar(const Parameters& parameters,const Row& row)
+	{
+	filterPixels(parameters,row,0,parameters.width);
+	}
+
+bool isScalarSupported(void)
+	{
+	return true;
+	}
+
+#if FRAMEFILTERKERNELS_X86
+
+/*********************************************************************
+The SIMD kernels below replicate the scalar kernel's arithmetic
+operation by operation, without fused multiply-adds and in the same
+evaluation order, so that their results are bit-identical. Integer
+statistics wrap around modulo 2^32 exactly like the scalar code, and
+unsigned-to-float conversions are split into two exactly representable
+halves so that they round exactly like scalar conversions.
+*********************************************************************/
+
+bool isPixelCorrectionPacked(void)
+	{
+	/* SIMD kernels load pixel correction coefficients as pairs of (scale, offset) floats: */
+	return sizeof(PixelDepthCorrection)==2*sizeof(float);
+	}
+
+/*****************
+SSE4.1 kernel:
+*****************/
+
+__attribute__((target("sse4.1")))
+inline __m128 convertUnsigned(__m128i v)
+	{
+	__m128 hi=_mm_cvtepi32_ps(_mm_srli_epi32(v,16));
+	__m128 lo=_mm_cvtepi32_ps(_mm_and_si128(v,_mm_set1_epi32(0xffff)));
+	return _mm_add_ps(_mm_mul_ps(hi,_mm_set1_ps(65536.0f)),lo);
+	}
+
+__attribute__((target("sse4.1")))
+inline __m128i lessEqualUnsigned(__m128i a,__m128i b)
+	{
+	return _mm_cmpeq_epi32(_mm_max_epu32(a,b),b);
+	}
+
+__attribute__((target("sse4.1")))
+void temporalKernelSSE41(const Parameters& p,const Row& row)
+	{
+	/* Broadcast the frame parameters: */
+	float py=float(row.y)+0.5f;
+	__m128 zero=_mm_setzero_ps();
+	__m128 half=_mm_set1_ps(0.5f);
+	__m128 minP0=_mm_set1_ps(p.minPlane[0]);
+	__m128 minP1py=_mm_set1_ps(p.minPlane[1]*py);
+	__m128 minP2=_mm_set1_ps(p.minPlane[2]);
+	__m128 minP3=_mm_set1_ps(p.minPlane[3]);
+	__m128 maxP0=_mm_set1_ps(p.maxPlane[0]);
+	__m128 maxP1py=_mm_set1_ps(p.maxPlane[1]*py);
+	__m128 maxP2=_mm_set1_ps(p.maxPlane[2]);
+	__m128 maxP3=_mm_set1_ps(p.maxPlane[3]);
+	__m128i invalid=_mm_set1_epi32(invalidDepth);
+	__m128i allOnes=_mm_set1_epi32(-1);
+	__m128i notRetain=p.retainValids?_mm_setzero_si128():allOnes;
+	__m128i minNumSamples=_mm_set1_epi32(p.minNumSamples);
+	__m128i maxVariance=_mm_set1_epi32(p.maxVariance);
+	__m128 hysteresis=_mm_set1_ps(p.hysteresis);
+	__m128 absMask=_mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 instable=_mm_set1_ps(p.instableValue);
+	__m128i xv=_mm_setr_epi32(0,1,2,3);
+	__m128i xStep=_mm_set1_epi32(4);
+	
+	/* Process groups of four pixels: */
+	unsigned int x;
+	for(x=0;x+4<=p.width;x+=4,xv=_mm_add_epi32(xv,xStep))
+		{
+		/* Load new and old raw depth values: */
+		__m128i newVal=_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row.input+x)));
+		__m128i oldVal=_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row.averaging+x)));
+		
+		/* Load and de-interleave the pixel depth correction coefficients: */
+		const float* pdcPtr=reinterpret_cast<const float*>(row.pixelDepthCorrection+x);
+		__m128 pdc0=_mm_loadu_ps(pdcPtr);
+		__m128 pdc1=_mm_loadu_ps(pdcPtr+4);
+		__m128 scale=_mm_shuffle_ps(pdc0,pdc1,_MM_SHUFFLE(2,0,2,0));
+		__m128 offset=_mm_shuffle_ps(pdc0,pdc1,_MM_SHUFFLE(3,1,3,1));
+		
+		/* Depth-correct the new values and test them against the minimum and maximum planes: */
+		__m128 px=_mm_add_ps(_mm_cvtepi32_ps(xv),half);
+		__m128 newCVal=_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(newVal),scale),offset);
+		__m128 minD=_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(minP0,px),minP1py),_mm_mul_ps(minP2,newCVal)),minP3);
+		__m128 maxD=_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(maxP0,px),maxP1py),_mm_mul_ps(maxP2,newCVal)),maxP3);
+		__m128i valid=_mm_castps_si128(_mm_and_ps(_mm_cmpge_ps(minD,zero),_mm_cmple_ps(maxD,zero)));
+		
+		/* Determine which old values leave the averaging buffer: */
+		__m128i update=_mm_or_si128(valid,notRetain);
+		__m128i remove=_mm_andnot_si128(_mm_cmpeq_epi32(oldVal,invalid),update);
+		
+		/* Update the averaging buffer: */
+		__m128i newAveraging=_mm_blendv_epi8(_mm_blendv_epi8(oldVal,invalid,update),newVal,valid);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(row.averaging+x),_mm_packus_epi32(newAveraging,newAveraging));
+		
+		/* Load the pixel statistics: */
+		__m128i* countPtr=reinterpret_cast<__m128i*>(row.numSamples+x);
+		__m128i* sumPtr=reinterpret_cast<__m128i*>(row.sums+x);
+		__m128i* sumSqPtr=reinterpret_cast<__m128i*>(row.sumSquares+x);
+		__m128i count=_mm_loadu_si128(countPtr);
+		__m128i sum=_mm_loadu_si128(sumPtr);
+		__m128i sumSq=_mm_loadu_si128(sumSqPtr);
+		
+		/* Update the pixel statistics; masks are -1 where set: */
+		count=_mm_add_epi32(_mm_sub_epi32(count,valid),remove);
+		sum=_mm_sub_epi32(_mm_add_epi32(sum,_mm_and_si128(newVal,valid)),_mm_and_si128(oldVal,remove));
+		sumSq=_mm_sub_epi32(_mm_add_epi32(sumSq,_mm_and_si128(_mm_mullo_epi32(newVal,newVal),valid)),_mm_and_si128(_mm_mullo_epi32(oldVal,oldVal),remove));
+		
+		/* Store the pixel statistics: */
+		_mm_storeu_si128(countPtr,count);
+		_mm_storeu_si128(sumPtr,sum);
+		_mm_storeu_si128(sumSqPtr,sumSq);
+		
+		/* Check which pixels are considered "stable": */
+		__m128i lhs=_mm_mullo_epi32(sumSq,count);
+		__m128i rhs=_mm_add_epi32(_mm_mullo_epi32(_mm_mullo_epi32(maxVariance,count),count),_mm_mullo_epi32(sum,sum));
+		__m128 stable=_mm_castsi128_ps(_mm_and_si128(lessEqualUnsigned(minNumSamples,count),lessEqualUnsigned(lhs,rhs)));
+		
+		/* Calculate the new depth-corrected running means and compare them against the previous values' envelopes: */
+		__m128 newFiltered=_mm_add_ps(_mm_mul_ps(_mm_div_ps(convertUnsigned(sum),convertUnsigned(count)),scale),offset);
+		__m128 oldValid=_mm_loadu_ps(row.valid+x);
+		__m128 change=_mm_cmpge_ps(_mm_and_ps(_mm_sub_ps(newFiltered,oldValid),absMask),hysteresis);
+		__m128 newValid=_mm_blendv_ps(oldValid,newFiltered,_mm_and_ps(stable,change));
+		_mm_storeu_ps(row.valid+x,newValid);
+		
+		/* Calculate the output values: */
+		__m128 unstableOutput=p.retainValids?oldValid:instable;
+		_mm_storeu_ps(row.output+x,_mm_blendv_ps(unstableOutput,newValid,stable));
+		}
+	
+	/* Process the remaining pixels: */
+	filterPixels(p,row,x,p.width);
+	}
+
+bool isSSE41Supported(void)
+	{
+	__builtin_cpu_init();
+	return isPixelCorrectionPacked()&&__builtin_cpu_supports("sse4.1");
+	}
+
+/*************
+AVX2 kernel:
+*************/
+
+__attribute__((target("avx2")))
+inline __m256 convertUnsigned(__m256i v)
+	{
+	__m256 hi=_mm256_cvtepi32_ps(_mm256_srli_epi32(v,16));
+	__m256 lo=_mm256_cvtepi32_ps(_mm256_and_si256(v,_mm256_set1_epi32(0xffff)));
+	return _mm256_add_ps(_mm256_mul_ps(hi,_mm256_set1_ps(65536.0f)),lo);
+	}
+
+__attribute__((target("avx2")))
+inline __m256i lessEqualUnsigned(__m256i a,__m256i b)
+	{
+	return _mm256_cmpeq_epi32(_mm256_max_epu32(a,b),b);
+	}
+
+__attribute__((target("avx2")))
+void temporalKernelAVX2(const Parameters& p,const Row& row)
+	{
+	/* Broadcast the frame parameters: */
+	float py=float(row.y)+0.5f;
+	__m256 zero=_mm256_setzero_ps();
+	__m256 half=_mm256_set1_ps(0.5f);
+	__m256 minP0=_mm256_set1_ps(p.minPlane[0]);
+	__m256 minP1py=_mm256_set1_ps(p.minPlane[1]*py);
+	__m256 minP2=_mm256_set1_ps(p.minPlane[2]);
+	__m256 minP3=_mm256_set1_ps(p.minPlane[3]);
+	__m256 maxP0=_mm256_set1_ps(p.maxPlane[0]);
+	__m256 maxP1py=_mm256_set1_ps(p.maxPlane[1]*py);
+	__m256 maxP2=_mm256_set1_ps(p.maxPlane[2]);
+	__m256 maxP3=_mm256_set1_ps(p.maxPlane[3]);
+	__m256i invalid=_mm256_set1_epi32(invalidDepth);
+	__m256i allOnes=_mm256_set1_epi32(-1);
+	__m256i notRetain=p.retainValids?_mm256_setzero_si256():allOnes;
+	__m256i minNumSamples=_mm256_set1_epi32(p.minNumSamples);
+	__m256i maxVariance=_mm256_set1_epi32(p.maxVariance);
+	__m256 hysteresis=_mm256_set1_ps(p.hysteresis);
+	__m256 absMask=_mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	__m256 instable=_mm256_set1_ps(p.instableValue);
+	__m256i xv=_mm256_setr_epi32(0,1,2,3,4,5,6,7);
+	__m256i xStep=_mm256_set1_epi32(8);
+	
+	/* Process groups of eight pixels: */
+	unsigned int x;
+	for(x=0;x+8<=p.width;x+=8,xv=_mm256_add_epi32(xv,xStep))
+		{
+		/* Load new and old raw depth values: */
+		__m256i newVal=_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row.input+x)));
+		__m256i oldVal=_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row.averaging+x)));
+		
+		/* Load and de-interleave the pixel depth correction coefficients: */
+		const float* pdcPtr=reinterpret_cast<const float*>(row.pixelDepthCorrection+x);
+		__m256 pdc0=_mm256_loadu_ps(pdcPtr);
+		__m256 pdc1=_mm256_loadu_ps(pdcPtr+8);
+		__m256 scale=_mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(pdc0,pdc1,_MM_SHUFFLE(2,0,2,0))),_MM_SHUFFLE(3,1,2,0)));
+		__m256 offset=_mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(pdc0,pdc1,_MM_SHUFFLE(3,1,3,1))),_MM_SHUFFLE(3,1,2,0)));
+		
+		/* Depth-correct the new values and test them against the minimum and maximum planes: */
+		__m256 px=_mm256_add_ps(_mm256_cvtepi32_ps(xv),half);
+		__m256 newCVal=_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(newVal),scale),offset);
+		__m256 minD=_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(minP0,px),minP1py),_mm256_mul_ps(minP2,newCVal)),minP3);
+		__m256 maxD=_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(maxP0,px),maxP1py),_mm256_mul_ps(maxP2,newCVal)),maxP3);
+		__m256i valid=_mm256_castps_si256(_mm256_and_ps(_mm256_cmp_ps(minD,zero,_CMP_GE_OQ),_mm256_cmp_ps(maxD,zero,_CMP_LE_OQ)));
+		
+		/* Determine which old values leave the averaging buffer: */
+		__m256i update=_mm256_or_si256(valid,notRetain);
+		__m256i remove=_mm256_andnot_si256(_mm256_cmpeq_epi32(oldVal,invalid),update);
+		
+		/* Update the averaging buffer: */
+		__m256i newAveraging=_mm256_blendv_epi8(_mm256_blendv_epi8(oldVal,invalid,update),newVal,valid);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(row.averaging+x),_mm_packus_epi32(_mm256_castsi256_si128(newAveraging),_mm256_extracti128_si256(newAveraging,1)));
+		
+		/* Load the pixel statistics: */
+		__m256i* countPtr=reinterpret_cast<__m256i*>(row.numSamples+x);
+		__m256i* sumPtr=reinterpret_cast<__m256i*>(row.sums+x);
+		__m256i* sumSqPtr=reinterpret_cast<__m256i*>(row.sumSquares+x);
+		__m256i count=_mm256_loadu_si256(countPtr);
+		__m256i sum=_mm256_loadu_si256(sumPtr);
+		__m256i sumSq=_mm256_loadu_si256(sumSqPtr);
+		
+		/* Update the pixel statistics; masks are -1 where set: */
+		count=_mm256_add_epi32(_mm256_sub_epi32(count,valid),remove);
+		sum=_mm256_sub_epi32(_mm256_add_epi32(sum,_mm256_and_si256(newVal,valid)),_mm256_and_si256(oldVal,remove));
+		sumSq=_mm256_sub_epi32(_mm256_add_epi32(sumSq,_mm256_and_si256(_mm256_mullo_epi32(newVal,newVal),valid)),_mm256_and_si256(_mm256_mullo_epi32(oldVal,oldVal),remove));
+		
+		/* Store the pixel statistics: */
+		_mm256_storeu_si256(countPtr,count);
+		_mm256_storeu_si256(sumPtr,sum);
+		_mm256_storeu_si256(sumSqPtr,sumSq);
+		
+		/* Check which pixels are considered "stable": */
+		__m256i lhs=_mm256_mullo_epi32(sumSq,count);
+		__m256i rhs=_mm256_add_epi32(_mm256_mullo_epi32(_mm256_mullo_epi32(maxVariance,count),count),_mm256_mullo_epi32(sum,sum));
+		__m256 stable=_mm256_castsi256_ps(_mm256_and_si256(lessEqualUnsigned(minNumSamples,count),lessEqualUnsigned(lhs,rhs)));
+		
+		/* Calculate the new depth-corrected running means and compare them against the previous values' envelopes: */
+		__m256 newFiltered=_mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(convertUnsigned(sum),convertUnsigned(count)),scale),offset);
+		__m256 oldValid=_mm256_loadu_ps(row.valid+x);
+		__m256 change=_mm256_cmp_ps(_mm256_and_ps(_mm256_sub_ps(newFiltered,oldValid),absMask),hysteresis,_CMP_GE_OQ);
+		__m256 newValid=_mm256_blendv_ps(oldValid,newFiltered,_mm256_and_ps(stable,change));
+		_mm256_storeu_ps(row.valid+x,newValid);
+		
+		/* Calculate the output values: */
+		__m256 unstableOutput=p.retainValids?oldValid:instable;
+		_mm256_storeu_ps(row.output+x,_mm256_blendv_ps(unstableOutput,newValid,stable));
+		}
+	
+	/* Process the remaining pixels: */
+	filterPixels(p,row,x,p.width);
+	}
+
+bool isAVX2Supported(void)
+	{
+	__builtin_cpu_init();
+	return isPixelCorrectionPacked()&&__builtin_cpu_supports("avx2");
+	}
+
+#endif
+
+/*******************************
+Table of compiled-in kernels:
+*******************************/
+
+struct KernelEntry // Structure describing a temporal kernel
+	{
+	/* Elements: */
+	public:
+	const char* name; // Kernel name for configuration files and reports
+	TemporalKernel kernel; // Kernel function
+	bool (*isSupported)(void); // Function to check whether the current CPU can execute the kernel
+	};
+
+/* Kernels in order of increasing performance: */
+const KernelEntry kernels[]=
+	{
+	{"scalar",temporalKernelScalar,isScalarSupported}
+	#if FRAMEFILTERKERNELS_X86
+	,{"sse4.1",temporalKernelSSE41,isSSE41Supported}
+	,{"avx2",temporalKernelAVX2,isAVX2Supported}
+	#endif
+	};
+
+const unsigned int numKernels=sizeof(kernels)/sizeof(KernelEntry);
+
+}
+
+/**********************************************
+Namespace-global functions of FrameFilterKernels:
+**********************************************/
+
+unsigned int getNumTemporalKernels(void)
+	{
+	return numKernels;
+	}
+
+const char* getTemporalKernelName(unsigned int index)
+	{
+	return kernels[index].name;
+	}
+
+bool isTemporalKernelSupported(unsigned int index)
+	{
+	return kernels[index].isSupported();
+	}
+
+TemporalKernel getTemporalKernel(unsigned int index)
+	{
+	return kernels[index].kernel;
+	}
+
+TemporalKernel findTemporalKernel(const char* name)
+	{
+	if(strcasecmp(name,"auto")==0)
+		{
+		/* Return the last, i.e., fastest, supported kernel: */
+		unsigned int i=numKernels;
+		while(i>1&&!kernels[i-1].isSupported())
+			--i;
+		return kernels[i-1].kernel;
+		}
+	else
+		{
+		/* Return the supported kernel of the given name: */
+		for(unsigned int i=0;i<numKernels;++i)
+			if(strcasecmp(name,kernels[i].name)==0)
+				return kernels[i].isSupported()?kernels[i].kernel:0;
+		return 0;
+		}
+	}
+
+const char* getTemporalKernelName(TemporalKernel kernel)
+	{
+	for(unsigned int i=0;i<numKernels;++i)
+		if(kernels[i].kernel==kernel)
+			return kernels[i].name;
+	return "unknown";
+	}
+
+void spatialFilterBand(unsigned int width,unsigned int height,unsigned int yBegin,unsigned int yEnd,const float* haloAbove,const float* haloBelow,float* scratch,float* frame)
+	{
+	/* Split the scratch buffer into a ring of three rows holding results of the first filter pass, and one temporary row: */
+	float* firstPass[3]={scratch,scratch+width,scratch+width*2};
+	float* temp=scratch+width*3;
+	
+	/* Sweep through the band's rows, plus one halo row on either side, and run both filter passes with a lag of one row: */
+	unsigned int rBegin=yBegin>0?yBegin-1:0;
+	unsigned int rEnd=yEnd<height?yEnd+1:height;
+	for(unsigned int r=rBegin;r<rEnd;++r)
+		{
+		/* Run the first filter pass on the current row: */
+		const float* above=r>0?unfilteredRow(width,yBegin,yEnd,haloAbove,haloBelow,frame,r-1):0;
+		const float* below=r+1<height?unfilteredRow(width,yBegin,yEnd,haloAbove,haloBelow,frame,r+1):0;
+		filterVertical(width,above,unfilteredRow(width,yBegin,yEnd,haloAbove,haloBelow,frame,r),below,temp);
+		filterHorizontal(width,temp,firstPass[r%3]);
+		
+		/* Run the second filter pass on the previous row if it is inside the band; the previous row's unfiltered values are not needed anymore: */
+		if(r>yBegin)
+			{
+			unsigned int y=r-1;
+			filterVertical(width,y>0?firstPass[(y-1)%3]:0,firstPass[y%3],firstPass[r%3],temp);
+			filterHorizontal(width,temp,frame+y*width);
+			}
+		}
+	
+	/* Run the second filter pass on the frame's last row if it is inside the band: */
+	if(yEnd==height)
+		{
+		unsigned int y=height-1;
+		filterVertical(width,y>0?firstPass[(y-1)%3]:0,firstPass[y%3],0,temp);
+		filterHorizontal(width,temp,frame+y*width);
+		}
+	}
+
+}
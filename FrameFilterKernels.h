@@ -0,0 +1,80 @@
+/***********************************************************************
+FrameFilterKernels - Per-row kernels implementing the temporal part of
+the depth frame filter, i.e., running averages, stability tests, and
+hysteresis, in scalar and SIMD versions selected at run-time, and
+per-band kernels implementing the spatial part of the depth frame
+filter.
+Copyright (c) 2012-2025 Oliver Kreylos
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef FRAMEFILTERKERNELS_INCLUDED
+#define FRAMEFILTERKERNELS_INCLUDED
+
+#include <Kinect/FrameSource.h>
+
+namespace FrameFilterKernels {
+
+typedef unsigned short RawDepth; // Data type for raw depth values
+typedef Kinect::FrameSource::DepthCorrection::PixelCorrection PixelDepthCorrection; // Type for per-pixel depth correction factors
+
+static const RawDepth invalidDepth=2048U; // Raw depth value marking an invalid sample in the averaging buffer
+
+struct Parameters // Structure holding filter parameters shared by all pixels of a frame
+	{
+	/* Elements: */
+	public:
+	unsigned int width; // Number of pixels in each row
+	float minPlane[4]; // Plane equation of the lower bound of valid depth values in depth image space
+	float maxPlane[4]; // Plane equation of the upper bound of valid depth values in depth image space
+	unsigned int minNumSamples; // Minimum number of valid samples needed to consider a pixel stable
+	unsigned int maxVariance; // Maximum variance to consider a pixel stable
+	float hysteresis; // Amount by which a new filtered value has to differ from the current value to update
+	bool retainValids; // Flag whether to retain previous stable values if a new pixel in instable, or reset to a default value
+	float instableValue; // Value to assign to instable pixels if retainValids is false
+	};
+
+struct Row // Structure pointing to the per-pixel state of one row of a frame
+	{
+	/* Elements: */
+	public:
+	unsigned int y; // Index of the row in the frame
+	const RawDepth* input; // Row of the new raw depth frame
+	const PixelDepthCorrection* pixelDepthCorrection; // Row of per-pixel depth correction coefficients
+	RawDepth* averaging; // Row of the current averaging slot
+	unsigned int* numSamples; // Row of numbers of valid samples
+	unsigned int* sums; // Row of sums of valid samples
+	unsigned int* sumSquares; // Row of sums of squares of valid samples
+	float* valid; // Row of most recent stable depth values
+	float* output; // Row of the output frame
+	};
+
+typedef void (*TemporalKernel)(const Parameters& parameters,const Row& row); // Type for kernels entering one row of a new raw depth frame into the filter state and calculating the row's output values
+
+unsigned int getNumTemporalKernels(void); // Returns the number of compiled-in temporal kernels, whether supported by the current CPU or not
+const char* getTemporalKernelName(unsigned int index); // Returns the name of the temporal kernel of the given index
+bool isTemporalKernelSupported(unsigned int index); // Returns true if the current CPU can execute the temporal kernel of the given index
+TemporalKernel getTemporalKernel(unsigned int index); // Returns the temporal kernel of the given index
+TemporalKernel findTemporalKernel(const char* name); // Returns the temporal kernel of the given name, or the fastest one supported by the current CPU if name is "auto"; returns null if no supported kernel of the given name exists
+const char* getTemporalKernelName(TemporalKernel kernel); // Returns the name of the given temporal kernel
+void spatialFilterBand(unsigned int width,unsigned int height,unsigned int yBegin,unsigned int yEnd,const float* haloAbove,const float* haloBelow,float* scratch,float* frame); // Low-pass filters the band of rows [yBegin, yEnd) of the given frame in-place by running two passes of a separable 1-2-1 filter in a single sweep; haloAbove and haloBelow hold the two unfiltered rows adjacent to the band above and below, if they exist; scratch must hold 4*width floats
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+/***********************************************************************
+FrameMailbox - Lock-free single-producer, single-consumer mailbox
+handing the most recent frame from a depth camera's streaming thread to
+a processing thread, dropping frames the consumer did not pick up in
+time.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef FRAMEMAILBOX_INCLUDED
+#define FRAMEMAILBOX_INCLUDED
+
+#include <semaphore.h>
+#include <Kinect/FrameBuffer.h>
+
+class FrameMailbox
+	{
+	/* Elements: */
+	private:
+	static const unsigned int indexMask=0x3U; // Mask to extract a slot index from the shared slot state
+	static const unsigned int freshFlag=0x4U; // Flag in the shared slot state indicating that the shared slot holds a frame not yet picked up by the consumer
+	Kinect::FrameBuffer slots[3]; // Three frame slots, owned by the producer, the consumer, and shared between the two, respectively; frame buffers are reference-counted and never copied
+	unsigned int producerSlot; // Index of the slot owned by the producer
+	unsigned int sharedState; // Index of the shared slot and fresh flag; only accessed atomically
+	unsigned int consumerSlot; // Index of the slot owned by the consumer
+	sem_t frameSemaphore; // Semaphore to wake up the consumer when a new frame is posted
+	unsigned int numPostedFrames; // Number of frames posted by the producer; only accessed atomically
+	unsigned int numDroppedFrames; // Number of posted frames overwritten before the consumer picked them up; only accessed atomically
+	
+	/* Constructors and destructors: */
+	public:
+	FrameMailbox(void) // Creates an empty mailbox
+		:producerSlot(0),sharedState(1),consumerSlot(2),
+		 numPostedFrames(0),numDroppedFrames(0)
+		{
+		sem_init(&frameSemaphore,0,0);
+		}
+	~FrameMailbox(void)
+		{
+		sem_destroy(&frameSemaphore);
+		}
+	
+	/* Methods: */
+	void post(const Kinect::FrameBuffer& frame) // Posts a new frame from the producer thread; never blocks
+		{
+		/* Store the new frame in the producer's slot, and exchange the slot with the shared one: */
+		slots[producerSlot]=frame;
+		unsigned int oldState=__atomic_exchange_n(&sharedState,producerSlot|freshFlag,__ATOMIC_ACQ_REL);
+		producerSlot=oldState&indexMask;
+		
+		/* Count the previous frame as dropped if the consumer never picked it up: */
+		__atomic_add_fetch(&numPostedFrames,1U,__ATOMIC_RELAXED);
+		if(oldState&freshFlag)
+			__atomic_add_fetch(&numDroppedFrames,1U,__ATOMIC_RELAXED);
+		
+		/* Wake up the consumer: */
+		sem_post(&frameSemaphore);
+		}
+	void wakeup(void) // Wakes up the consumer without posting a frame, e.g., to shut it down
+		{
+		sem_post(&frameSemaphore);
+		}
+	void wait(void) // Blocks the consumer thread until a frame was posted or it was woken up since the last call
+		{
+		while(sem_wait(&frameSemaphore)!=0)
+			;
+		}
+	bool lockNewFrame(void) // Makes the most recently posted frame available to the consumer thread; returns true if a new frame was posted since the last call
+		{
+		/* Bail out if the shared slot does not hold a new frame: */
+		if((__atomic_load_n(&sharedState,__ATOMIC_ACQUIRE)&freshFlag)==0U)
+			return false;
+		
+		/* Exchange the consumer's slot with the shared one; only the consumer clears the fresh flag, so the shared slot still holds a new frame: */
+		unsigned int oldState=__atomic_exchange_n(&sharedState,consumerSlot,__ATOMIC_ACQ_REL);
+		consumerSlot=oldState&indexMask;
+		return true;
+		}
+	const Kinect::FrameBuffer& getLockedFrame(void) const // Returns the frame most recently locked by the consumer thread
+		{
+		return slots[consumerSlot];
+		}
+	unsigned int getNumPostedFrames(void) const // Returns the number of frames posted so far
+		{
+		return __atomic_load_n(&numPostedFrames,__ATOMIC_RELAXED);
+		}
+	unsigned int getNumDroppedFrames(void) const // Returns the number of frames dropped so far
+		{
+		return __atomic_load_n(&numDroppedFrames,__ATOMIC_RELAXED);
+		}
+	};
+
+#endif
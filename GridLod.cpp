@@ -0,0 +1,199 @@
+/***********************************************************************
+GridLod - Class to select levels of detail for square patches of a
+regular vertex grid based on their distance from a viewer, and to
+triangulate the grid without cracks between patches of different levels.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "GridLod.h"
+
+#include <Math/Math.h>
+
+/************************
+Methods of class GridLod:
+************************/
+
+unsigned int GridLod::getPatchStep(int px,int py,unsigned int step) const
+	{
+	/* Return the given step if the patch is outside the grid: */
+	if(px<0||px>=int(numPatches[0])||py<0||py>=int(numPatches[1]))
+		return step;
+	
+	/* Return the smaller of the given step and the patch's step: */
+	unsigned int patchStep=1U<<patchLevels[py*numPatches[0]+px];
+	return patchStep<step?patchStep:step;
+	}
+
+void GridLod::addTriangle(unsigned int x0,unsigned int y0,unsigned int x1,unsigned int y1,unsigned int x2,unsigned int y2)
+	{
+	/* Skip degenerate triangles, which occur when a fan center lies on its quad's boundary: */
+	if((int(x1)-int(x0))*(int(y2)-int(y0))==(int(x2)-int(x0))*(int(y1)-int(y0)))
+		return;
+	
+	indices.push_back(GLuint(y0*gridSize[0]+x0));
+	indices.push_back(GLuint(y1*gridSize[0]+x1));
+	indices.push_back(GLuint(y2*gridSize[0]+x2));
+	}
+
+void GridLod::triangulatePatch(unsigned int px,unsigned int py)
+	{
+	/* Calculate the patch's vertex range and vertex step: */
+	unsigned int x0=px*patchSize;
+	unsigned int x1=Math::min(x0+patchSize,(unsigned int)(gridSize[0]-1));
+	unsigned int y0=py*patchSize;
+	unsigned int y1=Math::min(y0+patchSize,(unsigned int)(gridSize[1]-1));
+	unsigned int step=1U<<patchLevels[py*numPatches[0]+px];
+	
+	/* Calculate the vertex steps along the patch's sides, which must match the step of finer neighboring patches: */
+	unsigned int bottomStep=getPatchStep(px,int(py)-1,step);
+	unsigned int topStep=getPatchStep(px,py+1,step);
+	unsigned int leftStep=getPatchStep(int(px)-1,py,step);
+	unsigned int rightStep=getPatchStep(px+1,py,step);
+	
+	/* Triangulate the patch's quads: */
+	std::vector<unsigned int> loop;
+	for(unsigned int qy0=y0;qy0<y1;qy0+=step)
+		{
+		unsigned int qy1=Math::min(qy0+step,y1);
+		for(unsigned int qx0=x0;qx0<x1;qx0+=step)
+			{
+			unsigned int qx1=Math::min(qx0+step,x1);
+			
+			/* Get the vertex steps along the quad's sides: */
+			unsigned int bs=qy0==y0?bottomStep:step;
+			unsigned int ts=qy1==y1?topStep:step;
+			unsigned int ls=qx0==x0?leftStep:step;
+			unsigned int rs=qx1==x1?rightStep:step;
+			
+			if(bs>=qx1-qx0&&ts>=qx1-qx0&&ls>=qy1-qy0&&rs>=qy1-qy0)
+				{
+				/* Split the quad into two triangles: */
+				addTriangle(qx0,qy0,qx1,qy0,qx1,qy1);
+				addTriangle(qx0,qy0,qx1,qy1,qx0,qy1);
+				}
+			else
+				{
+				/* Collect the quad's boundary vertices in counter-clockwise order, including the vertices shared with finer neighboring patches: */
+				loop.clear();
+				for(unsigned int x=qx0;x<qx1;x+=bs)
+					{
+					loop.push_back(x);
+					loop.push_back(qy0);
+					}
+				for(unsigned int y=qy0;y<qy1;y+=rs)
+					{
+					loop.push_back(qx1);
+					loop.push_back(y);
+					}
+				loop.push_back(qx1);
+				loop.push_back(qy1);
+				for(unsigned int x=qx0+((qx1-qx0-1)/ts)*ts;x>qx0;x-=ts)
+					{
+					loop.push_back(x);
+					loop.push_back(qy1);
+					}
+				loop.push_back(qx0);
+				loop.push_back(qy1);
+				for(unsigned int y=qy0+((qy1-qy0-1)/ls)*ls;y>qy0;y-=ls)
+					{
+					loop.push_back(qx0);
+					loop.push_back(y);
+					}
+				
+				/* Create a triangle fan around the quad's center: */
+				unsigned int cx=(qx0+qx1)/2;
+				unsigned int cy=(qy0+qy1)/2;
+				size_t numLoop=loop.size()/2;
+				for(size_t i=0;i<numLoop;++i)
+					{
+					size_t j=(i+1)%numLoop;
+					addTriangle(cx,cy,loop[i*2],loop[i*2+1],loop[j*2],loop[j*2+1]);
+					}
+				}
+			}
+		}
+	}
+
+GridLod::GridLod(const Size& sGridSize,unsigned int sPatchSize,unsigned int sNumLevels)
+	:gridSize(sGridSize),
+	 patchSize(sPatchSize),numLevels(sNumLevels),
+	 version(0)
+	{
+	/* Ensure that the patch size is a positive multiple of the coarsest level's vertex step: */
+	if(numLevels<1U)
+		numLevels=1U;
+	unsigned int maxStep=1U<<(numLevels-1);
+	patchSize=Math::max((patchSize+maxStep-1)/maxStep,1U)*maxStep;
+	
+	/* Create the patch array with all patches at full resolution: */
+	for(int i=0;i<2;++i)
+		numPatches[i]=(gridSize[i]-1+patchSize-1)/patchSize;
+	patchLevels.resize(numPatches[1]*numPatches[0],~0U);
+	}
+
+bool GridLod::update(const Scalar viewPos[3],Scalar lodDistance)
+	{
+	/* Select each patch's level of detail based on its distance from the view position: */
+	bool changed=false;
+	unsigned int* plPtr=&patchLevels[0];
+	for(unsigned int py=0;py<numPatches[1];++py)
+		for(unsigned int px=0;px<numPatches[0];++px,++plPtr)
+			{
+			unsigned int level=0;
+			if(lodDistance>Scalar(0))
+				{
+				/* Calculate the distance from the view position to the patch's extent: */
+				Scalar pMin[2],pMax[2];
+				pMin[0]=Scalar(px*patchSize);
+				pMax[0]=Scalar(Math::min((px+1)*patchSize,(unsigned int)(gridSize[0]-1)));
+				pMin[1]=Scalar(py*patchSize);
+				pMax[1]=Scalar(Math::min((py+1)*patchSize,(unsigned int)(gridSize[1]-1)));
+				Scalar dist2=Math::sqr(viewPos[2]);
+				for(int i=0;i<2;++i)
+					{
+					if(viewPos[i]<pMin[i])
+						dist2+=Math::sqr(pMin[i]-viewPos[i]);
+					else if(viewPos[i]>pMax[i])
+						dist2+=Math::sqr(viewPos[i]-pMax[i]);
+					}
+				
+				/* Halve the resolution for every doubling of distance beyond the full-resolution distance: */
+				for(Scalar d2=Math::sqr(lodDistance);level<numLevels-1&&dist2>=d2;d2*=Scalar(4))
+					++level;
+				}
+			
+			if(*plPtr!=level)
+				{
+				*plPtr=level;
+				changed=true;
+				}
+			}
+	
+	if(changed)
+		{
+		/* Re-triangulate the grid: */
+		indices.clear();
+		for(unsigned int py=0;py<numPatches[1];++py)
+			for(unsigned int px=0;px<numPatches[0];++px)
+				triangulatePatch(px,py);
+		++version;
+		}
+	
+	return changed;
+	}
@@ -0,0 +1,69 @@
+/***********************************************************************
+GridLod - Class to select levels of detail for square patches of a
+regular vertex grid based on their distance from a viewer, and to
+triangulate the grid without cracks between patches of different levels.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef GRIDLOD_INCLUDED
+#define GRIDLOD_INCLUDED
+
+#include <vector>
+#include <GL/gl.h>
+
+#include "Types.h"
+
+class GridLod
+	{
+	/* Elements: */
+	private:
+	Size gridSize; // Number of vertices in the grid
+	unsigned int patchSize; // Number of grid cells along each side of a patch; a multiple of the vertex step of the coarsest level
+	unsigned int numLevels; // Number of levels of detail; level l uses every 2^l-th grid vertex
+	Size numPatches; // Number of patches in the grid
+	std::vector<unsigned int> patchLevels; // Current level of detail of each patch
+	std::vector<GLuint> indices; // Vertex indices of the triangles of the current triangulation
+	unsigned int version; // Version number of the current triangulation
+	
+	/* Private methods: */
+	unsigned int getPatchStep(int px,int py,unsigned int step) const; // Returns the smaller of the given vertex step and the vertex step of the patch of the given index, or the given step if there is no such patch
+	void addTriangle(unsigned int x0,unsigned int y0,unsigned int x1,unsigned int y1,unsigned int x2,unsigned int y2); // Adds a triangle to the triangulation if it is not degenerate
+	void triangulatePatch(unsigned int px,unsigned int py); // Adds the triangles of the given patch to the triangulation
+	
+	/* Constructors and destructors: */
+	public:
+	GridLod(const Size& sGridSize,unsigned int sPatchSize,unsigned int sNumLevels); // Creates a level-of-detail triangulation for a grid of the given number of vertices, using patches of the given size and the given number of levels
+	
+	/* Methods: */
+	bool update(const Scalar viewPos[3],Scalar lodDistance); // Selects the level of detail of each patch based on its distance from the given view position in grid vertex units, using the full resolution up to the given distance and halving it for every doubling of distance beyond; uses full resolution everywhere if lodDistance is zero; returns true if the triangulation changed
+	unsigned int getVersion(void) const // Returns the version number of the current triangulation
+		{
+		return version;
+		}
+	size_t getNumIndices(void) const // Returns the number of vertex indices in the current triangulation
+		{
+		return indices.size();
+		}
+	const GLuint* getIndices(void) const // Returns the vertex indices of the triangles of the current triangulation
+		{
+		return &indices[0];
+		}
+	};
+
+#endif
@@ -33,11 +33,53 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 class HuffmanDecoder
 	{
-	/* Elements: */
+	/* Embedded classes: */
 	private:
+	struct TableEntry // Structure for entries in the decoding lookup table
+		{
+		/* Elements: */
+		public:
+		unsigned int code; // Code represented by a leaf node reached within the lookup prefix, or ~0x0U if the code is longer than the prefix
+		HuffmanBuilder::Index nodeIndex; // Index of the decoding tree node reached after consuming numBits bits
+		unsigned int numBits; // Number of bits consumed by the table lookup
+		};
+	
+	/* Elements: */
+	static const unsigned int lookupBits=10; // Number of bits resolved by a single table lookup
 	BitSource bitSource; // Bit source to read Huffman-encoded values from a file
 	HuffmanBuilder::Node* treeAlloc; // Optional object-allocated memory backing the decoding tree
 	const HuffmanBuilder::Node* tree; // The Huffman decoding tree
+	TableEntry table[1U<<lookupBits]; // Lookup table resolving all codes of up to lookupBits bits, and the first lookupBits bits of longer codes
+	
+	/* Private methods: */
+	void fillTable(HuffmanBuilder::Index nodeIndex,Bits prefix,unsigned int numBits) // Recursively fills the lookup table entries for the subtree of the given decoding tree node, reached via the given prefix of the given number of bits
+		{
+		if(tree[nodeIndex].code!=~0x0U)
+			{
+			/* Enter the leaf node into all table entries starting with the node's prefix: */
+			Bits first=prefix<<(lookupBits-numBits);
+			Bits last=(prefix+1U)<<(lookupBits-numBits);
+			for(Bits i=first;i<last;++i)
+				{
+				table[i].code=tree[nodeIndex].code;
+				table[i].nodeIndex=nodeIndex;
+				table[i].numBits=numBits;
+				}
+			}
+		else if(numBits==lookupBits)
+			{
+			/* Enter the interior node as the starting point for decoding the rest of a long code: */
+			table[prefix].code=~0x0U;
+			table[prefix].nodeIndex=nodeIndex;
+			table[prefix].numBits=numBits;
+			}
+		else
+			{
+			/* Recurse into the node's children: */
+			for(int i=0;i<2;++i)
+				fillTable(tree[nodeIndex].childIndices[i],(prefix<<1)|Bits(i),numBits+1U);
+			}
+		}
 	
 	/* Constructors and destructors: */
 	public:
@@ -62,11 +104,16 @@ class HuffmanDecoder
 			}
 		std::cout<<std::endl<<"\t}"<<std::endl<<std::endl;
 		#endif
+		
+		/* Create the decoding lookup table: */
+		fillTable(0,0x0U,0U);
 		}
 	HuffmanDecoder(IO::File& file,const HuffmanBuilder::Node* sTree) // Creates a Huffman decoder for the given source file and Huffman decoding tree
 		:bitSource(file),
 		 treeAlloc(0),tree(sTree)
 		{
+		/* Create the decoding lookup table: */
+		fillTable(0,0x0U,0U);
 		}
 	~HuffmanDecoder(void)
 		{
@@ -82,8 +129,26 @@ class HuffmanDecoder
 		}
 	unsigned int decode(void) // Returns a Huffman-decoded value from the source file
 		{
-		/* Traverse the decoding tree from the root to a leaf using bits from the bit source: */
-		HuffmanBuilder::Index nodeIndex=0;
+		/* Look up the next bits from the bit source without reading past the current buffer: */
+		const TableEntry* entry=&table[bitSource.peek(lookupBits)];
+		if(entry->numBits>bitSource.getNumBufferedBits())
+			{
+			/* The current code extends past the buffered bits; read the next word from the bit source and repeat the lookup: */
+			bitSource.refill();
+			entry=&table[bitSource.peek(lookupBits)];
+			}
+		
+		/* Consume the looked-up bits: */
+		bitSource.skip(entry->numBits);
+		
+		/* Return the code if the lookup reached a leaf node: */
+		if(entry->code!=~0x0U)
+			return entry->code;
+		
+		/* Continue decoding a long code from the interior node reached by the lookup: */
+		HuffmanBuilder::Index nodeIndex=entry->nodeIndex;
+		
+		/* Traverse the decoding tree to a leaf using bits from the bit source: */
 		do
 			{
 			/* Read a bit from the bit source and traverse to the appropriate child node: */
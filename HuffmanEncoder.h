@@ -33,17 +33,20 @@ class HuffmanEncoder
 	BitSink bitSink; // Bit sink to write Huffman-encoded values to a file
 	HuffmanBuilder::Code* codebookAlloc; // Optional object-allocated memory backing the encoding codebook
 	const HuffmanBuilder::Code* codebook; // The Huffman encoding codebook
+	size_t* histogram; // Optional array counting the occurrences of encoded values
 	
 	/* Constructors and destructors: */
 	public:
 	HuffmanEncoder(IO::File& file,HuffmanBuilder& huffmanBuilder) // Creates a Huffman encoder for the given destination file and Huffman code builder
 		:bitSink(file),
-		 codebookAlloc(huffmanBuilder.buildEncodingCodebook()),codebook(codebookAlloc)
+		 codebookAlloc(huffmanBuilder.buildEncodingCodebook()),codebook(codebookAlloc),
+		 histogram(0)
 		{
 		}
-	HuffmanEncoder(IO::File& file,const HuffmanBuilder::Code* sCodebook) // Creates a Huffman encoder for the given destination file and Huffman encoding codebook
+	HuffmanEncoder(IO::File& file,const HuffmanBuilder::Code* sCodebook,size_t* sHistogram =0) // Creates a Huffman encoder for the given destination file and Huffman encoding codebook, optionally counting encoded values in the given histogram
 		:bitSink(file),
-		 codebookAlloc(0),codebook(sCodebook)
+		 codebookAlloc(0),codebook(sCodebook),
+		 histogram(sHistogram)
 		{
 		}
 	~HuffmanEncoder(void)
@@ -60,9 +63,23 @@ class HuffmanEncoder
 		}
 	void encode(unsigned int value) // Huffman-encodes the given value and writes the result to the file
 		{
+		/* Count the value: */
+		if(histogram!=0)
+			++histogram[value];
+		
 		/* Look up the value's code in the codebook and write it to the bit sink: */
 		bitSink.write(codebook[value].bits,codebook[value].numBits);
 		}
+	void encodeAndWriteBits(unsigned int value,Bits bits,unsigned int numBits) // Huffman-encodes the given value and directly writes the given bits after it in a single bit sink access
+		{
+		/* Count the value: */
+		if(histogram!=0)
+			++histogram[value];
+		
+		/* Concatenate the value's code and the given bits and write them to the bit sink: */
+		const HuffmanBuilder::Code& code=codebook[value];
+		bitSink.writeLong((Misc::UInt64(code.bits)<<numBits)|Misc::UInt64(bits),code.numBits+numBits);
+		}
 	void flush(void) // Flushes the encoder
 		{
 		/* Flush the bit sink: */
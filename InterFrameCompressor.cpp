@@ -22,7 +22,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "InterFrameCompressor.h"
 
+#include <Misc/SizedTypes.h>
+
 #include "HuffmanBuilder.h"
+#include "HuffmanEncoder.h"
+#include "RansEncoder.h"
 
 namespace {
 
@@ -160,7 +164,7 @@ static const HuffmanBuilder::Code interFrameCompressorCodebook[]=
 	{0x113ceU,18},{0x1138dU,18},{0x1139fU,18},{0x1248eU,18},{0x12488U,18},{0x127bfU,18},{0x127afU,18},{0x1311eU,18},
 	{0x1311dU,18},{0x1311cU,18},{0x16971U,18},{0x127a8U,18},{0x13777U,18},{0x168a2U,18},{0x1e4a4U,18},{0x17731U,18},
 	{0x1e4a5U,18},{0x17736U,18},{0x1ee61U,18},{0x1ee04U,18},{0x1ee05U,18},{0x1fa16U,18},{0x1efd5U,18},{0x1fbd1U,18},
-	{0x31706U,18},{0x176U,10}
+	{0x31706U,18},{0x2ecU,11},{0x2edU,11}
 	};
 
 }
@@ -169,56 +173,97 @@ static const HuffmanBuilder::Code interFrameCompressorCodebook[]=
 Methods of class InterFrameCompressor:
 *************************************/
 
-InterFrameCompressor::InterFrameCompressor(IO::File& sFile)
-	:file(&sFile),
-	 encoder(sFile,interFrameCompressorCodebook),
-	 zeroRunLength(0)
+const HuffmanBuilder::Code* InterFrameCompressor::getDefaultCodebook(void)
 	{
+	return interFrameCompressorCodebook;
 	}
 
-void InterFrameCompressor::compressFrame(unsigned int width,unsigned int height,const Pixel* pixels0,const Pixel* pixels1)
+InterFrameCompressor::InterFrameCompressor(IO::File& sFile,EntropyCoder::Type sCoder,const HuffmanBuilder::Code* sCodebook,size_t* sHistogram)
+	:file(&sFile),coder(sCoder),
+	 codebook(sCodebook!=0?sCodebook:interFrameCompressorCodebook),histogram(sHistogram),
+	 predictor(InterFramePredictor::DELTA)
+	{
+	}
+
+template <class EncoderParam,class PredictorParam>
+void InterFrameCompressor::compressPixels(EncoderParam& encoder,PredictorParam& predictor,unsigned int width,unsigned int height,const Pixel* pixels0,const Pixel* pixels1)
 	{
 	/* Encode all pixel differences: */
+	unsigned int zeroRunLength=0U;
 	const Pixel* p0Ptr=pixels0;
 	const Pixel* p1Ptr=pixels1;
-	const Pixel* p1End=pixels1+(height*width);
-	for(;p1Ptr!=p1End;++p0Ptr,++p1Ptr)
-		{
-		Pixel delta=*p1Ptr-*p0Ptr;
-		
-		/* Check for runs of zero deltas: */
-		if(delta==0U)
+	ptrdiff_t stride(width);
+	for(unsigned int y=0;y<height;++y)
+		for(unsigned int x=0;x<width;++x,++p0Ptr,++p1Ptr)
 			{
-			/* Increase the current zero run length: */
-			++zeroRunLength;
+			Pixel delta=*p1Ptr-*p0Ptr;
 			
-			/* Finish the current zero run if it has reached maximum length: */
-			if(zeroRunLength==maxZeroRunLength)
-				finishZeroRun();
-			}
-		else
-			{
-			/* Finish a potential zero run: */
-			if(zeroRunLength!=0U)
-				finishZeroRun();
+			/* Predict the delta from the deltas of already-encoded neighbors: */
+			if(x>0U&&y>0U)
+				delta-=predictor.predict(p1Ptr[-1]-p0Ptr[-1],p1Ptr[-stride]-p0Ptr[-stride],p1Ptr[-stride-1]-p0Ptr[-stride-1]);
 			
-			if(delta>=65536U-codeMax) // Negative in-range delta
-				encoder.encode(delta-(65536U-codeMax));
-			else if(delta<=codeMax) // Positive in-range delta
-				encoder.encode(delta+codeMax);
-			else // Out-of-range delta
+			/* Check for runs of zero prediction errors: */
+			if(delta==0U)
+				{
+				/* Increase the current zero run length: */
+				++zeroRunLength;
+				}
+			else
 				{
-				/* Write the out-of-range marker followed by the out-of-range delta as-is: */
-				encoder.encode(outOfRange);
-				encoder.writeBits(delta,sizeof(Pixel)*8U);
+				/* Finish a potential zero run: */
+				if(zeroRunLength!=0U)
+					finishZeroRun(encoder,zeroRunLength);
+				
+				if(delta>=65536U-codeMax) // Negative in-range delta
+					encoder.encode(delta-(65536U-codeMax));
+				else if(delta<=codeMax) // Positive in-range delta
+					encoder.encode(delta+codeMax);
+				else // Out-of-range delta
+					{
+					/* Write the out-of-range marker followed by the out-of-range delta as-is: */
+					encoder.encodeAndWriteBits(outOfRange,delta,sizeof(Pixel)*8U);
+					}
 				}
 			}
-		}
 	
 	/* Finish a potential zero run: */
 	if(zeroRunLength>0U)
-		finishZeroRun();
+		finishZeroRun(encoder,zeroRunLength);
 	
 	/* Flush the encoder: */
 	encoder.flush();
 	}
+
+template <class EncoderParam>
+void InterFrameCompressor::compressPixels(EncoderParam& encoder,unsigned int width,unsigned int height,const Pixel* pixels0,const Pixel* pixels1)
+	{
+	/* Compress the frame difference using the selected frame difference predictor: */
+	if(predictor==InterFramePredictor::MED)
+		{
+		InterFramePredictor::MedPredictor medPredictor;
+		compressPixels(encoder,medPredictor,width,height,pixels0,pixels1);
+		}
+	else
+		{
+		InterFramePredictor::DeltaPredictor deltaPredictor;
+		compressPixels(encoder,deltaPredictor,width,height,pixels0,pixels1);
+		}
+	}
+
+void InterFrameCompressor::compressFrame(unsigned int width,unsigned int height,const Pixel* pixels0,const Pixel* pixels1)
+	{
+	/* Write the frame header identifying the frame difference predictor: */
+	file->write<Misc::UInt8>(predictor);
+	
+	/* Compress the frame difference using the selected entropy coding back-end: */
+	if(coder==EntropyCoder::RANS)
+		{
+		RansEncoder encoder(*file,numSymbols);
+		compressPixels(encoder,width,height,pixels0,pixels1);
+		}
+	else
+		{
+		HuffmanEncoder encoder(*file,codebook,histogram);
+		compressPixels(encoder,width,height,pixels0,pixels1);
+		}
+	}
@@ -23,9 +23,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #ifndef INTERFRAMECOMPRESSOR_INCLUDED
 #define INTERFRAMECOMPRESSOR_INCLUDED
 
+#include <stddef.h>
 #include <IO/File.h>
 
-#include "HuffmanEncoder.h"
+#include "HuffmanBuilder.h"
+#include "EntropyCoder.h"
+#include "InterFramePredictor.h"
 #include "Pixel.h"
 
 class InterFrameCompressor
@@ -34,26 +37,63 @@ class InterFrameCompressor
 	private:
 	static const unsigned int codeMax=256U; // Maximum absolute Huffman-coded pixel value
 	static const unsigned int outOfRange=2U*codeMax+1U; // The value indicating an out-of-range pixel value
-	static const unsigned int maxZeroRunLength=512U; // Maximum length of a zero run
+	static const unsigned int maxZeroRunLength=512U; // Maximum length of directly coded zero runs
+	static const unsigned int escapeZeroRun=outOfRange+maxZeroRunLength+1U; // The symbol escaping longer zero runs, whose excess run lengths follow as raw bits
+	static const unsigned int numRunLengthBitsBits=5U; // Number of bits to encode the bit length of escape-coded excess run lengths
+	static const unsigned int numSymbols=escapeZeroRun+1U; // Number of symbols in the compressor's Huffman code
 	IO::FilePtr file; // Pointer to the destination file
-	HuffmanEncoder encoder; // The Huffman encoder object
-	unsigned int zeroRunLength; // Length of the current zero run
+	EntropyCoder::Type coder; // The entropy coding back-end
+	const HuffmanBuilder::Code* codebook; // The Huffman codebook used by the Huffman back-end
+	size_t* histogram; // Optional histogram counting symbols encoded by the Huffman back-end
+	InterFramePredictor::Type predictor; // The frame difference predictor
 	
 	/* Private methods: */
-	void finishZeroRun(void) // Finishes a non-zero length run of zeros
+	template <class EncoderParam>
+	static void finishZeroRun(EncoderParam& encoder,unsigned int& zeroRunLength) // Finishes a non-zero length run of zeros using the given entropy encoder
 		{
-		/* Encode the final zero run length: */
-		encoder.encode(outOfRange+zeroRunLength);
+		if(zeroRunLength<=maxZeroRunLength)
+			{
+			/* Encode the zero run length directly: */
+			encoder.encode(outOfRange+zeroRunLength);
+			}
+		else
+			{
+			/* Write the escape code followed by the bit length of the excess run length and the excess run length itself: */
+			unsigned int excess=zeroRunLength-(maxZeroRunLength+1U);
+			unsigned int numExcessBits=0U;
+			while((excess>>numExcessBits)!=0U)
+				++numExcessBits;
+			encoder.encodeAndWriteBits(escapeZeroRun,numExcessBits,numRunLengthBitsBits);
+			if(numExcessBits!=0U)
+				encoder.writeBits(excess,numExcessBits);
+			}
 		
 		/* Reset the zero run length counter: */
 		zeroRunLength=0U;
 		}
+	template <class EncoderParam,class PredictorParam>
+	static void compressPixels(EncoderParam& encoder,PredictorParam& predictor,unsigned int width,unsigned int height,const Pixel* pixels0,const Pixel* pixels1); // Compresses the difference between the two given frames using the given entropy encoder and frame difference predictor
+	template <class EncoderParam>
+	void compressPixels(EncoderParam& encoder,unsigned int width,unsigned int height,const Pixel* pixels0,const Pixel* pixels1); // Compresses the difference between the two given frames using the given entropy encoder and the selected frame difference predictor
 	
 	/* Constructors and destructors: */
 	public:
-	InterFrameCompressor(IO::File& sFile); // Creates an inter-frame compressor writing to the given file
+	InterFrameCompressor(IO::File& sFile,EntropyCoder::Type sCoder =EntropyCoder::HUFFMAN,const HuffmanBuilder::Code* sCodebook =0,size_t* sHistogram =0); // Creates an inter-frame compressor writing to the given file using the given entropy coding back-end; the Huffman back-end uses the given codebook, or the default codebook if null, and optionally counts encoded symbols in the given histogram of numSymbols entries; frame differences are coded using the DELTA predictor until changed
 	
 	/* Methods: */
+	static unsigned int getNumSymbols(void) // Returns the number of symbols in the compressor's code
+		{
+		return numSymbols;
+		}
+	static const HuffmanBuilder::Code* getDefaultCodebook(void); // Returns the compressor's default Huffman codebook
+	InterFramePredictor::Type getPredictor(void) const // Returns the compressor's frame difference predictor
+		{
+		return predictor;
+		}
+	void setPredictor(InterFramePredictor::Type newPredictor) // Sets the frame difference predictor used for subsequently compressed frames
+		{
+		predictor=newPredictor;
+		}
 	void compressFrame(unsigned int width,unsigned int height,const Pixel* pixels0,const Pixel* pixels1); // Compresses the difference between the two given frames
 	};
 
@@ -23,8 +23,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "InterFrameDecompressor.h"
 
 #include <stdexcept>
+#include <Misc/SizedTypes.h>
 
 #include "HuffmanBuilder.h"
+#include "HuffmanDecoder.h"
+#include "RansDecoder.h"
 
 namespace {
 
@@ -105,7 +108,7 @@ static const HuffmanBuilder::Node interFrameDecompressorTree[]=
 	{~0U,545U,550U},{~0U,546U,547U},{464U,0U,0U},{~0U,548U,549U},{488U,0U,0U},{503U,0U,0U},{449U,0U,0U},{944U,0U,0U},
 	{~0U,553U,554U},{948U,0U,0U},{949U,0U,0U},{~0U,556U,557U},{264U,0U,0U},{~0U,558U,563U},{~0U,559U,560U},{281U,0U,0U},
 	{~0U,561U,562U},{641U,0U,0U},{215U,0U,0U},{270U,0U,0U},{~0U,565U,612U},{~0U,566U,567U},{534U,0U,0U},{~0U,568U,569U},
-	{261U,0U,0U},{~0U,570U,571U},{1025U,0U,0U},{~0U,572U,597U},{~0U,573U,594U},{~0U,574U,579U},{~0U,575U,576U},{324U,0U,0U},
+	{261U,0U,0U},{~0U,570U,571U},{~0U,2051U,2052U},{~0U,572U,597U},{~0U,573U,594U},{~0U,574U,579U},{~0U,575U,576U},{324U,0U,0U},
 	{~0U,577U,578U},{748U,0U,0U},{140U,0U,0U},{~0U,580U,581U},{681U,0U,0U},{~0U,582U,593U},{~0U,583U,588U},{~0U,584U,587U},
 	{~0U,585U,586U},{32U,0U,0U},{1015U,0U,0U},{950U,0U,0U},{~0U,589U,590U},{398U,0U,0U},{~0U,591U,592U},{1017U,0U,0U},
 	{33U,0U,0U},{349U,0U,0U},{~0U,595U,596U},{302U,0U,0U},{214U,0U,0U},{~0U,598U,611U},{~0U,599U,610U},{~0U,600U,603U},
@@ -290,7 +293,7 @@ static const HuffmanBuilder::Node interFrameDecompressorTree[]=
 	{~0U,2025U,2046U},{~0U,2026U,2027U},{723U,0U,0U},{~0U,2028U,2029U},{863U,0U,0U},{~0U,2030U,2031U},{929U,0U,0U},{~0U,2032U,2045U},
 	{~0U,2033U,2044U},{~0U,2034U,2037U},{~0U,2035U,2036U},{487U,0U,0U},{493U,0U,0U},{~0U,2038U,2043U},{~0U,2039U,2040U},{509U,0U,0U},
 	{~0U,2041U,2042U},{512U,0U,0U},{256U,0U,0U},{483U,0U,0U},{444U,0U,0U},{45U,0U,0U},{~0U,2047U,2048U},{722U,0U,0U},
-	{150U,0U,0U},{605U,0U,0U},{545U,0U,0U}
+	{150U,0U,0U},{605U,0U,0U},{545U,0U,0U},{1025U,0U,0U},{1026U,0U,0U}
 	};
 
 }
@@ -299,55 +302,101 @@ static const HuffmanBuilder::Node interFrameDecompressorTree[]=
 Methods of class InterFrameDecompressor:
 ***************************************/
 
-InterFrameDecompressor::InterFrameDecompressor(IO::File& sFile)
-	:file(&sFile),
-	decoder(sFile,interFrameDecompressorTree)
+InterFrameDecompressor::InterFrameDecompressor(IO::File& sFile,EntropyCoder::Type sCoder,const HuffmanBuilder::Node* sTree)
+	:file(&sFile),coder(sCoder),
+	tree(sTree!=0?sTree:interFrameDecompressorTree)
 	{
 	}
 
-void InterFrameDecompressor::decompressFrame(unsigned int width,unsigned int height,const Pixel* pixels0,Pixel* pixels1)
+template <class DecoderParam,class PredictorParam>
+void InterFrameDecompressor::decompressPixels(DecoderParam& decoder,PredictorParam& predictor,unsigned int width,unsigned int height,const Pixel* pixels0,Pixel* pixels1)
 	{
 	/* Decode all pixel differences: */
+	size_t zeroRunLength=0;
 	const Pixel* p0Ptr=pixels0;
 	Pixel* p1Ptr=pixels1;
-	Pixel* p1End=pixels1+(height*width);
-	while(p1Ptr!=p1End)
-		{
-		/* Decode the next code: */
-		unsigned int code=decoder.decode();
-		
-		/* Check for a zero run: */
-		if(code>outOfRange)
+	ptrdiff_t stride(width);
+	for(unsigned int y=0;y<height;++y)
+		for(unsigned int x=0;x<width;++x,++p0Ptr,++p1Ptr)
 			{
-			/* Calculate the end of the zero run: */
-			Pixel* zeroEnd=p1Ptr+(code-outOfRange);
+			/* Decode the pixel's prediction error: */
+			Pixel delta(0);
+			if(zeroRunLength!=0)
+				{
+				/* Continue the current zero run: */
+				--zeroRunLength;
+				}
+			else
+				{
+				/* Decode the next code: */
+				unsigned int code=decoder.decode();
+				
+				/* Check for a zero run: */
+				if(code>outOfRange)
+					{
+					/* Start a new zero run, of which this pixel is the first: */
+					zeroRunLength=decodeZeroRunLength(decoder,code)-1;
+					}
+				else if(code<outOfRange)
+					{
+					/* Use the decoded delta: */
+					delta=Pixel(code-codeMax);
+					}
+				else
+					{
+					/* Read the unencoded out-of-range delta: */
+					delta=Pixel(decoder.readBits(sizeof(Pixel)*8U));
+					}
+				}
 			
-			/* Check for overrun errors, which can't happen in a correct code stream: */
-			if(zeroEnd>p1End)
-				throw std::runtime_error("InterFrameDecompressor::decompressFrame: Invalid zero run");
+			/* Add the delta predicted from the deltas of already-decoded neighbors: */
+			if(x>0U&&y>0U)
+				delta+=predictor.predict(p1Ptr[-1]-p0Ptr[-1],p1Ptr[-stride]-p0Ptr[-stride],p1Ptr[-stride-1]-p0Ptr[-stride-1]);
 			
-			/* Copy a run of pixels from the previous frame: */
-			for(;p1Ptr!=zeroEnd;++p0Ptr,++p1Ptr)
-				*p1Ptr=*p0Ptr;
+			/* Apply the delta: */
+			*p1Ptr=*p0Ptr+delta;
 			}
-		else if(code<outOfRange)
-			{
-			/* Apply the decoded delta: */
-			*p1Ptr=*p0Ptr+Pixel(code-codeMax);
-			
-			++p0Ptr;
-			++p1Ptr;
-			}
-		else
-			{
-			/* Read the unencoded out-of-range delta: */
-			*p1Ptr=*p0Ptr+Pixel(decoder.readBits(sizeof(Pixel)*8U));
-			
-			++p0Ptr;
-			++p1Ptr;
-			}
-		}
+	
+	/* Check for overrun errors, which can't happen in a correct code stream: */
+	if(zeroRunLength!=0)
+		throw std::runtime_error("InterFrameDecompressor::decompressFrame: Invalid zero run");
 	
 	/* Flush the decoder: */
 	decoder.flush();
 	}
+
+template <class DecoderParam>
+void InterFrameDecompressor::decompressPixels(DecoderParam& decoder,InterFramePredictor::Type predictor,unsigned int width,unsigned int height,const Pixel* pixels0,Pixel* pixels1)
+	{
+	/* Decompress the frame difference using the given frame difference predictor: */
+	if(predictor==InterFramePredictor::MED)
+		{
+		InterFramePredictor::MedPredictor medPredictor;
+		decompressPixels(decoder,medPredictor,width,height,pixels0,pixels1);
+		}
+	else
+		{
+		InterFramePredictor::DeltaPredictor deltaPredictor;
+		decompressPixels(decoder,deltaPredictor,width,height,pixels0,pixels1);
+		}
+	}
+
+void InterFrameDecompressor::decompressFrame(unsigned int width,unsigned int height,const Pixel* pixels0,Pixel* pixels1)
+	{
+	/* Read the frame header identifying the frame difference predictor: */
+	unsigned int predictor=file->read<Misc::UInt8>();
+	if(predictor>=InterFramePredictor::NUM_TYPES)
+		throw std::runtime_error("InterFrameDecompressor::decompressFrame: Unknown frame difference predictor");
+	
+	/* Decompress the frame difference using the selected entropy coding back-end: */
+	if(coder==EntropyCoder::RANS)
+		{
+		RansDecoder decoder(*file,numSymbols);
+		decompressPixels(decoder,InterFramePredictor::Type(predictor),width,height,pixels0,pixels1);
+		}
+	else
+		{
+		HuffmanDecoder decoder(*file,tree);
+		decompressPixels(decoder,InterFramePredictor::Type(predictor),width,height,pixels0,pixels1);
+		}
+	}
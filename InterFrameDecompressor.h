@@ -23,9 +23,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #ifndef INTERFRAMEDECOMPRESSOR_INCLUDED
 #define INTERFRAMEDECOMPRESSOR_INCLUDED
 
+#include <stddef.h>
 #include <IO/File.h>
 
-#include "HuffmanDecoder.h"
+#include "HuffmanBuilder.h"
+#include "EntropyCoder.h"
+#include "InterFramePredictor.h"
 #include "Pixel.h"
 
 class InterFrameDecompressor
@@ -34,12 +37,17 @@ class InterFrameDecompressor
 	private:
 	static const unsigned int codeMax=256U; // Maximum absolute Huffman-coded pixel value
 	static const unsigned int outOfRange=2U*codeMax+1U; // The value indicating an out-of-range pixel value
-	static const unsigned int maxZeroRunLength=512U; // Maximum length of a zero run
+	static const unsigned int maxZeroRunLength=512U; // Maximum length of directly coded zero runs
+	static const unsigned int escapeZeroRun=outOfRange+maxZeroRunLength+1U; // The symbol escaping longer zero runs, whose excess run lengths follow as raw bits
+	static const unsigned int numRunLengthBitsBits=5U; // Number of bits encoding the bit length of escape-coded excess run lengths
+	static const unsigned int numSymbols=escapeZeroRun+1U; // Number of symbols in the decompressor's code
 	IO::FilePtr file; // Pointer to the source file
-	HuffmanDecoder decoder; // The Huffman decoder object
+	EntropyCoder::Type coder; // The entropy coding back-end
+	const HuffmanBuilder::Node* tree; // The Huffman decoding tree used by the Huffman back-end
 	
 	/* Private methods: */
-	Pixel decode(void) // Decodes a prediction error
+	template <class DecoderParam>
+	static Pixel decode(DecoderParam& decoder) // Decodes a prediction error using the given entropy decoder
 		{
 		/* Read the next code from the file: */
 		unsigned int code=decoder.decode();
@@ -53,13 +61,32 @@ class InterFrameDecompressor
 			return Pixel(decoder.readBits(numPixelBits));
 			}
 		}
+	template <class DecoderParam>
+	static size_t decodeZeroRunLength(DecoderParam& decoder,unsigned int code) // Returns the length of the zero run starting with the given code using the given entropy decoder
+		{
+		/* Check for a directly coded zero run length: */
+		if(code!=escapeZeroRun)
+			return code-outOfRange;
+		
+		/* Read the bit length of the excess run length followed by the excess run length itself: */
+		size_t result=maxZeroRunLength+1U;
+		unsigned int numExcessBits=decoder.readBits(numRunLengthBitsBits);
+		if(numExcessBits!=0U)
+			result+=decoder.readBits(numExcessBits);
+		
+		return result;
+		}
+	template <class DecoderParam,class PredictorParam>
+	static void decompressPixels(DecoderParam& decoder,PredictorParam& predictor,unsigned int width,unsigned int height,const Pixel* pixels0,Pixel* pixels1); // Decompresses frame differences relative to the first given pixel array into the second given pixel array using the given entropy decoder and frame difference predictor
+	template <class DecoderParam>
+	static void decompressPixels(DecoderParam& decoder,InterFramePredictor::Type predictor,unsigned int width,unsigned int height,const Pixel* pixels0,Pixel* pixels1); // Decompresses frame differences relative to the first given pixel array into the second given pixel array using the given entropy decoder and the frame difference predictor of the given type
 	
 	/* Constructors and destructors: */
 	public:
-	InterFrameDecompressor(IO::File& sFile); // Creates an inter-frame decompressor reading from the given file
+	InterFrameDecompressor(IO::File& sFile,EntropyCoder::Type sCoder =EntropyCoder::HUFFMAN,const HuffmanBuilder::Node* sTree =0); // Creates an inter-frame decompressor reading from the given file using the given entropy coding back-end; the Huffman back-end uses the given decoding tree, or the default tree if null
 	
 	/* Methods: */
-	void decompressFrame(unsigned int width,unsigned int height,const Pixel* pixels0,Pixel* pixels1); // Decompresses frame differences relative to the first given pixel array into the second given pixel array
+	void decompressFrame(unsigned int width,unsigned int height,const Pixel* pixels0,Pixel* pixels1); // Decompresses frame differences relative to the first given pixel array into the second given pixel array using the frame difference predictor identified in the frame header
 	};
 
 #endif
@@ -0,0 +1,98 @@
+/***********************************************************************
+InterFramePredictor - Declarations of the predictors for frame
+differences that can be used by the inter-frame compressor and
+decompressor.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef INTERFRAMEPREDICTOR_INCLUDED
+#define INTERFRAMEPREDICTOR_INCLUDED
+
+#include <string.h>
+#include <Misc/SizedTypes.h>
+
+#include "Pixel.h"
+
+namespace InterFramePredictor {
+
+enum Type // Enumerated type for frame difference predictors; values are written into inter-frame compressed streams
+	{
+	DELTA=0, // Codes raw per-pixel frame differences
+	MED, // Predicts frame differences from already-coded neighboring frame differences using a median edge detector
+	NUM_TYPES
+	};
+
+inline const char* getName(Type type) // Returns the name of the given frame difference predictor
+	{
+	static const char* names[NUM_TYPES]={"delta","med"};
+	return names[type];
+	}
+
+inline Type findType(const char* name) // Returns the frame difference predictor of the given name, or NUM_TYPES if there is no such predictor
+	{
+	int result;
+	for(result=0;result<NUM_TYPES&&strcasecmp(name,getName(Type(result)))!=0;++result)
+		;
+	return Type(result);
+	}
+
+/*****************************************************************
+Predictor classes; in all methods, left, above, and aboveLeft are the
+frame differences of the respective neighbors of the current pixel in
+raster order:
+*****************************************************************/
+
+class DeltaPredictor // Predictor always predicting an unchanged pixel
+	{
+	/* Methods: */
+	public:
+	static Pixel predict(Pixel left,Pixel above,Pixel aboveLeft) // Predicts the current pixel's frame difference
+		{
+		return Pixel(0);
+		}
+	};
+
+class MedPredictor // Predictor applying a median edge detector to the frame differences of neighbors that changed
+	{
+	/* Methods: */
+	public:
+	static Pixel predict(Pixel left,Pixel above,Pixel aboveLeft) // Predicts the current pixel's frame difference
+		{
+		/* Predict no change unless both direct neighbors changed, to keep isolated changes from spreading into their neighborhoods: */
+		if(left==0U||above==0U)
+			return Pixel(0);
+		
+		/* Calculate the median edge prediction on the signed frame differences: */
+		int l=Misc::SInt16(left);
+		int a=Misc::SInt16(above);
+		int al=Misc::SInt16(aboveLeft);
+		int maxLA=l>a?l:a;
+		int minLA=l<a?l:a;
+		if(al>=maxLA)
+			return Pixel(minLA);
+		else if(al<=minLA)
+			return Pixel(maxLA);
+		else
+			return Pixel(l+a-al);
+		}
+	};
+
+}
+
+#endif
@@ -22,7 +22,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "IntraFrameCompressor.h"
 
+#include <Misc/SizedTypes.h>
+
 #include "HuffmanBuilder.h"
+#include "HuffmanEncoder.h"
+#include "RansEncoder.h"
 
 namespace {
 
@@ -105,43 +109,20 @@ static const HuffmanBuilder::Code intraFrameCompressorCodebook[]=
 Methods of class IntraFrameCompressor:
 *************************************/
 
-IntraFrameCompressor::IntraFrameCompressor(IO::File& sFile)
-	:file(&sFile),
-	 encoder(sFile,intraFrameCompressorCodebook)
+const HuffmanBuilder::Code* IntraFrameCompressor::getDefaultCodebook(void)
 	{
+	return intraFrameCompressorCodebook;
 	}
 
-namespace {
-
-inline Pixel predictPaeth(Pixel a,Pixel b,Pixel c) // Predicts a pixel value based on three neighbors using Alan W. Paeth's PNG filter
+IntraFrameCompressor::IntraFrameCompressor(IO::File& sFile,EntropyCoder::Type sCoder,const HuffmanBuilder::Code* sCodebook,size_t* sHistogram)
+	:file(&sFile),coder(sCoder),
+	 codebook(sCodebook!=0?sCodebook:intraFrameCompressorCodebook),histogram(sHistogram),
+	 predictor(IntraFramePredictor::MED)
 	{
-	/* Calculate the predictor coefficient: */
-	int p=int(a)+int(b)-int(c);
-	
-	/* Return the neighbor value that is closest to the predictor coefficient: */
-	Pixel result=a;
-	int d=abs(p-int(a));
-	
-	int db=abs(p-int(b));
-	if(d>db)
-		{
-		result=b;
-		d=db;
-		}
-	
-	int dc=abs(p-int(c));
-	if(d>dc)
-		{
-		result=c;
-		d=dc;
-		}
-	
-	return result;
 	}
 
-}
-
-void IntraFrameCompressor::compressFrame(unsigned int width,unsigned int height,const Pixel* pixels)
+template <class EncoderParam,class PredictorParam>
+void IntraFrameCompressor::compressPixels(EncoderParam& encoder,PredictorParam& predictor,unsigned int width,unsigned int height,const Pixel* pixels)
 	{
 	const Pixel* pPtr=pixels;
 	ptrdiff_t stride(width);
@@ -161,7 +142,7 @@ void IntraFrameCompressor::compressFrame(unsigned int width,unsigned int height,
 		pred=pPtr[-1];
 		
 		/* Encode the prediction error: */
-		encode(*pPtr-pred);
+		encode(encoder,*pPtr-pred);
 		}
 	
 	/* Compress the remaining rows: */
@@ -175,16 +156,16 @@ void IntraFrameCompressor::compressFrame(unsigned int width,unsigned int height,
 		pred=pPtr[-stride];
 		
 		/* Encode the prediction error: */
-		encode(*pPtr-pred);
+		encode(encoder,*pPtr-pred);
 		
 		/* Process the row's remaining pixels: */
 		for(--pPtr;pPtr!=rowEnd;--pPtr)
 			{
 			/* Predict the current grid value: */
-			pred=predictPaeth(pPtr[1],pPtr[-stride],pPtr[-stride+1]);
+			predictor.predict(pPtr[1],pPtr[-stride],pPtr[-stride+1],pPtr!=rowEnd+1?pPtr[-stride-1]:pPtr[-stride]);
 			
 			/* Encode the prediction error: */
-			encode(*pPtr-pred);
+			encode(encoder,predictor.getError(*pPtr));
 			}
 		
 		/* Bail out early if the grid's height is even: */
@@ -199,19 +180,53 @@ void IntraFrameCompressor::compressFrame(unsigned int width,unsigned int height,
 		pred=pPtr[-stride];
 		
 		/* Encode the prediction error: */
-		encode(*pPtr-pred);
+		encode(encoder,*pPtr-pred);
 		
 		/* Process the row's remaining pixels: */
 		for(++pPtr;pPtr!=rowEnd;++pPtr)
 			{
 			/* Predict the current grid value: */
-			pred=predictPaeth(pPtr[-1],pPtr[-stride],pPtr[-stride-1]);
+			predictor.predict(pPtr[-1],pPtr[-stride],pPtr[-stride-1],pPtr!=rowEnd-1?pPtr[-stride+1]:pPtr[-stride]);
 			
 			/* Encode the prediction error: */
-			encode(*pPtr-pred);
+			encode(encoder,predictor.getError(*pPtr));
 			}
 		}
 	
 	/* Flush the encoder: */
 	encoder.flush();
 	}
+
+template <class EncoderParam>
+void IntraFrameCompressor::compressPixels(EncoderParam& encoder,unsigned int width,unsigned int height,const Pixel* pixels)
+	{
+	/* Compress the frame using the selected pixel predictor: */
+	if(predictor==IntraFramePredictor::MED)
+		{
+		IntraFramePredictor::MedPredictor medPredictor;
+		compressPixels(encoder,medPredictor,width,height,pixels);
+		}
+	else
+		{
+		IntraFramePredictor::PaethPredictor paethPredictor;
+		compressPixels(encoder,paethPredictor,width,height,pixels);
+		}
+	}
+
+void IntraFrameCompressor::compressFrame(unsigned int width,unsigned int height,const Pixel* pixels)
+	{
+	/* Write the frame header identifying the pixel predictor: */
+	file->write<Misc::UInt8>(predictor);
+	
+	/* Compress the frame using the selected entropy coding back-end: */
+	if(coder==EntropyCoder::RANS)
+		{
+		RansEncoder encoder(*file,numSymbols);
+		compressPixels(encoder,width,height,pixels);
+		}
+	else
+		{
+		HuffmanEncoder encoder(*file,codebook,histogram);
+		compressPixels(encoder,width,height,pixels);
+		}
+	}
@@ -23,9 +23,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #ifndef INTRAFRAMECOMPRESSOR_INCLUDED
 #define INTRAFRAMECOMPRESSOR_INCLUDED
 
+#include <stddef.h>
 #include <IO/File.h>
 
-#include "HuffmanEncoder.h"
+#include "HuffmanBuilder.h"
+#include "EntropyCoder.h"
+#include "IntraFramePredictor.h"
 #include "Pixel.h"
 
 class IntraFrameCompressor
@@ -34,11 +37,16 @@ class IntraFrameCompressor
 	private:
 	static const unsigned int codeMax=256U; // Maximum absolute Huffman-coded pixel value
 	static const unsigned int outOfRange=2U*codeMax+1U; // The value indicating an out-of-range pixel value
+	static const unsigned int numSymbols=outOfRange+1U; // Number of symbols in the compressor's Huffman code
 	IO::FilePtr file; // Pointer to the destination file
-	HuffmanEncoder encoder; // The Huffman encoder object
+	EntropyCoder::Type coder; // The entropy coding back-end
+	const HuffmanBuilder::Code* codebook; // The Huffman codebook used by the Huffman back-end
+	size_t* histogram; // Optional histogram counting symbols encoded by the Huffman back-end
+	IntraFramePredictor::Type predictor; // The spatial pixel predictor
 	
 	/* Private methods: */
-	void encode(Pixel predictionError) // Encodes the given prediction error
+	template <class EncoderParam>
+	static void encode(EncoderParam& encoder,Pixel predictionError) // Encodes the given prediction error using the given entropy encoder
 		{
 		if(predictionError>=65536U-codeMax) // Negative in-range prediction error
 			encoder.encode(predictionError-(65536U-codeMax));
@@ -47,16 +55,32 @@ class IntraFrameCompressor
 		else // Out-of-range prediction error
 			{
 			/* Write the out-of-range marker followed by the out-of-range value as-is: */
-			encoder.encode(outOfRange);
-			encoder.writeBits(predictionError,numPixelBits);
+			encoder.encodeAndWriteBits(outOfRange,predictionError,numPixelBits);
 			}
 		}
+	template <class EncoderParam,class PredictorParam>
+	static void compressPixels(EncoderParam& encoder,PredictorParam& predictor,unsigned int width,unsigned int height,const Pixel* pixels); // Compresses the given frame using the given entropy encoder and pixel predictor
+	template <class EncoderParam>
+	void compressPixels(EncoderParam& encoder,unsigned int width,unsigned int height,const Pixel* pixels); // Compresses the given frame using the given entropy encoder and the selected pixel predictor
 	
 	/* Constructors and destructors: */
 	public:
-	IntraFrameCompressor(IO::File& sFile); // Creates an intra-frame compressor writing to the given file
+	IntraFrameCompressor(IO::File& sFile,EntropyCoder::Type sCoder =EntropyCoder::HUFFMAN,const HuffmanBuilder::Code* sCodebook =0,size_t* sHistogram =0); // Creates an intra-frame compressor writing to the given file using the given entropy coding back-end; the Huffman back-end uses the given codebook, or the default codebook if null, and optionally counts encoded symbols in the given histogram of numSymbols entries; frames are predicted using the MED predictor until changed
 	
 	/* Methods: */
+	static unsigned int getNumSymbols(void) // Returns the number of symbols in the compressor's code
+		{
+		return numSymbols;
+		}
+	static const HuffmanBuilder::Code* getDefaultCodebook(void); // Returns the compressor's default Huffman codebook
+	IntraFramePredictor::Type getPredictor(void) const // Returns the compressor's spatial pixel predictor
+		{
+		return predictor;
+		}
+	void setPredictor(IntraFramePredictor::Type newPredictor) // Sets the spatial pixel predictor used for subsequently compressed frames
+		{
+		predictor=newPredictor;
+		}
 	void compressFrame(unsigned int width,unsigned int height,const Pixel* pixels); // Compresses the given frame
 	};
 
@@ -22,7 +22,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "IntraFrameDecompressor.h"
 
+#include <stdexcept>
+#include <Misc/SizedTypes.h>
+
 #include "HuffmanBuilder.h"
+#include "HuffmanDecoder.h"
+#include "RansDecoder.h"
 
 namespace {
 
@@ -169,43 +174,14 @@ static const HuffmanBuilder::Node intraFrameDecompressorTree[]=
 Methods of class IntraFrameDecompressor:
 ***************************************/
 
-IntraFrameDecompressor::IntraFrameDecompressor(IO::File& sFile)
-	:file(&sFile),
-	 decoder(sFile,intraFrameDecompressorTree)
+IntraFrameDecompressor::IntraFrameDecompressor(IO::File& sFile,EntropyCoder::Type sCoder,const HuffmanBuilder::Node* sTree)
+	:file(&sFile),coder(sCoder),
+	 tree(sTree!=0?sTree:intraFrameDecompressorTree)
 	{
 	}
 
-namespace {
-
-inline Pixel predictPaeth(Pixel a,Pixel b,Pixel c) // Predicts a pixel value based on three neighbors using Alan W. Paeth's PNG filter
-	{
-	/* Calculate the predictor coefficient: */
-	int p=int(a)+int(b)-int(c);
-	
-	/* Return the neighbor value that is closest to the predictor coefficient: */
-	Pixel result=a;
-	int d=abs(p-int(a));
-	
-	int db=abs(p-int(b));
-	if(d>db)
-		{
-		result=b;
-		d=db;
-		}
-	
-	int dc=abs(p-int(c));
-	if(d>dc)
-		{
-		result=c;
-		d=dc;
-		}
-	
-	return result;
-	}
-
-}
-
-void IntraFrameDecompressor::decompressFrame(unsigned int width,unsigned int height,Pixel* pixels)
+template <class DecoderParam,class PredictorParam>
+void IntraFrameDecompressor::decompressPixels(DecoderParam& decoder,PredictorParam& predictor,unsigned int width,unsigned int height,Pixel* pixels)
 	{
 	Pixel* pPtr=pixels;
 	ptrdiff_t stride(width);
@@ -225,7 +201,7 @@ void IntraFrameDecompressor::decompressFrame(unsigned int width,unsigned int hei
 		pred=pPtr[-1];
 		
 		/* Decode the prediction error: */
-		*pPtr=pred+decode();
+		*pPtr=pred+decode(decoder);
 		}
 	
 	/* Decompress the remaining rows: */
@@ -239,16 +215,16 @@ void IntraFrameDecompressor::decompressFrame(unsigned int width,unsigned int hei
 		pred=pPtr[-stride];
 		
 		/* Decode the prediction error: */
-		*pPtr=pred+decode();
+		*pPtr=pred+decode(decoder);
 		
 		/* Process the row's remaining pixels: */
 		for(--pPtr;pPtr!=rowEnd;--pPtr)
 			{
 			/* Predict the current grid value: */
-			pred=predictPaeth(pPtr[1],pPtr[-stride],pPtr[-stride+1]);
+			predictor.predict(pPtr[1],pPtr[-stride],pPtr[-stride+1],pPtr!=rowEnd+1?pPtr[-stride-1]:pPtr[-stride]);
 			
 			/* Decode the prediction error: */
-			*pPtr=pred+decode();
+			*pPtr=predictor.getValue(decode(decoder));
 			}
 		
 		/* Bail out early if the grid's height is even: */
@@ -263,19 +239,55 @@ void IntraFrameDecompressor::decompressFrame(unsigned int width,unsigned int hei
 		pred=pPtr[-stride];
 		
 		/* Decode the prediction error: */
-		*pPtr=pred+decode();
+		*pPtr=pred+decode(decoder);
 		
 		/* Process the row's remaining pixels: */
 		for(++pPtr;pPtr!=rowEnd;++pPtr)
 			{
 			/* Predict the current grid value: */
-			pred=predictPaeth(pPtr[-1],pPtr[-stride],pPtr[-stride-1]);
+			predictor.predict(pPtr[-1],pPtr[-stride],pPtr[-stride-1],pPtr!=rowEnd-1?pPtr[-stride+1]:pPtr[-stride]);
 			
 			/* Decode the prediction error: */
-			*pPtr=pred+decode();
+			*pPtr=predictor.getValue(decode(decoder));
 			}
 		}
 	
 	/* Flush the decoder: */
 	decoder.flush();
 	}
+
+template <class DecoderParam>
+void IntraFrameDecompressor::decompressPixels(DecoderParam& decoder,IntraFramePredictor::Type predictor,unsigned int width,unsigned int height,Pixel* pixels)
+	{
+	/* Decompress the frame using the given pixel predictor: */
+	if(predictor==IntraFramePredictor::MED)
+		{
+		IntraFramePredictor::MedPredictor medPredictor;
+		decompressPixels(decoder,medPredictor,width,height,pixels);
+		}
+	else
+		{
+		IntraFramePredictor::PaethPredictor paethPredictor;
+		decompressPixels(decoder,paethPredictor,width,height,pixels);
+		}
+	}
+
+void IntraFrameDecompressor::decompressFrame(unsigned int width,unsigned int height,Pixel* pixels)
+	{
+	/* Read the frame header identifying the pixel predictor: */
+	unsigned int predictor=file->read<Misc::UInt8>();
+	if(predictor>=IntraFramePredictor::NUM_TYPES)
+		throw std::runtime_error("IntraFrameDecompressor::decompressFrame: Unknown pixel predictor");
+	
+	/* Decompress the frame using the selected entropy coding back-end: */
+	if(coder==EntropyCoder::RANS)
+		{
+		RansDecoder decoder(*file,numSymbols);
+		decompressPixels(decoder,IntraFramePredictor::Type(predictor),width,height,pixels);
+		}
+	else
+		{
+		HuffmanDecoder decoder(*file,tree);
+		decompressPixels(decoder,IntraFramePredictor::Type(predictor),width,height,pixels);
+		}
+	}
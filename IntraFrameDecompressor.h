@@ -25,7 +25,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include <IO/File.h>
 
-#include "HuffmanDecoder.h"
+#include "HuffmanBuilder.h"
+#include "EntropyCoder.h"
+#include "IntraFramePredictor.h"
 #include "Pixel.h"
 
 class IntraFrameDecompressor
@@ -34,11 +36,14 @@ class IntraFrameDecompressor
 	private:
 	static const unsigned int codeMax=256U; // Maximum absolute Huffman-coded pixel value
 	static const unsigned int outOfRange=2U*codeMax+1U; // The value indicating an out-of-range pixel value
+	static const unsigned int numSymbols=outOfRange+1U; // Number of symbols in the decompressor's code
 	IO::FilePtr file; // Pointer to the source file
-	HuffmanDecoder decoder; // The Huffman decoder object
+	EntropyCoder::Type coder; // The entropy coding back-end
+	const HuffmanBuilder::Node* tree; // The Huffman decoding tree used by the Huffman back-end
 	
 	/* Private methods: */
-	Pixel decode(void) // Decodes a prediction error
+	template <class DecoderParam>
+	static Pixel decode(DecoderParam& decoder) // Decodes a prediction error using the given entropy decoder
 		{
 		/* Read the next code from the file: */
 		unsigned int code=decoder.decode();
@@ -52,13 +57,17 @@ class IntraFrameDecompressor
 			return Pixel(decoder.readBits(numPixelBits));
 			}
 		}
+	template <class DecoderParam,class PredictorParam>
+	static void decompressPixels(DecoderParam& decoder,PredictorParam& predictor,unsigned int width,unsigned int height,Pixel* pixels); // Decompresses a frame into the given pixel array using the given entropy decoder and pixel predictor
+	template <class DecoderParam>
+	static void decompressPixels(DecoderParam& decoder,IntraFramePredictor::Type predictor,unsigned int width,unsigned int height,Pixel* pixels); // Decompresses a frame into the given pixel array using the given entropy decoder and the pixel predictor of the given type
 	
 	/* Constructors and destructors: */
 	public:
-	IntraFrameDecompressor(IO::File& sFile); // Creates an intra-frame decompressor reading from the given file
+	IntraFrameDecompressor(IO::File& sFile,EntropyCoder::Type sCoder =EntropyCoder::HUFFMAN,const HuffmanBuilder::Node* sTree =0); // Creates an intra-frame decompressor reading from the given file using the given entropy coding back-end; the Huffman back-end uses the given decoding tree, or the default tree if null
 	
 	/* Methods: */
-	void decompressFrame(unsigned int width,unsigned int height,Pixel* pixels); // Decompresses a frame into the given pixel array
+	void decompressFrame(unsigned int width,unsigned int height,Pixel* pixels); // Decompresses a frame into the given pixel array using the pixel predictor identified in the frame header
 	};
 
 #endif
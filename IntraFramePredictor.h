@@ -0,0 +1,219 @@
+/***********************************************************************
+IntraFramePredictor - Declarations of the spatial pixel predictors that
+can be used by the intra-frame compressor and decompressor.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef INTRAFRAMEPREDICTOR_INCLUDED
+#define INTRAFRAMEPREDICTOR_INCLUDED
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "Pixel.h"
+
+namespace IntraFramePredictor {
+
+enum Type // Enumerated type for spatial pixel predictors; values are written into intra-frame compressed streams
+	{
+	PAETH=0, // Alan W. Paeth's PNG filter
+	MED, // LOCO-I median edge detector with context-dependent bias correction
+	NUM_TYPES
+	};
+
+inline const char* getName(Type type) // Returns the name of the given pixel predictor
+	{
+	static const char* names[NUM_TYPES]={"paeth","med"};
+	return names[type];
+	}
+
+inline Type findType(const char* name) // Returns the pixel predictor of the given name, or NUM_TYPES if there is no such predictor
+	{
+	int result;
+	for(result=0;result<NUM_TYPES&&strcasecmp(name,getName(Type(result)))!=0;++result)
+		;
+	return Type(result);
+	}
+
+/*****************************************************************
+Predictor classes; in all methods, a is the previously coded pixel
+along the scan direction, b the pixel above the current one, c the
+pixel above a, and d the pixel following b along the scan direction:
+*****************************************************************/
+
+class PaethPredictor // Stateless predictor using Alan W. Paeth's PNG filter
+	{
+	/* Elements: */
+	private:
+	Pixel prediction; // Prediction for the current pixel
+	
+	/* Methods: */
+	public:
+	void predict(Pixel a,Pixel b,Pixel c,Pixel d) // Predicts the current pixel from its coded neighbors
+		{
+		/* Calculate the predictor coefficient: */
+		int p=int(a)+int(b)-int(c);
+		
+		/* Return the neighbor value that is closest to the predictor coefficient: */
+		prediction=a;
+		int dist=abs(p-int(a));
+		
+		int db=abs(p-int(b));
+		if(dist>db)
+			{
+			prediction=b;
+			dist=db;
+			}
+		
+		int dc=abs(p-int(c));
+		if(dist>dc)
+			{
+			prediction=c;
+			dist=dc;
+			}
+		}
+	Pixel getError(Pixel value) // Returns the prediction error to encode for the current pixel
+		{
+		return value-prediction;
+		}
+	Pixel getValue(Pixel error) // Returns the current pixel reconstructed from the given decoded prediction error
+		{
+		return prediction+error;
+		}
+	};
+
+class MedPredictor // Median edge detector from LOCO-I / JPEG-LS with adaptive per-context bias correction
+	{
+	/* Embedded classes: */
+	private:
+	struct Context // Structure accumulating the prediction errors in one gradient context
+		{
+		/* Elements: */
+		public:
+		int errorSum; // Accumulated prediction error since the last correction adjustment
+		int count; // Number of prediction errors accumulated in the context
+		int correction; // Bias correction added to the median edge prediction
+		};
+	
+	/* Elements: */
+	static const int t1=18,t2=67,t3=276; // Gradient quantization thresholds for 16-bit pixels as defined by JPEG-LS
+	static const int resetCount=64; // Context count at which accumulated statistics are halved
+	static const int minCorrection=-128,maxCorrection=127; // Range of bias corrections
+	static const int numContexts=365; // Number of distinct gradient contexts after merging contexts of opposite sign
+	Context contexts[numContexts]; // Statistics for all gradient contexts
+	Context* context; // Context of the current pixel
+	int sign; // Sign with which the current pixel's prediction error is coded
+	int prediction; // Bias-corrected prediction for the current pixel
+	
+	/* Private methods: */
+	static int quantizeGradient(int g) // Quantizes a local gradient into one of nine regions without branching
+		{
+		return int(g>0)+int(g>=t1)+int(g>=t2)+int(g>=t3)-int(g<0)-int(g<=-t1)-int(g<=-t2)-int(g<=-t3);
+		}
+	void update(Pixel error) // Updates the current context with the given coded prediction error
+		{
+		/* Accumulate the prediction error, interpreted as a signed value: */
+		context->errorSum+=error>=0x8000U?int(error)-0x10000:int(error);
+		if(context->count==resetCount)
+			{
+			/* Halve the accumulated statistics to adapt to changing image content: */
+			context->errorSum=context->errorSum>=0?context->errorSum>>1:-((1-context->errorSum)>>1);
+			context->count>>=1;
+			}
+		++context->count;
+		
+		/* Adjust the context's bias correction if its average prediction error left the [-1, 0] interval: */
+		if(context->errorSum<=-context->count)
+			{
+			context->errorSum+=context->count;
+			if(context->correction>minCorrection)
+				--context->correction;
+			if(context->errorSum<=-context->count)
+				context->errorSum=1-context->count;
+			}
+		else if(context->errorSum>0)
+			{
+			context->errorSum-=context->count;
+			if(context->correction<maxCorrection)
+				++context->correction;
+			if(context->errorSum>0)
+				context->errorSum=0;
+			}
+		}
+	
+	/* Constructors and destructors: */
+	public:
+	MedPredictor(void)
+		{
+		/* Initialize all contexts: */
+		for(int i=0;i<numContexts;++i)
+			{
+			contexts[i].errorSum=0;
+			contexts[i].count=1;
+			contexts[i].correction=0;
+			}
+		}
+	
+	/* Methods: */
+	void predict(Pixel a,Pixel b,Pixel c,Pixel d) // Predicts the current pixel from its coded neighbors
+		{
+		/* Select the context from the quantized local gradients, merging contexts of opposite sign: */
+		int ctx=(quantizeGradient(int(d)-int(b))*9+quantizeGradient(int(b)-int(c)))*9+quantizeGradient(int(c)-int(a));
+		sign=1;
+		if(ctx<0)
+			{
+			sign=-1;
+			ctx=-ctx;
+			}
+		context=&contexts[ctx];
+		
+		/* Calculate the median edge prediction: */
+		int ia=a,ib=b,ic=c;
+		int maxAB=ia>ib?ia:ib;
+		int minAB=ia<ib?ia:ib;
+		if(ic>=maxAB)
+			prediction=minAB;
+		else if(ic<=minAB)
+			prediction=maxAB;
+		else
+			prediction=ia+ib-ic;
+		
+		/* Apply the context's bias correction and clamp the result to the valid pixel range: */
+		prediction+=sign*context->correction;
+		if(prediction<0)
+			prediction=0;
+		else if(prediction>0xffff)
+			prediction=0xffff;
+		}
+	Pixel getError(Pixel value) // Returns the prediction error to encode for the current pixel and updates the current context
+		{
+		Pixel error=Pixel(sign*(int(value)-prediction));
+		update(error);
+		return error;
+		}
+	Pixel getValue(Pixel error) // Returns the current pixel reconstructed from the given decoded prediction error and updates the current context
+		{
+		update(error);
+		return Pixel(prediction+sign*int(error));
+		}
+	};
+
+}
+
+#endif
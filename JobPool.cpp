@@ -0,0 +1,155 @@
+/***********************************************************************
+JobPool - Class to run batches of independent jobs on a pool of worker
+threads.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "JobPool.h"
+
+#include <stdexcept>
+
+/************************
+Methods of class JobPool:
+************************/
+
+void JobPool::executeJobs(void)
+	{
+	while(true)
+		{
+		/* Grab the next job from the current batch: */
+		unsigned int jobIndex;
+		JobFunction function;
+		void* userData;
+		{
+		Threads::MutexCond::Lock jobLock(jobCond);
+		if(nextJob==numJobs)
+			break;
+		jobIndex=nextJob;
+		++nextJob;
+		function=jobFunction;
+		userData=jobUserData;
+		}
+		
+		/* Execute the job: */
+		std::string error;
+		bool failed=false;
+		try
+			{
+			function(jobIndex,userData);
+			}
+		catch(const std::exception& err)
+			{
+			error=err.what();
+			failed=true;
+			}
+		catch(...)
+			{
+			error="JobPool: Job threw an unknown exception";
+			failed=true;
+			}
+		
+		/* Mark the job as finished and wake up the calling thread if it was the batch's last one: */
+		Threads::MutexCond::Lock jobLock(jobCond);
+		if(failed&&!jobFailed)
+			{
+			jobFailed=true;
+			jobError=error;
+			}
+		if(--numUnfinishedJobs==0U)
+			jobCond.broadcast();
+		}
+	}
+
+void* JobPool::workerThreadMethod(void)
+	{
+	unsigned int lastBatchIndex=0;
+	while(true)
+		{
+		/* Wait for the next batch of jobs: */
+		{
+		Threads::MutexCond::Lock jobLock(jobCond);
+		while(runWorkerThreads&&batchIndex==lastBatchIndex)
+			jobCond.wait(jobLock);
+		if(!runWorkerThreads)
+			break;
+		lastBatchIndex=batchIndex;
+		}
+		
+		/* Help executing the batch's jobs: */
+		executeJobs();
+		}
+	
+	return 0;
+	}
+
+JobPool::JobPool(unsigned int sNumThreads)
+	:numWorkerThreads(sNumThreads>1U?sNumThreads-1U:0U),workerThreads(0),
+	 runWorkerThreads(true),batchIndex(0),
+	 jobFunction(0),jobUserData(0),numJobs(0),nextJob(0),numUnfinishedJobs(0),
+	 jobFailed(false)
+	{
+	/* Start the worker threads: */
+	if(numWorkerThreads>0U)
+		{
+		workerThreads=new Threads::Thread[numWorkerThreads];
+		for(unsigned int i=0;i<numWorkerThreads;++i)
+			workerThreads[i].start(this,&JobPool::workerThreadMethod);
+		}
+	}
+
+JobPool::~JobPool(void)
+	{
+	/* Shut down the worker threads: */
+	{
+	Threads::MutexCond::Lock jobLock(jobCond);
+	runWorkerThreads=false;
+	jobCond.broadcast();
+	}
+	for(unsigned int i=0;i<numWorkerThreads;++i)
+		workerThreads[i].join();
+	delete[] workerThreads;
+	}
+
+void JobPool::runJobs(unsigned int newNumJobs,JobPool::JobFunction newJobFunction,void* newJobUserData)
+	{
+	/* Start a new batch of jobs and wake up the worker threads: */
+	{
+	Threads::MutexCond::Lock jobLock(jobCond);
+	jobFunction=newJobFunction;
+	jobUserData=newJobUserData;
+	numJobs=newNumJobs;
+	nextJob=0;
+	numUnfinishedJobs=newNumJobs;
+	jobFailed=false;
+	++batchIndex;
+	jobCond.broadcast();
+	}
+	
+	/* Help executing the batch's jobs: */
+	executeJobs();
+	
+	/* Wait until all jobs have finished: */
+	Threads::MutexCond::Lock jobLock(jobCond);
+	while(numUnfinishedJobs>0U)
+		jobCond.wait(jobLock);
+	
+	/* Re-throw any exceptions thrown by the batch's jobs: */
+	if(jobFailed)
+		throw std::runtime_error(jobError);
+	}
@@ -0,0 +1,68 @@
+/***********************************************************************
+JobPool - Class to run batches of independent jobs on a pool of worker
+threads.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef JOBPOOL_INCLUDED
+#define JOBPOOL_INCLUDED
+
+#include <string>
+#include <Threads/Thread.h>
+#include <Threads/MutexCond.h>
+
+class JobPool
+	{
+	/* Embedded classes: */
+	public:
+	typedef void (*JobFunction)(unsigned int jobIndex,void* userData); // Type for functions executing a single job of a batch
+	
+	/* Elements: */
+	private:
+	unsigned int numWorkerThreads; // Number of additional worker threads
+	Threads::Thread* workerThreads; // Array of additional worker threads
+	Threads::MutexCond jobCond; // Condition variable protecting the current batch's state, signalled when a new batch starts or the current batch finishes
+	bool runWorkerThreads; // Flag to shut down the worker threads
+	unsigned int batchIndex; // Running index of the current batch of jobs
+	JobFunction jobFunction; // Function executing the current batch's jobs
+	void* jobUserData; // Additional parameter for the current batch's job function
+	unsigned int numJobs; // Number of jobs in the current batch
+	unsigned int nextJob; // Index of the next job in the current batch to be executed
+	unsigned int numUnfinishedJobs; // Number of jobs in the current batch that have not finished yet
+	bool jobFailed; // Flag whether any job in the current batch threw an exception
+	std::string jobError; // Description of the first exception thrown by a job in the current batch
+	
+	/* Private methods: */
+	void executeJobs(void); // Executes jobs from the current batch until there are none left
+	void* workerThreadMethod(void); // Method for the worker threads
+	
+	/* Constructors and destructors: */
+	public:
+	JobPool(unsigned int sNumThreads); // Creates a job pool executing jobs on the given total number of threads, including the thread calling runJobs
+	~JobPool(void);
+	
+	/* Methods: */
+	unsigned int getNumThreads(void) const // Returns the total number of threads executing jobs
+		{
+		return numWorkerThreads+1;
+		}
+	void runJobs(unsigned int newNumJobs,JobFunction newJobFunction,void* newJobUserData); // Executes the jobs of indices [0, newNumJobs) in parallel and returns when all have finished; throws an exception if any job threw an exception
+	};
+
+#endif
@@ -0,0 +1,117 @@
+/***********************************************************************
+KalmanTemporalFilter - Temporal filter tracking each pixel's depth
+value with a scalar Kalman filter, and restarting a pixel's estimate
+when its depth value changes abruptly.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "KalmanTemporalFilter.h"
+
+/*************************************
+Methods of class KalmanTemporalFilter:
+*************************************/
+
+KalmanTemporalFilter::KalmanTemporalFilter(const Size& sSize,unsigned int numAveragingSlots)
+	:TemporalFilter(sSize),
+	 changeThreshold(9.0f),
+	 states(new PixelState[size[1]*size[0]])
+	{
+	/* Calculate the process noise for which the filter's steady-state gain is 2/(n+1): */
+	float gain=2.0f/float(numAveragingSlots+1);
+	processNoise=gain*gain/(1.0f-gain);
+	
+	/* Initialize the filter state: */
+	PixelState* sPtr=states;
+	for(unsigned int y=0;y<size[1];++y)
+		for(unsigned int x=0;x<size[0];++x,++sPtr)
+			{
+			sPtr->estimate=0.0f;
+			sPtr->errorVariance=0.0f;
+			sPtr->numSamples=0;
+			}
+	}
+
+KalmanTemporalFilter::~KalmanTemporalFilter(void)
+	{
+	delete[] states;
+	}
+
+const char* KalmanTemporalFilter::getName(void) const
+	{
+	return "kalman";
+	}
+
+size_t KalmanTemporalFilter::getStateSize(void) const
+	{
+	return sizeof(PixelState);
+	}
+
+void KalmanTemporalFilter::filterBand(const TemporalFilter::Parameters& parameters,const TemporalFilter::Band& band)
+	{
+	/* Use the maximum variance of stable pixels as measurement noise variance: */
+	float measurementNoise=parameters.maxVariance>0?float(parameters.maxVariance):1.0f;
+	float frameProcessNoise=processNoise*measurementNoise;
+	
+	size_t bandOffset=size_t(band.yBegin)*size_t(size[0]);
+	const RawDepth* iPtr=band.input+bandOffset;
+	const PixelDepthCorrection* pdcPtr=band.pixelDepthCorrection+bandOffset;
+	PixelState* sPtr=states+bandOffset;
+	float* vPtr=band.valid+bandOffset;
+	float* oPtr=band.output+bandOffset;
+	for(unsigned int y=band.yBegin;y<band.yEnd;++y)
+		{
+		float py=float(y)+0.5f;
+		for(unsigned int x=0;x<size[0];++x,++iPtr,++pdcPtr,++sPtr,++vPtr,++oPtr)
+			{
+			float newVal=float(*iPtr);
+			if(isValid(parameters,float(x)+0.5f,py,pdcPtr->correct(newVal)))
+				{
+				/* Predict the estimate's error variance for the current frame: */
+				float predictedVariance=sPtr->errorVariance+frameProcessNoise;
+				
+				float innovation=newVal-sPtr->estimate;
+				if(sPtr->numSamples==0||innovation*innovation>changeThreshold*(predictedVariance+measurementNoise))
+					{
+					/* Restart the pixel's estimate from the new sample: */
+					sPtr->estimate=newVal;
+					sPtr->errorVariance=measurementNoise;
+					sPtr->numSamples=1;
+					}
+				else
+					{
+					/* Correct the pixel's estimate with the new sample: */
+					float gain=predictedVariance/(predictedVariance+measurementNoise);
+					sPtr->estimate+=gain*innovation;
+					sPtr->errorVariance=(1.0f-gain)*predictedVariance;
+					if(sPtr->numSamples<parameters.minNumSamples)
+						++sPtr->numSamples;
+					}
+				}
+			else if(!parameters.retainValids)
+				{
+				/* Invalidate the pixel's estimate: */
+				sPtr->numSamples=0;
+				}
+			
+			/* Check if the pixel is considered "stable" and update its output value: */
+			bool stable=sPtr->numSamples>=parameters.minNumSamples&&sPtr->numSamples>0;
+			updateOutput(parameters,stable,pdcPtr->correct(sPtr->estimate),*vPtr,*oPtr);
+			}
+		}
+	}
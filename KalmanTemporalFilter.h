@@ -0,0 +1,59 @@
+/***********************************************************************
+KalmanTemporalFilter - Temporal filter tracking each pixel's depth
+value with a scalar Kalman filter, and restarting a pixel's estimate
+when its depth value changes abruptly.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef KALMANTEMPORALFILTER_INCLUDED
+#define KALMANTEMPORALFILTER_INCLUDED
+
+#include "TemporalFilter.h"
+
+class KalmanTemporalFilter:public TemporalFilter
+	{
+	/* Embedded classes: */
+	private:
+	struct PixelState // Structure holding a pixel's filter state
+		{
+		/* Elements: */
+		public:
+		float estimate; // Estimated raw depth value
+		float errorVariance; // Variance of the estimate's error
+		unsigned int numSamples; // Number of valid samples since the estimate was last restarted
+		};
+	
+	/* Elements: */
+	private:
+	float processNoise; // Process noise variance added per frame, relative to measurement noise variance
+	float changeThreshold; // Squared number of standard deviations by which a new sample must differ from the estimate to restart the estimate
+	PixelState* states; // Array of per-pixel filter states
+	
+	/* Constructors and destructors: */
+	public:
+	KalmanTemporalFilter(const Size& sSize,unsigned int numAveragingSlots); // Creates a filter for frames of the given size whose steady-state gain matches an exponential moving average with the same center of mass as a running average of the given length
+	virtual ~KalmanTemporalFilter(void);
+	
+	/* Methods from class TemporalFilter: */
+	virtual const char* getName(void) const;
+	virtual size_t getStateSize(void) const;
+	virtual void filterBand(const Parameters& parameters,const Band& band);
+	};
+
+#endif
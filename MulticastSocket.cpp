@@ -0,0 +1,158 @@
+/***********************************************************************
+MulticastSocket - Class for UDP sockets sending datagrams to or
+receiving datagrams from an IPv4 multicast group.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "MulticastSocket.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <Misc/StdError.h>
+
+/********************************
+Methods of class MulticastSocket:
+********************************/
+
+Misc::UInt32 MulticastSocket::parseAddress(const char* address)
+	{
+	struct in_addr result;
+	if(inet_pton(AF_INET,address,&result)!=1)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Invalid IPv4 address %s",address);
+	
+	return ntohl(result.s_addr);
+	}
+
+MulticastSocket::MulticastSocket(Misc::UInt32 sGroupAddress,int sGroupPortId,const char* interfaceAddress,bool receive,int ttl)
+	:fd(-1),
+	 groupAddress(sGroupAddress),groupPortId(sGroupPortId)
+	{
+	/* Check that the group address is a multicast address: */
+	if((groupAddress&0xf0000000U)!=0xe0000000U)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"%u.%u.%u.%u is not a multicast address",(groupAddress>>24)&0xffU,(groupAddress>>16)&0xffU,(groupAddress>>8)&0xffU,groupAddress&0xffU);
+	
+	/* Look up the address of the network interface over which to send or receive: */
+	struct in_addr interface;
+	interface.s_addr=htonl(INADDR_ANY);
+	if(interfaceAddress!=0)
+		interface.s_addr=htonl(parseAddress(interfaceAddress));
+	
+	/* Create the UDP socket: */
+	fd=socket(AF_INET,SOCK_DGRAM,0);
+	if(fd<0)
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to create socket due to error %s",strerror(errno));
+	
+	try
+		{
+		struct sockaddr_in groupSocketAddress;
+		memset(&groupSocketAddress,0,sizeof(groupSocketAddress));
+		groupSocketAddress.sin_family=AF_INET;
+		groupSocketAddress.sin_addr.s_addr=htonl(groupAddress);
+		groupSocketAddress.sin_port=htons(groupPortId);
+		
+		if(receive)
+			{
+			/* Allow other processes on the same host to join the same group, and enlarge the receive buffer; failures to enlarge the buffer are not fatal: */
+			int reuse=1;
+			if(setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&reuse,sizeof(reuse))<0)
+				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to share socket address due to error %s",strerror(errno));
+			int rcvBufSize=socketBufferSize;
+			setsockopt(fd,SOL_SOCKET,SO_RCVBUF,&rcvBufSize,sizeof(rcvBufSize));
+			
+			/* Bind the socket to the group's address and port to receive only the group's datagrams: */
+			if(bind(fd,reinterpret_cast<struct sockaddr*>(&groupSocketAddress),sizeof(groupSocketAddress))<0)
+				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to bind socket to port %d due to error %s",groupPortId,strerror(errno));
+			
+			/* Join the multicast group on the selected interface: */
+			struct ip_mreq membership;
+			membership.imr_multiaddr=groupSocketAddress.sin_addr;
+			membership.imr_interface=interface;
+			if(setsockopt(fd,IPPROTO_IP,IP_ADD_MEMBERSHIP,&membership,sizeof(membership))<0)
+				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to join multicast group due to error %s",strerror(errno));
+			}
+		else
+			{
+			/* Enlarge the send buffer; failure to do so is not fatal: */
+			int sndBufSize=socketBufferSize;
+			setsockopt(fd,SOL_SOCKET,SO_SNDBUF,&sndBufSize,sizeof(sndBufSize));
+			
+			/* Select the sending interface and the datagrams' time-to-live, and deliver datagrams to receivers on the same host: */
+			if(setsockopt(fd,IPPROTO_IP,IP_MULTICAST_IF,&interface,sizeof(interface))<0)
+				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to select multicast interface due to error %s",strerror(errno));
+			unsigned char multicastTtl=(unsigned char)(ttl);
+			if(setsockopt(fd,IPPROTO_IP,IP_MULTICAST_TTL,&multicastTtl,sizeof(multicastTtl))<0)
+				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to set multicast time-to-live due to error %s",strerror(errno));
+			unsigned char loop=1;
+			if(setsockopt(fd,IPPROTO_IP,IP_MULTICAST_LOOP,&loop,sizeof(loop))<0)
+				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to enable multicast loopback due to error %s",strerror(errno));
+			
+			/* Connect the socket to the group, which also checks that the group can be reached: */
+			if(connect(fd,reinterpret_cast<struct sockaddr*>(&groupSocketAddress),sizeof(groupSocketAddress))<0)
+				throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to reach multicast group due to error %s",strerror(errno));
+			}
+		}
+	catch(...)
+		{
+		/* Close the socket and re-throw the exception: */
+		close(fd);
+		throw;
+		}
+	}
+
+MulticastSocket::~MulticastSocket(void)
+	{
+	close(fd);
+	}
+
+bool MulticastSocket::send(const void* datagram,size_t datagramSize)
+	{
+	while(true)
+		{
+		ssize_t result=::send(fd,datagram,datagramSize,MSG_DONTWAIT);
+		if(result>=0)
+			return true;
+		
+		/* Retry if interrupted; drop the datagram if the send buffer is full: */
+		if(errno==EAGAIN||errno==EWOULDBLOCK||errno==ENOBUFS)
+			return false;
+		if(errno!=EINTR)
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to send datagram due to error %s",strerror(errno));
+		}
+	}
+
+size_t MulticastSocket::receive(void* buffer,size_t bufferSize)
+	{
+	while(true)
+		{
+		ssize_t result=recv(fd,buffer,bufferSize,MSG_DONTWAIT);
+		if(result>=0)
+			return size_t(result);
+		
+		/* Retry if interrupted; return zero if there are no pending datagrams: */
+		if(errno==EAGAIN||errno==EWOULDBLOCK)
+			return 0;
+		if(errno!=EINTR)
+			throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unable to receive datagram due to error %s",strerror(errno));
+		}
+	}
@@ -0,0 +1,65 @@
+/***********************************************************************
+MulticastSocket - Class for UDP sockets sending datagrams to or
+receiving datagrams from an IPv4 multicast group.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef MULTICASTSOCKET_INCLUDED
+#define MULTICASTSOCKET_INCLUDED
+
+#include <stddef.h>
+#include <Misc/SizedTypes.h>
+
+class MulticastSocket
+	{
+	/* Elements: */
+	private:
+	static const int socketBufferSize=1<<22; // Size of the socket's kernel send and receive buffers to absorb bursts of datagrams
+	int fd; // File descriptor of the UDP socket
+	Misc::UInt32 groupAddress; // IPv4 address of the multicast group in host byte order
+	int groupPortId; // UDP port ID of the multicast group
+	
+	/* Constructors and destructors: */
+	public:
+	static Misc::UInt32 parseAddress(const char* address); // Returns the IPv4 address in host byte order of the given dotted-quad string
+	MulticastSocket(Misc::UInt32 sGroupAddress,int sGroupPortId,const char* interfaceAddress,bool receive,int ttl =1); // Creates a socket sending datagrams to, or if receive is true receiving datagrams from, the given multicast group via the network interface of the given IPv4 address, or the default interface if null
+	private:
+	MulticastSocket(const MulticastSocket& source); // Prohibit copy constructor
+	MulticastSocket& operator=(const MulticastSocket& source); // Prohibit assignment operator
+	public:
+	~MulticastSocket(void);
+	
+	/* Methods: */
+	int getFd(void) const // Returns the socket's file descriptor for event handling
+		{
+		return fd;
+		}
+	Misc::UInt32 getGroupAddress(void) const // Returns the multicast group's IPv4 address in host byte order
+		{
+		return groupAddress;
+		}
+	int getGroupPortId(void) const // Returns the multicast group's UDP port ID
+		{
+		return groupPortId;
+		}
+	bool send(const void* datagram,size_t datagramSize); // Sends a datagram to the multicast group without blocking; returns false if the datagram had to be dropped
+	size_t receive(void* buffer,size_t bufferSize); // Receives a pending datagram from the multicast group without blocking; returns the datagram's size, or zero if there is no pending datagram
+	};
+
+#endif
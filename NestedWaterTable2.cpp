@@ -0,0 +1,555 @@
+/***********************************************************************
+NestedWaterTable2 - Class to run the shallow water flow simulation of
+CpuWaterTable2 on two nested grids: a fine grid simulated only on tiles
+where the bathymetry was recently modified or that contain water, and a
+coarse grid covering the rest of the water table, with conservative flux
+coupling across the interface between the two.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "NestedWaterTable2.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <Math/Math.h>
+
+/**********************************
+Methods of class NestedWaterTable2:
+**********************************/
+
+void NestedWaterTable2::prolongTile(int tileX,int tileY,const std::vector<GLfloat>* coarseQuantity,bool conservative,GLfloat* dest[3],size_t destStride) const
+	{
+	const int tileSize=int(CpuWaterTable2::bandHeight);
+	int r=int(refinement);
+	int width=int(fine->size[0]);
+	int cWidth=int(coarse->size[0]);
+	int cx0=tileX*tileSize/r;
+	int cx1=Math::min((tileX+1)*tileSize,width)/r;
+	int cy0=tileY*tileSize/r;
+	int cy1=Math::min((tileY+1)*tileSize,int(fine->size[1]))/r;
+	for(int cy=cy0;cy<cy1;++cy)
+		for(int cx=cx0;cx<cx1;++cx)
+			{
+			size_t cIndex=size_t(cy)*size_t(cWidth)+cx;
+			GLfloat wc=coarseQuantity[0][cIndex];
+			GLfloat hc=Math::max(wc-coarse->cellBathymetry[cIndex],0.0f);
+			
+			/*****************************************************************
+			Distribute the coarse cell's water over its fine cells at the
+			coarse cell's water level, which keeps lakes at rest. To conserve
+			water volume, scale the resulting water column heights such that
+			their average matches the coarse cell's.
+			*****************************************************************/
+			
+			GLfloat scale=hc>0.0f?1.0f:0.0f;
+			bool uniform=false;
+			if(conservative&&hc>0.0f)
+				{
+				GLfloat volume=0.0f;
+				for(int y=cy*r;y<(cy+1)*r;++y)
+					for(int x=cx*r;x<(cx+1)*r;++x)
+						volume+=Math::max(wc-fine->cellBathymetry[size_t(y)*size_t(width)+x],0.0f);
+				if(volume>0.0f)
+					scale=hc*GLfloat(r*r)/volume;
+				else
+					uniform=true;
+				}
+			
+			for(int y=cy*r;y<(cy+1)*r;++y)
+				for(int x=cx*r;x<(cx+1)*r;++x)
+					{
+					size_t index=size_t(y)*size_t(width)+x;
+					GLfloat b=fine->cellBathymetry[index];
+					GLfloat h=uniform?hc:Math::max(wc-b,0.0f)*scale;
+					dest[0][index*destStride]=b+h;
+					dest[1][index*destStride]=coarseQuantity[1][cIndex];
+					dest[2][index*destStride]=coarseQuantity[2][cIndex];
+					}
+			}
+	}
+
+void NestedWaterTable2::updateRefinement(void)
+	{
+	const int tileSize=int(CpuWaterTable2::bandHeight);
+	int r=int(refinement);
+	int tw=int(fine->numTiles[0]);
+	int th=int(fine->numTiles[1]);
+	int cWidth=int(coarse->size[0]);
+	int cHeight=int(coarse->size[1]);
+	int ctw=int(coarse->numTiles[0]);
+	fine->updateTileWetness();
+	coarse->updateTileWetness();
+	
+	/* Find all tiles that need refinement: */
+	std::vector<unsigned char>& refined=fine->tileActive;
+	std::fill(tileRefined.begin(),tileRefined.end(),0);
+	for(int ty=0;ty<th;++ty)
+		for(int tx=0;tx<tw;++tx)
+			{
+			int tile=ty*tw+tx;
+			bool refine=fine->waterDeposit>0.0f;
+			refine=refine||(!fine->tileSource.empty()&&fine->tileSource[tile]);
+			refine=refine||simulationTime-tileModifiedTimes[tile]<modifiedDuration;
+			if(refined[tile])
+				{
+				/* The fine grid tracked the tile's wetness during the last simulation step: */
+				refine=refine||fine->tileWet[tile];
+				}
+			else if(!refine&&coarse->tileWet[((ty*tileSize/r)/tileSize)*ctw+(tx*tileSize/r)/tileSize])
+				{
+				/* Check the coarse cells covering the tile for water if the coarse tile containing them is wet: */
+				int cx1=Math::min((tx+1)*tileSize/r,cWidth);
+				int cy1=Math::min((ty+1)*tileSize/r,cHeight);
+				for(int cy=ty*tileSize/r;cy<cy1&&!refine;++cy)
+					for(int cx=tx*tileSize/r;cx<cx1&&!refine;++cx)
+						{
+						size_t cIndex=size_t(cy)*size_t(cWidth)+cx;
+						refine=coarse->quantity[0][cIndex]-coarse->cellBathymetry[cIndex]>refineDepth||coarse->snow[cIndex]>0.0f;
+						}
+				}
+			
+			/* Refine the tile and its neighbours, as water can spread into neighbouring tiles during one step: */
+			if(refine)
+				{
+				for(int y=Math::max(ty-1,0);y<=Math::min(ty+1,th-1);++y)
+					for(int x=Math::max(tx-1,0);x<=Math::min(tx+1,tw-1);++x)
+						tileRefined[y*tw+x]=1;
+				}
+			}
+	
+	/* Initialize newly refined tiles from the coarse grid, conserving water volume: */
+	GLfloat* dest[3];
+	for(int i=0;i<3;++i)
+		dest[i]=&fine->quantity[i][0];
+	int width=int(fine->size[0]);
+	for(int ty=0;ty<th;++ty)
+		for(int tx=0;tx<tw;++tx)
+			if(tileRefined[ty*tw+tx]&&!refined[ty*tw+tx])
+				{
+				prolongTile(tx,ty,coarse->quantity,true,dest,1);
+				int x1=Math::min((tx+1)*tileSize,width);
+				int y1=Math::min((ty+1)*tileSize,int(fine->size[1]));
+				for(int y=ty*tileSize;y<y1;++y)
+					for(int x=tx*tileSize;x<x1;++x)
+						fine->snow[size_t(y)*size_t(width)+x]=coarse->snow[size_t(y/r)*size_t(cWidth)+x/r];
+				}
+	
+	/* Activate the refined tiles on the fine grid: */
+	refined=tileRefined;
+	fine->updateTileRuns();
+	
+	/* Keep the coarse grid active around the refined tiles, where it needs to calculate interface fluxes and feed the fine grid's halo: */
+	for(int ty=0;ty<th;++ty)
+		for(int tx=0;tx<tw;++tx)
+			if(refined[ty*tw+tx])
+				coarse->tileWet[((ty*tileSize/r)/tileSize)*ctw+(tx*tileSize/r)/tileSize]=1;
+	coarse->updateActiveTiles();
+	}
+
+void NestedWaterTable2::prolongHaloTiles(const std::vector<GLfloat>* coarseQuantity,std::vector<GLfloat>* fineQuantity)
+	{
+	/*********************************************************************
+	The fine grid's flux passes reconstruct refined cells from up to two
+	cells in unrefined neighbouring tiles. Fill those tiles from the
+	coarse grid at the coarse water level; any mass or momentum they
+	exchange with refined cells is later deducted from the coarse grid by
+	the flux corrections.
+	*********************************************************************/
+	
+	GLfloat* dest[3];
+	for(int i=0;i<3;++i)
+		dest[i]=&fineQuantity[i][0];
+	for(int ty=0;ty<int(fine->numTiles[1]);++ty)
+		for(int tx=0;tx<int(fine->numTiles[0]);++tx)
+			if(fine->isHaloTile(tx,ty))
+				prolongTile(tx,ty,coarseQuantity,false,dest,1);
+	}
+
+void NestedWaterTable2::accumulateFluxCorrections(void)
+	{
+	const int tileSize=int(CpuWaterTable2::bandHeight);
+	int r=int(refinement);
+	int width=int(fine->size[0]);
+	int height=int(fine->size[1]);
+	int cWidth=int(coarse->size[0]);
+	int tw=int(fine->numTiles[0]);
+	int th=int(fine->numTiles[1]);
+	const std::vector<unsigned char>& refined=fine->tileActive;
+	GLfloat invR=1.0f/GLfloat(r);
+	GLfloat invCellSize[2];
+	for(int i=0;i<2;++i)
+		invCellSize[i]=1.0f/coarse->cellSize[i];
+	
+	/* Correct the coarse cells on the unrefined side of each vertical interface face with the average of the fine fluxes across the same face: */
+	for(int ty=0;ty<th;++ty)
+		for(int tx=0;tx+1<tw;++tx)
+			{
+			bool westRefined=refined[ty*tw+tx]!=0;
+			if(westRefined==(refined[ty*tw+tx+1]!=0))
+				continue;
+			int x=(tx+1)*tileSize;
+			int cx=x/r;
+			int cTarget=westRefined?cx:cx-1;
+			GLfloat sign=westRefined?invCellSize[0]:-invCellSize[0];
+			int cy1=Math::min((ty+1)*tileSize,height)/r;
+			for(int cy=ty*tileSize/r;cy<cy1;++cy)
+				for(int i=0;i<3;++i)
+					{
+					GLfloat fineFlux=0.0f;
+					for(int y=cy*r;y<(cy+1)*r;++y)
+						fineFlux+=fine->xFlux[i][size_t(y)*size_t(width+1)+x];
+					GLfloat coarseFlux=coarse->xFlux[i][size_t(cy)*size_t(cWidth+1)+cx];
+					fluxCorrections[i][size_t(cy)*size_t(cWidth)+cTarget]+=(fineFlux*invR-coarseFlux)*sign;
+					}
+			}
+	
+	/* Do the same for the horizontal interface faces: */
+	for(int ty=0;ty+1<th;++ty)
+		for(int tx=0;tx<tw;++tx)
+			{
+			bool southRefined=refined[ty*tw+tx]!=0;
+			if(southRefined==(refined[(ty+1)*tw+tx]!=0))
+				continue;
+			int y=(ty+1)*tileSize;
+			int cy=y/r;
+			int cTarget=southRefined?cy:cy-1;
+			GLfloat sign=southRefined?invCellSize[1]:-invCellSize[1];
+			int cx1=Math::min((tx+1)*tileSize,width)/r;
+			for(int cx=tx*tileSize/r;cx<cx1;++cx)
+				for(int i=0;i<3;++i)
+					{
+					GLfloat fineFlux=0.0f;
+					for(int x=cx*r;x<(cx+1)*r;++x)
+						fineFlux+=fine->yFlux[i][size_t(y)*size_t(width)+x];
+					GLfloat coarseFlux=coarse->yFlux[i][size_t(cy)*size_t(cWidth)+cx];
+					fluxCorrections[i][size_t(cTarget)*size_t(cWidth)+cx]+=(fineFlux*invR-coarseFlux)*sign;
+					}
+			}
+	}
+
+void NestedWaterTable2::restrictTiles(void)
+	{
+	const int tileSize=int(CpuWaterTable2::bandHeight);
+	int r=int(refinement);
+	int width=int(fine->size[0]);
+	int cWidth=int(coarse->size[0]);
+	int tw=int(fine->numTiles[0]);
+	int th=int(fine->numTiles[1]);
+	GLfloat invArea=1.0f/GLfloat(r*r);
+	for(int ty=0;ty<th;++ty)
+		for(int tx=0;tx<tw;++tx)
+			{
+			if(!fine->tileActive[ty*tw+tx])
+				continue;
+			
+			/* Average the water column heights, partial discharges, and snow heights of each coarse cell's fine cells: */
+			int cx1=Math::min((tx+1)*tileSize,width)/r;
+			int cy1=Math::min((ty+1)*tileSize,int(fine->size[1]))/r;
+			for(int cy=ty*tileSize/r;cy<cy1;++cy)
+				for(int cx=tx*tileSize/r;cx<cx1;++cx)
+					{
+					GLfloat sum[4]={0.0f,0.0f,0.0f,0.0f};
+					for(int y=cy*r;y<(cy+1)*r;++y)
+						for(int x=cx*r;x<(cx+1)*r;++x)
+							{
+							size_t index=size_t(y)*size_t(width)+x;
+							sum[0]+=Math::max(fine->quantity[0][index]-fine->cellBathymetry[index],0.0f);
+							sum[1]+=fine->quantity[1][index];
+							sum[2]+=fine->quantity[2][index];
+							sum[3]+=fine->snow[index];
+							}
+					size_t cIndex=size_t(cy)*size_t(cWidth)+cx;
+					coarse->quantity[0][cIndex]=coarse->cellBathymetry[cIndex]+sum[0]*invArea;
+					coarse->quantity[1][cIndex]=sum[1]*invArea;
+					coarse->quantity[2][cIndex]=sum[2]*invArea;
+					coarse->snow[cIndex]=sum[3]*invArea;
+					}
+			}
+	}
+
+NestedWaterTable2::NestedWaterTable2(const Size& sSize,const GLfloat sCellSize[2],unsigned int sRefinement,unsigned int numThreads)
+	:refinement(sRefinement),
+	 fine(0),coarse(0),
+	 refineDepth(0.0f),modifiedThreshold(0.5f),modifiedDuration(5.0),
+	 simulationTime(0.0),haveBathymetry(false)
+	{
+	/* Check that the coarse grid's cells tile the fine grid's tiles: */
+	if(refinement<2||CpuWaterTable2::bandHeight%refinement!=0)
+		throw std::runtime_error("NestedWaterTable2: Refinement factor does not divide the tile size");
+	if(sSize[0]%refinement!=0||sSize[1]%refinement!=0||sSize[0]<refinement*2||sSize[1]<refinement*2)
+		throw std::runtime_error("NestedWaterTable2: Grid size is not a multiple of the refinement factor");
+	
+	/* Create the fine and coarse grids: */
+	fine=new CpuWaterTable2(sSize,sCellSize,numThreads);
+	Size coarseSize(sSize[0]/refinement,sSize[1]/refinement);
+	GLfloat coarseCellSize[2];
+	for(int i=0;i<2;++i)
+		coarseCellSize[i]=sCellSize[i]*GLfloat(refinement);
+	coarse=new CpuWaterTable2(coarseSize,coarseCellSize,numThreads);
+	
+	/* Track tile wetness on both grids; the fine grid's active tiles are the refined tiles, which are initially all tiles: */
+	fine->setSparse(true,refineDepth);
+	coarse->setSparse(true,0.0f);
+	
+	/* Initialize the refinement state and the coarse grid's scratch grids: */
+	tileModifiedTimes.resize(fine->tileWet.size(),-1.0e30);
+	tileRefined.resize(fine->tileWet.size(),0);
+	coarseGrid.resize(size_t(coarseSize[1])*size_t(coarseSize[0])*2);
+	for(int i=0;i<3;++i)
+		fluxCorrections[i].resize(size_t(coarseSize[1])*size_t(coarseSize[0]),0.0f);
+	}
+
+NestedWaterTable2::~NestedWaterTable2(void)
+	{
+	delete fine;
+	delete coarse;
+	}
+
+void NestedWaterTable2::setMode(WaterTable2::Mode newMode)
+	{
+	fine->setMode(newMode);
+	coarse->setMode(newMode);
+	}
+
+void NestedWaterTable2::setAttenuation(GLfloat newAttenuation)
+	{
+	fine->setAttenuation(newAttenuation);
+	coarse->setAttenuation(newAttenuation);
+	}
+
+void NestedWaterTable2::forceMinStepSize(GLfloat newMinStepSize)
+	{
+	fine->forceMinStepSize(newMinStepSize);
+	coarse->forceMinStepSize(newMinStepSize);
+	}
+
+void NestedWaterTable2::setMaxStepSize(GLfloat newMaxStepSize)
+	{
+	fine->setMaxStepSize(newMaxStepSize);
+	coarse->setMaxStepSize(newMaxStepSize);
+	}
+
+void NestedWaterTable2::setSnowLine(GLfloat newSnowLine)
+	{
+	fine->setSnowLine(newSnowLine);
+	coarse->setSnowLine(newSnowLine);
+	}
+
+void NestedWaterTable2::setSnowMelt(GLfloat newSnowMelt)
+	{
+	fine->setSnowMelt(newSnowMelt);
+	coarse->setSnowMelt(newSnowMelt);
+	}
+
+void NestedWaterTable2::setWaterDeposit(GLfloat newWaterDeposit)
+	{
+	fine->setWaterDeposit(newWaterDeposit);
+	coarse->setWaterDeposit(newWaterDeposit);
+	}
+
+void NestedWaterTable2::setDryBoundary(bool newDryBoundary)
+	{
+	fine->setDryBoundary(newDryBoundary);
+	coarse->setDryBoundary(newDryBoundary);
+	}
+
+void NestedWaterTable2::setDryDepth(GLfloat newDryDepth)
+	{
+	coarse->setSparse(true,newDryDepth);
+	}
+
+void NestedWaterTable2::setFluxKernel(const char* kernelName)
+	{
+	fine->setFluxKernel(kernelName);
+	coarse->setFluxKernel(kernelName);
+	}
+
+void NestedWaterTable2::setRefinementCriteria(GLfloat newRefineDepth,GLfloat newModifiedThreshold,double newModifiedDuration)
+	{
+	refineDepth=newRefineDepth;
+	modifiedThreshold=newModifiedThreshold;
+	modifiedDuration=newModifiedDuration;
+	
+	/* The fine grid tracks the wetness of refined tiles at the refinement depth: */
+	fine->setSparse(true,refineDepth);
+	}
+
+void NestedWaterTable2::setPropertyGrid(const GLfloat* propertyGrid)
+	{
+	fine->setPropertyGrid(propertyGrid);
+	
+	/* Average the roughness coefficients and absorption rates of each coarse cell's fine cells: */
+	int r=int(refinement);
+	int width=int(fine->size[0]);
+	int cWidth=int(coarse->size[0]);
+	GLfloat invArea=1.0f/GLfloat(r*r);
+	GLfloat* cgPtr=&coarseGrid[0];
+	for(int cy=0;cy<int(coarse->size[1]);++cy)
+		for(int cx=0;cx<cWidth;++cx,cgPtr+=2)
+			for(int i=0;i<2;++i)
+				{
+				GLfloat sum=0.0f;
+				for(int y=cy*r;y<(cy+1)*r;++y)
+					for(int x=cx*r;x<(cx+1)*r;++x)
+						sum+=propertyGrid[(size_t(y)*size_t(width)+x)*2+i];
+				cgPtr[i]=sum*invArea;
+				}
+	coarse->setPropertyGrid(&coarseGrid[0]);
+	}
+
+void NestedWaterTable2::setWaterSource(const GLfloat* waterSourceGrid)
+	{
+	fine->setWaterSource(waterSourceGrid);
+	if(waterSourceGrid!=0)
+		{
+		/* Average the water source rates of each coarse cell's fine cells: */
+		int r=int(refinement);
+		int width=int(fine->size[0]);
+		int cWidth=int(coarse->size[0]);
+		GLfloat invArea=1.0f/GLfloat(r*r);
+		for(int cy=0;cy<int(coarse->size[1]);++cy)
+			for(int cx=0;cx<cWidth;++cx)
+				{
+				GLfloat sum=0.0f;
+				for(int y=cy*r;y<(cy+1)*r;++y)
+					for(int x=cx*r;x<(cx+1)*r;++x)
+						sum+=waterSourceGrid[size_t(y)*size_t(width)+x];
+				coarseGrid[size_t(cy)*size_t(cWidth)+cx]=sum*invArea;
+				}
+		coarse->setWaterSource(&coarseGrid[0]);
+		}
+	else
+		coarse->setWaterSource(0);
+	}
+
+void NestedWaterTable2::updateBathymetry(const GLfloat* bathymetryGrid)
+	{
+	const int tileSize=int(CpuWaterTable2::bandHeight);
+	int bWidth=int(fine->size[0])-1;
+	int bHeight=int(fine->size[1])-1;
+	int tw=int(fine->numTiles[0]);
+	if(haveBathymetry)
+		{
+		/* Mark all tiles containing grid vertices whose elevations changed by more than the threshold as modified: */
+		for(int y=0;y<bHeight;++y)
+			{
+			const GLfloat* oldRow=&fine->bathymetry[size_t(y)*size_t(bWidth)];
+			const GLfloat* newRow=bathymetryGrid+size_t(y)*size_t(bWidth);
+			double* modifiedRow=&tileModifiedTimes[(y/tileSize)*tw];
+			for(int x=0;x<bWidth;++x)
+				if(Math::abs(newRow[x]-oldRow[x])>modifiedThreshold)
+					modifiedRow[x/tileSize]=simulationTime;
+			}
+		}
+	haveBathymetry=true;
+	fine->updateBathymetry(bathymetryGrid);
+	
+	/* Sample the fine grid vertices coinciding with the coarse grid's vertices: */
+	int r=int(refinement);
+	int cbWidth=int(coarse->size[0])-1;
+	int cbHeight=int(coarse->size[1])-1;
+	for(int cy=0;cy<cbHeight;++cy)
+		for(int cx=0;cx<cbWidth;++cx)
+			coarseGrid[size_t(cy)*size_t(cbWidth)+cx]=bathymetryGrid[size_t((cy+1)*r-1)*size_t(bWidth)+((cx+1)*r-1)];
+	coarse->updateBathymetry(&coarseGrid[0]);
+	}
+
+void NestedWaterTable2::setWaterLevel(const GLfloat* waterGrid)
+	{
+	/* Set the water level on the fine grid, which holds the current state of all tiles until the next simulation step: */
+	fine->setWaterLevel(waterGrid);
+	std::fill(fine->tileActive.begin(),fine->tileActive.end(),1);
+	
+	/* Down-sample the new water level to the coarse grid: */
+	restrictTiles();
+	coarse->tileWetValid=false;
+	}
+
+GLfloat NestedWaterTable2::runSimulationStep(bool forceStepSize)
+	{
+	/* Select the refined tiles and the active coarse tiles: */
+	updateRefinement();
+	
+	/* Calculate the temporal derivatives of the most recent quantities on both grids, and a step size that is stable on both: */
+	prolongHaloTiles(coarse->quantity,fine->quantity);
+	coarse->runFluxPass(coarse->quantity);
+	fine->runFluxPass(fine->quantity);
+	GLfloat stepSize=forceStepSize?fine->maxStepSize:Math::min(fine->calcStepSize(),coarse->calcStepSize());
+	for(int i=0;i<3;++i)
+		std::fill(fluxCorrections[i].begin(),fluxCorrections[i].end(),0.0f);
+	accumulateFluxCorrections();
+	
+	/* Perform the tentative Euler integration step on both grids: */
+	coarse->runIntegrationPass(stepSize,false);
+	fine->runIntegrationPass(stepSize,false);
+	
+	/* Calculate the temporal derivatives of the intermediate quantities and perform the final Runge-Kutta integration step on both grids: */
+	prolongHaloTiles(coarse->quantityStar,fine->quantityStar);
+	coarse->runFluxPass(coarse->quantityStar);
+	fine->runFluxPass(fine->quantityStar);
+	accumulateFluxCorrections();
+	coarse->runIntegrationPass(stepSize,true);
+	fine->runIntegrationPass(stepSize,true);
+	
+	/* Replace the coarse fluxes across the refinement interface with the fine fluxes, averaged over both integration steps like the Runge-Kutta step does: */
+	GLfloat correctionWeight=stepSize*0.5f;
+	for(int i=0;i<3;++i)
+		{
+		std::vector<GLfloat>::iterator qIt=coarse->quantity[i].begin();
+		for(std::vector<GLfloat>::iterator fcIt=fluxCorrections[i].begin();fcIt!=fluxCorrections[i].end();++fcIt,++qIt)
+			*qIt+=*fcIt*correctionWeight;
+		}
+	
+	/* Overwrite the coarse grid on refined tiles with the fine grid's state: */
+	restrictTiles();
+	
+	simulationTime+=double(stepSize);
+	return stepSize;
+	}
+
+void NestedWaterTable2::readQuantityGrid(GLfloat* buffer) const
+	{
+	const int tileSize=int(CpuWaterTable2::bandHeight);
+	int width=int(fine->size[0]);
+	int tw=int(fine->numTiles[0]);
+	int th=int(fine->numTiles[1]);
+	GLfloat* dest[3]={buffer,buffer+1,buffer+2};
+	for(int ty=0;ty<th;++ty)
+		for(int tx=0;tx<tw;++tx)
+			{
+			if(fine->tileActive[ty*tw+tx])
+				{
+				/* Interleave the fine grid's conserved quantities: */
+				int x1=Math::min((tx+1)*tileSize,width);
+				int y1=Math::min((ty+1)*tileSize,int(fine->size[1]));
+				for(int y=ty*tileSize;y<y1;++y)
+					for(int x=tx*tileSize;x<x1;++x)
+						{
+						size_t index=size_t(y)*size_t(width)+x;
+						for(int i=0;i<3;++i)
+							buffer[index*3+i]=fine->quantity[i][index];
+						}
+				}
+			else
+				{
+				/* Interpolate the coarse grid's conserved quantities, conserving water volume: */
+				prolongTile(tx,ty,coarse->quantity,true,dest,3);
+				}
+			}
+	}
@@ -0,0 +1,117 @@
+/***********************************************************************
+NestedWaterTable2 - Class to run the shallow water flow simulation of
+CpuWaterTable2 on two nested grids: a fine grid simulated only on tiles
+where the bathymetry was recently modified or that contain water, and a
+coarse grid covering the rest of the water table, with conservative flux
+coupling across the interface between the two.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef NESTEDWATERTABLE2_INCLUDED
+#define NESTEDWATERTABLE2_INCLUDED
+
+#include <vector>
+#include <GL/gl.h>
+
+#include "Types.h"
+#include "WaterTable2.h"
+#include "CpuWaterTable2.h"
+
+class NestedWaterTable2
+	{
+	/* Elements: */
+	private:
+	unsigned int refinement; // Ratio between the cell sizes of the coarse and fine grids
+	CpuWaterTable2* fine; // Fine grid covering the entire water table; its active tiles are the refined tiles
+	CpuWaterTable2* coarse; // Coarse grid covering the entire water table, overwritten by the fine grid's state on refined tiles
+	GLfloat refineDepth; // Water column height above which a tile is refined
+	GLfloat modifiedThreshold; // Bathymetry elevation change above which a tile counts as modified
+	double modifiedDuration; // Simulation time for which modified tiles stay refined
+	double simulationTime; // Total simulation time since the water table was created
+	bool haveBathymetry; // Flag whether the bathymetry has been set before
+	std::vector<double> tileModifiedTimes; // Simulation time at which each fine tile's bathymetry was last modified
+	std::vector<unsigned char> tileRefined; // Per-tile flags whether a fine tile will be refined in the next simulation step
+	std::vector<GLfloat> coarseGrid; // Scratch grid to down-sample fine grids to the coarse grid
+	std::vector<GLfloat> fluxCorrections[3]; // Per-cell corrections to the coarse grid's conserved quantities accumulated across the refinement interface
+	
+	/* Private methods: */
+	void prolongTile(int tileX,int tileY,const std::vector<GLfloat>* coarseQuantity,bool conservative,GLfloat* dest[3],size_t destStride) const; // Interpolates the given coarse conserved quantities onto the fine cells of the given tile, either preserving water volume or water level
+	void updateRefinement(void); // Calculates the set of refined tiles for the next simulation step, and initializes newly refined tiles from the coarse grid
+	void prolongHaloTiles(const std::vector<GLfloat>* coarseQuantity,std::vector<GLfloat>* fineQuantity); // Interpolates the given coarse conserved quantities onto the fine tiles bordering refined tiles
+	void accumulateFluxCorrections(void); // Accumulates the differences between the coarse grid's fluxes and the fine grid's fluxes across the refinement interface
+	void restrictTiles(void); // Replaces the coarse grid's conserved quantities on refined tiles with averages of the fine grid's
+	
+	/* Constructors and destructors: */
+	public:
+	NestedWaterTable2(const Size& sSize,const GLfloat sCellSize[2],unsigned int sRefinement,unsigned int numThreads); // Creates a water table of the given fine size and cell size whose coarse grid's cells are the given number of fine cells wide, using the given number of threads per grid; the bathymetry is initially flat and dry at elevation zero
+	~NestedWaterTable2(void);
+	
+	/* Methods: */
+	const Size& getSize(void) const // Returns the size of the fine grid
+		{
+		return fine->getSize();
+		}
+	const GLfloat* getCellSize(void) const // Returns the fine grid's cell size
+		{
+		return fine->getCellSize();
+		}
+	unsigned int getRefinement(void) const // Returns the ratio between the cell sizes of the coarse and fine grids
+		{
+		return refinement;
+		}
+	unsigned int getNumThreads(void) const // Returns the number of threads running the simulation of each grid
+		{
+		return fine->getNumThreads();
+		}
+	void setMode(WaterTable2::Mode newMode); // Sets the water simulation mode
+	void setAttenuation(GLfloat newAttenuation); // Sets the attenuation factor for partial discharges
+	void forceMinStepSize(GLfloat newMinStepSize); // Forces the given minimum step size for all subsequent integration steps by limiting cell fluxes; removes the limit if the step size is zero
+	void setMaxStepSize(GLfloat newMaxStepSize); // Sets the maximum step size for all subsequent integration steps
+	void setSnowLine(GLfloat newSnowLine); // Sets the elevation of the snow line relative to the base plane
+	void setSnowMelt(GLfloat newSnowMelt); // Sets the snow melt rate in elevation units per second
+	void setWaterDeposit(GLfloat newWaterDeposit); // Sets the amount of deposited water
+	void setDryBoundary(bool newDryBoundary); // Enables or disables enforcement of dry boundaries
+	void setDryDepth(GLfloat newDryDepth); // Sets the water column height up to which the coarse grid skips cells as dry
+	void setFluxKernel(const char* kernelName); // Selects the flux kernel of the given name for both grids
+	const char* getFluxKernelName(void) const // Returns the name of both grids' flux kernel
+		{
+		return fine->getFluxKernelName();
+		}
+	void setRefinementCriteria(GLfloat newRefineDepth,GLfloat newModifiedThreshold,double newModifiedDuration); // Refines tiles containing water deeper than the given depth, and tiles whose bathymetry changed by more than the given threshold during the given simulation time
+	unsigned int getNumTiles(void) const // Returns the total number of fine tiles
+		{
+		return fine->getNumTiles();
+		}
+	unsigned int getNumRefinedTiles(void) const // Returns the number of fine tiles refined in the most recent simulation step
+		{
+		return fine->getNumActiveTiles();
+		}
+	void setPropertyGrid(const GLfloat* propertyGrid); // Sets the per-cell roughness coefficients and absorption rates used in engineering mode from an interleaved two-component fine grid
+	void setWaterSource(const GLfloat* waterSourceGrid); // Sets per-cell rates at which water is added (positive) or removed (negative) on the fine grid; removes all water sources if null
+	void updateBathymetry(const GLfloat* bathymetryGrid); // Updates the bathymetry with a vertex-centered elevation grid of fine grid size minus 1, keeping water column heights, and marks tiles whose elevation changed as modified
+	void setWaterLevel(const GLfloat* waterGrid); // Sets the current water level to the given fine grid, and resets flux components to zero
+	GLfloat runSimulationStep(bool forceStepSize); // Runs a water flow simulation step on both grids, always uses maxStepSize if flag is true (may lead to instability); returns step size taken by Runge-Kutta integration step
+	const GLfloat* getBathymetryGrid(void) const // Returns the fine vertex-centered bathymetry grid
+		{
+		return fine->getBathymetryGrid();
+		}
+	void readQuantityGrid(GLfloat* buffer) const; // Writes the conserved quantity grid at fine resolution into the given buffer in the interleaved layout of WaterTable2::readQuantityTexture with GL_RGB components
+	};
+
+#endif
@@ -0,0 +1,617 @@
+/***********************************************************************
+PipelineBenchmark - Utility to replay pre-recorded or synthetic depth
+streams through the Augmented Reality Sandbox's CPU-side processing
+pipeline as fast as possible without a display, and report per-stage
+latencies and throughput to catch performance regressions.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <Misc/SelfDestructPointer.h>
+#include <Misc/FunctionCalls.h>
+#include <Threads/MutexCond.h>
+#include <IO/VariableMemoryFile.h>
+#include <IO/FixedMemoryFile.h>
+#include <Realtime/Time.h>
+
+#include "Types.h"
+#include "FrameFilter.h"
+#include "HandExtractor.h"
+#include "Pixel.h"
+#include "IntraFrameCompressor.h"
+#include "InterFrameCompressor.h"
+#include "IntraFrameDecompressor.h"
+#include "InterFrameDecompressor.h"
+#include "EntropyCoder.h"
+#include "IntraFramePredictor.h"
+#include "InterFramePredictor.h"
+#include "DepthFrameRecording.h"
+
+namespace {
+
+/**************
+Helper classes:
+**************/
+
+class StageTimes // Class collecting per-frame processing times of one pipeline stage
+	{
+	/* Elements: */
+	private:
+	const char* name; // Name of the pipeline stage
+	std::vector<double> times; // List of per-frame processing times in seconds
+	
+	/* Constructors and destructors: */
+	public:
+	StageTimes(const char* sName)
+		:name(sName)
+		{
+		}
+	
+	/* Methods: */
+	void add(double time) // Adds a processing time
+		{
+		times.push_back(time);
+		}
+	double getTotal(void) const // Returns the sum of all processing times
+		{
+		double result=0.0;
+		for(std::vector<double>::const_iterator tIt=times.begin();tIt!=times.end();++tIt)
+			result+=*tIt;
+		return result;
+		}
+	void print(size_t numPixels) // Prints latency percentiles and throughput; sorts the list of processing times
+		{
+		std::sort(times.begin(),times.end());
+		size_t n=times.size();
+		double mean=getTotal()/double(n);
+		std::cout<<std::setw(12)<<name;
+		std::cout<<std::setw(10)<<std::fixed<<std::setprecision(3)<<mean*1000.0;
+		static const double percentiles[]={0.5,0.9,0.99};
+		for(int i=0;i<3;++i)
+			std::cout<<std::setw(10)<<times[std::min(size_t(percentiles[i]*double(n)),n-1)]*1000.0;
+		std::cout<<std::setw(10)<<times[n-1]*1000.0;
+		std::cout<<std::setw(10)<<std::setprecision(1)<<1.0/mean;
+		std::cout<<std::setw(10)<<double(numPixels)/(mean*1.0e6)<<std::endl;
+		}
+	};
+
+class CodecStats // Class collecting compressed sizes and encoding and decoding times of one compression method and entropy coder
+	{
+	/* Elements: */
+	private:
+	size_t numFrames; // Number of compressed frames
+	size_t numBytes; // Total size of compressed frames in bytes
+	double encodeTime; // Total encoding time in seconds
+	double decodeTime; // Total decoding time in seconds
+	
+	/* Constructors and destructors: */
+	public:
+	CodecStats(void)
+		:numFrames(0),numBytes(0),encodeTime(0.0),decodeTime(0.0)
+		{
+		}
+	
+	/* Methods: */
+	void add(size_t frameBytes,double frameEncodeTime,double frameDecodeTime) // Adds a compressed frame
+		{
+		++numFrames;
+		numBytes+=frameBytes;
+		encodeTime+=frameEncodeTime;
+		decodeTime+=frameDecodeTime;
+		}
+	void print(const char* coderName,const char* methodName,size_t numPixels) const // Prints bits per pixel and encoding and decoding throughput in MB of raw pixel data per second
+		{
+		if(numFrames==0)
+			return;
+		double rawBytes=double(numFrames)*double(numPixels*sizeof(Pixel));
+		std::cout<<std::setw(12)<<coderName<<std::setw(12)<<methodName;
+		std::cout<<std::setw(10)<<std::fixed<<std::setprecision(3)<<double(numBytes)*8.0/(double(numFrames)*double(numPixels));
+		std::cout<<std::setw(10)<<std::setprecision(1)<<rawBytes/(encodeTime*1.0e6);
+		std::cout<<std::setw(10)<<rawBytes/(decodeTime*1.0e6)<<std::endl;
+		}
+	};
+
+class FilteredFrameReceiver // Class to wait for output frames from a frame filter
+	{
+	/* Elements: */
+	private:
+	Threads::MutexCond frameCond; // Condition variable signalled when a new output frame arrives
+	unsigned int numFrames; // Number of received output frames
+	
+	/* Constructors and destructors: */
+	public:
+	FilteredFrameReceiver(void)
+		:numFrames(0)
+		{
+		}
+	
+	/* Methods: */
+	void receiveFrame(const Kinect::FrameBuffer& frame) // Callback called from the frame filter's background thread
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		++numFrames;
+		frameCond.signal();
+		}
+	void waitForFrame(unsigned int frameIndex) // Waits until the output frame of the given index has arrived
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		while(numFrames<=frameIndex)
+			frameCond.wait(frameLock);
+		}
+	};
+
+/****************
+Helper functions:
+****************/
+
+void quantizeFrame(const Size& size,const float* source,Pixel* dest) // Quantizes a filtered depth frame in the same way as RemoteServer quantizes grids
+	{
+	static const float scale=65535.0f/2048.0f;
+	Pixel* dEnd=dest+size_t(size[1])*size_t(size[0]);
+	const float* sPtr=source;
+	for(Pixel* dPtr=dest;dPtr!=dEnd;++dPtr,++sPtr)
+		{
+		/* Scale, clamp, and quantize the depth value: */
+		float sd=*sPtr*scale+0.5f;
+		if(sd<0.0f)
+			*dPtr=Pixel(0);
+		else if(sd>=65535.0f)
+			*dPtr=Pixel(65535U);
+		else
+			*dPtr=Pixel(sd);
+		}
+	}
+
+size_t compressTiles(IO::VariableMemoryFile& compressedFile,const Size& size,unsigned int numTileRows,unsigned int numTileColumns,const Pixel* previous,const Pixel* current,std::vector<Pixel>& tileBuffer) // Compresses the given frame, relative to the previous frame if not null, as independent tiles in the same way as RemoteServer, and returns the compressed size
+	{
+	unsigned int numTiles=numTileRows*numTileColumns;
+	for(unsigned int tile=0;tile<numTiles;++tile)
+		{
+		/* Calculate the tile's column and row ranges: */
+		unsigned int column=tile%numTileColumns;
+		unsigned int row=tile/numTileColumns;
+		unsigned int x0=(unsigned int)((size_t(size[0])*size_t(column))/size_t(numTileColumns));
+		unsigned int y0=(unsigned int)((size_t(size[1])*size_t(row))/size_t(numTileRows));
+		unsigned int tileWidth=(unsigned int)((size_t(size[0])*size_t(column+1))/size_t(numTileColumns))-x0;
+		unsigned int tileHeight=(unsigned int)((size_t(size[1])*size_t(row+1))/size_t(numTileRows))-y0;
+		
+		/* Copy the tile out of the current and previous frames unless it covers the entire frame: */
+		const Pixel* tileCurrent=current;
+		const Pixel* tilePrevious=previous;
+		if(numTiles>1U)
+			{
+			size_t tileSize=size_t(tileWidth)*size_t(tileHeight);
+			tileBuffer.resize(tileSize*2);
+			for(unsigned int y=0;y<tileHeight;++y)
+				{
+				size_t frameOffset=size_t(y0+y)*size_t(size[0])+size_t(x0);
+				memcpy(&tileBuffer[size_t(y)*size_t(tileWidth)],current+frameOffset,tileWidth*sizeof(Pixel));
+				if(previous!=0)
+					memcpy(&tileBuffer[tileSize+size_t(y)*size_t(tileWidth)],previous+frameOffset,tileWidth*sizeof(Pixel));
+				}
+			tileCurrent=&tileBuffer[0];
+			tilePrevious=&tileBuffer[tileSize];
+			}
+		
+		/* Compress the tile: */
+		if(previous!=0)
+			{
+			InterFrameCompressor compressor(compressedFile);
+			compressor.compressFrame(tileWidth,tileHeight,tilePrevious,tileCurrent);
+			}
+		else
+			{
+			IntraFrameCompressor compressor(compressedFile);
+			compressor.compressFrame(tileWidth,tileHeight,tileCurrent);
+			}
+		}
+	compressedFile.flush();
+	
+	return compressedFile.getDataSize();
+	}
+
+IO::FilePtr copyCompressedFrame(IO::VariableMemoryFile& compressedFile) // Returns a readable copy of a compressed frame
+	{
+	IO::FixedMemoryFile* result=new IO::FixedMemoryFile(compressedFile.getDataSize());
+	IO::FilePtr resultPtr(result);
+	compressedFile.writeToSink(*result);
+	result->flush();
+	result->setReadPosAbs(0);
+	return resultPtr;
+	}
+
+bool compareFrames(size_t numPixels,const Pixel* frame0,const Pixel* frame1) // Returns true if the two frames are identical
+	{
+	return memcmp(frame0,frame1,numPixels*sizeof(Pixel))==0;
+	}
+
+void printUsage(void)
+	{
+	std::cout<<"Usage: PipelineBenchmark [option 1] ... [option n] [<frame file prefix>]"<<std::endl;
+	std::cout<<"  Options:"<<std::endl;
+	std::cout<<"  -h"<<std::endl;
+	std::cout<<"     Prints this help message"<<std::endl;
+	std::cout<<"  -n <maximum number of frames>"<<std::endl;
+	std::cout<<"     Maximum number of depth frames to load from the recording, or number of"<<std::endl;
+	std::cout<<"     synthetic depth frames"<<std::endl;
+	std::cout<<"     Default: 300"<<std::endl;
+	std::cout<<"  -synthetic <width> <height>"<<std::endl;
+	std::cout<<"     Replays a synthetic noisy depth stream of the given frame size instead of"<<std::endl;
+	std::cout<<"     a recording; the synthetic stream is the same on every run"<<std::endl;
+	std::cout<<"  -r <number of repetitions>"<<std::endl;
+	std::cout<<"     Number of times to replay the loaded depth frames"<<std::endl;
+	std::cout<<"     Default: 3"<<std::endl;
+	std::cout<<"  -nas <number of averaging slots>"<<std::endl;
+	std::cout<<"     Length of the frame filter's temporal averaging window"<<std::endl;
+	std::cout<<"     Default: 30"<<std::endl;
+	std::cout<<"  -nft <number of filter threads>"<<std::endl;
+	std::cout<<"     Number of threads cooperating on each depth frame in the frame filter"<<std::endl;
+	std::cout<<"     Default: 1"<<std::endl;
+	std::cout<<"  -tf <temporal filter name>"<<std::endl;
+	std::cout<<"     Temporal filter to use in the frame filter (boxcar, ema, or kalman)"<<std::endl;
+	std::cout<<"     Default: boxcar"<<std::endl;
+	std::cout<<"  -k <temporal kernel name>"<<std::endl;
+	std::cout<<"     Temporal filter kernel to use in the frame filter, or auto to select the fastest supported one"<<std::endl;
+	std::cout<<"     Default: auto"<<std::endl;
+	std::cout<<"  -sp <min num samples> <max variance>"<<std::endl;
+	std::cout<<"     Statistical properties to consider a pixel stable"<<std::endl;
+	std::cout<<"     Default: 10 2"<<std::endl;
+	std::cout<<"  -he <hysteresis envelope>"<<std::endl;
+	std::cout<<"     Size of the stable value hysteresis envelope"<<std::endl;
+	std::cout<<"     Default: 0.1"<<std::endl;
+	std::cout<<"  -tiles <number of tile rows> <number of tile columns>"<<std::endl;
+	std::cout<<"     Compresses each quantized frame as independent tiles, as RemoteServer does"<<std::endl;
+	std::cout<<"     with the numRemoteServerStripes and numRemoteServerTileColumns settings"<<std::endl;
+	std::cout<<"     Default: 1 1"<<std::endl;
+	std::cout<<"  -cc"<<std::endl;
+	std::cout<<"     Compares all entropy coders and intra- and inter-frame predictors on the quantized frames, outside of the timed pipeline"<<std::endl;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Process command line parameters: */
+	const char* frameFilePrefix=0;
+	Size syntheticSize(0,0);
+	unsigned int maxNumFrames=300;
+	unsigned int numRepetitions=3;
+	unsigned int numAveragingSlots=30;
+	unsigned int numFilterThreads=1;
+	const char* temporalFilterName="boxcar";
+	const char* temporalKernelName="auto";
+	unsigned int minNumSamples=10;
+	unsigned int maxVariance=2;
+	float hysteresis=0.1f;
+	unsigned int numTileRows=1;
+	unsigned int numTileColumns=1;
+	bool compareCoders=false;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"h")==0)
+				{
+				printUsage();
+				return 0;
+				}
+			else if(strcasecmp(argv[i]+1,"n")==0)
+				{
+				++i;
+				maxNumFrames=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"synthetic")==0)
+				{
+				for(int j=0;j<2;++j)
+					{
+					++i;
+					syntheticSize[j]=atoi(argv[i]);
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"r")==0)
+				{
+				++i;
+				numRepetitions=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"nas")==0)
+				{
+				++i;
+				numAveragingSlots=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"nft")==0)
+				{
+				++i;
+				numFilterThreads=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"tf")==0)
+				{
+				++i;
+				temporalFilterName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"k")==0)
+				{
+				++i;
+				temporalKernelName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"sp")==0)
+				{
+				++i;
+				minNumSamples=atoi(argv[i]);
+				++i;
+				maxVariance=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"he")==0)
+				{
+				++i;
+				hysteresis=float(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"tiles")==0)
+				{
+				++i;
+				numTileRows=atoi(argv[i]);
+				++i;
+				numTileColumns=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"cc")==0)
+				compareCoders=true;
+			else
+				std::cerr<<"Ignoring unrecognized command line switch "<<argv[i]<<std::endl;
+			}
+		else if(frameFilePrefix==0)
+			frameFilePrefix=argv[i];
+		else
+			std::cerr<<"Ignoring extra command line argument "<<argv[i]<<std::endl;
+		}
+	if(frameFilePrefix==0&&(syntheticSize[0]<3U||syntheticSize[1]<3U))
+		{
+		printUsage();
+		return 1;
+		}
+	
+	try
+		{
+		/* Load the recorded depth frames, or synthesize a depth stream: */
+		Misc::SelfDestructPointer<DepthFrameRecording> recordingPtr;
+		if(frameFilePrefix!=0)
+			{
+			std::cout<<"Loading up to "<<maxNumFrames<<" depth frames from "<<frameFilePrefix<<"..."<<std::flush;
+			recordingPtr.setTarget(new DepthFrameRecording(frameFilePrefix,maxNumFrames));
+			}
+		else
+			{
+			std::cout<<"Synthesizing "<<maxNumFrames<<" depth frames..."<<std::flush;
+			recordingPtr.setTarget(new DepthFrameRecording(syntheticSize,maxNumFrames));
+			}
+		DepthFrameRecording& recording=*recordingPtr;
+		const Size& size=recording.getFrameSize();
+		size_t numPixels=size_t(size[1])*size_t(size[0]);
+		std::cout<<" done, "<<recording.getNumFrames()<<" frames of "<<size[0]<<"x"<<size[1]<<" pixels"<<std::endl;
+		
+		/* Limit the tile layout to the frame size: */
+		numTileRows=std::max(std::min(numTileRows,size[1]),1U);
+		numTileColumns=std::max(std::min(numTileColumns,size[0]),1U);
+		
+		/* Place a base plane orthogonal to the camera's viewing direction through the center pixel of the first frame: */
+		const PTransform& depthProjection=recording.getIntrinsics().depthProjection;
+		const DepthFrameRecording::RawDepth* firstFrame=recording.getFrame(0).getData<DepthFrameRecording::RawDepth>();
+		unsigned int cx=size[0]/2;
+		unsigned int cy=size[1]/2;
+		const DepthFrameRecording::PixelDepthCorrection& cpdc=recording.getPixelDepthCorrection()[cy*size[0]+cx];
+		Point center=depthProjection.transform(Point(Scalar(cx)+Scalar(0.5),Scalar(cy)+Scalar(0.5),Scalar(float(firstFrame[cy*size[0]+cx])*cpdc.scale+cpdc.offset)));
+		Plane basePlane(Vector(0,0,1),center);
+		
+		/* Create the pipeline's processing stages: */
+		FrameFilter frameFilter(size,numAveragingSlots,recording.getPixelDepthCorrection(),depthProjection,basePlane,numFilterThreads,temporalFilterName);
+		frameFilter.setTemporalKernel(temporalKernelName);
+		frameFilter.setStableParameters(minNumSamples,maxVariance);
+		frameFilter.setHysteresis(hysteresis);
+		FilteredFrameReceiver receiver;
+		frameFilter.setOutputFrameFunction(Misc::createFunctionCall(&receiver,&FilteredFrameReceiver::receiveFrame));
+		HandExtractor handExtractor(size,recording.getPixelDepthCorrection(),depthProjection);
+		HandExtractor::HandList hands;
+		Pixel* quantizedFrames[2];
+		for(int i=0;i<2;++i)
+			quantizedFrames[i]=new Pixel[numPixels];
+		IO::VariableMemoryFile* compressedFile=new IO::VariableMemoryFile;
+		IO::FilePtr compressedFilePtr(compressedFile); // Keeps the memory file alive across the compressors' temporary references
+		std::vector<Pixel> tileBuffer;
+		Pixel* decompressedFrame=new Pixel[numPixels];
+		
+		std::cout<<"Frame filter: "<<frameFilter.getTemporalFilterName()<<" temporal filter, "<<frameFilter.getTemporalKernelName()<<" kernel, "<<numFilterThreads<<" thread(s)"<<std::endl;
+		std::cout<<"Compressors: "<<numTileRows<<"x"<<numTileColumns<<" tile(s) per frame"<<std::endl;
+		
+		/* Replay the recording through all stages, one frame at a time: */
+		StageTimes filterTimes("filter");
+		StageTimes handTimes("hands");
+		StageTimes quantizeTimes("quantize");
+		StageTimes intraTimes("intra");
+		StageTimes interTimes("inter");
+		StageTimes pipelineTimes("pipeline");
+		size_t intraBytes=0,interBytes=0;
+		CodecStats intraCodecStats[EntropyCoder::NUM_TYPES][IntraFramePredictor::NUM_TYPES],interCodecStats[EntropyCoder::NUM_TYPES][InterFramePredictor::NUM_TYPES];
+		unsigned int numReplayedFrames=0;
+		Realtime::TimePointMonotonic wallClock;
+		for(unsigned int repetition=0;repetition<numRepetitions;++repetition)
+			for(unsigned int frameIndex=0;frameIndex<recording.getNumFrames();++frameIndex,++numReplayedFrames)
+				{
+				const Kinect::FrameBuffer& rawFrame=recording.getFrame(frameIndex);
+				Realtime::TimePointMonotonic frameStart;
+				
+				/* Filter the raw frame on the frame filter's threads and wait for the result: */
+				Realtime::TimePointMonotonic stageTimer;
+				frameFilter.receiveRawFrame(rawFrame);
+				receiver.waitForFrame(numReplayedFrames);
+				filterTimes.add(stageTimer.setAndDiff());
+				frameFilter.lockNewFrame();
+				const float* filteredFrame=frameFilter.getLockedFrame().getData<float>();
+				
+				/* Extract hands from the raw frame: */
+				handExtractor.extractHands(rawFrame.getData<HandExtractor::DepthPixel>(),hands,0);
+				handTimes.add(stageTimer.setAndDiff());
+				
+				/* Quantize the filtered frame: */
+				Pixel* quantized=quantizedFrames[numReplayedFrames%2];
+				quantizeFrame(size,filteredFrame,quantized);
+				quantizeTimes.add(stageTimer.setAndDiff());
+				
+				/* Compress the quantized frame on its own: */
+				intraBytes+=compressTiles(*compressedFile,size,numTileRows,numTileColumns,0,quantized,tileBuffer);
+				intraTimes.add(stageTimer.setAndDiff());
+				compressedFile->clear();
+				
+				/* Compress the quantized frame relative to the previous one: */
+				stageTimer.set();
+				if(numReplayedFrames>0)
+					{
+					interBytes+=compressTiles(*compressedFile,size,numTileRows,numTileColumns,quantizedFrames[(numReplayedFrames+1)%2],quantized,tileBuffer);
+					interTimes.add(stageTimer.setAndDiff());
+					compressedFile->clear();
+					}
+				
+				pipelineTimes.add(frameStart.setAndDiff());
+				
+				if(compareCoders)
+					{
+					/* Compress and decompress the quantized frame with all entropy coders, and check that decompression is lossless: */
+					for(int coderIndex=0;coderIndex<EntropyCoder::NUM_TYPES;++coderIndex)
+						{
+						EntropyCoder::Type coder=EntropyCoder::Type(coderIndex);
+						
+						/* Compress the quantized frame on its own with all pixel predictors: */
+						double encodeTime;
+						size_t frameBytes;
+						IO::FilePtr decompressedFile;
+						for(int predictorIndex=0;predictorIndex<IntraFramePredictor::NUM_TYPES;++predictorIndex)
+							{
+							IntraFramePredictor::Type predictor=IntraFramePredictor::Type(predictorIndex);
+							stageTimer.set();
+							{
+							IntraFrameCompressor compressor(*compressedFile,coder);
+							compressor.setPredictor(predictor);
+							compressor.compressFrame(size[0],size[1],quantized);
+							}
+							compressedFile->flush();
+							encodeTime=stageTimer.setAndDiff();
+							frameBytes=compressedFile->getDataSize();
+							decompressedFile=copyCompressedFrame(*compressedFile);
+							compressedFile->clear();
+							
+							/* Decompress the quantized frame: */
+							stageTimer.set();
+							{
+							IntraFrameDecompressor decompressor(*decompressedFile,coder);
+							decompressor.decompressFrame(size[0],size[1],decompressedFrame);
+							}
+							intraCodecStats[coder][predictor].add(frameBytes,encodeTime,stageTimer.setAndDiff());
+							if(!compareFrames(numPixels,quantized,decompressedFrame))
+								throw std::runtime_error(std::string("Intra-frame round trip failed with entropy coder ")+EntropyCoder::getName(coder)+" and pixel predictor "+IntraFramePredictor::getName(predictor));
+							}
+						
+						if(numReplayedFrames>0)
+							{
+							/* Compress the quantized frame relative to the previous one with all frame difference predictors: */
+							const Pixel* previous=quantizedFrames[(numReplayedFrames+1)%2];
+							for(int predictorIndex=0;predictorIndex<InterFramePredictor::NUM_TYPES;++predictorIndex)
+								{
+								InterFramePredictor::Type predictor=InterFramePredictor::Type(predictorIndex);
+								stageTimer.set();
+								{
+								InterFrameCompressor compressor(*compressedFile,coder);
+								compressor.setPredictor(predictor);
+								compressor.compressFrame(size[0],size[1],previous,quantized);
+								}
+								compressedFile->flush();
+								encodeTime=stageTimer.setAndDiff();
+								frameBytes=compressedFile->getDataSize();
+								decompressedFile=copyCompressedFrame(*compressedFile);
+								compressedFile->clear();
+								
+								/* Decompress the quantized frame relative to the previous one: */
+								stageTimer.set();
+								{
+								InterFrameDecompressor decompressor(*decompressedFile,coder);
+								decompressor.decompressFrame(size[0],size[1],previous,decompressedFrame);
+								}
+								interCodecStats[coder][predictor].add(frameBytes,encodeTime,stageTimer.setAndDiff());
+								if(!compareFrames(numPixels,quantized,decompressedFrame))
+									throw std::runtime_error(std::string("Inter-frame round trip failed with entropy coder ")+EntropyCoder::getName(coder)+" and frame difference predictor "+InterFramePredictor::getName(predictor));
+								}
+							}
+						}
+					}
+				}
+		double wallTime=wallClock.setAndDiff();
+		
+		/* Print the results: */
+		std::cout<<std::endl<<std::setw(12)<<"Stage"<<std::setw(10)<<"mean ms"<<std::setw(10)<<"p50 ms"<<std::setw(10)<<"p90 ms"<<std::setw(10)<<"p99 ms"<<std::setw(10)<<"max ms"<<std::setw(10)<<"frames/s"<<std::setw(10)<<"Mpixel/s"<<std::endl;
+		filterTimes.print(numPixels);
+		handTimes.print(numPixels);
+		quantizeTimes.print(numPixels);
+		intraTimes.print(numPixels);
+		if(numReplayedFrames>1)
+			interTimes.print(numPixels);
+		pipelineTimes.print(numPixels);
+		
+		std::cout<<std::endl<<"Replayed "<<numReplayedFrames<<" frames in "<<std::fixed<<std::setprecision(3)<<wallTime<<" s, "<<std::setprecision(1)<<double(numReplayedFrames)/wallTime<<" frames/s"<<std::endl;
+		double rawFrameBytes=double(numPixels*sizeof(Pixel));
+		std::cout<<"Intra-frame compression: "<<std::setprecision(1)<<double(intraBytes)/double(numReplayedFrames)/1024.0<<" KB/frame, ratio "<<std::setprecision(2)<<rawFrameBytes*double(numReplayedFrames)/double(intraBytes)<<std::endl;
+		if(numReplayedFrames>1)
+			std::cout<<"Inter-frame compression: "<<std::setprecision(1)<<double(interBytes)/double(numReplayedFrames-1)/1024.0<<" KB/frame, ratio "<<std::setprecision(2)<<rawFrameBytes*double(numReplayedFrames-1)/double(interBytes)<<std::endl;
+		if(frameFilter.getNumDroppedFrames()!=0)
+			std::cout<<"Frame filter dropped "<<frameFilter.getNumDroppedFrames()<<" of "<<frameFilter.getNumReceivedFrames()<<" frames"<<std::endl;
+		
+		if(compareCoders)
+			{
+			/* Print the entropy coder comparison: */
+			std::cout<<std::endl<<std::setw(12)<<"Coder"<<std::setw(12)<<"Method"<<std::setw(10)<<"bits/pix"<<std::setw(10)<<"enc MB/s"<<std::setw(10)<<"dec MB/s"<<std::endl;
+			for(int coderIndex=0;coderIndex<EntropyCoder::NUM_TYPES;++coderIndex)
+				{
+				const char* coderName=EntropyCoder::getName(EntropyCoder::Type(coderIndex));
+				for(int predictorIndex=0;predictorIndex<IntraFramePredictor::NUM_TYPES;++predictorIndex)
+					{
+					std::string methodName=std::string("intra-")+IntraFramePredictor::getName(IntraFramePredictor::Type(predictorIndex));
+					intraCodecStats[coderIndex][predictorIndex].print(coderName,methodName.c_str(),numPixels);
+					}
+				for(int predictorIndex=0;predictorIndex<InterFramePredictor::NUM_TYPES;++predictorIndex)
+					{
+					std::string methodName=std::string("inter-")+InterFramePredictor::getName(InterFramePredictor::Type(predictorIndex));
+					interCodecStats[coderIndex][predictorIndex].print(coderName,methodName.c_str(),numPixels);
+					}
+				}
+			}
+		
+		for(int i=0;i<2;++i)
+			delete[] quantizedFrames[i];
+		delete[] decompressedFrame;
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Caught exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	
+	return 0;
+	}
@@ -50,7 +50,7 @@ Methods of class PropertyGridCreator::DataItem:
 **********************************************/
 
 PropertyGridCreator::DataItem::DataItem(void)
-	:createdGridTextureObject(0),
+	:createdGridTextureObject(0),gridVersion(0),
 	 colorImageTextureObject(0),colorImageVersion(0),
 	 createdGridFramebufferObject(0),
 	 loadGridRequest(0),saveGridRequest(0)
@@ -211,6 +211,24 @@ GLint PropertyGridCreator::bindPropertyGridTexture(GLContextData& contextData,Te
 	return textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->createdGridTextureObject);
 	}
 
+bool PropertyGridCreator::readPropertyGrid(unsigned int& gridVersion,GLContextData& contextData,TextureTracker& textureTracker,GLfloat* buffer) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Bail out if the caller already has the current property grid: */
+	if(gridVersion==dataItem->gridVersion)
+		return false;
+	
+	/* Read the property grid texture into the given buffer: */
+	textureTracker.reset();
+	textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->createdGridTextureObject);
+	glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,GL_RG,GL_FLOAT,buffer);
+	gridVersion=dataItem->gridVersion;
+	
+	return true;
+	}
+
 void PropertyGridCreator::receiveRawFrame(const Kinect::FrameBuffer& frameBuffer)
 	{
 	/* Store the new color image: */
@@ -353,6 +371,9 @@ void PropertyGridCreator::updatePropertyGrid(GLContextData& contextData,TextureT
 		/* Restore OpenGL state: */
 		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFramebuffer);
 		glPopAttrib();
+		
+		/* Mark the property grid as changed: */
+		++dataItem->gridVersion;
 		}
 	
 	/* Check if there is a request to load a grid: */
@@ -368,6 +389,7 @@ void PropertyGridCreator::updatePropertyGrid(GLContextData& contextData,TextureT
 				textureTracker.reset();
 				textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->createdGridTextureObject);
 				glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,0,0,gridSize[0],gridSize[1],GL_RG,GL_FLOAT,gridImage.getPixels());
+				++dataItem->gridVersion;
 				}
 			}
 		catch(const std::runtime_error& err)
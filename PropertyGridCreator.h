@@ -48,6 +48,7 @@ class PropertyGridCreator:public GLObject
 		/* Elements: */
 		public:
 		GLuint createdGridTextureObject; // Texture object holding the most recently created property grid
+		unsigned int gridVersion; // Version number of the property grid currently in the property grid texture
 		unsigned int globalParametersVersions[2]; // Version number of global parameters represented in current property grid texture
 		GLuint colorImageTextureObject; // Texture object holding the current color image
 		unsigned int colorImageVersion; // Version of color image currently in the color image texture
@@ -100,6 +101,7 @@ class PropertyGridCreator:public GLObject
 	void setRoughness(GLfloat newRoughness); // Globally resets the grid property to the given roughness
 	void setAbsorption(GLfloat newAbsorption); // Globally resets the grid property to the given absorption rate
 	GLint bindPropertyGridTexture(GLContextData& contextData,TextureTracker& textureTracker) const; // Binds the property grid texture object to the next available texture unit in the given texture tracker; returns the used texture unit's index
+	bool readPropertyGrid(unsigned int& gridVersion,GLContextData& contextData,TextureTracker& textureTracker,GLfloat* buffer) const; // Reads the property grid into the given buffer as an interleaved two-component grid if it changed since the given version, and updates the version; returns true if the buffer was written
 	void receiveRawFrame(const Kinect::FrameBuffer& frameBuffer); // Receives a new color frame from the camera
 	bool requestRoughnessGrid(GLfloat newRequestRoughness); // Requests creation of a roughness property grid; returns true if request was granted
 	bool requestAbsorptionGrid(GLfloat newRequestAbsorption); // Requests creation of an absorption rate property grid; returns true if request was granted
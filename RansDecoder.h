@@ -0,0 +1,168 @@
+/***********************************************************************
+RansDecoder - Class to decode values encoded by a two-way interleaved
+range asymmetric numeral system (rANS) entropy encoder.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef RANSDECODER_INCLUDED
+#define RANSDECODER_INCLUDED
+
+#include <vector>
+#include <stdexcept>
+#include <Misc/SizedTypes.h>
+#include <IO/File.h>
+
+#include "Bits.h"
+#include "BitSource.h"
+#include "RansModel.h"
+
+class RansDecoder
+	{
+	/* Embedded classes: */
+	private:
+	typedef RansModel::State State; // Type for coder states
+	
+	/* Elements: */
+	static const unsigned int maxRawBits=16; // Maximum number of raw bits read by a single operation
+	IO::FilePtr file; // File from which to read the code stream
+	RansModel model; // The model of the current code stream
+	std::vector<Misc::UInt16> slotSymbols; // Table mapping each quantized probability slot to the symbol owning it
+	std::vector<Misc::UInt8> bytes; // The current rANS byte stream
+	const Misc::UInt8* bytesPtr; // Pointer to the next unread byte
+	const Misc::UInt8* bytesEnd; // Pointer to the end of the byte stream
+	bool started; // Flag whether the current code stream has been read from the file
+	State states[2]; // The two interleaved coder states
+	unsigned int nextState; // Index of the coder state used by the next operation
+	
+	/* Private methods: */
+	void start(void) // Reads the next model and byte stream from the file
+		{
+		/* Read the model and create the slot lookup table: */
+		{
+		BitSource bitSource(*file);
+		model.read(bitSource);
+		}
+		for(unsigned int symbol=0;symbol<model.getNumSymbols();++symbol)
+			{
+			std::vector<Misc::UInt16>::iterator slotIt=slotSymbols.begin()+model.getStart(symbol);
+			std::fill(slotIt,slotIt+model.getFrequency(symbol),Misc::UInt16(symbol));
+			}
+		
+		/* Read the byte stream: */
+		size_t numBytes=file->read<Misc::UInt32>();
+		if(numBytes<8)
+			throw std::runtime_error("RansDecoder: Truncated code stream");
+		bytes.resize(numBytes);
+		file->read(&bytes[0],numBytes);
+		bytesPtr=&bytes[0];
+		bytesEnd=bytesPtr+numBytes;
+		
+		/* Read the initial coder states: */
+		for(int s=0;s<2;++s)
+			{
+			states[s]=0;
+			for(int shift=0;shift<32;shift+=8,++bytesPtr)
+				states[s]|=State(*bytesPtr)<<shift;
+			}
+		nextState=0;
+		
+		started=true;
+		}
+	void renormalize(State& state) // Reads bytes into the given coder state until it is inside the normalized interval again
+		{
+		while(state<RansModel::lowerBound)
+			{
+			if(bytesPtr==bytesEnd)
+				throw std::runtime_error("RansDecoder: Truncated code stream");
+			state=(state<<8)|State(*bytesPtr);
+			++bytesPtr;
+			}
+		}
+	Bits readRawBits(unsigned int numBits) // Reads at most maxRawBits raw bits
+		{
+		/* Extract the bits from the next coder state: */
+		State& state=states[nextState];
+		nextState^=0x1U;
+		Bits result=Bits(state&((State(1U)<<numBits)-1U));
+		state>>=numBits;
+		renormalize(state);
+		
+		return result;
+		}
+	
+	/* Constructors and destructors: */
+	public:
+	RansDecoder(IO::File& sFile,unsigned int numSymbols) // Creates an rANS decoder for values smaller than the given number of symbols reading from the given source file
+		:file(&sFile),
+		 model(numSymbols),
+		 slotSymbols(RansModel::probScale,Misc::UInt16(0)),
+		 bytesPtr(0),bytesEnd(0),
+		 started(false),
+		 nextState(0)
+		{
+		states[0]=states[1]=RansModel::lowerBound;
+		}
+	
+	/* Methods: */
+	Bits readBits(unsigned int numBits) // Reads the given number of bits written with uniform probability
+		{
+		if(!started)
+			start();
+		
+		/* Read the bits in the same chunks in which they were written: */
+		if(numBits>maxRawBits)
+			{
+			Bits high=readRawBits(numBits-maxRawBits);
+			return (high<<maxRawBits)|readRawBits(maxRawBits);
+			}
+		else if(numBits>0U)
+			return readRawBits(numBits);
+		else
+			return 0x0U;
+		}
+	unsigned int decode(void) // Returns the next decoded value
+		{
+		if(!started)
+			start();
+		
+		/* Look up the symbol owning the next coder state's slot: */
+		State& state=states[nextState];
+		nextState^=0x1U;
+		State slot=state&(RansModel::probScale-1U);
+		unsigned int symbol=slotSymbols[slot];
+		
+		/* Advance the coder state past the symbol: */
+		state=model.getFrequency(symbol)*(state>>RansModel::probBits)+slot-model.getStart(symbol);
+		renormalize(state);
+		
+		return symbol;
+		}
+	void flush(void) // Finishes the current code stream; throws an exception if it was not consumed completely
+		{
+		if(started)
+			{
+			/* Check that the decoder arrived at the encoder's initial state: */
+			if(states[0]!=RansModel::lowerBound||states[1]!=RansModel::lowerBound||bytesPtr!=bytesEnd)
+				throw std::runtime_error("RansDecoder: Corrupted code stream");
+			started=false;
+			}
+		}
+	};
+
+#endif
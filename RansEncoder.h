@@ -0,0 +1,158 @@
+/***********************************************************************
+RansEncoder - Class to encode values using a two-way interleaved range
+asymmetric numeral system (rANS) entropy coder with a static model
+derived from the values encoded between flushes.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef RANSENCODER_INCLUDED
+#define RANSENCODER_INCLUDED
+
+#include <vector>
+#include <algorithm>
+#include <Misc/SizedTypes.h>
+#include <IO/File.h>
+
+#include "Bits.h"
+#include "BitSink.h"
+#include "RansModel.h"
+
+class RansEncoder
+	{
+	/* Embedded classes: */
+	private:
+	typedef RansModel::State State; // Type for coder states
+	typedef Misc::UInt32 Operation; // Type for buffered encoding operations
+	
+	/* Elements: */
+	static const Operation rawBitsFlag=0x80000000U; // Flag marking an operation writing raw bits; other operations encode the value stored in them
+	static const unsigned int maxRawBits=16; // Maximum number of raw bits written by a single operation
+	IO::FilePtr file; // File to which to write the code stream
+	RansModel model; // The model used to encode the buffered values
+	std::vector<Operation> operations; // Encoding operations buffered since the last flush, in stream order
+	std::vector<size_t> histogram; // Histogram of values encoded since the last flush
+	std::vector<Misc::UInt8> bytes; // Buffer for the rANS byte stream, which is produced back-to-front
+	
+	/* Private methods: */
+	void writeRawBits(Bits bits,unsigned int numBits) // Buffers an operation writing at most maxRawBits raw bits
+		{
+		operations.push_back(rawBitsFlag|(Operation(numBits)<<maxRawBits)|Operation(bits));
+		}
+	
+	/* Constructors and destructors: */
+	public:
+	RansEncoder(IO::File& sFile,unsigned int numSymbols) // Creates an rANS encoder for values smaller than the given number of symbols writing to the given destination file
+		:file(&sFile),
+		 model(numSymbols),
+		 histogram(numSymbols,0)
+		{
+		}
+	~RansEncoder(void)
+		{
+		/* Write any buffered operations: */
+		flush();
+		}
+	
+	/* Methods: */
+	void writeBits(Bits bits,unsigned int numBits) // Writes the given bits with uniform probability
+		{
+		/* Split the bits into chunks that fit into the coder's state: */
+		if(numBits>maxRawBits)
+			{
+			writeRawBits(bits>>maxRawBits,numBits-maxRawBits);
+			writeRawBits(bits&((Bits(1U)<<maxRawBits)-1U),maxRawBits);
+			}
+		else if(numBits>0U)
+			writeRawBits(bits,numBits);
+		}
+	void encode(unsigned int value) // Buffers the given value for encoding
+		{
+		/* Count the value and remember it for the reverse encoding pass: */
+		++histogram[value];
+		operations.push_back(Operation(value));
+		}
+	void encodeAndWriteBits(unsigned int value,Bits bits,unsigned int numBits) // Buffers the given value for encoding and writes the given bits after it
+		{
+		encode(value);
+		writeBits(bits,numBits);
+		}
+	void flush(void) // Encodes all buffered values and writes the model and code stream to the file; does nothing if there are no buffered values
+		{
+		if(operations.empty())
+			return;
+		
+		/* Create and write a model of the buffered values' frequencies: */
+		model.setFrequencies(&histogram[0]);
+		{
+		BitSink bitSink(*file);
+		model.write(bitSink);
+		}
+		
+		/* Encode all buffered operations in reverse order, alternating between two coder states: */
+		State states[2]={RansModel::lowerBound,RansModel::lowerBound};
+		bytes.clear();
+		for(size_t i=operations.size();i>0;--i)
+			{
+			/* Get the operation's frequency interval: */
+			Operation op=operations[i-1];
+			State start,frequency;
+			unsigned int scaleBits;
+			if(op&rawBitsFlag)
+				{
+				start=op&((Operation(1U)<<maxRawBits)-1U);
+				frequency=1U;
+				scaleBits=(op>>maxRawBits)&0x1fU;
+				}
+			else
+				{
+				start=model.getStart(op);
+				frequency=model.getFrequency(op);
+				scaleBits=RansModel::probBits;
+				}
+			
+			/* Renormalize the operation's coder state so that the encoded state stays inside the normalized interval: */
+			State& state=states[(i-1)&0x1U];
+			State stateMax=((RansModel::lowerBound>>scaleBits)<<8)*frequency;
+			while(state>=stateMax)
+				{
+				bytes.push_back(Misc::UInt8(state&0xffU));
+				state>>=8;
+				}
+			
+			/* Encode the operation: */
+			state=((state/frequency)<<scaleBits)+(state%frequency)+start;
+			}
+		
+		/* Append the final coder states such that the decoder reads the first state first: */
+		for(int s=1;s>=0;--s)
+			for(int shift=24;shift>=0;shift-=8)
+				bytes.push_back(Misc::UInt8((states[s]>>shift)&0xffU));
+		
+		/* Write the byte stream front-to-back: */
+		std::reverse(bytes.begin(),bytes.end());
+		file->write<Misc::UInt32>(bytes.size());
+		file->write(&bytes[0],bytes.size());
+		
+		/* Reset the encoder: */
+		operations.clear();
+		std::fill(histogram.begin(),histogram.end(),size_t(0));
+		}
+	};
+
+#endif
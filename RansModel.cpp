@@ -0,0 +1,196 @@
+/***********************************************************************
+RansModel - Class representing the quantized symbol frequencies shared
+by rANS entropy encoders and decoders.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "RansModel.h"
+
+#include <stdexcept>
+
+#include "BitSink.h"
+#include "BitSource.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline void writeGamma(BitSink& bitSink,Bits value) // Writes a positive value using an Elias gamma code
+	{
+	/* Count the value's significant bits: */
+	unsigned int numBits=1;
+	while((value>>numBits)!=0U)
+		++numBits;
+	
+	/* Write the value prefixed by one zero bit for each significant bit after the first: */
+	bitSink.writeLong(value,2U*numBits-1U);
+	}
+
+inline Bits readGamma(BitSource& bitSource,unsigned int maxBits) // Reads a positive value of at most the given number of significant bits using an Elias gamma code
+	{
+	/* Count the leading zero bits: */
+	unsigned int numBits=1;
+	while(bitSource.readBit()==0U)
+		{
+		if(++numBits>maxBits)
+			throw std::runtime_error("RansModel::read: Invalid frequency table");
+		}
+	
+	/* Read the rest of the value: */
+	Bits result=0x1U;
+	if(numBits>1U)
+		result=(result<<(numBits-1U))|bitSource.read(numBits-1U);
+	return result;
+	}
+
+}
+
+/**************************
+Methods of class RansModel:
+**************************/
+
+void RansModel::updateStarts(void)
+	{
+	State start=0;
+	for(unsigned int i=0;i<numSymbols;++i)
+		{
+		starts[i]=start;
+		start+=frequencies[i];
+		}
+	}
+
+RansModel::RansModel(unsigned int sNumSymbols)
+	:numSymbols(sNumSymbols),
+	 frequencies(new State[numSymbols]),starts(new State[numSymbols])
+	{
+	/* Initialize an empty model: */
+	for(unsigned int i=0;i<numSymbols;++i)
+		frequencies[i]=0;
+	updateStarts();
+	}
+
+RansModel::~RansModel(void)
+	{
+	delete[] frequencies;
+	delete[] starts;
+	}
+
+void RansModel::setFrequencies(const size_t* histogram)
+	{
+	/* Count the total number of symbols and find the most frequent one: */
+	size_t total=0;
+	unsigned int maxSymbol=0;
+	for(unsigned int i=0;i<numSymbols;++i)
+		{
+		total+=histogram[i];
+		if(histogram[maxSymbol]<histogram[i])
+			maxSymbol=i;
+		}
+	
+	/* Quantize the histogram, rounding each occurring symbol's frequency up to at least one: */
+	State sum=0;
+	for(unsigned int i=0;i<numSymbols;++i)
+		{
+		frequencies[i]=0;
+		if(histogram[i]!=0)
+			{
+			frequencies[i]=State((Misc::UInt64(histogram[i])*probScale+Misc::UInt64(total/2))/Misc::UInt64(total));
+			if(frequencies[i]==0)
+				frequencies[i]=1;
+			sum+=frequencies[i];
+			}
+		}
+	
+	if(total!=0)
+		{
+		/* Assign a deficit to the most frequent symbol: */
+		if(sum<probScale)
+			frequencies[maxSymbol]+=probScale-sum;
+		
+		/* Take an excess away from the currently most frequent symbols; this terminates because numSymbols is much smaller than probScale: */
+		while(sum>probScale)
+			{
+			unsigned int maxFreqSymbol=0;
+			for(unsigned int i=1;i<numSymbols;++i)
+				if(frequencies[maxFreqSymbol]<frequencies[i])
+					maxFreqSymbol=i;
+			State decrement=sum-probScale;
+			if(decrement>frequencies[maxFreqSymbol]/2U)
+				decrement=frequencies[maxFreqSymbol]/2U;
+			frequencies[maxFreqSymbol]-=decrement;
+			sum-=decrement;
+			}
+		}
+	
+	updateStarts();
+	}
+
+void RansModel::write(BitSink& bitSink) const
+	{
+	/* Write the frequencies as alternating runs of absent symbols and frequencies of present symbols: */
+	unsigned int i=0;
+	while(i<numSymbols)
+		{
+		/* Write the length of the run of absent symbols starting at the current symbol: */
+		unsigned int runEnd;
+		for(runEnd=i;runEnd<numSymbols&&frequencies[runEnd]==0;++runEnd)
+			;
+		writeGamma(bitSink,runEnd-i+1U);
+		i=runEnd;
+		
+		/* Write the frequency of the next present symbol: */
+		if(i<numSymbols)
+			{
+			writeGamma(bitSink,frequencies[i]);
+			++i;
+			}
+		}
+	}
+
+void RansModel::read(BitSource& bitSource)
+	{
+	/* Read alternating runs of absent symbols and frequencies of present symbols: */
+	State sum=0;
+	unsigned int i=0;
+	while(i<numSymbols)
+		{
+		/* Read the length of the run of absent symbols starting at the current symbol: */
+		unsigned int runEnd=i+readGamma(bitSource,maxNumBits-1U)-1U;
+		if(runEnd>numSymbols)
+			throw std::runtime_error("RansModel::read: Invalid frequency table");
+		for(;i<runEnd;++i)
+			frequencies[i]=0;
+		
+		/* Read the frequency of the next present symbol: */
+		if(i<numSymbols)
+			{
+			frequencies[i]=readGamma(bitSource,probBits+1U);
+			sum+=frequencies[i];
+			++i;
+			}
+		}
+	
+	/* Check that the frequencies form a valid model: */
+	if(sum!=probScale&&sum!=0)
+		throw std::runtime_error("RansModel::read: Invalid frequency table");
+	
+	updateStarts();
+	}
@@ -0,0 +1,78 @@
+/***********************************************************************
+RansModel - Class representing the quantized symbol frequencies shared
+by rANS entropy encoders and decoders.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef RANSMODEL_INCLUDED
+#define RANSMODEL_INCLUDED
+
+#include <stddef.h>
+#include <Misc/SizedTypes.h>
+
+/* Forward declarations: */
+class BitSink;
+class BitSource;
+
+class RansModel
+	{
+	/* Embedded classes: */
+	public:
+	typedef Misc::UInt32 State; // Type for rANS coder states
+	
+	/* Elements: */
+	static const unsigned int probBits=14; // Number of bits in quantized symbol probabilities
+	static const State probScale=State(1U)<<probBits; // Sum of all quantized symbol frequencies
+	static const State lowerBound=State(1U)<<23; // Lower bound of the normalized coder state interval; states are renormalized one byte at a time
+	private:
+	unsigned int numSymbols; // Number of symbols in the model's alphabet
+	State* frequencies; // Array of quantized symbol frequencies, summing to probScale or to zero for an empty model
+	State* starts; // Array of cumulative quantized frequencies of all preceding symbols
+	
+	/* Private methods: */
+	void updateStarts(void); // Calculates cumulative frequencies from the current symbol frequencies
+	
+	/* Constructors and destructors: */
+	public:
+	RansModel(unsigned int sNumSymbols); // Creates an empty model for the given number of symbols
+	private:
+	RansModel(const RansModel& source); // Prohibit copy constructor
+	RansModel& operator=(const RansModel& source); // Prohibit assignment operator
+	public:
+	~RansModel(void);
+	
+	/* Methods: */
+	unsigned int getNumSymbols(void) const // Returns the number of symbols in the model's alphabet
+		{
+		return numSymbols;
+		}
+	State getFrequency(unsigned int symbol) const // Returns the quantized frequency of the given symbol
+		{
+		return frequencies[symbol];
+		}
+	State getStart(unsigned int symbol) const // Returns the cumulative quantized frequency of all symbols preceding the given symbol
+		{
+		return starts[symbol];
+		}
+	void setFrequencies(const size_t* histogram); // Quantizes the given histogram of numSymbols entries such that every symbol that occurs in it has a non-zero frequency
+	void write(BitSink& bitSink) const; // Writes the model's quantized frequencies to the given bit sink
+	void read(BitSource& bitSource); // Reads quantized frequencies from the given bit source; throws an exception if they do not form a valid model
+	};
+
+#endif
@@ -0,0 +1,39 @@
+/***********************************************************************
+RemoteProtocol - Constants identifying the protocol used to stream
+bathymetry and water level grids from a remote AR Sandbox to its
+clients.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef REMOTEPROTOCOL_INCLUDED
+#define REMOTEPROTOCOL_INCLUDED
+
+#include <Misc/SizedTypes.h>
+
+namespace RemoteProtocol {
+
+static const Misc::UInt32 token=0x5341524eU; // Endianness token starting the connection handshake in both directions; differs from the legacy token so that peers predating protocol versions reject the connection
+static const Misc::UInt32 swappedToken=0x4e524153U; // Endianness token as received from a peer of opposite byte order
+static const Misc::UInt32 legacyToken=0x12345678U; // Endianness token sent by servers and clients predating protocol versions
+static const Misc::UInt32 swappedLegacyToken=0x78563412U; // Legacy endianness token as received from a peer of opposite byte order
+static const Misc::UInt32 version=2U; // Version of the grid streaming protocol, sent after the endianness token; servers and clients only talk to peers of the same version
+
+}
+
+#endif
@@ -22,10 +22,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "RemoteServer.h"
 
+#include <string.h>
+#include <algorithm>
 #include <Misc/SizedTypes.h>
+#include <Misc/StdError.h>
 #include <Misc/MessageLogger.h>
+#include <IO/FixedMemoryFile.h>
 #include <Comm/Pipe.h>
 #include <Math/Math.h>
+#include <Math/Constants.h>
 #include <GL/gl.h>
 #include <GL/GLMaterialTemplates.h>
 #include <GL/GLModels.h>
@@ -36,17 +41,101 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "Sandbox.h"
 #include "IntraFrameCompressor.h"
 #include "InterFrameCompressor.h"
+#include "AdaptiveCodebook.h"
+#include "MulticastSocket.h"
+#include "RemoteProtocol.h"
+
+/*************************************
+Static elements of class RemoteServer:
+*************************************/
+
+const unsigned int RemoteServer::invalidTileVersion;
+const size_t RemoteServer::multicastFragmentSize;
 
 /*************************************
 Methods of class RemoteServer::Client:
 *************************************/
 
+void* RemoteServer::Client::senderThreadMethod(void)
+	{
+	while(true)
+		{
+		/* Wait for the next queued grid triplet: */
+		CompressedFramePtr frame;
+		{
+		Threads::MutexCond::Lock queueLock(queueCond);
+		while(runSenderThread&&sendQueue.empty())
+			queueCond.wait(queueLock);
+		if(!runSenderThread)
+			break;
+		frame=sendQueue.front();
+		sendQueue.pop_front();
+		}
+		
+		try
+			{
+			/* Copy the compressed grid triplet to the client's pipe: */
+			frame->writeToSink(clientPipe);
+			
+			/* Finish the message: */
+			clientPipe.flush();
+			}
+		catch(const std::runtime_error& err)
+			{
+			/* Report the error to the communication thread, which will disconnect the client: */
+			Threads::MutexCond::Lock queueLock(queueCond);
+			sendFailed=true;
+			sendError=err.what();
+			break;
+			}
+		
+		/* Update the client's statistics: */
+		Threads::MutexCond::Lock queueLock(queueCond);
+		++stats.numSentFrames;
+		}
+	
+	return 0;
+	}
+
 RemoteServer::Client::Client(RemoteServer* sServer)
 	:server(sServer),
 	 clientPipe(server->listenSocket),
-	 state(START)
+	 state(START),coder(EntropyCoder::HUFFMAN),multicast(false),
+	 hasPose(false),
+	 tileVersions(server->numTiles,invalidTileVersion),
+	 runSenderThread(true),sendFailed(false)
 	{
 	clientPipe.ref();
+	
+	/* Initialize the client's statistics: */
+	stats.queueDepth=0;
+	stats.numSentFrames=0;
+	stats.numDroppedFrames=0;
+	stats.numRekeys=0;
+	
+	/* Start the sender thread: */
+	senderThread.start(this,&RemoteServer::Client::senderThreadMethod);
+	}
+
+RemoteServer::Client::~Client(void)
+	{
+	/* Shut down the sender thread: */
+	{
+	Threads::MutexCond::Lock queueLock(queueCond);
+	runSenderThread=false;
+	queueCond.signal();
+	}
+	
+	/* Wake up the sender thread if it is blocked writing to a stalled client: */
+	try
+		{
+		clientPipe.shutdown(true,true);
+		}
+	catch(const std::runtime_error& err)
+		{
+		/* Ignore the error; the client is going away anyway */
+		}
+	senderThread.join();
 	}
 
 /*****************************
@@ -72,6 +161,283 @@ void RemoteServer::quantizeGrid(GLsizei width,GLsizei height,const GLfloat* sour
 		}
 	}
 
+void RemoteServer::getTileRect(unsigned int tile,GLsizei width,GLsizei height,GLsizei rect[4]) const
+	{
+	/* Calculate the tile's column and row ranges: */
+	unsigned int column=tile%numTileColumns;
+	unsigned int row=tile/numTileColumns;
+	rect[0]=GLsizei((size_t(width)*size_t(column))/size_t(numTileColumns));
+	rect[1]=GLsizei((size_t(height)*size_t(row))/size_t(numTileRows));
+	rect[2]=GLsizei((size_t(width)*size_t(column+1))/size_t(numTileColumns));
+	rect[3]=GLsizei((size_t(height)*size_t(row+1))/size_t(numTileRows));
+	}
+
+bool RemoteServer::isTileInRegionOfInterest(const Client* client,unsigned int tile) const
+	{
+	/* Treat all tiles as interesting until the client has sent its position and viewing direction: */
+	if(!client->hasPose)
+		return true;
+	
+	/* Calculate the tile's extent in grid space from its extent in the cell-centered water grid: */
+	GLsizei rect[4];
+	getTileRect(tile,gridSize[0],gridSize[1],rect);
+	Vrui::Scalar min[2],max[2];
+	for(int i=0;i<2;++i)
+		{
+		min[i]=Vrui::Scalar(rect[i])*Vrui::Scalar(cellSize[i]);
+		max[i]=Vrui::Scalar(rect[2+i])*Vrui::Scalar(cellSize[i]);
+		}
+	
+	/* Check if the tile is horizontally near the client's position: */
+	Vrui::Scalar dist2(0);
+	for(int i=0;i<2;++i)
+		{
+		if(client->position[i]<min[i])
+			dist2+=Math::sqr(min[i]-client->position[i]);
+		else if(client->position[i]>max[i])
+			dist2+=Math::sqr(client->position[i]-max[i]);
+		}
+	if(dist2<=Math::sqr(Vrui::Scalar(nearRadius)))
+		return true;
+	
+	/* Check if the tile's center or any of its corners at the middle of the elevation range are inside the client's view cone: */
+	Vrui::Scalar directionMag=client->direction.mag();
+	if(directionMag==Vrui::Scalar(0))
+		return false;
+	Vrui::Scalar z=Math::mid(Vrui::Scalar(elevationRange[0]),Vrui::Scalar(elevationRange[1]));
+	for(int i=0;i<5;++i)
+		{
+		Vrui::Point p(Math::mid(min[0],max[0]),Math::mid(min[1],max[1]),z);
+		if(i<4)
+			{
+			p[0]=(i&0x1)!=0?max[0]:min[0];
+			p[1]=(i&0x2)!=0?max[1]:min[1];
+			}
+		Vrui::Vector d=p-client->position;
+		if(d*client->direction>=Vrui::Scalar(cosViewAngle)*d.mag()*directionMag)
+			return true;
+		}
+	
+	return false;
+	}
+
+unsigned int RemoteServer::requestTileVariant(unsigned int tile,unsigned int baseAge,EntropyCoder::Type coder)
+	{
+	/* Check if the tile variant was already requested by another client: */
+	unsigned int& index=tileVariantIndices[(size_t(tile)*size_t(numGridSlots)+size_t(baseAge))*EntropyCoder::NUM_TYPES+coder];
+	if(index==~0U)
+		{
+		/* Add a new tile variant to the current frame's list: */
+		index=tileVariants.size();
+		TileVariant tv;
+		tv.tile=tile;
+		tv.baseAge=baseAge;
+		tv.coder=coder;
+		tileVariants.push_back(tv);
+		}
+	
+	return index;
+	}
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+void extractTile(const Pixel* grid,GLsizei width,const GLsizei rect[4],Pixel* tile) // Copies the given rectangle out of a grid of the given width into a contiguous tile
+	{
+	GLsizei tileWidth=rect[2]-rect[0];
+	const Pixel* gPtr=grid+(size_t(rect[1])*size_t(width)+size_t(rect[0]));
+	for(GLsizei y=rect[1];y<rect[3];++y,gPtr+=width,tile+=tileWidth)
+		memcpy(tile,gPtr,size_t(tileWidth)*sizeof(Pixel));
+	}
+
+template <class ValueParam>
+inline char* writeDatagramValue(char* dest,ValueParam value) // Writes a value into a datagram buffer in native byte order and returns a pointer behind it
+	{
+	memcpy(dest,&value,sizeof(ValueParam));
+	return dest+sizeof(ValueParam);
+	}
+
+}
+
+void RemoteServer::compressTile(unsigned int jobIndex,void* userData)
+	{
+	RemoteServer* thisPtr=static_cast<RemoteServer*>(userData);
+	
+	/* Select the tile variant and the grid to compress: */
+	const TileVariant& variant=thisPtr->tileVariants[jobIndex/3U];
+	unsigned int grid=jobIndex%3U;
+	GLsizei width=thisPtr->gridSize[0];
+	GLsizei height=thisPtr->gridSize[1];
+	const std::vector<Pixel*>* pixels=&thisPtr->waterLevel;
+	if(grid==0U)
+		{
+		/* The bathymetry grid is vertex-centered: */
+		--width;
+		--height;
+		pixels=&thisPtr->bathymetry;
+		}
+	else if(grid==2U)
+		pixels=&thisPtr->snowHeight;
+	
+	/* Copy the tile out of the current grid, and out of the base grid for inter-frame compression: */
+	GLsizei rect[4];
+	thisPtr->getTileRect(variant.tile,width,height,rect);
+	GLsizei tileWidth=rect[2]-rect[0];
+	GLsizei tileHeight=rect[3]-rect[1];
+	size_t tileSize=size_t(tileWidth)*size_t(tileHeight);
+	std::vector<Pixel> tiles(variant.baseAge!=0U?tileSize*2:tileSize);
+	extractTile((*pixels)[thisPtr->frameIndex%thisPtr->numGridSlots],width,rect,&tiles[0]);
+	if(variant.baseAge!=0U)
+		extractTile((*pixels)[(thisPtr->frameIndex-variant.baseAge)%thisPtr->numGridSlots],width,rect,&tiles[tileSize]);
+	
+	/* Clear the tile's symbol histogram if the tile is Huffman-coded; rANS-coded tiles carry their own frequency tables: */
+	const AdaptiveCodebook& codebook=*thisPtr->codebooks[variant.baseAge==0U?0:1];
+	size_t* histogram=0;
+	if(variant.coder==EntropyCoder::HUFFMAN)
+		{
+		histogram=&thisPtr->tileHistograms[size_t(jobIndex)*thisPtr->histogramSize];
+		for(unsigned int i=0;i<codebook.getNumSymbols();++i)
+			histogram[i]=0;
+		}
+	
+	/* Compress the tile into its buffer using the selected entropy coder: */
+	IO::VariableMemoryFile& buffer=*thisPtr->tileBuffers[jobIndex];
+	buffer.clear();
+	if(variant.baseAge==0U)
+		{
+		IntraFrameCompressor compressor(buffer,variant.coder,codebook.getCodebook(),histogram);
+		compressor.compressFrame(tileWidth,tileHeight,&tiles[0]);
+		}
+	else
+		{
+		InterFrameCompressor compressor(buffer,variant.coder,codebook.getCodebook(),histogram);
+		compressor.compressFrame(tileWidth,tileHeight,&tiles[tileSize],&tiles[0]);
+		}
+	buffer.flush();
+	}
+
+void RemoteServer::compressTileVariants(void)
+	{
+	/* Create enough compression buffers and symbol histograms for all grids of all requested tile variants: */
+	unsigned int numJobs=tileVariants.size()*3U;
+	while(tileBuffers.size()<numJobs)
+		tileBuffers.push_back(new IO::VariableMemoryFile);
+	if(tileHistograms.size()<size_t(numJobs)*histogramSize)
+		tileHistograms.resize(size_t(numJobs)*histogramSize,0);
+	
+	/* Compress all grids of all requested tile variants in parallel: */
+	compressionPool.runJobs(numJobs,&RemoteServer::compressTile,this);
+	
+	/* Add the symbol histograms of Huffman-coded tiles to the respective codebook's training window: */
+	for(unsigned int i=0;i<numJobs;++i)
+		{
+		const TileVariant& variant=tileVariants[i/3U];
+		if(variant.coder==EntropyCoder::HUFFMAN)
+			codebooks[variant.baseAge==0U?0:1]->addSamples(&tileHistograms[size_t(i)*histogramSize]);
+		}
+	}
+
+RemoteServer::CompressedFramePtr RemoteServer::createGridMessage(const std::vector<unsigned int>& frameTileVariants,EntropyCoder::Type coder) const
+	{
+	CompressedFramePtr result=new IO::VariableMemoryFile;
+	result->write<Misc::UInt16>(0); // Compressed grid tiles message
+	
+	/* Write the IDs of the intra- and inter-frame codebooks with which the tiles were compressed, or zero if they were not Huffman-coded: */
+	for(int kind=0;kind<2;++kind)
+		result->write<Misc::UInt16>(coder==EntropyCoder::HUFFMAN?codebooks[kind]->getCodebookId():0U);
+	
+	/* Write the index, compression method, and compressed grid sizes of each tile: */
+	result->write<Misc::UInt16>(frameTileVariants.size());
+	for(std::vector<unsigned int>::const_iterator tvIt=frameTileVariants.begin();tvIt!=frameTileVariants.end();++tvIt)
+		{
+		result->write<Misc::UInt16>(tileVariants[*tvIt].tile);
+		result->write<Misc::UInt16>(tileVariants[*tvIt].baseAge==0U?0:1); // Intra- or inter-frame compressed tile
+		for(unsigned int grid=0;grid<3U;++grid)
+			result->write<Misc::UInt32>(tileBuffers[*tvIt*3U+grid]->getDataSize());
+		}
+	
+	/* Copy the compressed tiles into the message: */
+	for(std::vector<unsigned int>::const_iterator tvIt=frameTileVariants.begin();tvIt!=frameTileVariants.end();++tvIt)
+		for(unsigned int grid=0;grid<3U;++grid)
+			tileBuffers[*tvIt*3U+grid]->writeToSink(*result);
+	
+	/* Finish the buffer before it is handed to a client's sender thread or the multicast group: */
+	result->flush();
+	
+	return result;
+	}
+
+void RemoteServer::sendMulticastMessage(IO::VariableMemoryFile& message,bool keyframe)
+	{
+	/* Check that the message can be split into the maximum number of fragments: */
+	size_t messageSize=message.getDataSize();
+	size_t numFragments=(messageSize+multicastFragmentSize-1)/multicastFragmentSize;
+	if(numFragments>65535U)
+		throw std::runtime_error("Grid message too large for multicast");
+	
+	/* Copy the message into a contiguous buffer: */
+	IO::FixedMemoryFile messageBuffer(messageSize);
+	message.writeToSink(messageBuffer);
+	messageBuffer.flush();
+	const char* messagePtr=static_cast<const char*>(messageBuffer.getMemory());
+	
+	/* Send the message as a sequence of datagrams, each carrying the message's sequence number, size, and keyframe flag, the fragment's index, and the total number of fragments: */
+	++multicastSequenceNumber;
+	for(size_t fragment=0;fragment<numFragments;++fragment)
+		{
+		size_t fragmentOffset=fragment*multicastFragmentSize;
+		size_t fragmentSize=Math::min(messageSize-fragmentOffset,multicastFragmentSize);
+		char* dPtr=&datagram[0];
+		dPtr=writeDatagramValue(dPtr,multicastSequenceNumber);
+		dPtr=writeDatagramValue(dPtr,Misc::UInt32(messageSize));
+		dPtr=writeDatagramValue(dPtr,Misc::UInt16(fragment));
+		dPtr=writeDatagramValue(dPtr,Misc::UInt16(numFragments));
+		dPtr=writeDatagramValue(dPtr,Misc::UInt16(keyframe?1:0));
+		dPtr=writeDatagramValue(dPtr,Misc::UInt16(0));
+		memcpy(dPtr,messagePtr+fragmentOffset,fragmentSize);
+		
+		/* Send the datagram; datagrams dropped due to a full send buffer are treated like datagrams lost in transit: */
+		multicastSocket->send(&datagram[0],multicastHeaderSize+fragmentSize);
+		}
+	}
+
+RemoteServer::CompressedFramePtr RemoteServer::createCodebookMessage(unsigned int kind) const
+	{
+	/* Write the codebook's normalized symbol frequencies, from which the client builds its decoding tree: */
+	const AdaptiveCodebook& codebook=*codebooks[kind];
+	CompressedFramePtr result=new IO::VariableMemoryFile;
+	result->write<Misc::UInt16>(2); // Codebook update message
+	result->write<Misc::UInt16>(kind);
+	result->write<Misc::UInt16>(codebook.getCodebookId());
+	result->write<Misc::UInt32>(codebook.getNumSymbols());
+	result->write(codebook.getFrequencies(),codebook.getNumSymbols());
+	result->flush();
+	
+	return result;
+	}
+
+void RemoteServer::updateCodebooks(void)
+	{
+	for(unsigned int kind=0;kind<2;++kind)
+		if(codebooks[kind]->update())
+			{
+			/* Create a message defining the new codebook: */
+			codebookMessages[kind]=createCodebookMessage(kind);
+			
+			/* Queue the message for all connected Huffman-coded clients in streaming state: */
+			for(std::vector<Client*>::iterator cIt=clients.begin();cIt!=clients.end();++cIt)
+				if((*cIt)->state>=Client::INTRA&&(*cIt)->coder==EntropyCoder::HUFFMAN)
+					{
+					Threads::MutexCond::Lock queueLock((*cIt)->queueCond);
+					(*cIt)->sendQueue.push_back(codebookMessages[kind]);
+					(*cIt)->queueCond.signal();
+					}
+			}
+	}
+
 void RemoteServer::disconnectClient(Client* client,bool removeListener)
 	{
 	/* Find the client in the client list: */
@@ -80,7 +446,11 @@ void RemoteServer::disconnectClient(Client* client,bool removeListener)
 			{
 			/* Reduce the number of streaming clients if the client was streaming: */
 			if(client->state>=Client::INTRA)
+				{
 				--numClients;
+				if(client->multicast)
+					--numMulticastClients;
+				}
 			
 			if(removeListener)
 				{
@@ -110,8 +480,9 @@ void RemoteServer::newConnectionCallback(Threads::EventDispatcher::IOEvent& even
 		/* Create a new client object: */
 		newClient=new Client(thisPtr);
 		
-		/* Send an endianness token to the client: */
-		newClient->clientPipe.write<Misc::UInt32>(0x12345678U);
+		/* Send an endianness token and the protocol version to the client: */
+		newClient->clientPipe.write<Misc::UInt32>(RemoteProtocol::token);
+		newClient->clientPipe.write<Misc::UInt32>(RemoteProtocol::version);
 		
 		/* Send the water table's grid size and cell size to the client: */
 		for(int i=0;i<2;++i)
@@ -124,6 +495,26 @@ void RemoteServer::newConnectionCallback(Threads::EventDispatcher::IOEvent& even
 		for(int i=0;i<2;++i)
 			newClient->clientPipe.write<Misc::Float32>(thisPtr->elevationRange[i]);
 		
+		/* Send the set of supported entropy coders, from which the client selects one in its reply: */
+		newClient->clientPipe.write<Misc::UInt16>((1U<<EntropyCoder::HUFFMAN)|(1U<<EntropyCoder::RANS));
+		
+		/* Send the layout of tiles into which each grid is split: */
+		newClient->clientPipe.write<Misc::UInt16>(thisPtr->numTileRows);
+		newClient->clientPipe.write<Misc::UInt16>(thisPtr->numTileColumns);
+		
+		/* Send the multicast group's address and port and the size of message fragments, or an address of zero if multicast is disabled: */
+		if(thisPtr->multicastSocket!=0)
+			{
+			newClient->clientPipe.write<Misc::UInt32>(thisPtr->multicastSocket->getGroupAddress());
+			newClient->clientPipe.write<Misc::UInt16>(thisPtr->multicastSocket->getGroupPortId());
+			}
+		else
+			{
+			newClient->clientPipe.write<Misc::UInt32>(0U);
+			newClient->clientPipe.write<Misc::UInt16>(0U);
+			}
+		newClient->clientPipe.write<Misc::UInt16>(multicastFragmentSize);
+		
 		/* Finish the message: */
 		newClient->clientPipe.flush();
 		
@@ -155,14 +546,38 @@ void RemoteServer::clientMessageCallback(Threads::EventDispatcher::IOEvent& even
 				{
 				/* Read an endianness token: */
 				Misc::UInt32 token=client->clientPipe.read<Misc::UInt32>();
-				if(token==0x78563412U)
+				if(token==RemoteProtocol::swappedToken)
 					client->clientPipe.setSwapOnRead(true);
-				else if(token!=0x12345678U)
+				else if(token==RemoteProtocol::legacyToken||token==RemoteProtocol::swappedLegacyToken)
+					throw Misc::makeStdErr(0,"Client uses an unversioned protocol instead of version %u",(unsigned int)(RemoteProtocol::version));
+				else if(token!=RemoteProtocol::token)
 					throw std::runtime_error("Invalid endianness token");
 				
+				/* Read the client's protocol version and reject clients that lay out messages differently: */
+				unsigned int version=client->clientPipe.read<Misc::UInt32>();
+				if(version!=RemoteProtocol::version)
+					throw Misc::makeStdErr(0,"Client uses protocol version %u instead of %u",version,(unsigned int)(RemoteProtocol::version));
+				
+				/* Read the client's selected entropy coder: */
+				unsigned int coder=client->clientPipe.read<Misc::UInt16>();
+				if(coder>=EntropyCoder::NUM_TYPES)
+					throw std::runtime_error("Unsupported entropy coder");
+				client->coder=EntropyCoder::Type(coder);
+				
+				/* Read whether the client wants to receive grid triplets from the multicast group: */
+				client->multicast=client->clientPipe.read<Misc::UInt16>()!=0U;
+				if(client->multicast&&server->multicastSocket==0)
+					throw std::runtime_error("Multicast requested but not enabled");
+				
 				/* Go to the next state: */
 				client->state=Client::INTRA;
 				++server->numClients;
+				if(client->multicast)
+					{
+					/* Send the next multicast grid message as a keyframe so the new client can start decoding it: */
+					++server->numMulticastClients;
+					server->forceKeyframe=true;
+					}
 				break;
 				}
 			
@@ -180,8 +595,21 @@ void RemoteServer::clientMessageCallback(Threads::EventDispatcher::IOEvent& even
 						Misc::Float32 dir[3];
 						client->clientPipe.read(dir,3);
 						client->direction=Vrui::Vector(dir);
+						client->hasPose=true;
 						break;
 					
+					case 1: // Multicast re-synchronization request message
+						{
+						if(!client->multicast)
+							throw std::runtime_error("Invalid client message");
+						
+						/* Send the next multicast grid message as a keyframe: */
+						server->forceKeyframe=true;
+						Threads::MutexCond::Lock queueLock(client->queueCond);
+						++client->stats.numRekeys;
+						break;
+						}
+					
 					default:
 						throw std::runtime_error("Invalid client message");
 					}
@@ -218,60 +646,162 @@ void* RemoteServer::communicationThreadMethod(void)
 				}
 		clientPositions.postNewValue();
 		
+		/* Collect the send queue statistics of all connected clients in streaming state: */
+		std::vector<ClientStats>& stats=clientStats.startNewValue();
+		stats.clear();
+		for(std::vector<Client*>::iterator cIt=clients.begin();cIt!=clients.end();++cIt)
+			if((*cIt)->state>=Client::INTRA)
+				{
+				Threads::MutexCond::Lock queueLock((*cIt)->queueCond);
+				(*cIt)->stats.queueDepth=(*cIt)->sendQueue.size();
+				stats.push_back((*cIt)->stats);
+				}
+		clientStats.postNewValue();
+		
 		/* Check if there is a new grid triplet: */
 		if(grids.lockNewValue())
 			{
-			/* Quantize the property grids: */
-			int newGrid=1-currentGrid;
-			quantizeGrid(gridSize[0]-1,gridSize[1]-1,grids.getLockedValue().bathymetry,bathymetry[newGrid]);
-			quantizeGrid(gridSize[0],gridSize[1],grids.getLockedValue().waterLevel,waterLevel[newGrid]);
-			quantizeGrid(gridSize[0],gridSize[1],grids.getLockedValue().snowHeight,snowHeight[newGrid]);
+			/* Quantize the property grids into the next ring buffer slot: */
+			++frameIndex;
+			unsigned int slot=frameIndex%numGridSlots;
+			quantizeGrid(gridSize[0]-1,gridSize[1]-1,grids.getLockedValue().bathymetry,bathymetry[slot]);
+			quantizeGrid(gridSize[0],gridSize[1],grids.getLockedValue().waterLevel,waterLevel[slot]);
+			quantizeGrid(gridSize[0],gridSize[1],grids.getLockedValue().snowHeight,snowHeight[slot]);
 			
-			/* Send the quantized grid triplet to all connected clients in streaming state: */
+			/* Start a new list of requested tile variants: */
+			tileVariants.clear();
+			std::fill(tileVariantIndices.begin(),tileVariantIndices.end(),~0U);
+			
+			/* Select the tiles to send to all connected clients in streaming state, requesting each tile variant at most once: */
+			std::vector<Client*> streamingClients;
 			std::vector<Client*> deadClients;
 			for(std::vector<Client*>::iterator cIt=clients.begin();cIt!=clients.end();++cIt)
 				{
-				try
+				Client* client=*cIt;
+				if(client->state<Client::INTRA)
+					continue;
+				
+				/* Check the client's sender thread and send queue: */
+				{
+				Threads::MutexCond::Lock queueLock(client->queueCond);
+				if(client->sendFailed)
 					{
-					if((*cIt)->state==Client::INTRA)
-						{
-						/* Send the new grid triplet to the client using intra-frame compression: */
-						IntraFrameCompressor compressor((*cIt)->clientPipe);
-						compressor.compressFrame(gridSize[0]-1,gridSize[1]-1,bathymetry[newGrid]);
-						compressor.compressFrame(gridSize[0],gridSize[1],waterLevel[newGrid]);
-						compressor.compressFrame(gridSize[0],gridSize[1],snowHeight[newGrid]);
-						
-						/* Finish the message: */
-						(*cIt)->clientPipe.flush();
-						
-						/* Send grid pairs using inter-frame compression from now on: */
-						(*cIt)->state=Client::INTER;
-						}
-					else if((*cIt)->state==Client::INTER)
+					/* Disconnect the client: */
+					Misc::formattedConsoleWarning("RemoteServer: Disconnecting client due to exception %s",client->sendError.c_str());
+					deadClients.push_back(client);
+					continue;
+					}
+				
+				if(client->state==Client::INTER&&client->sendQueue.size()>=maxQueuedFrames)
+					{
+					/* The client is falling behind; drop all queued grid triplets and re-synchronize it with intra-frame compressed tiles: */
+					client->stats.numDroppedFrames+=client->sendQueue.size();
+					client->sendQueue.clear();
+					++client->stats.numRekeys;
+					client->state=Client::INTRA;
+					}
+				}
+				
+				/* Invalidate all of a new or re-synchronized client's tiles: */
+				if(client->state==Client::INTRA)
+					std::fill(client->tileVersions.begin(),client->tileVersions.end(),invalidTileVersion);
+				
+				/* Select the client's tiles, unless it receives grid triplets from the multicast group, which sends a keyframe whenever a client joins or re-synchronizes; a TCP copy could arrive after newer multicast messages and overwrite them: */
+				client->frameTileVariants.clear();
+				if(!client->multicast)
+					{
+					for(unsigned int tile=0;tile<numTiles;++tile)
 						{
-						/* Send the difference between the current and new grid pairs to the client using inter-frame compression: */
-						InterFrameCompressor compressor((*cIt)->clientPipe);
-						compressor.compressFrame(gridSize[0]-1,gridSize[1]-1,bathymetry[currentGrid],bathymetry[newGrid]);
-						compressor.compressFrame(gridSize[0],gridSize[1],waterLevel[currentGrid],waterLevel[newGrid]);
-						compressor.compressFrame(gridSize[0],gridSize[1],snowHeight[currentGrid],snowHeight[newGrid]);
-						
-						/* Finish the message: */
-						(*cIt)->clientPipe.flush();
+						unsigned int& version=client->tileVersions[tile];
+						if(version==invalidTileVersion)
+							{
+							/* Send the tile using intra-frame compression: */
+							client->frameTileVariants.push_back(requestTileVariant(tile,0,client->coder));
+							version=frameIndex;
+							}
+						else
+							{
+							/* Send the tile every frame if it is in the client's region of interest, or when it is due otherwise: */
+							unsigned int age=frameIndex-version;
+							if(age>=farTileInterval||isTileInRegionOfInterest(client,tile))
+								{
+								/* Use inter-frame compression relative to the client's version of the tile if that version is still in the ring buffer: */
+								client->frameTileVariants.push_back(requestTileVariant(tile,age<numGridSlots?age:0,client->coder));
+								version=frameIndex;
+								}
+							}
 						}
 					}
+				
+				streamingClients.push_back(client);
+				}
+			
+			/* Select all tiles for the multicast group if there are multicast clients, as keyframe or inter-frame compressed relative to the previous grid triplet: */
+			bool keyframe=forceKeyframe||numMessagesSinceKeyframe>=keyframeInterval;
+			multicastTileVariants.clear();
+			if(numMulticastClients>0)
+				for(unsigned int tile=0;tile<numTiles;++tile)
+					multicastTileVariants.push_back(requestTileVariant(tile,keyframe?0:1,EntropyCoder::RANS));
+			
+			/* Compress all requested tile variants: */
+			compressTileVariants();
+			
+			/* Queue the selected tiles for all streaming clients: */
+			for(std::vector<Client*>::iterator cIt=streamingClients.begin();cIt!=streamingClients.end();++cIt)
+				{
+				Client* client=*cIt;
+				
+				/* Send the current adaptive codebooks ahead of the tiles if the client is new or re-synchronized and uses them, as it might not have received them yet: */
+				bool sendCodebooks=client->state==Client::INTRA&&client->coder==EntropyCoder::HUFFMAN;
+				
+				/* Send tiles using inter-frame compression from now on: */
+				client->state=Client::INTER;
+				
+				/* Skip clients that do not receive any tiles in this frame: */
+				if(client->frameTileVariants.empty())
+					continue;
+				
+				/* Queue the client's compressed tiles and wake up the client's sender thread: */
+				CompressedFramePtr frame=createGridMessage(client->frameTileVariants,client->coder);
+				Threads::MutexCond::Lock queueLock(client->queueCond);
+				if(sendCodebooks)
+					{
+					for(int kind=0;kind<2;++kind)
+						if(codebookMessages[kind]!=0)
+							client->sendQueue.push_back(codebookMessages[kind]);
+					}
+				client->sendQueue.push_back(frame);
+				client->queueCond.signal();
+				}
+			
+			if(!multicastTileVariants.empty())
+				{
+				/* Send the multicast tiles to the multicast group: */
+				try
+					{
+					sendMulticastMessage(*createGridMessage(multicastTileVariants,EntropyCoder::RANS),keyframe);
+					}
 				catch(const std::runtime_error& err)
 					{
-					/* Disconnect the client: */
-					Misc::formattedConsoleWarning("RemoteServer: Disconnecting client due to exception %s",err.what());
-					deadClients.push_back(*cIt);
+					/* Treat the message as lost; clients will request a keyframe: */
+					Misc::formattedConsoleWarning("RemoteServer: Unable to send multicast grid message due to exception %s",err.what());
+					}
+				
+				/* Update the keyframe schedule: */
+				if(keyframe)
+					{
+					forceKeyframe=false;
+					numMessagesSinceKeyframe=0;
 					}
+				++numMessagesSinceKeyframe;
 				}
 			
 			/* Disconnect all dead clients: */
 			for(std::vector<Client*>::iterator dcIt=deadClients.begin();dcIt!=deadClients.end();++dcIt)
 				disconnectClient(*dcIt,true);
 			
-			currentGrid=newGrid;
+			/* Adapt the codebooks to the statistics of the recently compressed tiles: */
+			updateCodebooks();
 			}
 		}
 	
@@ -287,11 +817,18 @@ void RemoteServer::readBackCallback(GLfloat*,GLfloat*,GLfloat*,void* userData)
 	thisPtr->dispatcher.interrupt();
 	}
 
-RemoteServer::RemoteServer(Sandbox* sSandbox,int listenPortId,double sRequestInterval)
+RemoteServer::RemoteServer(Sandbox* sSandbox,const RemoteServer::Parameters& parameters)
 	:sandbox(sSandbox),
-	 listenSocket(listenPortId,0),
+	 listenSocket(parameters.listenPortId,0),
 	 numClients(0),
-	 requestInterval(sRequestInterval),nextRequestTime(0.0)
+	 requestInterval(parameters.requestInterval),nextRequestTime(0.0),
+	 numTileRows(parameters.numTileRows),numTileColumns(parameters.numTileColumns),
+	 farTileInterval(parameters.farTileInterval),nearRadius(parameters.nearRadius),cosViewAngle(Math::cos(Math::rad(parameters.viewAngle))),
+	 frameIndex(0),
+	 compressionPool(parameters.numCompressionThreads),
+	 multicastSocket(0),numMulticastClients(0),
+	 keyframeInterval(Math::max(parameters.keyframeInterval,1U)),numMessagesSinceKeyframe(0),forceKeyframe(true),
+	 multicastSequenceNumber(0)
 	{
 	/* Ignore SIGPIPE and leave handling of pipe errors to TCP sockets: */
 	Comm::ignorePipeSignals();
@@ -318,14 +855,53 @@ RemoteServer::RemoteServer(Sandbox* sSandbox,int listenPortId,double sRequestInt
 	for(int i=0;i<3;++i)
 		grids.getBuffer(i).init(gridSize);
 	
-	/* Create the grid quantization buffers: */
-	for(int i=0;i<2;++i)
+	/* Limit the numbers of tile rows and columns to the size of the smallest grid and to the number of tiles that can be addressed in grid messages: */
+	if(numTileRows<1U)
+		numTileRows=1U;
+	if(numTileRows>(unsigned int)(gridSize[1]-1))
+		numTileRows=(unsigned int)(gridSize[1]-1);
+	if(numTileColumns<1U)
+		numTileColumns=1U;
+	if(numTileColumns>(unsigned int)(gridSize[0]-1))
+		numTileColumns=(unsigned int)(gridSize[0]-1);
+	if(numTileRows*numTileColumns>65535U)
+		numTileColumns=65535U/numTileRows;
+	numTiles=numTileRows*numTileColumns;
+	
+	/* Limit the far tile update interval and calculate the default region of interest radius: */
+	if(farTileInterval<1U)
+		farTileInterval=1U;
+	if(nearRadius<0.0f)
+		nearRadius=Math::max(GLfloat(gridSize[0])*cellSize[0],GLfloat(gridSize[1])*cellSize[1])*0.25f;
+	
+	/* Create the grid quantization ring buffer, holding enough grid triplets to inter-frame compress tiles that are only updated every farTileInterval grid triplets: */
+	numGridSlots=farTileInterval+1U;
+	for(unsigned int i=0;i<numGridSlots;++i)
+		{
+		bathymetry.push_back(new Pixel[(gridSize[1]-1)*(gridSize[0]-1)]);
+		waterLevel.push_back(new Pixel[gridSize[1]*gridSize[0]]);
+		snowHeight.push_back(new Pixel[gridSize[1]*gridSize[0]]);
+		}
+	tileVariantIndices.resize(size_t(numTiles)*size_t(numGridSlots)*EntropyCoder::NUM_TYPES,~0U);
+	
+	/* Create the adaptive codebooks, starting from the compressors' default codebooks; per-tile compression buffers and symbol histograms are created on demand: */
+	codebooks[0]=new AdaptiveCodebook(IntraFrameCompressor::getNumSymbols(),IntraFrameCompressor::getDefaultCodebook(),codebookWindowSize);
+	codebooks[1]=new AdaptiveCodebook(InterFrameCompressor::getNumSymbols(),InterFrameCompressor::getDefaultCodebook(),codebookWindowSize);
+	histogramSize=Math::max(IntraFrameCompressor::getNumSymbols(),InterFrameCompressor::getNumSymbols());
+	
+	if(!parameters.multicastGroup.empty())
 		{
-		bathymetry[i]=new Pixel[(gridSize[1]-1)*(gridSize[0]-1)];
-		waterLevel[i]=new Pixel[gridSize[1]*gridSize[0]];
-		snowHeight[i]=new Pixel[gridSize[1]*gridSize[0]];
+		/* Create a socket sending to the multicast group, and serve all clients via TCP if the group can not be reached: */
+		try
+			{
+			multicastSocket=new MulticastSocket(MulticastSocket::parseAddress(parameters.multicastGroup.c_str()),parameters.multicastPortId,parameters.multicastInterface.empty()?0:parameters.multicastInterface.c_str(),false,parameters.multicastTtl);
+			datagram.resize(multicastHeaderSize+multicastFragmentSize);
+			}
+		catch(const std::runtime_error& err)
+			{
+			Misc::formattedConsoleWarning("RemoteServer: Disabling multicast to group %s due to exception %s",parameters.multicastGroup.c_str(),err.what());
+			}
 		}
-	currentGrid=1;
 	
 	/* Start listening for incoming connections on the listening socket: */
 	dispatcher.addIOEventListener(listenSocket.getFd(),Threads::EventDispatcher::Read,newConnectionCallback,this);
@@ -343,18 +919,22 @@ RemoteServer::~RemoteServer(void)
 		delete *cIt;
 	
 	/* Release allocated resources: */
-	for(int i=0;i<2;++i)
+	for(unsigned int i=0;i<numGridSlots;++i)
 		{
 		delete[] bathymetry[i];
 		delete[] waterLevel[i];
 		delete[] snowHeight[i];
 		}
+	for(int i=0;i<2;++i)
+		delete codebooks[i];
+	delete multicastSocket;
 	}
 
 void RemoteServer::frame(double applicationTime)
 	{
-	/* Lock the most recent list of client positions: */
+	/* Lock the most recent lists of client positions and send queue statistics: */
 	clientPositions.lockNewValue();
+	clientStats.lockNewValue();
 	
 	/* Check if it's time to request a new set of grids: */
 	if(numClients>0&&applicationTime>=nextRequestTime)
@@ -23,11 +23,17 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #ifndef REMOTESERVER_INCLUDED
 #define REMOTESERVER_INCLUDED
 
+#include <string>
+#include <deque>
 #include <vector>
+#include <Misc/Autopointer.h>
+#include <Misc/SizedTypes.h>
 #include <Threads/Thread.h>
+#include <Threads/MutexCond.h>
 #include <Threads/TripleBuffer.h>
 #include <Threads/EventDispatcher.h>
 #include <Comm/ListeningTCPSocket.h>
+#include <IO/VariableMemoryFile.h>
 #include <Comm/TCPPipe.h>
 #include <Geometry/Point.h>
 #include <Geometry/Vector.h>
@@ -37,15 +43,59 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "Types.h"
 #include "Pixel.h"
+#include "JobPool.h"
+#include "EntropyCoder.h"
 
 /* Forward declarations: */
 class GLContextData;
 class Sandbox;
+class AdaptiveCodebook;
+class MulticastSocket;
 
 class RemoteServer
 	{
 	/* Embedded classes: */
+	public:
+	struct Parameters // Structure holding the configuration of a remote server
+		{
+		/* Elements: */
+		public:
+		int listenPortId; // Port on which to listen for incoming connections
+		double requestInterval; // Interval between grid triplet requests in seconds
+		unsigned int numCompressionThreads; // Number of threads compressing grid tiles
+		unsigned int numTileRows,numTileColumns; // Number of tile rows and columns into which each grid is split
+		unsigned int farTileInterval; // Number of grid triplets between updates of tiles far from a client
+		GLfloat nearRadius; // Radius around a client's position inside which tiles are updated with every grid triplet, or negative for a quarter of the grid's larger extent
+		GLfloat viewAngle; // Angle around a client's viewing direction in degrees inside which tiles are updated with every grid triplet
+		std::string multicastGroup; // Address of the multicast group from which clients can opt to receive all grid triplets, or empty to disable multicast
+		int multicastPortId; // Port of the multicast group
+		std::string multicastInterface; // Address of the network interface through which to send to the multicast group, or empty for the default interface
+		int multicastTtl; // Time-to-live of multicast datagrams
+		unsigned int keyframeInterval; // Maximum number of grid triplets between intra-frame compressed keyframes sent to the multicast group
+		
+		/* Constructors and destructors: */
+		Parameters(void) // Creates default parameters
+			:listenPortId(26000),requestInterval(1.0/30.0),numCompressionThreads(3),
+			 numTileRows(1),numTileColumns(1),
+			 farTileInterval(4),nearRadius(-1.0f),viewAngle(60.0f),
+			 multicastPortId(26001),multicastTtl(1),keyframeInterval(30)
+			{
+			}
+		};
+	
+	struct ClientStats // Structure reporting the state of a streaming client's send queue
+		{
+		/* Elements: */
+		public:
+		unsigned int queueDepth; // Number of compressed grid triplets currently waiting to be sent to the client
+		size_t numSentFrames; // Total number of compressed grid triplets sent to the client
+		size_t numDroppedFrames; // Total number of compressed grid triplets dropped because the client fell behind
+		size_t numRekeys; // Number of times the client was re-synchronized with an intra-frame compressed grid triplet after dropping frames
+		};
+	
 	private:
+	typedef Misc::Autopointer<IO::VariableMemoryFile> CompressedFramePtr; // Type for reference-counted buffers holding a compressed grid triplet
+	
 	struct GridBuffers // Structure representing a triplet of grids
 		{
 		/* Elements: */
@@ -89,14 +139,44 @@ class RemoteServer
 		Comm::TCPPipe clientPipe; // Pipe connected to the remote client
 		Threads::EventDispatcher::ListenerKey listenerKey; // Key with which this client is listening for I/O events
 		ClientStates state; // Client's protocol state
+		EntropyCoder::Type coder; // Entropy coder selected by the client during protocol negotiation
+		bool multicast; // Flag whether the client receives grid triplets from the multicast group after its initial intra-frame compressed grid triplet
+		bool hasPose; // Flag whether the client has sent its position and viewing direction
 		Vrui::Point position; // Client's current position in grid space
 		Vrui::Vector direction; // Client's current viewing direction in grid space
+		std::vector<unsigned int> tileVersions; // Index of the grid triplet whose tiles were most recently sent to the client for each tile, or invalidTileVersion if the client does not have a valid copy of the tile
+		std::vector<unsigned int> frameTileVariants; // Indices of the compressed tile variants to be sent to the client in the current frame
+		Threads::MutexCond queueCond; // Condition variable protecting the send queue and signalling new queued grid triplets
+		std::deque<CompressedFramePtr> sendQueue; // Queue of compressed grid triplets waiting to be sent to the client
+		bool runSenderThread; // Flag to shut down the sender thread
+		bool sendFailed; // Flag whether the sender thread stopped due to a communication error
+		std::string sendError; // Description of the communication error that stopped the sender thread
+		ClientStats stats; // The client's send queue statistics
+		Threads::Thread senderThread; // Thread writing queued grid triplets to the client's pipe
+		
+		/* Private methods: */
+		void* senderThreadMethod(void); // Method writing queued grid triplets to the client's pipe in the background
 		
 		/* Constructors and destructors: */
 		Client(RemoteServer* sServer); // Connects a remote client from a pending incoming connection on the listening socket
+		~Client(void); // Shuts down the sender thread and disconnects the client
+		};
+	
+	struct TileVariant // Structure describing one compressed version of a tile of the current grid triplet
+		{
+		/* Elements: */
+		public:
+		unsigned int tile; // Index of the tile
+		unsigned int baseAge; // Age of the grid triplet relative to which the tile is inter-frame compressed, or 0 for intra-frame compression
+		EntropyCoder::Type coder; // Entropy coder with which the tile is compressed
 		};
 	
 	/* Elements: */
+	static const size_t maxQueuedFrames=3; // Maximum number of grid triplets queued for a client before the client is re-synchronized
+	static const unsigned int invalidTileVersion=~0U; // Tile version indicating that a client does not have a valid copy of a tile
+	static const size_t codebookWindowSize=size_t(1U)<<22; // Number of encoded symbols from which each new adaptive codebook is trained
+	static const size_t multicastHeaderSize=16; // Size of the header of each multicast datagram
+	static const size_t multicastFragmentSize=1400; // Maximum number of bytes of a grid message carried by each multicast datagram
 	Sandbox* sandbox; // Pointer to the sandbox object
 	GLsizei gridSize[2]; // Width and height of the water table's cell-centered quantity grid
 	GLfloat cellSize[2]; // Width and height of each water table cell
@@ -108,16 +188,48 @@ class RemoteServer
 	std::vector<Client*> clients; // List of currently connected clients
 	unsigned int numClients; // Number of connected clients in streaming state
 	Threads::TripleBuffer<std::vector<Vrui::ONTransform> > clientPositions; // Triple buffer of lists of positions/orientations of connected clients
+	Threads::TripleBuffer<std::vector<ClientStats> > clientStats; // Triple buffer of lists of send queue statistics of connected clients
 	double requestInterval; // Time interval between requests for new property grids
 	double nextRequestTime; // Application time at which to request the next property grids
 	Threads::TripleBuffer<GridBuffers> grids; // Triple buffer of arrays to receive property grids
-	Pixel* bathymetry[2]; // Pair of buffers for the current quantized bathymetry grid
-	Pixel* waterLevel[2]; // Pair of buffers for the current quantized water grid
-	Pixel* snowHeight[2]; // Pair of buffers for the current quantized snow grid
-	int currentGrid; // Index of the current buffer pair
+	unsigned int numTileRows,numTileColumns; // Number of rows and columns of tiles into which each grid is split for independent compression
+	unsigned int numTiles; // Total number of tiles per grid
+	unsigned int farTileInterval; // Number of grid triplets between updates of tiles outside a client's region of interest
+	GLfloat nearRadius; // Horizontal distance from a client's position in grid space inside which tiles are in the client's region of interest
+	GLfloat cosViewAngle; // Cosine of the angle around a client's viewing direction inside which tiles are in the client's region of interest
+	unsigned int numGridSlots; // Number of most recent quantized grid triplets kept for inter-frame compression of tiles against older versions
+	std::vector<Pixel*> bathymetry; // Ring buffer of the most recent quantized bathymetry grids
+	std::vector<Pixel*> waterLevel; // Ring buffer of the most recent quantized water grids
+	std::vector<Pixel*> snowHeight; // Ring buffer of the most recent quantized snow grids
+	unsigned int frameIndex; // Index of the current quantized grid triplet; the triplet is stored in ring buffer slot frameIndex%numGridSlots
+	JobPool compressionPool; // Pool of threads compressing grid tiles in parallel
+	std::vector<TileVariant> tileVariants; // List of tile variants requested by clients in the current frame
+	std::vector<unsigned int> tileVariantIndices; // Indices of already requested tile variants in the current frame by tile, base age, and entropy coder
+	std::vector<CompressedFramePtr> tileBuffers; // Buffers receiving the compressed tile variants of all three grids
+	AdaptiveCodebook* codebooks[2]; // Adaptive Huffman codebooks for intra-frame (index 0) and inter-frame (index 1) compression
+	CompressedFramePtr codebookMessages[2]; // Messages defining the current intra- and inter-frame codebooks, or null while using the default codebooks
+	size_t histogramSize; // Number of histogram bins reserved for each compressed tile
+	std::vector<size_t> tileHistograms; // Histograms of symbols encoded by each tile compressor during the most recent compression
+	MulticastSocket* multicastSocket; // Socket sending grid messages to the multicast group, or null if all clients are served via TCP
+	unsigned int numMulticastClients; // Number of connected clients in streaming state receiving grid triplets from the multicast group
+	unsigned int keyframeInterval; // Maximum number of multicast grid messages from one intra-frame compressed keyframe to the next
+	unsigned int numMessagesSinceKeyframe; // Number of multicast grid messages sent since and including the most recent keyframe
+	bool forceKeyframe; // Flag to send the next multicast grid message as a keyframe after a client joined or lost messages
+	Misc::UInt32 multicastSequenceNumber; // Sequence number of the most recently sent multicast grid message
+	std::vector<unsigned int> multicastTileVariants; // Indices of the tile variants to be sent to the multicast group in the current frame
+	std::vector<char> datagram; // Buffer to assemble multicast datagrams
 	
 	/* Private methods: */
 	void quantizeGrid(GLsizei width,GLsizei height,const GLfloat* source,Pixel* dest); // Quantizes a float-valued source grid into a Pixel-valued destination grid
+	void getTileRect(unsigned int tile,GLsizei width,GLsizei height,GLsizei rect[4]) const; // Returns the pixel range (x0, y0, x1, y1) of the given tile in a grid of the given size
+	bool isTileInRegionOfInterest(const Client* client,unsigned int tile) const; // Returns true if the given tile is near the given client's position or inside its view
+	unsigned int requestTileVariant(unsigned int tile,unsigned int baseAge,EntropyCoder::Type coder); // Requests a compressed variant of the given tile of the current grid triplet and returns its index in the current frame's list of tile variants
+	static void compressTile(unsigned int jobIndex,void* userData); // Compresses one grid of one requested tile variant
+	void compressTileVariants(void); // Compresses all tile variants requested in the current frame
+	CompressedFramePtr createGridMessage(const std::vector<unsigned int>& frameTileVariants,EntropyCoder::Type coder) const; // Returns a message containing the given tile variants of the current frame, compressed with the given entropy coder
+	void sendMulticastMessage(IO::VariableMemoryFile& message,bool keyframe); // Splits the given grid message into datagrams and sends them to the multicast group
+	CompressedFramePtr createCodebookMessage(unsigned int kind) const; // Returns a message defining the current adaptive codebook of the given kind
+	void updateCodebooks(void); // Trains new adaptive codebooks and sends changed codebooks to all connected Huffman-coded clients in streaming state
 	void disconnectClient(Client* client,bool removeListener); // Disconnects the given client after a communications error
 	static void newConnectionCallback(Threads::EventDispatcher::IOEvent& event); // Callback called when a connection attempt is made at the listening socket
 	static void clientMessageCallback(Threads::EventDispatcher::IOEvent& event); // Callback called when a message is received from a connected client
@@ -126,11 +238,15 @@ class RemoteServer
 	
 	/* Constructors and destructors: */
 	public:
-	RemoteServer(Sandbox* sSandbox,int listenPortId,double sRequestInterval); // Creates a remote server for the given water table and listening port ID
+	RemoteServer(Sandbox* sSandbox,const Parameters& parameters); // Creates a remote server for the given sandbox with the given configuration
 	~RemoteServer(void);
 	
 	/* Methods: */
 	void frame(double applicationTime); // Called from the AR Sandbox's frame method
+	const std::vector<ClientStats>& getClientStats(void) const // Returns the send queue statistics of all connected clients in streaming state, as of the most recent call to frame()
+		{
+		return clientStats.getLockedValue();
+		}
 	void glRenderAction(const PTransform& projection,const OGTransform& modelview,GLContextData& contextData) const; // Renders the remote server's current state
 	};
 
@@ -100,6 +100,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "DEM.h"
 #include "DepthImageRenderer.h"
 #include "WaterTable2.h"
+#include "WaterStepScheduler.h"
+#include "CpuWaterTable2.h"
 #include "SurfaceRenderer.h"
 #include "WaterRenderer.h"
 #include "PropertyGridCreator.h"
@@ -343,6 +345,49 @@ void Sandbox::addWater(GLContextData& contextData) const
 		}
 	}
 
+void Sandbox::updateCpuWaterTable(bool lagged,GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	/* Pass the current simulation parameters, and the property grid if it changed: */
+	cpuWaterTable->setParameters(*waterTable);
+	if(propertyGridCreator->readPropertyGrid(cpuPropertyGridVersion,contextData,textureTracker,&cpuPropertyGrid[0]))
+		cpuWaterTable->setPropertyGrid(&cpuPropertyGrid[0]);
+	
+	/* Pass the rates of all water sources and sinks rendered by hands and water tools, which also activate tiles in sparse mode: */
+	if(waterTable->readWaterSourceTexture(contextData,textureTracker,lagged,&cpuWaterSource[0]))
+		cpuWaterTable->setWaterSource(&cpuWaterSource[0]);
+	else
+		cpuWaterTable->setWaterSource(0);
+	}
+
+GLfloat Sandbox::checkCpuWaterTable(GLfloat maxStepSize,GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	/* Copy the water table's complete current state into the CPU water flow simulation: */
+	waterTable->readBathymetryTexture(contextData,textureTracker,&cpuBathymetry[0]);
+	cpuWaterTable->updateBathymetry(&cpuBathymetry[0]);
+	waterTable->readQuantityTexture(contextData,textureTracker,GL_RGB,&cpuQuantity[0]);
+	waterTable->readSnowTexture(contextData,textureTracker,&cpuSnow[0]);
+	cpuWaterTable->setQuantityGrid(&cpuQuantity[0],&cpuSnow[0]);
+	updateCpuWaterTable(false,contextData,textureTracker);
+	
+	/* Run one step with a self-determined step size on the CPU, and force the same step size on the GPU: */
+	cpuWaterTable->setMaxStepSize(maxStepSize);
+	GLfloat stepSize=cpuWaterTable->runSimulationStep(false);
+	waterTable->setMaxStepSize(stepSize);
+	waterTable->runSimulationStep(true,contextData,textureTracker);
+	
+	/* Find the largest differences between the resulting conserved quantities: */
+	waterTable->readQuantityTexture(contextData,textureTracker,GL_RGB,&cpuQuantity[0]);
+	std::vector<GLfloat> cpuResult(cpuQuantity.size());
+	cpuWaterTable->readQuantityGrid(&cpuResult[0]);
+	GLfloat maxDiffs[3]={0.0f,0.0f,0.0f};
+	for(size_t index=0;index<cpuResult.size();index+=3)
+		for(int i=0;i<3;++i)
+			maxDiffs[i]=Math::max(maxDiffs[i],Math::abs(cpuResult[index+i]-cpuQuantity[index+i]));
+	std::cout<<"Sandbox: CPU/GPU water step of "<<stepSize<<" s: largest differences "<<maxDiffs[0]<<" in water level, "<<maxDiffs[1]<<", "<<maxDiffs[2]<<" in discharge"<<std::endl;
+	
+	return stepSize;
+	}
+
 void Sandbox::pauseUpdatesCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData)
 	{
 	pauseUpdates=cbData->set;
@@ -381,6 +426,8 @@ void Sandbox::waterSpeedSliderCallback(GLMotif::TextFieldSlider::ValueChangedCal
 void Sandbox::waterMaxStepsSliderCallback(GLMotif::TextFieldSlider::ValueChangedCallbackData* cbData)
 	{
 	waterMaxSteps=int(Math::floor(cbData->value+0.5));
+	if(waterStepScheduler!=0)
+		waterStepScheduler->setMaxSteps(waterMaxSteps);
 	}
 
 void Sandbox::waterModeRadioBoxCallback(GLMotif::RadioBox::ValueChangedCallbackData* cbData)
@@ -520,6 +567,19 @@ GLMotif::PopupWindow* Sandbox::createWaterControlDialog(void)
 	
 	frameRateMargin->manageChild();
 	
+	new GLMotif::Label("WaterDeficitLabel",waterControlDialog,"Water Deficit %");
+	
+	GLMotif::Margin* waterDeficitMargin=new GLMotif::Margin("WaterDeficitMargin",waterControlDialog,false);
+	waterDeficitMargin->setAlignment(GLMotif::Alignment::LEFT);
+	
+	waterDeficitTextField=new GLMotif::TextField("WaterDeficitTextField",waterDeficitMargin,8);
+	waterDeficitTextField->setFieldWidth(7);
+	waterDeficitTextField->setPrecision(2);
+	waterDeficitTextField->setFloatFormat(GLMotif::TextField::FIXED);
+	waterDeficitTextField->setValue(0.0);
+	
+	waterDeficitMargin->manageChild();
+	
 	new GLMotif::Label("WaterModeLabel",waterControlDialog,"Water Mode");
 	
 	GLMotif::Margin* waterModeMargin=new GLMotif::Margin("WaterModeMargin",waterControlDialog,false);
@@ -660,6 +720,29 @@ void printUsage(void)
 	std::cout<<"  -wmts <water table minimum time step>"<<std::endl;
 	std::cout<<"     Sets the minimum time step for water simulation to ensure frame rates at"<<std::endl;
 	std::cout<<"     the cost of water simulation accuracy in high-flow regions"<<std::endl;
+	std::cout<<"  -wlag"<<std::endl;
+	std::cout<<"     Plans water simulation steps with step sizes read back asynchronously from"<<std::endl;
+	std::cout<<"     earlier steps instead of waiting for the GPU to calculate each step size"<<std::endl;
+	std::cout<<"  -wsync"<<std::endl;
+	std::cout<<"     Waits for the GPU to calculate each water simulation step size (default)"<<std::endl;
+	std::cout<<"  -wtfr <water target frame rate>"<<std::endl;
+	std::cout<<"     Limits the number of water simulation steps per frame to hold the given"<<std::endl;
+	std::cout<<"     frame rate, based on the measured GPU or CPU time of simulation steps"<<std::endl;
+	std::cout<<"     Default: 0 (disabled)"<<std::endl;
+	std::cout<<"  -cpuWater <num threads>"<<std::endl;
+	std::cout<<"     Runs the water simulation on the given number of CPU threads instead of"<<std::endl;
+	std::cout<<"     the GPU; the simulation sees sand surface changes and water added by"<<std::endl;
+	std::cout<<"     hands and water tools one frame late"<<std::endl;
+	std::cout<<"     Default: 0 (run on the GPU)"<<std::endl;
+	std::cout<<"  -cpuWaterCheck <check interval>"<<std::endl;
+	std::cout<<"     Runs the water simulation on the GPU, and every given number of seconds"<<std::endl;
+	std::cout<<"     runs one simulation step from the same state on the CPU threads selected"<<std::endl;
+	std::cout<<"     by -cpuWater as well, and prints the largest differences"<<std::endl;
+	std::cout<<"     Default: 0 (disabled)"<<std::endl;
+	std::cout<<"  -cpuWaterDryDepth <dry depth>"<<std::endl;
+	std::cout<<"     Only simulates CPU water table tiles containing water deeper than the given"<<std::endl;
+	std::cout<<"     depth in cm, and their neighbours; a negative depth simulates all tiles"<<std::endl;
+	std::cout<<"     Default: 0.01"<<std::endl;
 	std::cout<<"  -sl <snow line>"<<std::endl;
 	std::cout<<"     Sets the elevation above which precipitation lands as snow instead of rain"<<std::endl;
 	std::cout<<"     in cm"<<std::endl;
@@ -730,7 +813,8 @@ Sandbox::Sandbox(int& argc,char**& argv)
 	 camera(0),pixelDepthCorrection(0),
 	 frameFilter(0),pauseUpdates(false),
 	 depthImageRenderer(0),
-	 waterTable(0),
+	 waterTable(0),waterStepScheduler(0),
+	 cpuWaterTable(0),cpuWaterCheckInterval(0.0),cpuWaterTableTime(0.0),cpuPropertyGridVersion(0),
 	 propertyGridCreator(0),
 	 handExtractor(0),addWaterFunction(0),addWaterFunctionRegistered(false),
 	 sun(0),
@@ -738,7 +822,7 @@ Sandbox::Sandbox(int& argc,char**& argv)
 	 mainMenu(0),pauseUpdatesToggle(0),
 	 gridPropertyFileHelper(Vrui::getWidgetManager(),"GridProperty.tiff",".tif;.tiff"),
 	 waterControlDialog(0),
-	 snowLineSlider(0),waterSpeedSlider(0),waterMaxStepsSlider(0),frameRateTextField(0),waterAttenuationSlider(0),
+	 snowLineSlider(0),waterSpeedSlider(0),waterMaxStepsSlider(0),frameRateTextField(0),waterDeficitTextField(0),waterAttenuationSlider(0),
 	 controlPipeFd(-1)
 	{
 	/* Read the sandbox's default configuration parameters: */
@@ -763,11 +847,34 @@ Sandbox::Sandbox(int& argc,char**& argv)
 	unsigned int minNumSamples=cfg.retrieveValue<unsigned int>("./minNumSamples",10);
 	unsigned int maxVariance=cfg.retrieveValue<unsigned int>("./maxVariance",2);
 	float hysteresis=cfg.retrieveValue<float>("./hysteresis",0.1f);
+	std::string temporalFilterName=cfg.retrieveString("./temporalFilter","boxcar");
+	std::string frameFilterKernel=cfg.retrieveString("./frameFilterKernel","auto");
+	unsigned int numFilterThreads=cfg.retrieveValue<unsigned int>("./numFilterThreads",1);
+	RemoteServer::Parameters remoteServerParameters;
+	remoteServerParameters.requestInterval=1.0/cfg.retrieveValue<double>("./remoteServerFrameRate",1.0/remoteServerParameters.requestInterval);
+	remoteServerParameters.numCompressionThreads=cfg.retrieveValue<unsigned int>("./numRemoteServerThreads",remoteServerParameters.numCompressionThreads);
+	remoteServerParameters.numTileRows=cfg.retrieveValue<unsigned int>("./numRemoteServerStripes",remoteServerParameters.numTileRows);
+	remoteServerParameters.numTileColumns=cfg.retrieveValue<unsigned int>("./numRemoteServerTileColumns",remoteServerParameters.numTileColumns);
+	remoteServerParameters.farTileInterval=cfg.retrieveValue<unsigned int>("./remoteServerFarTileInterval",remoteServerParameters.farTileInterval);
+	remoteServerParameters.nearRadius=cfg.retrieveValue<GLfloat>("./remoteServerNearRadius",remoteServerParameters.nearRadius);
+	remoteServerParameters.viewAngle=cfg.retrieveValue<GLfloat>("./remoteServerViewAngle",remoteServerParameters.viewAngle);
+	remoteServerParameters.multicastGroup=cfg.retrieveString("./remoteServerMulticastGroup",remoteServerParameters.multicastGroup);
+	remoteServerParameters.multicastPortId=cfg.retrieveValue<int>("./remoteServerMulticastPort",remoteServerParameters.multicastPortId);
+	remoteServerParameters.multicastInterface=cfg.retrieveString("./remoteServerMulticastInterface",remoteServerParameters.multicastInterface);
+	remoteServerParameters.multicastTtl=cfg.retrieveValue<int>("./remoteServerMulticastTtl",remoteServerParameters.multicastTtl);
+	remoteServerParameters.keyframeInterval=cfg.retrieveValue<unsigned int>("./remoteServerKeyframeInterval",remoteServerParameters.keyframeInterval);
 	Size wtSize(640,480);
 	cfg.updateValue("./waterTableSize",wtSize);
 	waterSpeed=cfg.retrieveValue<double>("./waterSpeed",1.0);
 	waterMaxSteps=cfg.retrieveValue<unsigned int>("./waterMaxSteps",30U);
 	float waterMinTimeStep=cfg.retrieveValue<float>("./waterMinTimeStep",0.0f);
+	bool waterLaggedStepSize=cfg.retrieveValue<bool>("./waterLaggedStepSize",false);
+	double waterTargetFrameRate=cfg.retrieveValue<double>("./waterTargetFrameRate",0.0);
+	double waterGpuBudget=cfg.retrieveValue<double>("./waterGpuBudget",0.5);
+	float waterMaxMinTimeStep=cfg.retrieveValue<float>("./waterMaxMinTimeStep",0.0f);
+	unsigned int numCpuWaterThreads=cfg.retrieveValue<unsigned int>("./numCpuWaterThreads",0);
+	float cpuWaterDryDepth=cfg.retrieveValue<float>("./cpuWaterDryDepth",0.01f);
+	cpuWaterCheckInterval=cfg.retrieveValue<double>("./cpuWaterCheckInterval",0.0);
 	Math::Interval<double> rainElevationRange=cfg.retrieveValue<Math::Interval<double> >("./rainElevationRange",Math::Interval<double>(-1000.0,1000.0));
 	rainStrength=cfg.retrieveValue<GLfloat>("./rainStrength",0.25f);
 	double snowLine=cfg.retrieveValue<double>("./snowLine",1000.0);
@@ -781,7 +888,6 @@ Sandbox::Sandbox(int& argc,char**& argv)
 	const char* frameFilePrefix=0;
 	const char* kinectServerName=0;
 	bool useRemoteServer=false;
-	int remoteServerPortId=26000;
 	bool engineering=false;
 	int windowIndex=0;
 	renderSettings.push_back(RenderSettings());
@@ -797,7 +903,7 @@ Sandbox::Sandbox(int& argc,char**& argv)
 				if(i+1<argc&&argv[i+1][0]>='0'&&argv[i+1][0]<='9')
 					{
 					++i;
-					remoteServerPortId=atoi(argv[i]);
+					remoteServerParameters.listenPortId=atoi(argv[i]);
 					}
 				
 				useRemoteServer=true;
@@ -889,6 +995,34 @@ Sandbox::Sandbox(int& argc,char**& argv)
 				{
 				engineering=true;
 				}
+			else if(strcasecmp(argv[i]+1,"wlag")==0)
+				{
+				waterLaggedStepSize=true;
+				}
+			else if(strcasecmp(argv[i]+1,"wsync")==0)
+				{
+				waterLaggedStepSize=false;
+				}
+			else if(strcasecmp(argv[i]+1,"wtfr")==0)
+				{
+				++i;
+				waterTargetFrameRate=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"cpuWater")==0)
+				{
+				++i;
+				numCpuWaterThreads=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"cpuWaterDryDepth")==0)
+				{
+				++i;
+				cpuWaterDryDepth=float(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"cpuWaterCheck")==0)
+				{
+				++i;
+				cpuWaterCheckInterval=atof(argv[i]);
+				}
 			else if(strcasecmp(argv[i]+1,"rer")==0)
 				{
 				++i;
@@ -1134,15 +1268,16 @@ Sandbox::Sandbox(int& argc,char**& argv)
 	demDistScale*=sf;
 	
 	/* Create the frame filter object: */
-	frameFilter=new FrameFilter(frameSize,numAveragingSlots,pixelDepthCorrection,cameraIps.depthProjection,basePlane);
+	frameFilter=new FrameFilter(frameSize,numAveragingSlots,pixelDepthCorrection,cameraIps.depthProjection,basePlane,numFilterThreads,temporalFilterName.c_str());
 	frameFilter->setValidElevationInterval(cameraIps.depthProjection,basePlane,elevationRange.getMin(),elevationRange.getMax());
 	frameFilter->setStableParameters(minNumSamples,maxVariance);
 	frameFilter->setHysteresis(hysteresis);
 	frameFilter->setSpatialFilter(true);
+	frameFilter->setTemporalKernel(frameFilterKernel.c_str());
 	frameFilter->setOutputFrameFunction(Misc::createFunctionCall(this,&Sandbox::receiveFilteredFrame));
 	
 	/* Create the depth image renderer: */
-	depthImageRenderer=new DepthImageRenderer(frameSize);
+	depthImageRenderer=new DepthImageRenderer(frameSize,FrameFilter::tileSize);
 	depthImageRenderer->setIntrinsics(cameraIps);
 	depthImageRenderer->setBasePlane(basePlane);
 	
@@ -1178,11 +1313,37 @@ Sandbox::Sandbox(int& argc,char**& argv)
 			waterTable->setMode(WaterTable2::Engineering);
 		if(waterMinTimeStep>0.0f)
 			waterTable->forceMinStepSize(waterMinTimeStep);
+		waterTable->setLaggedStepSize(waterLaggedStepSize);
 		snowLine=Math::clamp(snowLine,elevationRange.getMin(),elevationRange.getMax());
 		waterTable->setSnowLine(snowLine);
 		waterTable->setSnowMelt(snowMelt);
 		waterTable->setWaterDeposit(evaporationRate);
 		
+		/* Create the water simulation step scheduler: */
+		waterStepScheduler=new WaterStepScheduler(waterMaxSteps,waterMinTimeStep);
+		waterStepScheduler->setTargetFrameRate(waterTargetFrameRate,waterGpuBudget);
+		waterStepScheduler->setMaxMinStepSize(waterMaxMinTimeStep);
+		
+		if(numCpuWaterThreads>0||cpuWaterCheckInterval>0.0)
+			{
+			/* Create a CPU water flow simulation with the water table's grid layout and parameters, whose state is displayed through the water table or compared against it: */
+			if(numCpuWaterThreads==0)
+				numCpuWaterThreads=1;
+			cpuWaterTable=new CpuWaterTable2(*waterTable,numCpuWaterThreads);
+			if(cpuWaterDryDepth>=0.0f)
+				cpuWaterTable->setSparse(true,cpuWaterDryDepth);
+			size_t numCells=size_t(wtSize[1])*size_t(wtSize[0]);
+			cpuBathymetry.resize(size_t(wtSize[1]-1)*size_t(wtSize[0]-1));
+			cpuPropertyGrid.resize(numCells*2);
+			cpuWaterSource.resize(numCells);
+			cpuSnow.resize(numCells);
+			cpuQuantity.resize(numCells*3);
+			if(cpuWaterCheckInterval>0.0)
+				std::cout<<"Sandbox: Comparing GPU water simulation against "<<numCpuWaterThreads<<" CPU thread(s) using "<<cpuWaterTable->getFluxKernelName()<<" flux kernel every "<<cpuWaterCheckInterval<<" s"<<std::endl;
+			else
+				std::cout<<"Sandbox: Running water simulation on "<<numCpuWaterThreads<<" CPU thread(s) using "<<cpuWaterTable->getFluxKernelName()<<" flux kernel"<<std::endl;
+			}
+		
 		/* Create the property grid creator object: */
 		propertyGridCreator=new PropertyGridCreator(*waterTable,*camera);
 		waterTable->setPropertyGridCreator(propertyGridCreator);
@@ -1207,11 +1368,11 @@ Sandbox::Sandbox(int& argc,char**& argv)
 		/* Create a remote server: */
 		try
 			{
-			remoteServer=new RemoteServer(this,remoteServerPortId,1.0/30.0);
+			remoteServer=new RemoteServer(this,remoteServerParameters);
 			}
 		catch(const std::runtime_error& err)
 			{
-			Misc::formattedConsoleError("Sandbox: Unable to create remote server on port %d due to exception %s",remoteServerPortId,err.what());
+			Misc::formattedConsoleError("Sandbox: Unable to create remote server on port %d due to exception %s",remoteServerParameters.listenPortId,err.what());
 			}
 		}
 	
@@ -1295,11 +1456,21 @@ Sandbox::~Sandbox(void)
 	/* Stop streaming color and depth frames: */
 	camera->stopStreaming();
 	delete camera;
+	
+	/* Report depth frames the frame filter could not keep up with: */
+	if(frameFilter->getNumDroppedFrames()!=0)
+		std::cout<<"Sandbox: Frame filter dropped "<<frameFilter->getNumDroppedFrames()<<" of "<<frameFilter->getNumReceivedFrames()<<" depth frames"<<std::endl;
 	delete frameFilter;
 	
+	/* Report simulation time the water simulation could not keep up with: */
+	if(waterStepScheduler!=0&&waterStepScheduler->getStats().totalDeficit>0.0)
+		std::cout<<"Sandbox: Water simulation fell behind by "<<waterStepScheduler->getStats().totalDeficit<<" s of simulation time"<<std::endl;
+	
 	/* Delete helper objects: */
 	delete handExtractor;
 	delete propertyGridCreator;
+	delete waterStepScheduler;
+	delete cpuWaterTable;
 	delete waterTable;
 	delete depthImageRenderer;
 	delete addWaterFunction;
@@ -1380,8 +1551,8 @@ void Sandbox::frame(void)
 	/* Check if the filtered frame has been updated: */
 	if(filteredFrames.lockNewValue())
 		{
-		/* Update the depth image renderer's depth image: */
-		depthImageRenderer->setDepthImage(filteredFrames.getLockedValue());
+		/* Update the changed tiles of the depth image renderer's depth image: */
+		depthImageRenderer->setDepthImage(filteredFrames.getLockedValue(),FrameFilter::getTileStamps(filteredFrames.getLockedValue()));
 		}
 	
 	if(handExtractor!=0)
@@ -1479,6 +1650,8 @@ void Sandbox::frame(void)
 					if(tokens.size()==2)
 						{
 						waterMaxSteps=atoi(tokens[1].c_str());
+						if(waterStepScheduler!=0)
+							waterStepScheduler->setMaxSteps(waterMaxSteps);
 						if(waterMaxStepsSlider!=0)
 							waterMaxStepsSlider->setValue(waterMaxSteps);
 						}
@@ -1718,6 +1891,12 @@ void Sandbox::frame(void)
 		frameRateTextField->setValue(1.0/Vrui::getCurrentFrameTime());
 		}
 	
+	if(waterDeficitTextField!=0&&waterStepScheduler!=0&&Vrui::getWidgetManager()->isVisible(waterControlDialog))
+		{
+		/* Update the water simulation deficit display: */
+		waterDeficitTextField->setValue(waterStepScheduler->getStats().deficit*100.0);
+		}
+	
 	if(pauseUpdates)
 		Vrui::scheduleUpdate(Vrui::getApplicationTime()+1.0/30.0);
 	}
@@ -1757,41 +1936,40 @@ void Sandbox::display(GLContextData& contextData) const
 		/* Update the water simulation property grid: */
 		propertyGridCreator->updatePropertyGrid(contextData,textureTracker);
 		
-		/* Run the water flow simulation's main pass: */
-		GLfloat totalTimeStep=GLfloat(Vrui::getFrameTime()*waterSpeed);
-		
-		// DEBUGGING
-		// std::cout<<totalTimeStep<<',';
-		// Realtime::TimePointMonotonic timer;
-		
-		unsigned int numSteps=0;
-		while(numSteps<waterMaxSteps&&totalTimeStep>1.0e-8f)
+		if(cpuWaterTable!=0&&cpuWaterCheckInterval==0.0)
 			{
-			/* Run with a self-determined time step to maintain stability: */
-			waterTable->setMaxStepSize(totalTimeStep);
-			GLfloat timeStep=waterTable->runSimulationStep(false,contextData,textureTracker);
-			totalTimeStep-=timeStep;
-			++numSteps;
+			/* Advance the CPU water flow simulation once per frame, on the bathymetry of the first OpenGL context to get here: */
+			if(cpuWaterTableTime!=Vrui::getApplicationTime())
+				{
+				/* Pass bathymetry changes into the CPU water flow simulation one frame late, without waiting for the GPU: */
+				if(waterTable->readBathymetryTextureAsync(contextData,textureTracker,&cpuBathymetry[0]))
+					cpuWaterTable->updateBathymetry(&cpuBathymetry[0]);
+				updateCpuWaterTable(true,contextData,textureTracker);
+				
+				/* Run the CPU water flow simulation inside the step scheduler's budget; the scheduler reports any simulation time deficit: */
+				waterStepScheduler->runSimulationSteps(*cpuWaterTable,GLfloat(Vrui::getFrameTime()*waterSpeed));
+				
+				cpuWaterTable->readQuantityGrid(&cpuQuantity[0]);
+				cpuWaterTableTime=Vrui::getApplicationTime();
+				}
+			
+			/* Upload the CPU water flow simulation's state into the water table for rendering and grid read-back: */
+			waterTable->writeQuantityTexture(&cpuQuantity[0],contextData,textureTracker);
+			waterTable->writeSnowTexture(cpuWaterTable->getSnowGrid(),contextData,textureTracker);
 			}
-		
-		// DEBUGGING
-		// double elapsed(timer.setAndDiff());
-		// std::cout<<numSteps<<','<<elapsed<<','<<elapsed/numSteps<<std::endl;
-		
-		#if 0
-		if(totalTimeStep>1.0e-8f)
+		else
 			{
-			std::cout<<'.'<<std::flush;
-			/* Force the final step to avoid simulation slow-down: */
-			waterTable->setMaxStepSize(totalTimeStep);
-			GLfloat timeStep=waterTable->runSimulationStep(true,contextData,textureTracker);
-			totalTimeStep-=timeStep;
-			++numSteps;
+			GLfloat totalTimeStep=GLfloat(Vrui::getFrameTime()*waterSpeed);
+			if(cpuWaterTable!=0&&Vrui::getApplicationTime()>=cpuWaterTableTime+cpuWaterCheckInterval)
+				{
+				/* Run the first simulation step of this frame on the GPU and the CPU, and compare the results: */
+				totalTimeStep-=checkCpuWaterTable(totalTimeStep,contextData,textureTracker);
+				cpuWaterTableTime=Vrui::getApplicationTime();
+				}
+			
+			/* Run the water flow simulation's main pass inside the step scheduler's budget; the scheduler reports any simulation time deficit: */
+			waterStepScheduler->runSimulationSteps(*waterTable,totalTimeStep,contextData,textureTracker);
 			}
-		#elif 1
-		if(totalTimeStep>1.0e-8f)
-			std::cout<<"Ran out of time by "<<totalTimeStep<<std::endl;
-		#endif
 		
 		/* Check if the grid request is active and wants water level data: */
 		if(request.isActive()&&request.waterLevelBuffer!=0)
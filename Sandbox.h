@@ -53,6 +53,7 @@ template <class ParameterParam>
 class FunctionCall;
 }
 class GLContextData;
+class TextureTracker;
 namespace GLMotif {
 class PopupMenu;
 class PopupWindow;
@@ -70,6 +71,8 @@ class ElevationColorMap;
 class DEM;
 class SurfaceRenderer;
 class WaterTable2;
+class WaterStepScheduler;
+class CpuWaterTable2;
 class PropertyGridCreator;
 class HandExtractor;
 typedef Misc::FunctionCall<GLContextData&> AddWaterFunction;
@@ -218,6 +221,16 @@ class Sandbox:public Vrui::Application,public GLObject
 	WaterTable2* waterTable; // Water flow simulation object
 	double waterSpeed; // Relative speed of water flow simulation
 	unsigned int waterMaxSteps; // Maximum number of water simulation steps per frame
+	WaterStepScheduler* waterStepScheduler; // Object scheduling water simulation steps inside a GPU time budget
+	CpuWaterTable2* cpuWaterTable; // Water flow simulation object running on the CPU in place of the water table's GPU simulation, or null
+	double cpuWaterCheckInterval; // Interval in seconds between comparisons of single GPU and CPU water simulation steps run from the same state, or zero to run the CPU water flow simulation in place of the GPU one
+	mutable double cpuWaterTableTime; // Application time up to which the CPU water flow simulation has been advanced, or of its most recent comparison with the GPU
+	mutable unsigned int cpuPropertyGridVersion; // Version of the property grid most recently passed to the CPU water flow simulation
+	mutable std::vector<GLfloat> cpuBathymetry; // Buffer to read the water table's bathymetry grid into the CPU water flow simulation
+	mutable std::vector<GLfloat> cpuPropertyGrid; // Buffer to read the property grid into the CPU water flow simulation
+	mutable std::vector<GLfloat> cpuWaterSource; // Buffer to read the rates of water sources and sinks into the CPU water flow simulation
+	mutable std::vector<GLfloat> cpuSnow; // Buffer to read the water table's snow height grid into the CPU water flow simulation
+	mutable std::vector<GLfloat> cpuQuantity; // Buffer to exchange conserved quantity grids between the CPU water flow simulation and the water table
 	GLfloat rainStrength; // Amount of water deposited by rain tools and objects on each water simulation step
 	PropertyGridCreator* propertyGridCreator; // Object to create water simulation property grids from color camera images
 	HandExtractor* handExtractor; // Object to detect splayed hands above the sand surface to make rain
@@ -236,6 +249,7 @@ class Sandbox:public Vrui::Application,public GLObject
 	GLMotif::TextFieldSlider* waterSpeedSlider;
 	GLMotif::TextFieldSlider* waterMaxStepsSlider;
 	GLMotif::TextField* frameRateTextField;
+	GLMotif::TextField* waterDeficitTextField;
 	GLMotif::RadioBox* waterModeRadioBox;
 	GLMotif::TextFieldSlider* waterAttenuationSlider;
 	GLMotif::TextFieldSlider* waterRoughnessSlider;
@@ -248,6 +262,8 @@ class Sandbox:public Vrui::Application,public GLObject
 	void toggleDEM(DEM* dem); // Sets or toggles the currently active DEM
 	void renderRainDisk(const Point& center,Scalar radius,GLfloat strength) const; // Renders a disk of rain, during rain processing
 	void addWater(GLContextData& contextData) const; // Function to render geometry that adds water to the water table
+	void updateCpuWaterTable(bool lagged,GLContextData& contextData,TextureTracker& textureTracker) const; // Passes the water table's simulation parameters, the property grid, and the rates of all water sources and sinks into the CPU water flow simulation, with the latter one frame behind if flag is true
+	GLfloat checkCpuWaterTable(GLfloat maxStepSize,GLContextData& contextData,TextureTracker& textureTracker) const; // Runs one water simulation step from the water table's current state on the CPU and the same step on the GPU, and prints the largest differences; returns the step size
 	void pauseUpdatesCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData);
 	void loadGridPropertyFileCallback(GLMotif::FileSelectionDialog::OKCallbackData* cbData);
 	void saveGridPropertyFileCallback(GLMotif::FileSelectionDialog::OKCallbackData* cbData);
@@ -22,12 +22,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "SandboxClient.h"
 
+#include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <stdexcept>
 #include <iostream>
 #include <Misc/SizedTypes.h>
+#include <Misc/Endianness.h>
 #include <Misc/PrintInteger.h>
 #include <Misc/FunctionCalls.h>
+#include <Misc/StdError.h>
 #include <Comm/TCPPipe.h>
 #include <Math/Math.h>
 #include <Geometry/LinearUnit.h>
@@ -57,8 +61,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "TextureTracker.h"
 #include "ElevationColorMap.h"
+#include "MulticastSocket.h"
 #include "IntraFrameDecompressor.h"
 #include "InterFrameDecompressor.h"
+#include "AdaptiveCodebook.h"
+#include "RemoteProtocol.h"
 
 /****************************************************
 Static eleemnts of class SandboxClient::TeleportTool:
@@ -358,6 +365,7 @@ SandboxClient::DataItem::DataItem(void)
 	 depthTexture(0),depthTextureSize(0,0),
 	 bathymetryVertexBuffer(0),bathymetryIndexBuffer(0),
 	 waterVertexBuffer(0),waterIndexBuffer(0),
+	 bathymetryLodVersion(0),waterLodVersion(0),
 	 lightStateVersion(0)
 	{
 	/* Initialize required OpenGL extensions: */
@@ -425,19 +433,19 @@ void SandboxClient::unquantizeGrids(void)
 	
 	/* Un-quantize the bathymetry grid: */
 	GLfloat* bEnd=gb.bathymetry+(bathymetrySize[1]*bathymetrySize[0]);
-	Pixel* qbPtr=bathymetry[currentGrid];
+	Pixel* qbPtr=bathymetry;
 	for(GLfloat* bPtr=gb.bathymetry;bPtr!=bEnd;++bPtr,++qbPtr)
 		*bPtr=GLfloat(*qbPtr)*eScale+eOffset;
 	
 	/* Un-quantize the water level grid: */
 	GLfloat* wlEnd=gb.waterLevel+(gridSize[1]*gridSize[0]);
-	Pixel* qwlPtr=waterLevel[currentGrid];
+	Pixel* qwlPtr=waterLevel;
 	for(GLfloat* wlPtr=gb.waterLevel;wlPtr!=wlEnd;++wlPtr,++qwlPtr)
 		*wlPtr=GLfloat(*qwlPtr)*eScale+eOffset;
 	
 	/* Un-quantize the snow height grid: */
 	GLfloat* shEnd=gb.snowHeight+(gridSize[1]*gridSize[0]);
-	Pixel* qshPtr=snowHeight[currentGrid];
+	Pixel* qshPtr=snowHeight;
 	for(GLfloat* shPtr=gb.snowHeight;shPtr!=shEnd;++shPtr,++qshPtr)
 		*shPtr=GLfloat(*qshPtr)*eScale+eOffset;
 	
@@ -445,17 +453,182 @@ void SandboxClient::unquantizeGrids(void)
 	grids.postNewValue();
 	}
 
-void SandboxClient::receiveGridsInter(void)
+void SandboxClient::getTileRect(unsigned int tile,unsigned int width,unsigned int height,unsigned int rect[4]) const
 	{
-	int newGrid=1-currentGrid;
-	InterFrameDecompressor decompressor(*pipe);
-	decompressor.decompressFrame(bathymetrySize[0],bathymetrySize[1],bathymetry[currentGrid],bathymetry[newGrid]);
-	decompressor.decompressFrame(gridSize[0],gridSize[1],waterLevel[currentGrid],waterLevel[newGrid]);
-	decompressor.decompressFrame(gridSize[0],gridSize[1],snowHeight[currentGrid],snowHeight[newGrid]);
-	currentGrid=newGrid;
+	/* Calculate the tile's column and row ranges exactly as the server does: */
+	unsigned int column=tile%numTileColumns;
+	unsigned int row=tile/numTileColumns;
+	rect[0]=(unsigned int)((size_t(width)*size_t(column))/size_t(numTileColumns));
+	rect[1]=(unsigned int)((size_t(height)*size_t(row))/size_t(numTileRows));
+	rect[2]=(unsigned int)((size_t(width)*size_t(column+1))/size_t(numTileColumns));
+	rect[3]=(unsigned int)((size_t(height)*size_t(row+1))/size_t(numTileRows));
+	}
+
+size_t SandboxClient::getMaxTileDataSize(unsigned int tile,unsigned int grid) const
+	{
+	/* Calculate the tile's pixel range in the selected grid: */
+	unsigned int rect[4];
+	if(grid==0U)
+		getTileRect(tile,bathymetrySize[0],bathymetrySize[1],rect);
+	else
+		getTileRect(tile,gridSize[0],gridSize[1],rect);
+	
+	return size_t(rect[2]-rect[0])*size_t(rect[3]-rect[1])*maxCompressedPixelSize+maxCompressedTileOverhead;
+	}
+
+void SandboxClient::decompressTile(unsigned int jobIndex,void* userData)
+	{
+	SandboxClient* thisPtr=static_cast<SandboxClient*>(userData);
+	
+	/* Select the tile and the grid to decompress: */
+	TileUpdate& tu=thisPtr->tileUpdates[jobIndex/3U];
+	unsigned int grid=jobIndex%3U;
+	unsigned int width=thisPtr->gridSize[0];
+	unsigned int height=thisPtr->gridSize[1];
+	Pixel* pixels=thisPtr->waterLevel;
+	if(grid==0U)
+		{
+		/* The bathymetry grid is vertex-centered: */
+		width=thisPtr->bathymetrySize[0];
+		height=thisPtr->bathymetrySize[1];
+		pixels=thisPtr->bathymetry;
+		}
+	else if(grid==2U)
+		pixels=thisPtr->snowHeight;
+
+	/* Calculate the tile's pixel range: */
+	unsigned int rect[4];
+	thisPtr->getTileRect(tu.tile,width,height,rect);
+	unsigned int tileWidth=rect[2]-rect[0];
+	unsigned int tileHeight=rect[3]-rect[1];
+	size_t tileSize=size_t(tileWidth)*size_t(tileHeight);
+	Pixel* tilePixels=pixels+(size_t(rect[1])*size_t(width)+size_t(rect[0]));
+	
+	/* Copy the tile's current contents out of the grid for inter-frame decompression: */
+	std::vector<Pixel> tiles(tu.inter?tileSize*2:tileSize);
+	if(tu.inter)
+		{
+		Pixel* gPtr=tilePixels;
+		Pixel* tPtr=&tiles[tileSize];
+		for(unsigned int y=rect[1];y<rect[3];++y,gPtr+=width,tPtr+=tileWidth)
+			memcpy(tPtr,gPtr,size_t(tileWidth)*sizeof(Pixel));
+		}
+	
+	/* Decompress the tile from its buffer using the negotiated entropy coder and the current codebook: */
+	IO::FixedMemoryFile& buffer=*tu.files[grid];
+	if(tu.inter)
+		{
+		InterFrameDecompressor decompressor(buffer,tu.coder,thisPtr->codebookTrees[1]);
+		decompressor.decompressFrame(tileWidth,tileHeight,&tiles[tileSize],&tiles[0]);
+		}
+	else
+		{
+		IntraFrameDecompressor decompressor(buffer,tu.coder,thisPtr->codebookTrees[0]);
+		decompressor.decompressFrame(tileWidth,tileHeight,&tiles[0]);
+		}
+	
+	/* Copy the decompressed tile back into the grid: */
+	Pixel* gPtr=tilePixels;
+	Pixel* tPtr=&tiles[0];
+	for(unsigned int y=rect[1];y<rect[3];++y,gPtr+=width,tPtr+=tileWidth)
+		memcpy(gPtr,tPtr,size_t(tileWidth)*sizeof(Pixel));
+	}
+
+void SandboxClient::receiveCodebook(void)
+	{
+	/* Read the codebook's kind, ID, and number of symbols: */
+	unsigned int kind=pipe->read<Misc::UInt16>();
+	unsigned int id=pipe->read<Misc::UInt16>();
+	unsigned int numSymbols=pipe->read<Misc::UInt32>();
+	if(kind>1U||id==0U||numSymbols<2U||numSymbols>65536U)
+		throw std::runtime_error("SandboxClient: Invalid codebook from remote AR Sandbox");
+	
+	/* Read the codebook's normalized symbol frequencies: */
+	std::vector<Misc::UInt32> frequencies(numSymbols);
+	pipe->read(&frequencies[0],numSymbols);
+	
+	/* Build the codebook's decoding tree exactly as the server built its encoding codebook: */
+	HuffmanBuilder builder;
+	AdaptiveCodebook::initBuilder(builder,numSymbols,&frequencies[0]);
+	HuffmanBuilder::Node* tree=builder.buildDecodingTree();
+	
+	/* Replace the current codebook of the same kind: */
+	delete[] codebookTrees[kind];
+	codebookTrees[kind]=tree;
+	codebookIds[kind]=id;
+	}
+
+void SandboxClient::receiveGrids(IO::File& source,EntropyCoder::Type sourceCoder)
+	{
+	/* Check that the tiles were compressed using the current codebooks, or no codebooks if they were not Huffman-coded: */
+	for(int kind=0;kind<2;++kind)
+		{
+		unsigned int codebookId=source.read<Misc::UInt16>();
+		if(codebookId!=(sourceCoder==EntropyCoder::HUFFMAN?codebookIds[kind]:0U))
+			throw std::runtime_error("SandboxClient: Grids from remote AR Sandbox use an unknown codebook");
+		}
+	
+	/* Read the index, compression method, and compressed grid sizes of each tile: */
+	unsigned int numTileUpdates=source.read<Misc::UInt16>();
+	if(numTileUpdates>numTileRows*numTileColumns)
+		throw std::runtime_error("SandboxClient: Invalid number of grid tiles from remote AR Sandbox");
+	tileUpdates.clear();
+	tileUpdates.resize(numTileUpdates);
+	std::vector<size_t> tileSizes;
+	tileSizes.reserve(numTileUpdates*3U);
+	for(std::vector<TileUpdate>::iterator tuIt=tileUpdates.begin();tuIt!=tileUpdates.end();++tuIt)
+		{
+		tuIt->tile=source.read<Misc::UInt16>();
+		unsigned int method=source.read<Misc::UInt16>();
+		if(tuIt->tile>=numTileRows*numTileColumns||method>1U)
+			throw std::runtime_error("SandboxClient: Invalid grid tile from remote AR Sandbox");
+		tuIt->inter=method==1U;
+		tuIt->coder=sourceCoder;
+		for(int grid=0;grid<3;++grid)
+			{
+			/* Reject compressed sizes that no tile of the negotiated grid size can reach: */
+			size_t tileSize=source.read<Misc::UInt32>();
+			if(tileSize>getMaxTileDataSize(tuIt->tile,grid))
+				throw std::runtime_error("SandboxClient: Invalid grid tile size from remote AR Sandbox");
+			tileSizes.push_back(tileSize);
+			}
+		}
+	
+	/* Read all compressed tiles into memory buffers: */
+	std::vector<size_t>::iterator tsIt=tileSizes.begin();
+	for(std::vector<TileUpdate>::iterator tuIt=tileUpdates.begin();tuIt!=tileUpdates.end();++tuIt)
+		for(int grid=0;grid<3;++grid,++tsIt)
+			{
+			IO::FixedMemoryFile* tileFile=new IO::FixedMemoryFile(*tsIt);
+			tuIt->files[grid]=tileFile;
+			source.readRaw(tileFile->getMemory(),*tsIt);
+			tileFile->setSwapOnRead(source.mustSwapOnRead());
+			}
+	
+	/* Decompress all grids of all tiles in parallel, in place in the quantized grids: */
+	decompressionPool->runJobs(numTileUpdates*3U,&SandboxClient::decompressTile,this);
 	unquantizeGrids();
 	}
 
+bool SandboxClient::receiveMessage(void)
+	{
+	/* Read the message token and handle the message: */
+	unsigned int token=pipe->read<Misc::UInt16>();
+	switch(token)
+		{
+		case 0: // Compressed grid tiles
+			receiveGrids(*pipe,coder);
+			return true;
+		
+		case 2: // Codebook update
+			receiveCodebook();
+			return false;
+		
+		default:
+			throw std::runtime_error("SandboxClient: Invalid message from remote AR Sandbox");
+		}
+	}
+
 SandboxClient::Scalar SandboxClient::intersectLine(const SandboxClient::Point& p0,const SandboxClient::Point& p1) const
 	{
 	/* Convert the points to grid coordinates: */
@@ -603,14 +776,171 @@ void SandboxClient::serverMessageCallback(Threads::EventDispatcher::IOEvent& eve
 	
 	try
 		{
-		/* Read a new set of grids using inter-frame compression: */
-		thisPtr->receiveGridsInter();
+		/* Handle all messages that have already arrived: */
+		bool newGrids=false;
+		do
+			{
+			if(thisPtr->receiveMessage())
+				newGrids=true;
+			}
+		while(thisPtr->pipe->canReadImmediately());
 		
-		/* Wake up the main thread: */
-		Vrui::requestUpdate();
+		/* Wake up the main thread if there is a new set of grids: */
+		if(newGrids)
+			Vrui::requestUpdate();
 		}
 	catch(const std::runtime_error& err)
 		{
+		std::cerr<<"SandboxClient: Disconnecting from remote AR Sandbox due to exception "<<err.what()<<std::endl;
+		
+		/* The TCP pipe is out of sync after a partially read message; stop sending to the server and shut down communication: */
+		{
+		Threads::Mutex::Lock pipeLock(thisPtr->pipeMutex);
+		thisPtr->connected=false;
+		thisPtr->pipe->shutdown(true,true);
+		}
+		thisPtr->dispatcher.stop();
+		}
+	}
+
+void SandboxClient::requestResync(void)
+	{
+	/* Request a keyframe when the grids first go out of sync, and repeat the request if the keyframe does not arrive: */
+	if(multicastSynced||++numMessagesSinceResyncRequest>=resyncRetryInterval)
+		{
+		multicastSynced=false;
+		numMessagesSinceResyncRequest=0;
+		
+		Threads::Mutex::Lock pipeLock(pipeMutex);
+		if(connected)
+			{
+			pipe->write<Misc::UInt16>(1);
+			pipe->flush();
+			}
+		}
+	}
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+template <class ValueParam>
+inline const char* readDatagramValue(const char* source,bool swap,ValueParam& value) // Reads a value from a datagram buffer, swapping its endianness if requested, and returns a pointer behind it
+	{
+	memcpy(&value,source,sizeof(ValueParam));
+	if(swap)
+		Misc::swapEndianness(value);
+	return source+sizeof(ValueParam);
+	}
+
+}
+
+bool SandboxClient::receiveDatagram(size_t datagramSize)
+	{
+	/* Ignore datagrams too short to carry a header: */
+	if(datagramSize<multicastHeaderSize)
+		return false;
+	
+	/* Read the datagram's header using the byte order negotiated on the TCP pipe: */
+	const char* dPtr=&datagram[0];
+	bool swap=pipe->mustSwapOnRead();
+	Misc::UInt32 sequenceNumber,messageSize;
+	Misc::UInt16 fragment,numFragments,flags,reserved;
+	dPtr=readDatagramValue(dPtr,swap,sequenceNumber);
+	dPtr=readDatagramValue(dPtr,swap,messageSize);
+	dPtr=readDatagramValue(dPtr,swap,fragment);
+	dPtr=readDatagramValue(dPtr,swap,numFragments);
+	dPtr=readDatagramValue(dPtr,swap,flags);
+	dPtr=readDatagramValue(dPtr,swap,reserved);
+	
+	/* Ignore malformed datagrams: */
+	size_t fragmentOffset=size_t(fragment)*multicastFragmentSize;
+	if(messageSize>maxGridMessageSize||fragment>=numFragments||fragmentOffset>=messageSize||numFragments!=(messageSize+multicastFragmentSize-1)/multicastFragmentSize||datagramSize-multicastHeaderSize!=Math::min(size_t(messageSize)-fragmentOffset,multicastFragmentSize))
+		return false;
+	
+	if(assemblyMessage!=0&&sequenceNumber!=assemblySequenceNumber)
+		{
+		/* Ignore late fragments of older messages: */
+		if(Misc::SInt32(sequenceNumber-assemblySequenceNumber)<0)
+			return false;
+		
+		/* A newer message started before the current one was complete; the current one is lost: */
+		assemblyMessage=0;
+		requestResync();
+		}
+	
+	if(assemblyMessage==0)
+		{
+		/* Ignore fragments of messages that were already decoded: */
+		if(multicastSynced&&Misc::SInt32(sequenceNumber-lastSequenceNumber)<=0)
+			return false;
+		
+		/* Start assembling a new message: */
+		assemblySequenceNumber=sequenceNumber;
+		assemblyKeyframe=(flags&0x1U)!=0U;
+		assemblyMessage=new IO::FixedMemoryFile(messageSize);
+		assemblyMessage->setSwapOnRead(swap);
+		assemblyFragments.clear();
+		assemblyFragments.resize(numFragments,false);
+		numMissingFragments=numFragments;
+		}
+	else if(assemblyFragments.size()!=numFragments||assemblyFragments[fragment])
+		{
+		/* Ignore inconsistent or duplicate fragments: */
+		return false;
+		}
+	
+	/* Copy the fragment into the message: */
+	memcpy(static_cast<char*>(assemblyMessage->getMemory())+fragmentOffset,dPtr,datagramSize-multicastHeaderSize);
+	assemblyFragments[fragment]=true;
+	if(--numMissingFragments>0)
+		return false;
+	
+	/* The message is complete; decode it if it is a keyframe or directly follows the most recently decoded message: */
+	Misc::Autopointer<IO::FixedMemoryFile> message=assemblyMessage;
+	assemblyMessage=0;
+	if(!assemblyKeyframe&&!(multicastSynced&&sequenceNumber==lastSequenceNumber+1U))
+		{
+		/* A message was lost; drop inter-frame compressed messages until the next keyframe arrives: */
+		requestResync();
+		return false;
+		}
+	if(message->read<Misc::UInt16>()!=0)
+		throw std::runtime_error("SandboxClient: Invalid multicast message from remote AR Sandbox");
+	receiveGrids(*message,EntropyCoder::RANS);
+	multicastSynced=true;
+	lastSequenceNumber=sequenceNumber;
+	
+	return true;
+	}
+
+void SandboxClient::multicastMessageCallback(Threads::EventDispatcher::IOEvent& event)
+	{
+	SandboxClient* thisPtr=static_cast<SandboxClient*>(event.getUserData());
+	
+	try
+		{
+		/* Handle all datagrams that have already arrived: */
+		bool newGrids=false;
+		size_t datagramSize;
+		while((datagramSize=thisPtr->multicastSocket->receive(&thisPtr->datagram[0],thisPtr->datagram.size()))>0)
+			if(thisPtr->receiveDatagram(datagramSize))
+				newGrids=true;
+		
+		/* Wake up the main thread if there is a new set of grids: */
+		if(newGrids)
+			Vrui::requestUpdate();
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"SandboxClient: Dropping multicast message due to exception "<<err.what()<<std::endl;
+		
+		/* Drop inter-frame compressed messages until the next keyframe arrives: */
+		thisPtr->assemblyMessage=0;
+		thisPtr->requestResync();
+		thisPtr->multicastSynced=false;
 		}
 	}
 
@@ -1101,17 +1431,56 @@ void SandboxClient::compileShaders(SandboxClient::DataItem* dataItem,const GLLig
 	dataItem->lightStateVersion=lightTracker.getVersion();
 	}
 
+void SandboxClient::updateIndexBuffers(SandboxClient::DataItem* dataItem) const
+	{
+	if(dataItem->bathymetryLodVersion!=bathymetryLod->getVersion())
+		{
+		/* Upload the bathymetry's current triangulation into the index buffer: */
+		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,dataItem->bathymetryIndexBuffer);
+		glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB,bathymetryLod->getNumIndices()*sizeof(GLuint),bathymetryLod->getIndices(),GL_DYNAMIC_DRAW_ARB);
+		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,0);
+		dataItem->bathymetryLodVersion=bathymetryLod->getVersion();
+		}
+	
+	if(dataItem->waterLodVersion!=waterLod->getVersion())
+		{
+		/* Upload the water surface's current triangulation into the index buffer: */
+		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,dataItem->waterIndexBuffer);
+		glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB,waterLod->getNumIndices()*sizeof(GLuint),waterLod->getIndices(),GL_DYNAMIC_DRAW_ARB);
+		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,0);
+		dataItem->waterLodVersion=waterLod->getVersion();
+		}
+	}
+
 SandboxClient::SandboxClient(int& argc,char**& argv)
 	:Vrui::Application(argc,argv),
 	 pipe(0),
 	 elevationColorMap(0),
+	 bathymetry(0),waterLevel(0),snowHeight(0),
+	 decompressionPool(0),numTileRows(0),numTileColumns(0),maxGridMessageSize(0),
+	 coder(EntropyCoder::RANS),
+	 connected(true),
+	 multicastSocket(0),multicastFragmentSize(0),
+	 assemblySequenceNumber(0),assemblyKeyframe(false),numMissingFragments(0),
+	 multicastSynced(false),lastSequenceNumber(0),numMessagesSinceResyncRequest(0),
 	 gridVersion(0),
+	 lodDistance(64),bathymetryLod(0),waterLod(0),
 	 sun(0),underwater(false),undersnow(false)
 	{
+	/* Start with the default codebooks: */
+	for(int i=0;i<2;++i)
+		{
+		codebookIds[i]=0;
+		codebookTrees[i]=0;
+		}
+	
 	/* Parse the command line: */
 	const char* serverName=0;
 	int serverPortId=26000;
 	const char* elevationColorMapName=0;
+	unsigned int numDecompressionThreads=3;
+	bool useMulticast=false;
+	const char* multicastInterface=0;
 	for(int argi=1;argi<argc;++argi)
 		{
 		if(argv[argi][0]=='-')
@@ -1126,6 +1495,52 @@ SandboxClient::SandboxClient(int& argc,char**& argv)
 				else
 					std::cerr<<"SandboxClient: Missing height map name"<<std::endl;
 				}
+			else if(strcasecmp(argv[argi]+1,"nt")==0)
+				{
+				if(argi+1<argc&&argv[argi+1][0]!='-')
+					{
+					++argi;
+					numDecompressionThreads=atoi(argv[argi]);
+					}
+				else
+					std::cerr<<"SandboxClient: Missing number of decompression threads"<<std::endl;
+				}
+			else if(strcasecmp(argv[argi]+1,"ec")==0)
+				{
+				if(argi+1<argc&&argv[argi+1][0]!='-')
+					{
+					++argi;
+					EntropyCoder::Type requestedCoder=EntropyCoder::findType(argv[argi]);
+					if(requestedCoder!=EntropyCoder::NUM_TYPES)
+						coder=requestedCoder;
+					else
+						std::cerr<<"SandboxClient: Ignoring unknown entropy coder "<<argv[argi]<<std::endl;
+					}
+				else
+					std::cerr<<"SandboxClient: Missing entropy coder name"<<std::endl;
+				}
+			else if(strcasecmp(argv[argi]+1,"multicast")==0)
+				useMulticast=true;
+			else if(strcasecmp(argv[argi]+1,"mcif")==0)
+				{
+				if(argi+1<argc&&argv[argi+1][0]!='-')
+					{
+					++argi;
+					multicastInterface=argv[argi];
+					}
+				else
+					std::cerr<<"SandboxClient: Missing multicast interface address"<<std::endl;
+				}
+			else if(strcasecmp(argv[argi]+1,"lod")==0)
+				{
+				if(argi+1<argc&&argv[argi+1][0]!='-')
+					{
+					++argi;
+					lodDistance=Math::max(Scalar(atof(argv[argi])),Scalar(0));
+					}
+				else
+					std::cerr<<"SandboxClient: Missing level-of-detail distance"<<std::endl;
+				}
 			else
 				std::cerr<<"SandboxClient: Ignoring command line option "<<argv[argi]<<std::endl;
 			}
@@ -1154,20 +1569,29 @@ SandboxClient::SandboxClient(int& argc,char**& argv)
 	pipe=new Comm::TCPPipe(serverName,serverPortId);
 	pipe->ref();
 	
-	/* Send an endianness token to the server: */
-	pipe->write<Misc::UInt32>(0x12345678U);
-	pipe->flush();
-	
 	/* Receive an endianness token from the server: */
 	Misc::UInt32 token=pipe->read<Misc::UInt32>();
-	if(token==0x78563412U)
+	if(token==RemoteProtocol::swappedToken)
 		pipe->setSwapOnRead(true);
-	else if(token!=0x12345678U)
+	else if(token!=RemoteProtocol::token)
 		{
 		delete pipe;
+		if(token==RemoteProtocol::legacyToken||token==RemoteProtocol::swappedLegacyToken)
+			throw Misc::makeStdErr(0,"SandboxClient: Remote AR Sandbox uses an unversioned protocol; this client requires protocol version %u",(unsigned int)(RemoteProtocol::version));
 		throw std::runtime_error("SandboxClient: Invalid response from remote AR Sandbox");
 		}
 	
+	/* Receive the server's protocol version and reject servers that lay out messages differently: */
+	unsigned int version=pipe->read<Misc::UInt32>();
+	if(version!=RemoteProtocol::version)
+		{
+		delete pipe;
+		throw Misc::makeStdErr(0,"SandboxClient: Remote AR Sandbox uses protocol version %u; this client requires protocol version %u",version,(unsigned int)(RemoteProtocol::version));
+		}
+	
+	/* Create the pool of grid decompression threads: */
+	decompressionPool=new JobPool(numDecompressionThreads);
+	
 	try
 		{
 		/* Receive the remote AR Sandbox's water table grid size, cell size, and elevation range: */
@@ -1175,42 +1599,107 @@ SandboxClient::SandboxClient(int& argc,char**& argv)
 			{
 			gridSize[i]=pipe->read<Misc::UInt32>();
 			cellSize[i]=pipe->read<Misc::Float32>();
+			if(gridSize[i]<2U||gridSize[i]>65536U)
+				throw std::runtime_error("SandboxClient: Invalid grid size from remote AR Sandbox");
 			bathymetrySize[i]=gridSize[i]-1;
 			}
 		for(int i=0;i<2;++i)
 			elevationRange[i]=pipe->read<Misc::Float32>();
 		
-		/* Initialize the quantized grid buffers: */
-		for(int i=0;i<2;++i)
+		/* Receive the set of entropy coders supported by the remote AR Sandbox and fall back to Huffman coding if the requested one is not among them: */
+		unsigned int supportedCoders=pipe->read<Misc::UInt16>();
+		if((supportedCoders&(1U<<coder))==0U)
+			{
+			std::cerr<<"SandboxClient: Remote AR Sandbox does not support entropy coder "<<EntropyCoder::getName(coder)<<"; falling back to "<<EntropyCoder::getName(EntropyCoder::HUFFMAN)<<std::endl;
+			coder=EntropyCoder::HUFFMAN;
+			}
+		
+		/* Receive the layout of tiles into which the remote AR Sandbox splits each grid: */
+		numTileRows=pipe->read<Misc::UInt16>();
+		numTileColumns=pipe->read<Misc::UInt16>();
+		if(numTileRows<1U||numTileRows>bathymetrySize[1]||numTileColumns<1U||numTileColumns>bathymetrySize[0])
+			throw std::runtime_error("SandboxClient: Invalid grid tile layout from remote AR Sandbox");
+		
+		/* Calculate the size of a grid message updating all tiles, including the message token, codebook IDs, and tile headers: */
+		unsigned int numTiles=numTileRows*numTileColumns;
+		maxGridMessageSize=4*sizeof(Misc::UInt16);
+		for(unsigned int tile=0;tile<numTiles;++tile)
 			{
-			bathymetry[i]=new Pixel[bathymetrySize[1]*bathymetrySize[0]];
-			waterLevel[i]=new Pixel[gridSize[1]*gridSize[0]];
-			snowHeight[i]=new Pixel[gridSize[1]*gridSize[0]];
+			maxGridMessageSize+=2*sizeof(Misc::UInt16);
+			for(unsigned int grid=0;grid<3;++grid)
+				maxGridMessageSize+=sizeof(Misc::UInt32)+getMaxTileDataSize(tile,grid);
 			}
-		currentGrid=0;
+		
+		/* Receive the remote AR Sandbox's multicast group, and join it if requested: */
+		Misc::UInt32 multicastGroup=pipe->read<Misc::UInt32>();
+		int multicastPortId=pipe->read<Misc::UInt16>();
+		multicastFragmentSize=pipe->read<Misc::UInt16>();
+		if(useMulticast)
+			{
+			if(multicastGroup==0U)
+				std::cerr<<"SandboxClient: Remote AR Sandbox does not support multicast; receiving grids via TCP"<<std::endl;
+			else if(multicastFragmentSize<1U)
+				throw std::runtime_error("SandboxClient: Invalid multicast fragment size from remote AR Sandbox");
+			else
+				{
+				try
+					{
+					multicastSocket=new MulticastSocket(multicastGroup,multicastPortId,multicastInterface,true);
+					datagram.resize(multicastHeaderSize+multicastFragmentSize);
+					}
+				catch(const std::runtime_error& err)
+					{
+					std::cerr<<"SandboxClient: Unable to join multicast group due to exception "<<err.what()<<"; receiving grids via TCP"<<std::endl;
+					}
+				}
+			}
+		
+		/* Send an endianness token, the protocol version, the selected entropy coder, and whether to receive grids from the multicast group to the server: */
+		pipe->write<Misc::UInt32>(RemoteProtocol::token);
+		pipe->write<Misc::UInt32>(RemoteProtocol::version);
+		pipe->write<Misc::UInt16>(coder);
+		pipe->write<Misc::UInt16>(multicastSocket!=0?1:0);
+		pipe->flush();
+		
+		/* Initialize the quantized grid buffers: */
+		bathymetry=new Pixel[bathymetrySize[1]*bathymetrySize[0]];
+		waterLevel=new Pixel[gridSize[1]*gridSize[0]];
+		snowHeight=new Pixel[gridSize[1]*gridSize[0]];
 		
 		/* Initialize the grid buffers: */
 		for(int i=0;i<3;++i)
 			grids.getBuffer(i).init(gridSize);
 		
-		/* Read the initial set of grids using intra-frame decompression: */
-		IntraFrameDecompressor decompressor(*pipe);
-		decompressor.decompressFrame(bathymetrySize[0],bathymetrySize[1],bathymetry[currentGrid]);
-		decompressor.decompressFrame(gridSize[0],gridSize[1],waterLevel[currentGrid]);
-		decompressor.decompressFrame(gridSize[0],gridSize[1],snowHeight[currentGrid]);
-		unquantizeGrids();
+		/* Create the level-of-detail triangulations of the bathymetry and water grids: */
+		bathymetryLod=new GridLod(bathymetrySize,32,4);
+		waterLod=new GridLod(gridSize,32,4);
+		
+		/* Read messages until the initial set of grids, which the server always sends as intra-frame compressed tiles covering all grids, has arrived: */
+		while(!receiveMessage())
+			;
 		}
 	catch(const std::runtime_error& err)
 		{
 		/* Disconnect from the remote AR Sandbox: */
 		delete pipe;
+		delete multicastSocket;
+		delete decompressionPool;
+		for(int i=0;i<2;++i)
+			delete[] codebookTrees[i];
+		delete[] bathymetry;
+		delete[] waterLevel;
+		delete[] snowHeight;
+		delete bathymetryLod;
+		delete waterLod;
 		
 		/* Re-throw the exception: */
 		throw;
 		}
 	
-	/* Start listening on the TCP pipe: */
+	/* Start listening on the TCP pipe and the multicast socket: */
 	dispatcher.addIOEventListener(pipe->getFd(),Threads::EventDispatcher::Read,serverMessageCallback,this);
+	if(multicastSocket!=0)
+		dispatcher.addIOEventListener(multicastSocket->getFd(),Threads::EventDispatcher::Read,multicastMessageCallback,this);
 	communicationThread.start(this,&SandboxClient::communicationThreadMethod);
 	
 	/* Set the linear unit to scale the AR Sandbox correctly: */
@@ -1237,15 +1726,18 @@ SandboxClient::~SandboxClient(void)
 	dispatcher.stop();
 	communicationThread.join();
 	delete pipe;
+	delete multicastSocket;
+	delete decompressionPool;
+	for(int i=0;i<2;++i)
+		delete[] codebookTrees[i];
 	
 	/* Release allocated resources: */
 	delete elevationColorMap;
-	for(int i=0;i<2;++i)
-		{
-		delete[] bathymetry[i];
-		delete[] waterLevel[i];
-		delete[] snowHeight[i];
-		}
+	delete[] bathymetry;
+	delete[] waterLevel;
+	delete[] snowHeight;
+	delete bathymetryLod;
+	delete waterLod;
 	}
 
 void SandboxClient::toolCreationCallback(Vrui::ToolManager::ToolCreationCallbackData* cbData)
@@ -1317,13 +1809,27 @@ void SandboxClient::frame(void)
 			}
 		}
 	
+	/* Update the level-of-detail triangulations based on the head's position in the vertex grids and its height above the middle of the elevation range: */
+	Scalar viewPos[3];
+	viewPos[2]=(head[2]-Math::mid(Scalar(elevationRange[0]),Scalar(elevationRange[1])))/Math::mid(Scalar(cellSize[0]),Scalar(cellSize[1]));
+	for(int i=0;i<2;++i)
+		viewPos[i]=head[i]/Scalar(cellSize[i])-Scalar(0.5);
+	bathymetryLod->update(viewPos,lodDistance);
+	for(int i=0;i<2;++i)
+		viewPos[i]=head[i]/Scalar(cellSize[i]);
+	waterLod->update(viewPos,lodDistance);
+	
 	/* Send the current head position to the remote AR Sandbox: */
 	Geometry::Point<Misc::Float32,3> fhead(head);
-	pipe->write<Misc::UInt16>(0);
-	pipe->write(fhead.getComponents(),3);
-	Geometry::Vector<Misc::Float32,3> fview(Vrui::getViewDirection());
-	pipe->write(fview.getComponents(),3);
-	pipe->flush();
+	Threads::Mutex::Lock pipeLock(pipeMutex);
+	if(connected)
+		{
+		pipe->write<Misc::UInt16>(0);
+		pipe->write(fhead.getComponents(),3);
+		Geometry::Vector<Misc::Float32,3> fview(Vrui::getViewDirection());
+		pipe->write(fview.getComponents(),3);
+		pipe->flush();
+		}
 	}
 
 void SandboxClient::display(GLContextData& contextData) const
@@ -1358,6 +1864,9 @@ void SandboxClient::display(GLContextData& contextData) const
 	/* Create a texture tracker: */
 	TextureTracker textureTracker;
 	
+	/* Update the level-of-detail triangulations if necessary: */
+	updateIndexBuffers(dataItem);
+	
 	/* Update the shader programs if necessary: */
 	const GLLightTracker& lightTracker=*contextData.getLightTracker();
 	if(dataItem->lightStateVersion!=lightTracker.getVersion())
@@ -1406,9 +1915,7 @@ void SandboxClient::display(GLContextData& contextData) const
 	{
 	GLVertexArrayParts::enable(Vertex::getPartsMask());
 	glVertexPointer(static_cast<const Vertex*>(0));
-	GLuint* indexPtr=0;
-	for(unsigned int y=1;y<bathymetrySize[1];++y,indexPtr+=bathymetrySize[0]*2)
-		glDrawElements(GL_QUAD_STRIP,bathymetrySize[0]*2,GL_UNSIGNED_INT,indexPtr);
+	glDrawElements(GL_TRIANGLES,GLsizei(bathymetryLod->getNumIndices()),GL_UNSIGNED_INT,0);
 	GLVertexArrayParts::disable(Vertex::getPartsMask());
 	}
 	
@@ -1440,9 +1947,7 @@ void SandboxClient::display(GLContextData& contextData) const
 	{
 	GLVertexArrayParts::enable(Vertex::getPartsMask());
 	glVertexPointer(static_cast<const Vertex*>(0));
-	GLuint* indexPtr=0;
-	for(unsigned int y=1;y<gridSize[1];++y,indexPtr+=gridSize[0]*2)
-		glDrawElements(GL_QUAD_STRIP,gridSize[0]*2,GL_UNSIGNED_INT,indexPtr);
+	glDrawElements(GL_TRIANGLES,GLsizei(waterLod->getNumIndices()),GL_UNSIGNED_INT,0);
 	GLVertexArrayParts::disable(Vertex::getPartsMask());
 	}
 	glCullFace(GL_BACK);
@@ -1474,9 +1979,7 @@ void SandboxClient::display(GLContextData& contextData) const
 	{
 	GLVertexArrayParts::enable(Vertex::getPartsMask());
 	glVertexPointer(static_cast<const Vertex*>(0));
-	GLuint* indexPtr=0;
-	for(unsigned int y=1;y<gridSize[1];++y,indexPtr+=gridSize[0]*2)
-		glDrawElements(GL_QUAD_STRIP,gridSize[0]*2,GL_UNSIGNED_INT,indexPtr);
+	glDrawElements(GL_TRIANGLES,GLsizei(waterLod->getNumIndices()),GL_UNSIGNED_INT,0);
 	GLVertexArrayParts::disable(Vertex::getPartsMask());
 	}
 	
@@ -1584,19 +2087,6 @@ void SandboxClient::initContext(GLContextData& contextData) const
 			}
 	glUnmapBufferARB(GL_ARRAY_BUFFER_ARB);
 	glBindBufferARB(GL_ARRAY_BUFFER_ARB,0);
-	
-	/* Upload the bathymetry's triangle indices into the index buffer: */
-	glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,dataItem->bathymetryIndexBuffer);
-	glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB,(bathymetrySize[1]-1)*bathymetrySize[0]*2*sizeof(GLuint),0,GL_STATIC_DRAW_ARB);
-	GLuint* iPtr=static_cast<GLuint*>(glMapBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,GL_WRITE_ONLY_ARB));
-	for(unsigned int y=1;y<bathymetrySize[1];++y)
-		for(unsigned int x=0;x<bathymetrySize[0];++x,iPtr+=2)
-			{
-			iPtr[0]=GLuint(y*bathymetrySize[0]+x);
-			iPtr[1]=GLuint((y-1)*bathymetrySize[0]+x);
-			}
-	glUnmapBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB);
-	glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,0);
 	}
 	
 	/* Upload the grid of water surface template vertices into the vertex buffer: */
@@ -1613,19 +2103,6 @@ void SandboxClient::initContext(GLContextData& contextData) const
 			}
 	glUnmapBufferARB(GL_ARRAY_BUFFER_ARB);
 	glBindBufferARB(GL_ARRAY_BUFFER_ARB,0);
-	
-	/* Upload the water surface's triangle indices into the index buffer: */
-	glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,dataItem->waterIndexBuffer);
-	glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB,(gridSize[1]-1)*gridSize[0]*2*sizeof(GLuint),0,GL_STATIC_DRAW_ARB);
-	GLuint* iPtr=static_cast<GLuint*>(glMapBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,GL_WRITE_ONLY_ARB));
-	for(unsigned int y=1;y<gridSize[1];++y)
-		for(unsigned int x=0;x<gridSize[0];++x,iPtr+=2)
-			{
-			iPtr[0]=GLuint(y*gridSize[0]+x);
-			iPtr[1]=GLuint((y-1)*gridSize[0]+x);
-			}
-	glUnmapBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB);
-	glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,0);
 	}
 	
 	/* Create the initial bathymetry and water surface shader programs: */
@@ -1645,6 +2122,9 @@ void SandboxClient::glRenderActionTransparent(GLContextData& contextData) const
 	/* Create a texture tracker: */
 	TextureTracker textureTracker;
 	
+	/* Update the level-of-detail triangulations if necessary: */
+	updateIndexBuffers(dataItem);
+	
 	/* Go to navigational space: */
 	Vrui::goToNavigationalSpace(contextData);
 	
@@ -1707,9 +2187,7 @@ void SandboxClient::glRenderActionTransparent(GLContextData& contextData) const
 	{
 	GLVertexArrayParts::enable(Vertex::getPartsMask());
 	glVertexPointer(static_cast<const Vertex*>(0));
-	GLuint* indexPtr=0;
-	for(unsigned int y=1;y<gridSize[1];++y,indexPtr+=gridSize[0]*2)
-		glDrawElements(GL_QUAD_STRIP,gridSize[0]*2,GL_UNSIGNED_INT,indexPtr);
+	glDrawElements(GL_TRIANGLES,GLsizei(waterLod->getNumIndices()),GL_UNSIGNED_INT,0);
 	GLVertexArrayParts::disable(Vertex::getPartsMask());
 	}
 	glDisable(GL_DEPTH_CLAMP);
@@ -1732,9 +2210,7 @@ void SandboxClient::glRenderActionTransparent(GLContextData& contextData) const
 	{
 	GLVertexArrayParts::enable(Vertex::getPartsMask());
 	glVertexPointer(static_cast<const Vertex*>(0));
-	GLuint* indexPtr=0;
-	for(unsigned int y=1;y<gridSize[1];++y,indexPtr+=gridSize[0]*2)
-		glDrawElements(GL_QUAD_STRIP,gridSize[0]*2,GL_UNSIGNED_INT,indexPtr);
+	glDrawElements(GL_TRIANGLES,GLsizei(waterLod->getNumIndices()),GL_UNSIGNED_INT,0);
 	GLVertexArrayParts::disable(Vertex::getPartsMask());
 	}
 	glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
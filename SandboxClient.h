@@ -23,7 +23,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #ifndef SANDBOXCLIENT_INCLUDED
 #define SANDBOXCLIENT_INCLUDED
 
+#include <vector>
+#include <Misc/Autopointer.h>
+#include <Misc/SizedTypes.h>
+#include <IO/FixedMemoryFile.h>
 #include <Threads/Thread.h>
+#include <Threads/Mutex.h>
 #include <Threads/TripleBuffer.h>
 #include <Threads/EventDispatcher.h>
 #include <Geometry/Point.h>
@@ -43,6 +48,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "Types.h"
 #include "Pixel.h"
 #include "Shader.h"
+#include "JobPool.h"
+#include "HuffmanBuilder.h"
+#include "EntropyCoder.h"
+#include "GridLod.h"
 
 /* Forward declarations: */
 namespace Comm {
@@ -53,6 +62,7 @@ namespace Vrui {
 class Lightsource;
 }
 class ElevationColorMap;
+class MulticastSocket;
 
 class SandboxClient:public Vrui::Application,public GLObject,public Vrui::TransparentObject
 	{
@@ -91,6 +101,16 @@ class SandboxClient:public Vrui::Application,public GLObject,public Vrui::Transp
 			}
 		};
 	
+	struct TileUpdate // Structure describing a compressed tile of a grid triplet received from the server
+		{
+		/* Elements: */
+		public:
+		unsigned int tile; // Index of the tile
+		bool inter; // Flag whether the tile is inter-frame compressed relative to the current contents of the tile
+		EntropyCoder::Type coder; // Entropy coder with which the tile is compressed
+		Misc::Autopointer<IO::FixedMemoryFile> files[3]; // Buffers holding the compressed tile of the bathymetry, water level, and snow height grids
+		};
+	
 	class TeleportTool;
 	typedef Vrui::GenericToolFactory<TeleportTool> TeleportToolFactory;
 	
@@ -146,6 +166,8 @@ class SandboxClient:public Vrui::Application,public GLObject,public Vrui::Transp
 		GLuint bathymetryIndexBuffer; // ID of index buffer object holding bathymetry's triangles
 		GLuint waterVertexBuffer; // ID of vertex buffer object holding water surface's template vertices
 		GLuint waterIndexBuffer; // ID of index buffer object holding water surface's triangles
+		unsigned int bathymetryLodVersion; // Version number of the bathymetry's level-of-detail triangulation stored in the index buffer
+		unsigned int waterLodVersion; // Version number of the water surface's level-of-detail triangulation stored in the index buffer
 		Shader bathymetryShader; // Shader to render the bathymetry
 		Shader opaqueWaterShader; // Shader to render the water surface's back side during the opaque rendering pass
 		Shader transparentWaterShader; // Shader to render the water surface's front side during the transparent rendering pass
@@ -158,32 +180,67 @@ class SandboxClient:public Vrui::Application,public GLObject,public Vrui::Transp
 		};
 	
 	/* Elements: */
+	static const size_t multicastHeaderSize=16; // Size of the header of each multicast datagram
+	static const unsigned int resyncRetryInterval=16; // Number of dropped multicast grid messages after which a re-synchronization request is repeated
+	static const size_t maxCompressedPixelSize=16; // Upper limit on the number of bytes per pixel a compressed grid tile can occupy, including its share of the tile's entropy coding model
+	static const size_t maxCompressedTileOverhead=64; // Upper limit on the number of bytes of a compressed grid tile's fixed-size header and trailer
 	Comm::TCPPipe* pipe; // TCP pipe connected to the remote AR Sandbox
 	Size gridSize; // Width and height of the water table's cell-centered quantity grid
 	GLfloat cellSize[2]; // Width and height of each water table cell
 	Size bathymetrySize; // Width and height of the water table's vertex-centered bathymetry grid
 	GLfloat elevationRange[2]; // Minimum and maximum valid elevations
 	ElevationColorMap* elevationColorMap; // The elevation color map
-	Threads::EventDispatcher dispatcher; // Dispatcher for events on the TCP pipe
+	Threads::EventDispatcher dispatcher; // Dispatcher for events on the TCP pipe and the multicast socket
 	Threads::Thread communicationThread; // Thread to handle communication with the remote AR Sandbox in the background
-	Pixel* bathymetry[2]; // Pair of buffers holding quantized bathymetry grids received from the server
-	Pixel* waterLevel[2]; // Pair of buffers holding quantized water level grids received from the server
-	Pixel* snowHeight[2]; // Pair of buffers holding quantized snow height grids received from the server
-	int currentGrid; // Index of the current grid pair
+	Pixel* bathymetry; // Buffer holding the quantized bathymetry grid assembled from tiles received from the server
+	Pixel* waterLevel; // Buffer holding the quantized water level grid assembled from tiles received from the server
+	Pixel* snowHeight; // Buffer holding the quantized snow height grid assembled from tiles received from the server
+	JobPool* decompressionPool; // Pool of threads decompressing grid tiles in parallel
+	unsigned int numTileRows,numTileColumns; // Number of rows and columns of tiles into which the server splits each grid
+	size_t maxGridMessageSize; // Upper limit on the size of a grid message for the negotiated grid size and tile layout
+	std::vector<TileUpdate> tileUpdates; // List of compressed tiles of the most recent message
+	EntropyCoder::Type coder; // Entropy coder negotiated with the server
+	unsigned int codebookIds[2]; // IDs of the current intra- and inter-frame codebooks received from the server, or zero for the default codebooks
+	HuffmanBuilder::Node* codebookTrees[2]; // Decoding trees of the current intra- and inter-frame codebooks, or null for the default codebooks
+	Threads::Mutex pipeMutex; // Mutex serializing messages sent to the server from the main and communication threads
+	bool connected; // Flag whether the TCP pipe is still in sync with the server; protected by the pipe mutex
+	MulticastSocket* multicastSocket; // Socket receiving grid messages from the server's multicast group, or null if grid messages arrive via the TCP pipe
+	size_t multicastFragmentSize; // Maximum number of bytes of a grid message carried by each multicast datagram
+	std::vector<char> datagram; // Buffer receiving multicast datagrams
+	Misc::UInt32 assemblySequenceNumber; // Sequence number of the multicast grid message currently being assembled
+	bool assemblyKeyframe; // Flag whether the multicast grid message currently being assembled is a keyframe
+	Misc::Autopointer<IO::FixedMemoryFile> assemblyMessage; // Buffer assembling the current multicast grid message from its fragments, or null
+	std::vector<bool> assemblyFragments; // Flags for each fragment of the current multicast grid message whether it has been received
+	size_t numMissingFragments; // Number of fragments of the current multicast grid message that have not been received yet
+	bool multicastSynced; // Flag whether the quantized grids match the most recently decoded multicast grid message
+	Misc::UInt32 lastSequenceNumber; // Sequence number of the most recently decoded multicast grid message
+	unsigned int numMessagesSinceResyncRequest; // Number of multicast grid messages dropped since the most recent re-synchronization request
 	Threads::TripleBuffer<GridBuffers> grids; // Triple buffer of bathymetry and water level grids
 	unsigned int gridVersion; // Version number of currently locked grids
+	Scalar lodDistance; // Distance from the main viewer's head in grid cells up to which grids are rendered at full resolution, or zero to disable level of detail
+	GridLod* bathymetryLod; // Level-of-detail triangulation of the bathymetry grid
+	GridLod* waterLod; // Level-of-detail triangulation of the water level and snow height grids
 	Vrui::Lightsource* sun; // Light source representing the sun
 	bool underwater; // Flag if the main viewer's head is currently under water
 	bool undersnow; // Flag if the main viewer's head is currently under snow
 	
 	/* Private methods: */
 	void unquantizeGrids(void); // Un-quantizes the current bathymetry and water level grids received from the remote AR Sandbox
-	void receiveGridsInter(void); // Receives a set of bathymetry and water level grids from the server using inter-frame compression
+	void getTileRect(unsigned int tile,unsigned int width,unsigned int height,unsigned int rect[4]) const; // Returns the pixel range (x0, y0, x1, y1) of the given tile in a grid of the given size
+	size_t getMaxTileDataSize(unsigned int tile,unsigned int grid) const; // Returns the upper limit on the compressed size of the given grid of the given tile
+	static void decompressTile(unsigned int jobIndex,void* userData); // Decompresses one grid of one tile of the most recent message
+	void receiveCodebook(void); // Receives a new intra- or inter-frame codebook from the server
+	void receiveGrids(IO::File& source,EntropyCoder::Type sourceCoder); // Receives a set of updated tiles of the bathymetry, water level, and snow height grids compressed with the given entropy coder from the given source
+	bool receiveMessage(void); // Receives a message from the server; returns true if the message contained a new set of grids
 	Scalar intersectLine(const Point& p0,const Point& p1) const; // Returns the intersection parameter of a line segment with the bathymetry; returns 1.0 if there is no intersection
 	static void serverMessageCallback(Threads::EventDispatcher::IOEvent& event); // Callback called when a message arrives from the remote AR Sandbox
+	void requestResync(void); // Requests a keyframe from the server after losing a multicast grid message
+	bool receiveDatagram(size_t datagramSize); // Adds a received multicast datagram to the current multicast grid message; returns true if the datagram completed a new set of grids
+	static void multicastMessageCallback(Threads::EventDispatcher::IOEvent& event); // Callback called when datagrams arrive from the server's multicast group
 	void* communicationThreadMethod(void); // Method handling communication with the remote AR Sandbox in the background
 	void alignSurfaceFrame(Vrui::SurfaceNavigationTool::AlignmentData& alignmentData); // Aligns the surface frame of a surface navigation tool with the bathymetry surface
 	void compileShaders(DataItem* dataItem,const GLLightTracker& lightTracker) const; // Compiles the bathymetry and water surface shader programs based on current lighting state
+	void updateIndexBuffers(DataItem* dataItem) const; // Uploads the current level-of-detail triangulations of the bathymetry and water surface into the index buffers if they changed
 	
 	/* Constructors and destructors: */
 	public:
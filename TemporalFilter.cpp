@@ -0,0 +1,64 @@
+/***********************************************************************
+TemporalFilter - Abstract base class for per-pixel temporal filters
+used by the depth frame filter to remove noise and detect unstable
+pixels.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "TemporalFilter.h"
+
+#include <string.h>
+#include <Misc/StdError.h>
+
+#include "BoxcarTemporalFilter.h"
+#include "EMATemporalFilter.h"
+#include "KalmanTemporalFilter.h"
+
+/*******************************
+Methods of class TemporalFilter:
+*******************************/
+
+TemporalFilter* TemporalFilter::create(const char* filterName,const Size& sSize,unsigned int numAveragingSlots)
+	{
+	if(strcasecmp(filterName,"boxcar")==0)
+		return new BoxcarTemporalFilter(sSize,numAveragingSlots);
+	else if(strcasecmp(filterName,"ema")==0)
+		return new EMATemporalFilter(sSize,numAveragingSlots);
+	else if(strcasecmp(filterName,"kalman")==0)
+		return new KalmanTemporalFilter(sSize,numAveragingSlots);
+	else
+		throw Misc::makeStdErr(__PRETTY_FUNCTION__,"Unknown temporal filter %s",filterName);
+	}
+
+TemporalFilter::TemporalFilter(const Size& sSize)
+	:size(sSize)
+	{
+	}
+
+TemporalFilter::~TemporalFilter(void)
+	{
+	}
+
+void TemporalFilter::setTemporalKernel(FrameFilterKernels::TemporalKernel newTemporalKernel)
+	{
+	}
+
+void TemporalFilter::finishFrame(void)
+	{
+	}
@@ -0,0 +1,98 @@
+/***********************************************************************
+TemporalFilter - Abstract base class for per-pixel temporal filters
+used by the depth frame filter to remove noise and detect unstable
+pixels.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef TEMPORALFILTER_INCLUDED
+#define TEMPORALFILTER_INCLUDED
+
+#include <stddef.h>
+#include <Math/Math.h>
+
+#include "Types.h"
+#include "FrameFilterKernels.h"
+
+class TemporalFilter
+	{
+	/* Embedded classes: */
+	public:
+	typedef FrameFilterKernels::RawDepth RawDepth; // Data type for raw depth values
+	typedef FrameFilterKernels::PixelDepthCorrection PixelDepthCorrection; // Type for per-pixel depth correction factors
+	typedef FrameFilterKernels::Parameters Parameters; // Type for filter parameters shared by all pixels of a frame
+	
+	struct Band // Structure pointing to the full-frame buffers of which a band of rows is to be processed
+		{
+		/* Elements: */
+		public:
+		unsigned int yBegin,yEnd; // Range of rows to process
+		const RawDepth* input; // The new raw depth frame
+		const PixelDepthCorrection* pixelDepthCorrection; // Per-pixel depth correction coefficients
+		float* valid; // Most recent stable depth values
+		float* output; // The output frame
+		};
+	
+	/* Elements: */
+	protected:
+	Size size; // Width and height of processed frames
+	
+	/* Protected methods: */
+	static bool isValid(const Parameters& p,float px,float py,float cVal) // Returns true if the given depth-corrected value at the given pixel position is between the minimum and maximum planes
+		{
+		float minD=p.minPlane[0]*px+p.minPlane[1]*py+p.minPlane[2]*cVal+p.minPlane[3];
+		float maxD=p.maxPlane[0]*px+p.maxPlane[1]*py+p.maxPlane[2]*cVal+p.maxPlane[3];
+		return minD>=0.0f&&maxD<=0.0f;
+		}
+	static void updateOutput(const Parameters& p,bool stable,float newFiltered,float& valid,float& output) // Updates a pixel's stable and output values based on its stability and new depth-corrected filtered value
+		{
+		if(stable)
+			{
+			/* Update the stable value if the new filtered value is outside the previous value's envelope: */
+			if(Math::abs(newFiltered-valid)>=p.hysteresis)
+				valid=newFiltered;
+			output=valid;
+			}
+		else if(p.retainValids)
+			{
+			/* Leave the pixel at its previous value: */
+			output=valid;
+			}
+		else
+			{
+			/* Assign default value to instable pixels: */
+			output=p.instableValue;
+			}
+		}
+	
+	/* Constructors and destructors: */
+	public:
+	static TemporalFilter* create(const char* filterName,const Size& sSize,unsigned int numAveragingSlots); // Returns a new temporal filter of the given name for frames of the given size and the given averaging length; throws exception if the name is unknown
+	TemporalFilter(const Size& sSize); // Creates a filter for frames of the given size
+	virtual ~TemporalFilter(void);
+	
+	/* Methods: */
+	virtual const char* getName(void) const =0; // Returns the filter's name as used in configuration files
+	virtual size_t getStateSize(void) const =0; // Returns the size of the filter's per-pixel state in bytes
+	virtual void setTemporalKernel(FrameFilterKernels::TemporalKernel newTemporalKernel); // Sets the per-row kernel for filters that have SIMD implementations; ignored by default
+	virtual void filterBand(const Parameters& parameters,const Band& band) =0; // Enters the given band of rows of a new frame into the filter state and calculates the band's output values; can be called concurrently for non-overlapping bands
+	virtual void finishFrame(void); // Called after all bands of a new frame have been processed
+	};
+
+#endif
@@ -0,0 +1,350 @@
+/***********************************************************************
+WaterBenchmark - Utility to run the CPU implementation of the water
+flow simulation on a synthetic dam-break scenario without a display, and
+report simulation throughput and water volume to catch performance and
+correctness regressions.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <Math/Math.h>
+#include <Realtime/Time.h>
+
+#include "Types.h"
+#include "CpuWaterTable2.h"
+#include "NestedWaterTable2.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+void createScenario(const Size& size,const GLfloat cellSize[2],GLfloat damPosition,bool closed,std::vector<GLfloat>& bathymetry,std::vector<GLfloat>& waterLevel) // Creates a valley of rolling hills with a reservoir held back by a breached dam at the given fraction of its width, optionally enclosed by walls
+	{
+	/* Create the vertex-centered bathymetry grid: */
+	unsigned int bWidth=size[0]-1;
+	unsigned int bHeight=size[1]-1;
+	GLfloat extent[2];
+	for(int i=0;i<2;++i)
+		extent[i]=GLfloat(size[i])*cellSize[i];
+	GLfloat damX=extent[0]*damPosition;
+	bathymetry.resize(size_t(bHeight)*size_t(bWidth));
+	for(unsigned int y=0;y<bHeight;++y)
+		{
+		GLfloat py=(GLfloat(y)+1.0f)*cellSize[1];
+		GLfloat valley=(py/extent[1]-0.5f)*2.0f;
+		for(unsigned int x=0;x<bWidth;++x)
+			{
+			GLfloat px=(GLfloat(x)+1.0f)*cellSize[0];
+			GLfloat b=10.0f*valley*valley-4.0f*px/extent[0]+Math::sin(px*0.37f)*Math::cos(py*0.23f);
+			
+			/* Raise a dam with a breach in its middle: */
+			if(Math::abs(px-damX)<2.0f*cellSize[0]&&Math::abs(valley)>0.1f)
+				b+=8.0f;
+			
+			/* Raise walls around the valley that no water can overtop: */
+			if(closed&&(x<4||x>=bWidth-4||y<4||y>=bHeight-4))
+				b+=30.0f;
+			bathymetry[size_t(y)*size_t(bWidth)+x]=b;
+			}
+		}
+	
+	/* Fill the reservoir behind the dam: */
+	waterLevel.resize(size_t(size[1])*size_t(size[0]));
+	for(unsigned int y=0;y<size[1];++y)
+		for(unsigned int x=0;x<size[0];++x)
+			waterLevel[size_t(y)*size_t(size[0])+x]=(GLfloat(x)+0.5f)*cellSize[0]<damX?6.0f:-100.0f;
+	}
+
+template <class WaterTableParam>
+double calcWaterVolume(const WaterTableParam& waterTable,std::vector<GLfloat>& quantity) // Returns the total volume of water in the given water table, and reads its conserved quantities into the given buffer
+	{
+	const Size& size=waterTable.getSize();
+	const GLfloat* bathymetry=waterTable.getBathymetryGrid();
+	quantity.resize(size_t(size[1])*size_t(size[0])*3);
+	waterTable.readQuantityGrid(&quantity[0]);
+	int bMaxX=int(size[0])-2;
+	int bMaxY=int(size[1])-2;
+	double volume=0.0;
+	for(int y=0;y<int(size[1]);++y)
+		for(int x=0;x<int(size[0]);++x)
+			{
+			/* Calculate the cell-centered bathymetry elevation from the four surrounding grid vertices: */
+			double b=0.0;
+			for(int dy=-1;dy<=0;++dy)
+				for(int dx=-1;dx<=0;++dx)
+					b+=bathymetry[Math::max(Math::min(y+dy,bMaxY),0)*(bMaxX+1)+Math::max(Math::min(x+dx,bMaxX),0)];
+			volume+=Math::max(double(quantity[(y*int(size[0])+x)*3])-b*0.25,0.0);
+			}
+	
+	return volume*double(waterTable.getCellSize()[0])*double(waterTable.getCellSize()[1]);
+	}
+
+inline double getActiveFraction(const CpuWaterTable2& waterTable) // Returns the fraction of tiles simulated in the most recent simulation step
+	{
+	return double(waterTable.getNumActiveTiles())/double(waterTable.getNumTiles());
+	}
+
+inline double getActiveFraction(const NestedWaterTable2& waterTable) // Returns the fraction of tiles simulated on the fine grid in the most recent simulation step
+	{
+	return double(waterTable.getNumRefinedTiles())/double(waterTable.getNumTiles());
+	}
+
+template <class WaterTableParam>
+void runBenchmark(WaterTableParam& waterTable,const std::vector<GLfloat>& bathymetry,const std::vector<GLfloat>& waterLevel,unsigned int numSteps,const char* description,std::vector<GLfloat>& result) // Runs the given number of simulation steps on the given water table and prints timing and water volume; returns final conserved quantities
+	{
+	/* Initialize the water table: */
+	waterTable.updateBathymetry(&bathymetry[0]);
+	waterTable.setWaterLevel(&waterLevel[0]);
+	double initialVolume=calcWaterVolume(waterTable,result);
+	
+	/* Run the simulation steps: */
+	std::vector<double> stepTimes;
+	stepTimes.reserve(numSteps);
+	double simulationTime=0.0;
+	double activeFraction=0.0;
+	Realtime::TimePointMonotonic stepTimer;
+	for(unsigned int step=0;step<numSteps;++step)
+		{
+		simulationTime+=double(waterTable.runSimulationStep(false));
+		stepTimes.push_back(stepTimer.setAndDiff());
+		activeFraction+=getActiveFraction(waterTable);
+		}
+	
+	/* Print the results: */
+	const Size& size=waterTable.getSize();
+	double totalTime=0.0;
+	for(std::vector<double>::iterator stIt=stepTimes.begin();stIt!=stepTimes.end();++stIt)
+		totalTime+=*stIt;
+	std::sort(stepTimes.begin(),stepTimes.end());
+	double mean=totalTime/double(numSteps);
+	std::cout<<size[0]<<"x"<<size[1]<<" cells, "<<description<<", "<<waterTable.getNumThreads()<<" thread(s), "<<waterTable.getFluxKernelName()<<" flux kernel"<<std::endl;
+	std::cout<<"Step time: mean "<<std::fixed<<std::setprecision(3)<<mean*1000.0<<" ms, p50 "<<stepTimes[numSteps/2]*1000.0<<" ms, max "<<stepTimes[numSteps-1]*1000.0<<" ms"<<std::endl;
+	std::cout<<"Throughput: "<<std::setprecision(1)<<1.0/mean<<" steps/s, "<<double(size[0])*double(size[1])/(mean*1.0e6)<<" Mcells/s"<<std::endl;
+	std::cout<<"Simulated "<<std::setprecision(4)<<simulationTime<<" s in "<<numSteps<<" steps"<<std::endl;
+	std::cout<<"Active tiles: "<<std::setprecision(1)<<activeFraction*100.0/double(numSteps)<<"% on average"<<std::endl;
+	double finalVolume=calcWaterVolume(waterTable,result);
+	std::cout<<"Water volume: "<<std::setprecision(4)<<initialVolume<<" initially, "<<finalVolume<<" finally"<<std::endl;
+	std::cout<<"Relative volume change: "<<std::scientific<<std::setprecision(2)<<(finalVolume-initialVolume)/initialVolume<<std::fixed<<std::endl;
+	}
+
+void printUsage(void)
+	{
+	std::cout<<"Usage: WaterBenchmark [option 1] ... [option n]"<<std::endl;
+	std::cout<<"  Options:"<<std::endl;
+	std::cout<<"  -h"<<std::endl;
+	std::cout<<"     Prints this help message"<<std::endl;
+	std::cout<<"  -size <width> <height>"<<std::endl;
+	std::cout<<"     Size of the water table in cells"<<std::endl;
+	std::cout<<"     Default: 640 480"<<std::endl;
+	std::cout<<"  -cs <cell size>"<<std::endl;
+	std::cout<<"     Width and height of each cell"<<std::endl;
+	std::cout<<"     Default: 0.2"<<std::endl;
+	std::cout<<"  -n <number of steps>"<<std::endl;
+	std::cout<<"     Number of simulation steps to run"<<std::endl;
+	std::cout<<"     Default: 200"<<std::endl;
+	std::cout<<"  -nt <number of threads>"<<std::endl;
+	std::cout<<"     Number of threads cooperating on each simulation step"<<std::endl;
+	std::cout<<"     Default: 1"<<std::endl;
+	std::cout<<"  -fk <flux kernel name>"<<std::endl;
+	std::cout<<"     Flux kernel to use (scalar, sse4.1, avx, or auto for the fastest one supported by the CPU)"<<std::endl;
+	std::cout<<"     Default: auto"<<std::endl;
+	std::cout<<"  -engineering"<<std::endl;
+	std::cout<<"     Runs the simulation in engineering mode instead of traditional mode"<<std::endl;
+	std::cout<<"  -rain <rain rate>"<<std::endl;
+	std::cout<<"     Amount of water deposited on every cell per second"<<std::endl;
+	std::cout<<"     Default: 0"<<std::endl;
+	std::cout<<"  -dam <dam position>"<<std::endl;
+	std::cout<<"     Position of the dam holding back the reservoir as a fraction of the water table's width; 0 creates a dry valley"<<std::endl;
+	std::cout<<"     Default: 0.333"<<std::endl;
+	std::cout<<"  -closed"<<std::endl;
+	std::cout<<"     Encloses the valley in walls and disables the dry boundary, so that the simulation must conserve the water volume"<<std::endl;
+	std::cout<<"  -sparse <dry depth>"<<std::endl;
+	std::cout<<"     Only simulates tiles containing water deeper than the given depth, and their neighbours"<<std::endl;
+	std::cout<<"  -nested <refinement factor> <refinement depth>"<<std::endl;
+	std::cout<<"     Simulates tiles containing water deeper than the given depth on the full-resolution grid, and the rest on a grid coarser by the given factor"<<std::endl;
+	std::cout<<"  -verify"<<std::endl;
+	std::cout<<"     Re-runs the simulation on a single thread with the scalar flux kernel and checks that the results are identical"<<std::endl;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Process command line parameters: */
+	Size size(640,480);
+	GLfloat cellSize=0.2f;
+	unsigned int numSteps=200;
+	unsigned int numThreads=1;
+	const char* fluxKernelName="auto";
+	bool engineering=false;
+	GLfloat rainRate=0.0f;
+	GLfloat damPosition=1.0f/3.0f;
+	bool closed=false;
+	bool sparse=false;
+	GLfloat dryDepth=0.0f;
+	unsigned int refinement=0;
+	GLfloat refineDepth=0.0f;
+	bool verify=false;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"h")==0)
+				{
+				printUsage();
+				return 0;
+				}
+			else if(strcasecmp(argv[i]+1,"size")==0)
+				{
+				for(int j=0;j<2;++j)
+					{
+					++i;
+					size[j]=atoi(argv[i]);
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"cs")==0)
+				{
+				++i;
+				cellSize=GLfloat(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"n")==0)
+				{
+				++i;
+				numSteps=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"nt")==0)
+				{
+				++i;
+				numThreads=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"fk")==0)
+				{
+				++i;
+				fluxKernelName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"engineering")==0)
+				engineering=true;
+			else if(strcasecmp(argv[i]+1,"rain")==0)
+				{
+				++i;
+				rainRate=GLfloat(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"dam")==0)
+				{
+				++i;
+				damPosition=GLfloat(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"closed")==0)
+				closed=true;
+			else if(strcasecmp(argv[i]+1,"sparse")==0)
+				{
+				++i;
+				sparse=true;
+				dryDepth=GLfloat(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"nested")==0)
+				{
+				++i;
+				refinement=atoi(argv[i]);
+				++i;
+				refineDepth=GLfloat(atof(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"verify")==0)
+				verify=true;
+			else
+				std::cerr<<"Ignoring unrecognized command line switch "<<argv[i]<<std::endl;
+			}
+		else
+			std::cerr<<"Ignoring extra command line argument "<<argv[i]<<std::endl;
+		}
+	if(size[0]<4||size[1]<4||numSteps==0||numThreads==0)
+		{
+		printUsage();
+		return 1;
+		}
+	
+	try
+		{
+		/* Create the scenario: */
+		GLfloat cellSizes[2]={cellSize,cellSize};
+		std::vector<GLfloat> bathymetry,waterLevel;
+		createScenario(size,cellSizes,damPosition,closed,bathymetry,waterLevel);
+		size_t numCells=size_t(size[1])*size_t(size[0]);
+		
+		/* Run the simulation on the requested number of threads with the requested flux kernel, and on a single thread with the scalar flux kernel if requested: */
+		std::vector<GLfloat> results[2];
+		for(int run=0;run<(verify?2:1);++run)
+			{
+			/* Create a water table and run the simulation: */
+			std::string description=engineering?"engineering mode":"traditional mode";
+			if(closed)
+				description+=", closed";
+			if(refinement>0)
+				{
+				NestedWaterTable2 waterTable(size,cellSizes,refinement,run==0?numThreads:1);
+				waterTable.setFluxKernel(run==0?fluxKernelName:"scalar");
+				if(engineering)
+					waterTable.setMode(WaterTable2::Engineering);
+				waterTable.setWaterDeposit(rainRate);
+				waterTable.setDryBoundary(!closed);
+				waterTable.setRefinementCriteria(refineDepth,0.5f,5.0);
+				waterTable.setDryDepth(dryDepth);
+				description+=", nested grids";
+				runBenchmark(waterTable,bathymetry,waterLevel,numSteps,description.c_str(),results[run]);
+				}
+			else
+				{
+				CpuWaterTable2 waterTable(size,cellSizes,run==0?numThreads:1);
+				waterTable.setFluxKernel(run==0?fluxKernelName:"scalar");
+				if(engineering)
+					waterTable.setMode(WaterTable2::Engineering);
+				waterTable.setWaterDeposit(rainRate);
+				waterTable.setDryBoundary(!closed);
+				waterTable.setSparse(sparse,dryDepth);
+				if(sparse)
+					description+=", sparse";
+				runBenchmark(waterTable,bathymetry,waterLevel,numSteps,description.c_str(),results[run]);
+				}
+			}
+		
+		if(verify)
+			{
+			/* Check that the simulation produced the same results as the single-threaded scalar one: */
+			if(memcmp(&results[0][0],&results[1][0],numCells*3*sizeof(GLfloat))!=0)
+				throw std::runtime_error("Simulation results differ from single-threaded scalar results");
+			std::cout<<"Simulation results are identical to single-threaded scalar results"<<std::endl;
+			}
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Terminated program due to exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	
+	return 0;
+	}
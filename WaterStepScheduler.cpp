@@ -0,0 +1,252 @@
+/***********************************************************************
+WaterStepScheduler - Class to schedule the water flow simulation steps
+run in each frame inside a GPU time budget, using timer queries to
+measure the cost of simulation steps, and to report the amount of
+simulation time that could not be simulated.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "WaterStepScheduler.h"
+
+#include <Math/Math.h>
+#include <Realtime/Time.h>
+#include <GL/gl.h>
+#include <GL/GLContextData.h>
+#include <GL/Extensions/GLARBOcclusionQuery.h>
+#include <GL/Extensions/GLARBTimerQuery.h>
+
+#include "WaterTable2.h"
+#include "CpuWaterTable2.h"
+
+namespace {
+
+/* Weight of a new measurement in the exponentially weighted averages of step times and deficits: */
+const double averageWeight=0.1;
+
+}
+
+/*********************************************
+Methods of class WaterStepScheduler::DataItem:
+*********************************************/
+
+WaterStepScheduler::DataItem::DataItem(void)
+	:haveTimerQuery(false),
+	 nextQuery(0),numPendingQueries(0),
+	 stepTime(0.0)
+	{
+	for(unsigned int i=0;i<numQueries;++i)
+		{
+		queryObjects[i]=0;
+		queryNumSteps[i]=0;
+		}
+	}
+
+WaterStepScheduler::DataItem::~DataItem(void)
+	{
+	/* Delete the timer queries: */
+	if(haveTimerQuery)
+		glDeleteQueriesARB(numQueries,queryObjects);
+	}
+
+/***********************************
+Methods of class WaterStepScheduler:
+***********************************/
+
+void WaterStepScheduler::calcFrameLimits(double stepTime,GLfloat totalTimeStep,unsigned int& frameMaxSteps,GLfloat& frameMinStepSize) const
+	{
+	/* Calculate the number of simulation steps fitting into the time budget: */
+	frameMaxSteps=maxSteps;
+	frameMinStepSize=minStepSize;
+	if(targetFrameTime>0.0&&stepTime>0.0)
+		{
+		double budgetSteps=Math::floor(targetFrameTime*budgetFraction/stepTime);
+		if(budgetSteps<double(frameMaxSteps))
+			{
+			frameMaxSteps=budgetSteps>=1.0?(unsigned int)(budgetSteps):1U;
+			
+			/* Limit fluxes so that the budgeted steps can cover the frame's simulation time, up to the accuracy limit: */
+			frameMinStepSize=Math::max(frameMinStepSize,Math::min(totalTimeStep/GLfloat(frameMaxSteps),maxMinStepSize));
+			}
+		}
+	}
+
+GLfloat WaterStepScheduler::publishStats(double stepTime,unsigned int numSteps,unsigned int frameMaxSteps,GLfloat frameMinStepSize,GLfloat requestedTimeStep,GLfloat remainingTimeStep) const
+	{
+	GLfloat deficit=Math::max(remainingTimeStep,0.0f);
+	
+	Threads::Mutex::Lock statsLock(statsMutex);
+	stats.stepTime=stepTime;
+	stats.numSteps=numSteps;
+	stats.maxSteps=frameMaxSteps;
+	stats.minStepSize=frameMinStepSize;
+	if(requestedTimeStep>0.0f)
+		stats.deficit+=(double(deficit)/double(requestedTimeStep)-stats.deficit)*averageWeight;
+	stats.totalDeficit+=double(deficit);
+	
+	return deficit;
+	}
+
+WaterStepScheduler::WaterStepScheduler(unsigned int sMaxSteps,GLfloat sMinStepSize)
+	:targetFrameTime(0.0),budgetFraction(0.5),
+	 maxSteps(sMaxSteps),minStepSize(sMinStepSize),maxMinStepSize(0.0f),
+	 cpuStepTime(0.0)
+	{
+	}
+
+WaterStepScheduler::~WaterStepScheduler(void)
+	{
+	}
+
+void WaterStepScheduler::initContext(GLContextData& contextData) const
+	{
+	/* Create a data item and add it to the context: */
+	DataItem* dataItem=new DataItem;
+	contextData.addDataItem(this,dataItem);
+	
+	/* Check whether the OpenGL context supports timer queries; otherwise, only the step limit is enforced: */
+	dataItem->haveTimerQuery=GLARBOcclusionQuery::isSupported()&&GLARBTimerQuery::isSupported();
+	if(dataItem->haveTimerQuery)
+		{
+		/* Initialize the required OpenGL extensions: */
+		GLARBOcclusionQuery::initExtension();
+		GLARBTimerQuery::initExtension();
+		
+		/* Create the ring of timer queries: */
+		glGenQueriesARB(DataItem::numQueries,dataItem->queryObjects);
+		}
+	}
+
+void WaterStepScheduler::setMaxSteps(unsigned int newMaxSteps)
+	{
+	maxSteps=newMaxSteps;
+	}
+
+void WaterStepScheduler::setTargetFrameRate(double newTargetFrameRate,double newBudgetFraction)
+	{
+	targetFrameTime=newTargetFrameRate>0.0?1.0/newTargetFrameRate:0.0;
+	budgetFraction=newBudgetFraction;
+	}
+
+void WaterStepScheduler::setMaxMinStepSize(GLfloat newMaxMinStepSize)
+	{
+	maxMinStepSize=newMaxMinStepSize;
+	}
+
+WaterStepScheduler::Stats WaterStepScheduler::getStats(void) const
+	{
+	Threads::Mutex::Lock statsLock(statsMutex);
+	return stats;
+	}
+
+GLfloat WaterStepScheduler::runSimulationSteps(WaterTable2& waterTable,GLfloat totalTimeStep,GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Collect the results of all finished timer queries in order without waiting for the GPU: */
+	while(dataItem->numPendingQueries>0)
+		{
+		unsigned int query=(dataItem->nextQuery+DataItem::numQueries-dataItem->numPendingQueries)%DataItem::numQueries;
+		GLint available=0;
+		glGetQueryObjectivARB(dataItem->queryObjects[query],GL_QUERY_RESULT_AVAILABLE_ARB,&available);
+		if(!available)
+			break;
+		
+		/* Update the averaged step time: */
+		GLuint64 elapsed=0;
+		glGetQueryObjectui64v(dataItem->queryObjects[query],GL_QUERY_RESULT_ARB,&elapsed);
+		double stepTime=double(elapsed)*1.0e-9/double(dataItem->queryNumSteps[query]);
+		if(dataItem->stepTime>0.0)
+			dataItem->stepTime+=(stepTime-dataItem->stepTime)*averageWeight;
+		else
+			dataItem->stepTime=stepTime;
+		--dataItem->numPendingQueries;
+		}
+	
+	/* Calculate the number of simulation steps fitting into the GPU time budget: */
+	unsigned int frameMaxSteps;
+	GLfloat frameMinStepSize;
+	calcFrameLimits(dataItem->stepTime,totalTimeStep,frameMaxSteps,frameMinStepSize);
+	
+	/* Apply this frame's minimum step size, which drops back to the configured one once the budget suffices again: */
+	waterTable.forceMinStepSize(frameMinStepSize);
+	
+	/* Start timing the simulation steps if there is a free timer query: */
+	bool timing=dataItem->haveTimerQuery&&dataItem->numPendingQueries<DataItem::numQueries&&frameMaxSteps>0&&totalTimeStep>1.0e-8f;
+	if(timing)
+		glBeginQueryARB(GL_TIME_ELAPSED,dataItem->queryObjects[dataItem->nextQuery]);
+	
+	/* Run simulation steps until the frame's simulation time is used up or the step budget is exhausted: */
+	GLfloat requestedTimeStep=totalTimeStep;
+	unsigned int numSteps=0;
+	while(numSteps<frameMaxSteps&&totalTimeStep>1.0e-8f)
+		{
+		/* Run with a self-determined time step to maintain stability: */
+		waterTable.setMaxStepSize(totalTimeStep);
+		GLfloat timeStep=waterTable.runSimulationStep(false,contextData,textureTracker);
+		totalTimeStep-=timeStep;
+		++numSteps;
+		}
+	
+	if(timing)
+		{
+		/* Finish timing the simulation steps: */
+		glEndQueryARB(GL_TIME_ELAPSED);
+		dataItem->queryNumSteps[dataItem->nextQuery]=numSteps;
+		dataItem->nextQuery=(dataItem->nextQuery+1)%DataItem::numQueries;
+		++dataItem->numPendingQueries;
+		}
+	
+	/* Publish the scheduler state: */
+	return publishStats(dataItem->stepTime,numSteps,frameMaxSteps,frameMinStepSize,requestedTimeStep,totalTimeStep);
+	}
+
+GLfloat WaterStepScheduler::runSimulationSteps(CpuWaterTable2& cpuWaterTable,GLfloat totalTimeStep) const
+	{
+	/* Calculate the number of simulation steps fitting into the CPU time budget: */
+	unsigned int frameMaxSteps;
+	GLfloat frameMinStepSize;
+	calcFrameLimits(cpuStepTime,totalTimeStep,frameMaxSteps,frameMinStepSize);
+	cpuWaterTable.forceMinStepSize(frameMinStepSize);
+	
+	/* Run simulation steps until the frame's simulation time is used up or the step budget is exhausted: */
+	Realtime::TimePointMonotonic timer;
+	GLfloat requestedTimeStep=totalTimeStep;
+	unsigned int numSteps=0;
+	while(numSteps<frameMaxSteps&&totalTimeStep>1.0e-8f)
+		{
+		/* Run with a self-determined time step to maintain stability: */
+		cpuWaterTable.setMaxStepSize(totalTimeStep);
+		totalTimeStep-=cpuWaterTable.runSimulationStep(false);
+		++numSteps;
+		}
+	
+	/* Update the averaged step time; CPU steps are finished when they return: */
+	if(numSteps>0)
+		{
+		double stepTime=double(timer.setAndDiff())/double(numSteps);
+		if(cpuStepTime>0.0)
+			cpuStepTime+=(stepTime-cpuStepTime)*averageWeight;
+		else
+			cpuStepTime=stepTime;
+		}
+	
+	/* Publish the scheduler state: */
+	return publishStats(cpuStepTime,numSteps,frameMaxSteps,frameMinStepSize,requestedTimeStep,totalTimeStep);
+	}
@@ -0,0 +1,113 @@
+/***********************************************************************
+WaterStepScheduler - Class to schedule the water flow simulation steps
+run in each frame inside a GPU time budget, using timer queries to
+measure the cost of simulation steps, and to report the amount of
+simulation time that could not be simulated.
+Copyright (c) 2026 agent
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef WATERSTEPSCHEDULER_INCLUDED
+#define WATERSTEPSCHEDULER_INCLUDED
+
+#include <Threads/Mutex.h>
+#include <GL/gl.h>
+#include <GL/GLObject.h>
+
+/* Forward declarations: */
+class TextureTracker;
+class WaterTable2;
+class CpuWaterTable2;
+
+class WaterStepScheduler:public GLObject
+	{
+	/* Embedded classes: */
+	public:
+	struct Stats // Structure reporting the scheduler's state as of the most recent frame
+		{
+		/* Elements: */
+		public:
+		double stepTime; // Averaged GPU or CPU time per simulation step in seconds, or zero if not measured
+		unsigned int numSteps; // Number of simulation steps run in the most recent frame
+		unsigned int maxSteps; // Maximum number of simulation steps allowed in the most recent frame
+		GLfloat minStepSize; // Minimum step size forced in the most recent frame, or zero
+		double deficit; // Averaged fraction of requested simulation time that could not be simulated
+		double totalDeficit; // Total amount of simulation time that could not be simulated since start-up
+		
+		/* Constructors and destructors: */
+		Stats(void)
+			:stepTime(0.0),numSteps(0),maxSteps(0),minStepSize(0.0f),
+			 deficit(0.0),totalDeficit(0.0)
+			{
+			}
+		};
+	
+	private:
+	struct DataItem:public GLObject::DataItem // Structure holding per-context state
+		{
+		/* Elements: */
+		public:
+		bool haveTimerQuery; // Flag whether the OpenGL context supports timer queries
+		static const unsigned int numQueries=4; // Number of timer queries in the query ring
+		GLuint queryObjects[numQueries]; // Ring of timer query objects, each timing the simulation steps of one frame
+		unsigned int queryNumSteps[numQueries]; // Number of simulation steps timed by each timer query
+		unsigned int nextQuery; // Index of the next timer query to issue
+		unsigned int numPendingQueries; // Number of issued timer queries whose results have not been collected yet
+		double stepTime; // Averaged GPU time per simulation step in seconds, or zero if not measured yet
+		
+		/* Constructors and destructors: */
+		DataItem(void);
+		virtual ~DataItem(void);
+		};
+	
+	/* Elements: */
+	double targetFrameTime; // Target frame interval in seconds, or zero to disable GPU time budgeting
+	double budgetFraction; // Fraction of the target frame interval the water simulation may use on the GPU, or on the CPU for CPU water tables
+	unsigned int maxSteps; // Upper limit on the number of simulation steps per frame
+	GLfloat minStepSize; // Minimum step size always forced on the water simulation, or zero
+	GLfloat maxMinStepSize; // Upper limit on the minimum step size forced to fit a frame's simulation time into the GPU time budget, or zero to let the water slow down instead
+	mutable double cpuStepTime; // Averaged CPU time per simulation step of CPU water tables in seconds, or zero if not measured yet
+	mutable Threads::Mutex statsMutex; // Mutex protecting the published scheduler state
+	mutable Stats stats; // Scheduler state as of the most recent frame
+	
+	/* Private methods: */
+	void calcFrameLimits(double stepTime,GLfloat totalTimeStep,unsigned int& frameMaxSteps,GLfloat& frameMinStepSize) const; // Calculates the number of simulation steps and the minimum step size for a frame's simulation time from the given averaged step time
+	GLfloat publishStats(double stepTime,unsigned int numSteps,unsigned int frameMaxSteps,GLfloat frameMinStepSize,GLfloat requestedTimeStep,GLfloat remainingTimeStep) const; // Publishes the scheduler state for the most recent frame; returns the simulation time that could not be simulated
+	
+	/* Constructors and destructors: */
+	public:
+	WaterStepScheduler(unsigned int sMaxSteps,GLfloat sMinStepSize); // Creates a scheduler running at most the given number of simulation steps per frame, with GPU time budgeting disabled
+	virtual ~WaterStepScheduler(void);
+	
+	/* Methods from class GLObject: */
+	virtual void initContext(GLContextData& contextData) const;
+	
+	/* New methods: */
+	unsigned int getMaxSteps(void) const // Returns the upper limit on the number of simulation steps per frame
+		{
+		return maxSteps;
+		}
+	void setMaxSteps(unsigned int newMaxSteps); // Sets the upper limit on the number of simulation steps per frame
+	void setTargetFrameRate(double newTargetFrameRate,double newBudgetFraction); // Sets the frame rate to hold and the fraction of each frame's interval the water simulation may use on the GPU; disables GPU time budgeting if frame rate is zero
+	void setMaxMinStepSize(GLfloat newMaxMinStepSize); // Sets the upper limit on the minimum step size forced to fit into the GPU time budget
+	Stats getStats(void) const; // Returns the scheduler state as of the most recent frame
+	GLfloat runSimulationSteps(WaterTable2& waterTable,GLfloat totalTimeStep,GLContextData& contextData,TextureTracker& textureTracker) const; // Advances the given water table by the given simulation time inside the current budget; returns the simulation time that could not be simulated
+	GLfloat runSimulationSteps(CpuWaterTable2& cpuWaterTable,GLfloat totalTimeStep) const; // Advances the given CPU water table by the given simulation time inside the current budget, timing the simulation steps on the CPU; returns the simulation time that could not be simulated
+	};
+
+#endif
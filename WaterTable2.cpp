@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "WaterTable2.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <Math/Math.h>
 #include <Geometry/AffineCombiner.h>
@@ -32,9 +33,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <GL/GLMiscTemplates.h>
 #include <GL/Extensions/GLARBDrawBuffers.h>
 #include <GL/Extensions/GLARBFragmentShader.h>
+#include <GL/Extensions/GLARBPixelBufferObject.h>
 #include <GL/Extensions/GLARBTextureFloat.h>
 #include <GL/Extensions/GLARBTextureRectangle.h>
 #include <GL/Extensions/GLARBTextureRg.h>
+#include <GL/Extensions/GLARBVertexBufferObject.h>
 #include <GL/Extensions/GLARBVertexShader.h>
 #include <GL/Extensions/GLEXTFramebufferObject.h>
 #include <GL/GLContextData.h>
@@ -94,6 +97,27 @@ void sampleLinear(void)
 	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
 	}
 
+void queueReadback(GLuint bufferObject)
+	{
+	/* Queue an asynchronous read-back of the currently bound one-component texture into the given pixel buffer: */
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,bufferObject);
+	glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,GL_RED,GL_FLOAT,0);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	}
+
+bool copyReadback(GLuint bufferObject,size_t numValues,GLfloat* buffer)
+	{
+	/* Map the given pixel buffer and copy its contents into the given buffer: */
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,bufferObject);
+	const GLfloat* readback=static_cast<const GLfloat*>(glMapBufferARB(GL_PIXEL_PACK_BUFFER_ARB,GL_READ_ONLY_ARB));
+	if(readback!=0)
+		memcpy(buffer,readback,numValues*sizeof(GLfloat));
+	glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_ARB);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	
+	return readback!=0;
+	}
+
 }
 
 /*********************************************
@@ -211,24 +235,38 @@ Methods of class WaterTable2::DataItem:
 
 WaterTable2::DataItem::DataItem(void)
 	:bathymetry(GL_TEXTURE_RECTANGLE_ARB),
-	 bathymetryVersion(0),
+	 bathymetryVersion(0),bathymetryPmvVersion(0),
+	 numBathymetryUpdates(1),bathymetryBufferObject(0),bathymetryReadbackUpdates(0),bathymetryReadbackPending(false),
 	 snow(GL_TEXTURE_RECTANGLE_ARB),
 	 quantity(GL_TEXTURE_RECTANGLE_ARB),
 	 derivativeTextureObject(0),
 	 maxStepSize(GL_TEXTURE_RECTANGLE_ARB),
+	 stepSizeTextureObject(0),
+	 numStepSizeReadbacks(0),
 	 waterTextureObject(0),
-	 bathymetryFramebufferObject(0),derivativeFramebufferObject(0),maxStepSizeFramebufferObject(0),integrationFramebufferObject(0),waterFramebufferObject(0)
+	 waterBufferObject(0),waterReadbackPending(false),
+	 bathymetryFramebufferObject(0),derivativeFramebufferObject(0),maxStepSizeFramebufferObject(0),stepSizeFramebufferObject(0),integrationFramebufferObject(0),waterFramebufferObject(0)
 	{
+	for(unsigned int i=0;i<numStepSizeBuffers;++i)
+		{
+		stepSizeBufferObjects[i]=0;
+		stepSizeCaps[i]=0.0f;
+		}
 	}
 
 WaterTable2::DataItem::~DataItem(void)
 	{
 	/* Delete all allocated textures and buffers: */
 	glDeleteTextures(1,&derivativeTextureObject);
+	glDeleteTextures(1,&stepSizeTextureObject);
 	glDeleteTextures(1,&waterTextureObject);
+	glDeleteBuffersARB(numStepSizeBuffers,stepSizeBufferObjects);
+	glDeleteBuffersARB(1,&bathymetryBufferObject);
+	glDeleteBuffersARB(1,&waterBufferObject);
 	glDeleteFramebuffersEXT(1,&bathymetryFramebufferObject);
 	glDeleteFramebuffersEXT(1,&derivativeFramebufferObject);
 	glDeleteFramebuffersEXT(1,&maxStepSizeFramebufferObject);
+	glDeleteFramebuffersEXT(1,&stepSizeFramebufferObject);
 	glDeleteFramebuffersEXT(1,&integrationFramebufferObject);
 	glDeleteFramebuffersEXT(1,&waterFramebufferObject);
 	}
@@ -258,6 +296,7 @@ void WaterTable2::calcTransformations(void)
 	bpmvm(2,2)=Scalar(-2)/(far-near);
 	bpmvm(2,3)=-(far+near)/(far-near);
 	bathymetryPmv*=baseTransform;
+	++bathymetryPmvVersion;
 	}
 	
 	/* Calculate the combined modelview and projection matrix to render water-adding geometry into the water texture: */
@@ -301,6 +340,74 @@ void WaterTable2::calcTransformations(void)
 			*wttmPtr=GLfloat(wttm(i,j));
 	}
 
+bool WaterTable2::calcBathymetryRegion(unsigned int sinceVersion,GLint region[4]) const
+	{
+	/* Get the depth image region affected by changes since the given version: */
+	Scalar dirtyRegion[4];
+	if(!depthImageRenderer->getDirtyRegion(sinceVersion,dirtyRegion))
+		return false;
+	
+	/* Calculate transformations from depth image space to upright elevation map space and to bathymetry grid clip space: */
+	PTransform dicToUpright=PTransform::identity;
+	dicToUpright*=baseTransform;
+	dicToUpright*=depthImageRenderer->getDepthProjection();
+	const PTransform::Matrix& dtum=dicToUpright.getMatrix();
+	PTransform dicToGrid=bathymetryPmv;
+	dicToGrid*=depthImageRenderer->getDepthProjection();
+	
+	/* Bound the frustum cut from the elevation range by the rays through the region's corners, which contains all surface parts rendered from the region: */
+	Size bathymetrySize=getBathymetrySize();
+	Scalar gridMin[2],gridMax[2];
+	for(int corner=0;corner<4;++corner)
+		{
+		Scalar x=dirtyRegion[(corner&0x1)!=0?2:0];
+		Scalar y=dirtyRegion[(corner&0x2)!=0?3:1];
+		for(int zi=0;zi<2;++zi)
+			{
+			/* Find the depth at which the corner's ray reaches the elevation range's bottom or top: */
+			Scalar z=zi==0?domain.min[2]:domain.max[2];
+			Scalar denom=dtum(2,2)-z*dtum(3,2);
+			if(Math::abs(denom)<Scalar(1.0e-10))
+				{
+				/* Play it safe and update the entire grid: */
+				region[0]=region[1]=0;
+				region[2]=GLint(bathymetrySize[0]);
+				region[3]=GLint(bathymetrySize[1]);
+				return true;
+				}
+			Scalar d=(z*(dtum(3,0)*x+dtum(3,1)*y+dtum(3,3))-(dtum(2,0)*x+dtum(2,1)*y+dtum(2,3)))/denom;
+			
+			/* Transform the frustum vertex to bathymetry grid space: */
+			Point gp=dicToGrid.transform(Point(x,y,d));
+			for(int i=0;i<2;++i)
+				{
+				Scalar g=(gp[i]+Scalar(1))*Scalar(0.5)*Scalar(bathymetrySize[i]);
+				if((corner==0&&zi==0)||gridMin[i]>g)
+					gridMin[i]=g;
+				if((corner==0&&zi==0)||gridMax[i]<g)
+					gridMax[i]=g;
+				}
+			}
+		}
+	
+	/* Convert the bounding box to a conservative grid rectangle: */
+	for(int i=0;i<2;++i)
+		{
+		GLint rMin=GLint(Math::floor(gridMin[i]))-1;
+		if(rMin<0)
+			rMin=0;
+		GLint rMax=GLint(Math::ceil(gridMax[i]))+1;
+		if(rMax>GLint(bathymetrySize[i]))
+			rMax=GLint(bathymetrySize[i]);
+		if(rMin>=rMax)
+			return false;
+		region[i]=rMin;
+		region[2+i]=rMax-rMin;
+		}
+	
+	return true;
+	}
+
 GLfloat WaterTable2::calcDerivative(GLContextData& contextData,TextureTracker& textureTracker,int quantityTextureIndex,bool calcMaxStepSize) const
 	{
 	/* Retrieve the context data item: */
@@ -361,12 +468,16 @@ GLfloat WaterTable2::calcDerivative(GLContextData& contextData,TextureTracker& t
 			dataItem->maxStepSizeShader.resetUniforms();
 			textureTracker.reset();
 			
-			/* Set up the simulation frame buffer for maximum step size reduction: */
-			glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+(1-dataItem->maxStepSize.current));
-			
 			/* Reduce the viewport by a factor of two: */
 			Size nextReducedSize((reducedSize[0]+1)/2,(reducedSize[1]+1)/2);
 			glViewport(nextReducedSize);
+			
+			/* Set up the simulation frame buffer for maximum step size reduction, or the final step size frame buffer for the last reduction step: */
+			if(nextReducedSize[0]>1||nextReducedSize[1]>1)
+				glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+(1-dataItem->maxStepSize.current));
+			else
+				glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->stepSizeFramebufferObject);
+			
 			dataItem->maxStepSizeShader.uploadUniform(GLfloat(reducedSize[0]-1),GLfloat(reducedSize[1]-1));
 			
 			/* Bind the current max step size texture: */
@@ -388,24 +499,79 @@ GLfloat WaterTable2::calcDerivative(GLContextData& contextData,TextureTracker& t
 			dataItem->maxStepSize.current=1-dataItem->maxStepSize.current;
 			}
 		
-		/* Read the final value written into the last reduced 1x1 frame buffer: */
-		glReadBuffer(GL_COLOR_ATTACHMENT0_EXT+dataItem->maxStepSize.current);
-		glReadPixels(0,0,1,1,GL_LUMINANCE,GL_FLOAT,&stepSize);
-		
-		/* Limit the step size to the client-specified range: */
-		stepSize=Math::min(stepSize,maxStepSize);
+		if(laggedStepSize)
+			{
+			/* Queue an asynchronous read-back of the final step size into the next pixel buffer in the ring, and remember the step size limit the integration steps will use with it: */
+			unsigned int numBuffers=DataItem::numStepSizeBuffers;
+			unsigned int writeSlot=dataItem->numStepSizeReadbacks%numBuffers;
+			glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->stepSizeBufferObjects[writeSlot]);
+			glReadPixels(0,0,1,1,GL_LUMINANCE,GL_FLOAT,0);
+			dataItem->stepSizeCaps[writeSlot]=maxStepSize;
+			++dataItem->numStepSizeReadbacks;
+			
+			/* Once the ring is full, map the oldest read-back, which the GPU has most likely finished, and calculate the step size its step actually took: */
+			stepSize=0.0f;
+			if(dataItem->numStepSizeReadbacks>=numBuffers)
+				{
+				unsigned int readSlot=dataItem->numStepSizeReadbacks%numBuffers;
+				glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->stepSizeBufferObjects[readSlot]);
+				const GLfloat* readStepSize=static_cast<const GLfloat*>(glMapBufferARB(GL_PIXEL_PACK_BUFFER_ARB,GL_READ_ONLY_ARB));
+				if(readStepSize!=0)
+					stepSize=Math::min(*readStepSize,dataItem->stepSizeCaps[readSlot]);
+				glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_ARB);
+				}
+			glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+			}
+		else
+			{
+			/* Read the final value written into the final step size frame buffer: */
+			glReadPixels(0,0,1,1,GL_LUMINANCE,GL_FLOAT,&stepSize);
+			
+			/* Limit the step size to the client-specified range: */
+			stepSize=Math::min(stepSize,maxStepSize);
+			}
 		}
 	
 	return stepSize;
 	}
 
+void WaterTable2::renderWaterSources(WaterTable2::DataItem* dataItem,GLfloat baseRate,GLContextData& contextData) const
+	{
+	/* Save OpenGL state: */
+	GLfloat currentClearColor[4];
+	glGetFloatv(GL_COLOR_CLEAR_VALUE,currentClearColor);
+	
+	/* Set up and clear the water frame buffer to the base rate: */
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->waterFramebufferObject);
+	glViewport(size);
+	glClearColor(baseRate,0.0f,0.0f,0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	
+	/* Enable additive rendering: */
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE,GL_ONE);
+	
+	/* Set up the water adding shader: */
+	dataItem->waterAddShader.use();
+	dataItem->waterAddShader.uploadUniformMatrix4(1,GL_FALSE,waterAddPmvMatrix);
+	
+	/* Call all render functions: */
+	for(std::vector<const AddWaterFunction*>::const_iterator rfIt=renderFunctions.begin();rfIt!=renderFunctions.end();++rfIt)
+		(**rfIt)(contextData);
+	
+	/* Restore OpenGL state: */
+	glDisable(GL_BLEND);
+	glClearColor(currentClearColor[0],currentClearColor[1],currentClearColor[2],currentClearColor[3]);
+	}
+
 WaterTable2::WaterTable2(const Size& sSize,const GLfloat sCellSize[2])
 	:size(sSize),
 	 depthImageRenderer(0),
 	 baseTransform(ONTransform::identity),
+	 bathymetryPmvVersion(0),
 	 mode(Traditional),
 	 propertyGridCreator(0),
-	 dryBoundary(true)
+	 dryBoundary(true),laggedStepSize(false)
 	{
 	/* Initialize the water table cell size: */
 	for(int i=0;i<2;++i)
@@ -440,9 +606,10 @@ WaterTable2::WaterTable2(const Size& sSize,const GLfloat sCellSize[2])
 WaterTable2::WaterTable2(const Size& sSize,const DepthImageRenderer* sDepthImageRenderer,const Point basePlaneCorners[4])
 	:size(sSize),
 	 depthImageRenderer(sDepthImageRenderer),
+	 bathymetryPmvVersion(0),
 	 mode(Traditional),
 	 propertyGridCreator(0),
-	 dryBoundary(true)
+	 dryBoundary(true),laggedStepSize(false)
 	{
 	/* Project the corner points to the base plane and calculate their centroid: */
 	const Plane& basePlane=depthImageRenderer->getBasePlane();
@@ -502,9 +669,11 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	/* Initialize required OpenGL extensions: */
 	GLARBDrawBuffers::initExtension();
 	GLARBFragmentShader::initExtension();
+	GLARBPixelBufferObject::initExtension();
 	GLARBTextureFloat::initExtension();
 	GLARBTextureRectangle::initExtension();
 	GLARBTextureRg::initExtension();
+	GLARBVertexBufferObject::initExtension();
 	GLARBVertexShader::initExtension();
 	GLEXTFramebufferObject::initExtension();
 	Shader::initExtensions();
@@ -535,6 +704,15 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	/* Create the cell-centered maximum step size gathering texture: */
 	dataItem->maxStepSize.init(size[0],size[1],1,GL_R32F,GL_LUMINANCE,10000.0f);
 	
+	{
+	/* Create the final maximum step size texture: */
+	glGenTextures(1,&dataItem->stepSizeTextureObject);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->stepSizeTextureObject);
+	sampleNearest();
+	GLfloat ss=10000.0f;
+	glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_R32F,1,1,0,GL_LUMINANCE,GL_FLOAT,&ss);
+	}
+	
 	{
 	/* Create the cell-centered water texture: */
 	glGenTextures(1,&dataItem->waterTextureObject);
@@ -548,6 +726,23 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	/* Protect the newly-created textures: */
 	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
 	
+	/* Create the ring of pixel buffers to read back reduced step sizes asynchronously: */
+	glGenBuffersARB(DataItem::numStepSizeBuffers,dataItem->stepSizeBufferObjects);
+	for(unsigned int i=0;i<DataItem::numStepSizeBuffers;++i)
+		{
+		glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->stepSizeBufferObjects[i]);
+		glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB,sizeof(GLfloat),0,GL_STREAM_READ_ARB);
+		}
+	
+	/* Create pixel buffers to read back the bathymetry and water textures asynchronously: */
+	glGenBuffersARB(1,&dataItem->bathymetryBufferObject);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->bathymetryBufferObject);
+	glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB,size_t(size[1]-1)*size_t(size[0]-1)*sizeof(GLfloat),0,GL_STREAM_READ_ARB);
+	glGenBuffersARB(1,&dataItem->waterBufferObject);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->waterBufferObject);
+	glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB,size_t(size[1])*size_t(size[0])*sizeof(GLfloat),0,GL_STREAM_READ_ARB);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	
 	/* Save the currently bound frame buffer: */
 	GLint currentFrameBuffer;
 	glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
@@ -593,6 +788,17 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	glReadBuffer(GL_NONE);
 	}
 	
+	{
+	/* Create the final maximum step size frame buffer: */
+	glGenFramebuffersEXT(1,&dataItem->stepSizeFramebufferObject);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->stepSizeFramebufferObject);
+	
+	/* Attach the final maximum step size texture to the final maximum step size frame buffer: */
+	glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT0_EXT,GL_TEXTURE_RECTANGLE_ARB,dataItem->stepSizeTextureObject,0);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	}
+	
 	{
 	/* Create the integration step frame buffer: */
 	glGenFramebuffersEXT(1,&dataItem->integrationFramebufferObject);
@@ -692,6 +898,7 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	dataItem->eulerStepShaders[0].setUniformLocation("attenuation");
 	dataItem->eulerStepShaders[0].setUniformLocation("quantitySampler");
 	dataItem->eulerStepShaders[0].setUniformLocation("derivativeSampler");
+	dataItem->eulerStepShaders[0].setUniformLocation("stepSizeSampler");
 	
 	/* Create the "engineering" Euler integration step shader: */
 	dataItem->eulerStepShaders[1].addShader(vertexShader,false);
@@ -700,6 +907,7 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	dataItem->eulerStepShaders[1].setUniformLocation("stepSize");
 	dataItem->eulerStepShaders[1].setUniformLocation("quantitySampler");
 	dataItem->eulerStepShaders[1].setUniformLocation("derivativeSampler");
+	dataItem->eulerStepShaders[1].setUniformLocation("stepSizeSampler");
 	
 	/* Create the "traditional" Runge-Kutta integration step shader: */
 	dataItem->rungeKuttaStepShaders[0].addShader(vertexShader,false);
@@ -710,6 +918,7 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	dataItem->rungeKuttaStepShaders[0].setUniformLocation("quantitySampler");
 	dataItem->rungeKuttaStepShaders[0].setUniformLocation("quantityStarSampler");
 	dataItem->rungeKuttaStepShaders[0].setUniformLocation("derivativeSampler");
+	dataItem->rungeKuttaStepShaders[0].setUniformLocation("stepSizeSampler");
 	
 	/* Create the "engineering" Runge-Kutta integration step shader: */
 	dataItem->rungeKuttaStepShaders[1].addShader(vertexShader,false);
@@ -719,13 +928,13 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	dataItem->rungeKuttaStepShaders[1].setUniformLocation("quantitySampler");
 	dataItem->rungeKuttaStepShaders[1].setUniformLocation("quantityStarSampler");
 	dataItem->rungeKuttaStepShaders[1].setUniformLocation("derivativeSampler");
+	dataItem->rungeKuttaStepShaders[1].setUniformLocation("stepSizeSampler");
 	
 	/* Create the water adder rendering shader: */
 	dataItem->waterAddShader.addShader(compileVertexShader("Water2WaterAddShader"));
 	dataItem->waterAddShader.addShader(compileFragmentShader("Water2WaterAddShader"));
 	dataItem->waterAddShader.link();
 	dataItem->waterAddShader.setUniformLocation("pmv");
-	dataItem->waterAddShader.setUniformLocation("stepSize");
 	
 	/* Create the water shader: */
 	dataItem->waterShader.addShader(vertexShader,false);
@@ -737,6 +946,8 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	dataItem->waterShader.setUniformLocation("waterSampler");
 	dataItem->waterShader.setUniformLocation("snowLine");
 	dataItem->waterShader.setUniformLocation("snowMelt");
+	dataItem->waterShader.setUniformLocation("stepSize");
+	dataItem->waterShader.setUniformLocation("stepSizeSampler");
 	
 	/* Delete the shared vertex shader: */
 	glDeleteObjectARB(vertexShader);
@@ -769,9 +980,9 @@ void WaterTable2::setPropertyGridCreator(PropertyGridCreator* newPropertyGridCre
 
 void WaterTable2::forceMinStepSize(GLfloat newMinStepSize)
 	{
-	/* Calculate the maximum propagation speeds in x and y: */
+	/* Calculate the maximum propagation speeds in x and y, or remove the limit: */
 	for(int i=0;i<2;++i)
-		maxPropagationSpeed[i]=cellSize[i]/(2.0f*newMinStepSize);
+		maxPropagationSpeed[i]=newMinStepSize>0.0f?cellSize[i]/(2.0f*newMinStepSize):1.0e10; // Ridiculously large
 	}
 
 void WaterTable2::setMaxStepSize(GLfloat newMaxStepSize)
@@ -817,14 +1028,34 @@ void WaterTable2::setDryBoundary(bool newDryBoundary)
 	dryBoundary=newDryBoundary;
 	}
 
+void WaterTable2::setLaggedStepSize(bool newLaggedStepSize)
+	{
+	laggedStepSize=newLaggedStepSize;
+	}
+
 void WaterTable2::updateBathymetry(GLContextData& contextData,TextureTracker& textureTracker) const
 	{
 	/* Get the data item: */
 	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
 	
 	/* Check if the current bathymetry texture is outdated: */
-	if(dataItem->bathymetryVersion!=depthImageRenderer->getDepthImageVersion())
+	if(dataItem->bathymetryPmvVersion!=bathymetryPmvVersion||dataItem->bathymetryVersion!=depthImageRenderer->getDepthImageVersion())
 		{
+		/* Update the entire grid if the rendering matrix changed, or only the region affected by depth image changes otherwise: */
+		GLint region[4];
+		if(dataItem->bathymetryPmvVersion!=bathymetryPmvVersion)
+			{
+			region[0]=region[1]=0;
+			region[2]=GLint(size[0]-1);
+			region[3]=GLint(size[1]-1);
+			}
+		else if(!calcBathymetryRegion(dataItem->bathymetryVersion,region))
+			{
+			/* The depth image changes do not affect the bathymetry grid: */
+			dataItem->bathymetryVersion=depthImageRenderer->getDepthImageVersion();
+			return;
+			}
+		
 		/* Retrieve the current and new buffer slots for the bathymetry and quantity textures: */
 		int oldBathymetry=dataItem->bathymetry.current;
 		int newBathymetry=1-oldBathymetry;
@@ -832,21 +1063,24 @@ void WaterTable2::updateBathymetry(GLContextData& contextData,TextureTracker& te
 		int newQuantity=1-oldQuantity;
 		
 		/* Save relevant OpenGL state: */
-		glPushAttrib(GL_VIEWPORT_BIT);
+		glPushAttrib(GL_VIEWPORT_BIT|GL_SCISSOR_BIT);
 		GLint currentFrameBuffer;
 		glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
 		GLfloat currentClearColor[4];
 		glGetFloatv(GL_COLOR_CLEAR_VALUE,currentClearColor);
 		
-		/* Bind the bathymetry rendering frame buffer and clear it: */
+		/* Bind the bathymetry rendering frame buffer and clear the update region: */
 		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->bathymetryFramebufferObject);
 		glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+newBathymetry);
 		glViewport(getBathymetrySize());
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(region[0],region[1],region[2],region[3]);
 		glClearColor(GLfloat(domain.min[2]),0.0f,0.0f,1.0f);
 		glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
 		
-		/* Render the surface into the bathymetry grid: */
+		/* Render the surface into the update region of the bathymetry grid: */
 		depthImageRenderer->renderElevation(bathymetryPmv,contextData,textureTracker);
+		glDisable(GL_SCISSOR_TEST);
 		
 		/* Set up the integration frame buffer to update the conserved quantities based on bathymetry changes: */
 		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->integrationFramebufferObject);
@@ -868,9 +1102,18 @@ void WaterTable2::updateBathymetry(GLContextData& contextData,TextureTracker& te
 		glVertex2i(0,size[1]);
 		glEnd();
 		
+		/* Copy the update region into the old bathymetry grid, so that both grids agree outside of the next update region: */
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->bathymetryFramebufferObject);
+		glReadBuffer(GL_COLOR_ATTACHMENT0_EXT+newBathymetry);
+		textureTracker.reset();
+		textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->bathymetry.textureObjects[oldBathymetry]);
+		glCopyTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,region[0],region[1],region[0],region[1],region[2],region[3]);
+		
 		/* Update the bathymetry and quantity grids: */
 		dataItem->bathymetry.current=newBathymetry;
 		dataItem->bathymetryVersion=depthImageRenderer->getDepthImageVersion();
+		dataItem->bathymetryPmvVersion=bathymetryPmvVersion;
+		++dataItem->numBathymetryUpdates;
 		dataItem->quantity.current=newQuantity;
 		
 		/* Restore OpenGL state: */
@@ -919,9 +1162,15 @@ void WaterTable2::updateBathymetry(const GLfloat* bathymetryGrid,GLContextData&
 	glVertex2i(size[0],size[1]);
 	glVertex2i(0,size[1]);
 	glEnd();
+	
+	/* Upload the new bathymetry grid into the old bathymetry grid as well, so that both grids agree for subsequent partial updates: */
+	textureTracker.reset();
+	textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->bathymetry.textureObjects[oldBathymetry]);
+	glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,getBathymetrySize(),GL_LUMINANCE,GL_FLOAT,bathymetryGrid);
 
 	/* Update the bathymetry and quantity grids: */
 	dataItem->bathymetry.current=newBathymetry;
+	++dataItem->numBathymetryUpdates;
 	dataItem->quantity.current=newQuantity;
 
 	/* Restore OpenGL state: */
@@ -989,6 +1238,17 @@ GLfloat WaterTable2::runSimulationStep(bool forceStepSize,GLContextData& context
 	
 	GLfloat stepSize=calcDerivative(contextData,textureTracker,dataItem->quantity.current,!forceStepSize);
 	
+	/* Upload the client-specified step size limit with lagged step sizes, as the GPU limits each step to its own reduction: */
+	GLfloat stepSizeLimit=laggedStepSize&&!forceStepSize?maxStepSize:stepSize;
+	
+	if(forceStepSize)
+		{
+		/* Reset the final step size texture so the integration shaders take the forced step size: */
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->stepSizeFramebufferObject);
+		glClearColor(stepSize,0.0f,0.0f,0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		}
+	
 	// DEBUGGING
 	// std::cout<<stepSize<<' ';
 	
@@ -1005,11 +1265,12 @@ GLfloat WaterTable2::runSimulationStep(bool forceStepSize,GLContextData& context
 	Shader* eulerStepShader=&dataItem->eulerStepShaders[mode];
 	eulerStepShader->use();
 	textureTracker.reset();
-	eulerStepShader->uploadUniform(stepSize);
+	eulerStepShader->uploadUniform(stepSizeLimit);
 	if(mode==Traditional)
-		eulerStepShader->uploadUniform(Math::pow(attenuation,stepSize));
+		eulerStepShader->uploadUniform(attenuation);
 	dataItem->quantity.bind(textureTracker,*eulerStepShader,dataItem->quantity.current,false);
 	eulerStepShader->uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->derivativeTextureObject));
+	eulerStepShader->uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->stepSizeTextureObject));
 	
 	/* Run the Euler integration step: */
 	glBegin(GL_QUADS);
@@ -1038,12 +1299,13 @@ GLfloat WaterTable2::runSimulationStep(bool forceStepSize,GLContextData& context
 	Shader* rungeKuttaStepShader=&dataItem->rungeKuttaStepShaders[mode];
 	rungeKuttaStepShader->use();
 	textureTracker.reset();
-	rungeKuttaStepShader->uploadUniform(stepSize);
+	rungeKuttaStepShader->uploadUniform(stepSizeLimit);
 	if(mode==Traditional)
-		rungeKuttaStepShader->uploadUniform(Math::pow(attenuation,stepSize));
+		rungeKuttaStepShader->uploadUniform(attenuation);
 	dataItem->quantity.bind(textureTracker,*rungeKuttaStepShader,dataItem->quantity.current,false);
 	dataItem->quantity.bind(textureTracker,*rungeKuttaStepShader,2,false);
 	rungeKuttaStepShader->uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->derivativeTextureObject));
+	rungeKuttaStepShader->uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->stepSizeTextureObject));
 	
 	/* Run the Runge-Kutta integration step: */
 	glBegin(GL_QUADS);
@@ -1076,37 +1338,13 @@ GLfloat WaterTable2::runSimulationStep(bool forceStepSize,GLContextData& context
 	
 	if(waterDeposit!=0.0f||!renderFunctions.empty())
 		{
-		/* Save OpenGL state: */
-		GLfloat currentClearColor[4];
-		glGetFloatv(GL_COLOR_CLEAR_VALUE,currentClearColor);
-		
 		/*******************************************************************
 		Step 5: Render all water sources and sinks additively into the water
 		texture.
 		*******************************************************************/
 		
-		/* Set up and clear the water frame buffer: */
-		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->waterFramebufferObject);
-		glViewport(size);
-		glClearColor(waterDeposit*stepSize,0.0f,0.0f,0.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
-		
-		/* Enable additive rendering: */
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_ONE,GL_ONE);
-		
-		/* Set up the water adding shader: */
-		dataItem->waterAddShader.use();
-		dataItem->waterAddShader.uploadUniformMatrix4(1,GL_FALSE,waterAddPmvMatrix);
-		dataItem->waterAddShader.uploadUniform(stepSize);
-		
-		/* Call all render functions: */
-		for(std::vector<const AddWaterFunction*>::const_iterator rfIt=renderFunctions.begin();rfIt!=renderFunctions.end();++rfIt)
-			(**rfIt)(contextData);
-		
-		/* Restore OpenGL state: */
-		glDisable(GL_BLEND);
-		glClearColor(currentClearColor[0],currentClearColor[1],currentClearColor[2],currentClearColor[3]);
+		/* Start from the deposit rate; the water update shader scales rates by the step size the GPU took: */
+		renderWaterSources(dataItem,waterDeposit,contextData);
 		
 		/*******************************************************************
 		Step 6: Update the conserved quantities based on the water texture.
@@ -1128,7 +1366,9 @@ GLfloat WaterTable2::runSimulationStep(bool forceStepSize,GLContextData& context
 		dataItem->quantity.bind(textureTracker,dataItem->waterShader,dataItem->quantity.current,false);
 		dataItem->waterShader.uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->waterTextureObject));
 		dataItem->waterShader.uploadUniform(snowLine);
-		dataItem->waterShader.uploadUniform(snowMelt*stepSize);
+		dataItem->waterShader.uploadUniform(snowMelt);
+		dataItem->waterShader.uploadUniform(stepSizeLimit);
+		dataItem->waterShader.uploadUniform(textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->stepSizeTextureObject));
 		
 		/* Run the water update: */
 		glBegin(GL_QUADS);
@@ -1197,6 +1437,32 @@ void WaterTable2::readBathymetryTexture(GLContextData& contextData,TextureTracke
 	glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,GL_RED,GL_FLOAT,buffer);
 	}
 
+bool WaterTable2::readBathymetryTextureAsync(GLContextData& contextData,TextureTracker& textureTracker,GLfloat* buffer) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Copy a pending read-back, which the GPU has most likely finished since it was queued, into the given buffer: */
+	bool result=false;
+	if(dataItem->bathymetryReadbackPending)
+		{
+		result=copyReadback(dataItem->bathymetryBufferObject,size_t(size[1]-1)*size_t(size[0]-1),buffer);
+		dataItem->bathymetryReadbackPending=false;
+		}
+	
+	/* Queue a new read-back if the bathymetry grid changed since the previous one: */
+	if(dataItem->bathymetryReadbackUpdates!=dataItem->numBathymetryUpdates)
+		{
+		textureTracker.reset();
+		textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->bathymetry.textureObjects[dataItem->bathymetry.current]);
+		queueReadback(dataItem->bathymetryBufferObject);
+		dataItem->bathymetryReadbackUpdates=dataItem->numBathymetryUpdates;
+		dataItem->bathymetryReadbackPending=true;
+		}
+	
+	return result;
+	}
+
 void WaterTable2::readSnowTexture(GLContextData& contextData,TextureTracker& textureTracker,GLfloat* buffer) const
 	{
 	/* Get the data item: */
@@ -1222,3 +1488,77 @@ void WaterTable2::readQuantityTexture(GLContextData& contextData,TextureTracker&
 	/* Read the requested components of the texture image into the given buffer: */
 	glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,components,GL_FLOAT,buffer);
 	}
+
+bool WaterTable2::readWaterSourceTexture(GLContextData& contextData,TextureTracker& textureTracker,bool lagged,GLfloat* buffer) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Copy a pending read-back queued by the previous call into the given buffer: */
+	bool result=false;
+	if(lagged&&dataItem->waterReadbackPending)
+		{
+		result=copyReadback(dataItem->waterBufferObject,size_t(size[1])*size_t(size[0]),buffer);
+		dataItem->waterReadbackPending=false;
+		}
+	
+	if(!renderFunctions.empty())
+		{
+		/* Save relevant OpenGL state: */
+		glPushAttrib(GL_COLOR_BUFFER_BIT|GL_VIEWPORT_BIT);
+		GLint currentFrameBuffer;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
+		
+		/* Render all water sources and sinks into the water texture, leaving deposited water to the caller: */
+		renderWaterSources(dataItem,0.0f,contextData);
+		
+		/* Restore OpenGL state: */
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
+		glPopAttrib();
+		
+		/* Bind the water texture: */
+		textureTracker.reset();
+		textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->waterTextureObject);
+		
+		if(lagged)
+			{
+			/* Queue an asynchronous read-back to be copied by the next call: */
+			queueReadback(dataItem->waterBufferObject);
+			dataItem->waterReadbackPending=true;
+			}
+		else
+			{
+			/* Read the texture image into the given buffer: */
+			glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,GL_RED,GL_FLOAT,buffer);
+			result=true;
+			}
+		}
+	
+	return result;
+	}
+
+void WaterTable2::writeSnowTexture(const GLfloat* buffer,GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Bind the current snow height texture: */
+	textureTracker.reset();
+	textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->snow.textureObjects[dataItem->snow.current]);
+	
+	/* Upload the given buffer into the texture image: */
+	glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,size,GL_RED,GL_FLOAT,buffer);
+	}
+
+void WaterTable2::writeQuantityTexture(const GLfloat* buffer,GLContextData& contextData,TextureTracker& textureTracker) const
+	{
+	/* Get the data item: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Bind the current conserved quantities texture: */
+	textureTracker.reset();
+	textureTracker.bindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->quantity.textureObjects[dataItem->quantity.current]);
+	
+	/* Upload the given buffer into the texture image: */
+	glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,size,GL_RGB,GL_FLOAT,buffer);
+	}
@@ -86,14 +86,27 @@ class WaterTable2:public GLObject
 		public:
 		BufferedTexture<2> bathymetry; // Double-buffered one-component float color texture object holding the vertex-centered bathymetry grid
 		unsigned int bathymetryVersion; // Version number of the most recent bathymetry grid
+		unsigned int bathymetryPmvVersion; // Version number of the bathymetry rendering matrix used for the most recent bathymetry grid
+		unsigned int numBathymetryUpdates; // Number of changes to the bathymetry grid since the context was created
+		GLuint bathymetryBufferObject; // Pixel buffer object receiving asynchronous read-backs of the bathymetry grid
+		unsigned int bathymetryReadbackUpdates; // Number of bathymetry grid changes reflected in the most recently queued read-back
+		bool bathymetryReadbackPending; // Flag whether the bathymetry pixel buffer holds a read-back that has not been copied out yet
 		BufferedTexture<2> snow; // Double-buffered one-component float texture object holding the cell-centered snow height grid
 		BufferedTexture<3> quantity; // Double-buffered three-component color texture object (with one extra "scratch" slot) holding the cell-centered conserved quantity grid (w, hu, hv)
 		GLuint derivativeTextureObject; // Three-component color texture object holding the cell-centered temporal derivative grid
 		BufferedTexture<2> maxStepSize; // Double-buffered one-component color texture objects to gather the maximum step size for Runge-Kutta integration steps
+		GLuint stepSizeTextureObject; // One-component 1x1 color texture object receiving the final maximum step size reduction, to limit the step size of integration steps on the GPU
+		static const unsigned int numStepSizeBuffers=4; // Number of pixel buffers in the step size read-back ring
+		GLuint stepSizeBufferObjects[numStepSizeBuffers]; // Ring of pixel buffer objects receiving asynchronous read-backs of reduced maximum step sizes
+		GLfloat stepSizeCaps[numStepSizeBuffers]; // Step size limits uploaded to the integration steps whose reductions are read back into each pixel buffer of the ring
+		unsigned int numStepSizeReadbacks; // Total number of step size read-backs queued into the pixel buffer ring
 		GLuint waterTextureObject; // One-component color texture object to add or remove water to/from the conserved quantity grid
+		GLuint waterBufferObject; // Pixel buffer object receiving asynchronous read-backs of the water texture
+		bool waterReadbackPending; // Flag whether the water pixel buffer holds a read-back that has not been copied out yet
 		GLuint bathymetryFramebufferObject; // Frame buffer used to render the bathymetry surface into the bathymetry grid
 		GLuint derivativeFramebufferObject; // Frame buffer used for temporal derivative computation
 		GLuint maxStepSizeFramebufferObject; // Frame buffer used to calculate the maximum integration step size
+		GLuint stepSizeFramebufferObject; // Frame buffer used to write the final maximum step size reduction
 		GLuint integrationFramebufferObject; // Frame buffer used for the Euler and Runge-Kutta integration steps
 		GLuint waterFramebufferObject; // Frame buffer used for the water rendering step
 		Shader bathymetryShader; // Shader to update cell-centered conserved quantities after a change to the bathymetry grid
@@ -111,6 +124,8 @@ class WaterTable2:public GLObject
 		virtual ~DataItem(void);
 		};
 	
+	friend class CpuWaterTable2;
+	
 	/* Elements: */
 	Size size; // Width and height of water table in pixels
 	const DepthImageRenderer* depthImageRenderer; // Renderer object used to update the water table's bathymetry grid
@@ -118,6 +133,7 @@ class WaterTable2:public GLObject
 	Box domain; // Domain of elevation map space in rotated camera space
 	GLfloat cellSize[2]; // Width and height of water table cells in world coordinate units
 	PTransform bathymetryPmv; // Combined projection and modelview matrix to render the current surface into the bathymetry grid
+	unsigned int bathymetryPmvVersion; // Version number of the bathymetry rendering matrix
 	PTransform waterAddPmv; // Combined projection and modelview matrix to render water-adding geometry into the water grid
 	GLfloat waterAddPmvMatrix[16]; // Same, in GLSL-compatible format
 	GLfloat theta; // Coefficient for minmod flux-limiting differential operator
@@ -135,10 +151,13 @@ class WaterTable2:public GLObject
 	GLfloat snowMelt; // The rate of snow melt in elevation units per second
 	GLfloat waterDeposit; // A fixed amount of water added at every iteration of the flow simulation, for evaporation etc.
 	bool dryBoundary; // Flag whether to enforce dry boundary conditions at the end of each simulation step
+	bool laggedStepSize; // Flag whether to estimate step sizes from asynchronous read-backs of earlier reductions instead of waiting for the current reduction
 	
 	/* Private methods: */
 	void calcTransformations(void); // Calculates derived transformations
+	bool calcBathymetryRegion(unsigned int sinceVersion,GLint region[4]) const; // Calculates the rectangle (x, y, width, height) of the bathymetry grid affected by changes to the depth image since the given version; returns false if no grid cells are affected
 	GLfloat calcDerivative(GLContextData& contextData,TextureTracker& textureTracker,int quantityTextureIndex,bool calcMaxStepSize) const; // Calculates the temporal derivative of the conserved quantities in the given texture object and returns maximum step size if flag is true
+	void renderWaterSources(DataItem* dataItem,GLfloat baseRate,GLContextData& contextData) const; // Clears the water texture to the given rate and renders all water sources and sinks additively into it
 	
 	/* Constructors and destructors: */
 	public:
@@ -178,11 +197,15 @@ class WaterTable2:public GLObject
 		{
 		return dryBoundary;
 		}
+	bool getLaggedStepSize(void) const // Returns true if step sizes are estimated from earlier reductions
+		{
+		return laggedStepSize;
+		}
 	void setElevationRange(Scalar newMin,Scalar newMax); // Sets the range of possible elevations in the water table
 	void setMode(Mode newMode); // Sets the water simulation mode
 	void setAttenuation(GLfloat newAttenuation); // Sets the attenuation factor for partial discharges
 	void setPropertyGridCreator(PropertyGridCreator* newPropertyGridCreator); // Sets the property grid creator to be used in engineering mode
-	void forceMinStepSize(GLfloat newMinStepSize); // Forces the given minimum step size for all subsequent integration steps by limiting cell fluxes
+	void forceMinStepSize(GLfloat newMinStepSize); // Forces the given minimum step size for all subsequent integration steps by limiting cell fluxes; removes the limit if the step size is zero
 	void setMaxStepSize(GLfloat newMaxStepSize); // Sets the maximum step size for all subsequent integration steps
 	const PTransform& getWaterTextureTransform(void) const // Returns the matrix transforming from camera space into water texture space
 		{
@@ -206,17 +229,22 @@ class WaterTable2:public GLObject
 		}
 	void setWaterDeposit(GLfloat newWaterDeposit); // Sets the amount of deposited water
 	void setDryBoundary(bool newDryBoundary); // Enables or disables enforcement of dry boundaries
+	void setLaggedStepSize(bool newLaggedStepSize); // Enables or disables estimating step sizes from asynchronous read-backs of earlier reductions; integration steps are still limited by the current reduction on the GPU
 	void updateBathymetry(GLContextData& contextData,TextureTracker& textureTracker) const; // Prepares the water table for subsequent calls to the runSimulationStep() method
 	void updateBathymetry(const GLfloat* bathymetryGrid,GLContextData& contextData,TextureTracker& textureTracker) const; // Updates the bathymetry directly with a vertex-centered elevation grid of grid size minus 1
 	void setWaterLevel(const GLfloat* waterGrid,GLContextData& contextData,TextureTracker& textureTracker) const; // Sets the current water level to the given grid, and resets flux components to zero
-	GLfloat runSimulationStep(bool forceStepSize,GLContextData& contextData,TextureTracker& textureTracker) const; // Runs a water flow simulation step, always uses maxStepSize if flag is true (may lead to instability); returns step size taken by Runge-Kutta integration step
+	GLfloat runSimulationStep(bool forceStepSize,GLContextData& contextData,TextureTracker& textureTracker) const; // Runs a water flow simulation step, always uses maxStepSize if flag is true (may lead to instability); returns step size taken by Runge-Kutta integration step; if lagged step sizes are enabled, returns the step size taken by the step whose reduction was read back, or zero while the read-back ring fills, so that returned step sizes add up to the simulated time
 	void uploadWaterTextureTransform(Shader& shader) const; // Uploads the water texture transformation into the GLSL 4x4 matrix at the next uniform location in the given shader
 	GLint bindBathymetryTexture(GLContextData& contextData,TextureTracker& textureTracker,bool linearSampling) const; // Binds the bathymetry texture object to the next available texture unit in the given texture tracker and sets filtering mode to linear if flag is true; returns the used texture unit's index
 	GLint bindSnowTexture(GLContextData& contextData,TextureTracker& textureTracker,bool linearSampling) const; // Binds the most recent snow height texture object to the next available texture unit in the given texture tracker and sets filtering mode to linear if flag is true; returns the used texture unit's index
 	GLint bindQuantityTexture(GLContextData& contextData,TextureTracker& textureTracker,bool linearSampling) const; // Binds the most recent conserved quantities texture object to the next available texture unit in the given texture tracker and sets filtering mode to linear if flag is true; returns the used texture unit's index
 	void readBathymetryTexture(GLContextData& contextData,TextureTracker& textureTracker,GLfloat* buffer) const; // Reads the current bathymetry texture into the given buffer
+	bool readBathymetryTextureAsync(GLContextData& contextData,TextureTracker& textureTracker,GLfloat* buffer) const; // Copies the bathymetry read-back queued by a previous call into the given buffer and returns true if there was one; queues an asynchronous read-back of the current bathymetry texture if it changed since the previous one
 	void readSnowTexture(GLContextData& contextData,TextureTracker& textureTracker,GLfloat* buffer) const; // Reads the current snow height texture into the given buffer
 	void readQuantityTexture(GLContextData& contextData,TextureTracker& textureTracker,GLenum components,GLfloat* buffer) const; // Reads the given component(s) of the current conserved quantities texture into the given buffer
+	bool readWaterSourceTexture(GLContextData& contextData,TextureTracker& textureTracker,bool lagged,GLfloat* buffer) const; // Renders the rates of all water sources and sinks, excluding deposited water, into the water texture and reads them into the given buffer; if flag is true, queues an asynchronous read-back instead and copies the one queued by the previous call; returns true if the buffer was written
+	void writeSnowTexture(const GLfloat* buffer,GLContextData& contextData,TextureTracker& textureTracker) const; // Replaces the current snow height texture with the given cell-centered grid, e.g., to display a simulation run elsewhere
+	void writeQuantityTexture(const GLfloat* buffer,GLContextData& contextData,TextureTracker& textureTracker) const; // Replaces the current conserved quantities texture with the given grid in the interleaved layout of readQuantityTexture with GL_RGB components
 	Size getBathymetrySize(void) const // Returns the width or height of the bathymetry grid
 		{
 		return Size(size[0]-1,size[1]-1);
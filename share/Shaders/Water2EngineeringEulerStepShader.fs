@@ -25,12 +25,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 uniform float stepSize;
 uniform sampler2DRect quantitySampler;
 uniform sampler2DRect derivativeSampler;
+uniform sampler2DRect stepSizeSampler;
 
 void main()
 	{
+	/* Limit the step size to the most recent maximum step size reduction: */
+	float dt=min(stepSize,texture2DRect(stepSizeSampler,vec2(0.5,0.5)).r);
+	
 	/* Calculate the Euler step: */
 	vec3 q=texture2DRect(quantitySampler,gl_FragCoord.xy).rgb;
 	vec3 qt=texture2DRect(derivativeSampler,gl_FragCoord.xy).rgb;
-	vec3 newQ=q+qt*stepSize;
+	vec3 newQ=q+qt*dt;
 	gl_FragColor=vec4(newQ,0.0);
 	}
@@ -26,13 +26,17 @@ uniform float stepSize;
 uniform sampler2DRect quantitySampler;
 uniform sampler2DRect quantityStarSampler;
 uniform sampler2DRect derivativeSampler;
+uniform sampler2DRect stepSizeSampler;
 
 void main()
 	{
+	/* Limit the step size to the most recent maximum step size reduction: */
+	float dt=min(stepSize,texture2DRect(stepSizeSampler,vec2(0.5,0.5)).r);
+	
 	/* Calculate the Runge-Kutta step: */
 	vec3 q=texture2DRect(quantitySampler,gl_FragCoord.xy).rgb;
 	vec3 qStar=texture2DRect(quantityStarSampler,gl_FragCoord.xy).rgb;
 	vec3 qt=texture2DRect(derivativeSampler,gl_FragCoord.xy).rgb;
-	vec3 newQ=(q+qStar+qt*stepSize)*0.5;
+	vec3 newQ=(q+qStar+qt*dt)*0.5;
 	gl_FragColor=vec4(newQ,0.0);
 	}
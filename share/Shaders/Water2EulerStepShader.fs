@@ -25,13 +25,17 @@ uniform float stepSize;
 uniform float attenuation;
 uniform sampler2DRect quantitySampler;
 uniform sampler2DRect derivativeSampler;
+uniform sampler2DRect stepSizeSampler;
 
 void main()
 	{
+	/* Limit the step size to the most recent maximum step size reduction: */
+	float dt=min(stepSize,texture2DRect(stepSizeSampler,vec2(0.5,0.5)).r);
+	
 	/* Calculate the Euler step: */
 	vec3 q=texture2DRect(quantitySampler,gl_FragCoord.xy).rgb;
 	vec3 qt=texture2DRect(derivativeSampler,gl_FragCoord.xy).rgb;
-	vec3 newQ=q+qt*stepSize;
-	newQ.yz*=attenuation;
+	vec3 newQ=q+qt*dt;
+	newQ.yz*=pow(attenuation,dt);
 	gl_FragColor=vec4(newQ,0.0);
 	}
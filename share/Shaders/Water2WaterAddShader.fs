@@ -19,10 +19,10 @@ with the Augmented Reality Sandbox; if not, write to the Free Software
 Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 ***********************************************************************/
 
-varying float scaledWaterAmount;
+varying float waterRate;
 
 void main()
 	{
 	/* Update the water texture: */
-	gl_FragColor=vec4(scaledWaterAmount);
+	gl_FragColor=vec4(waterRate);
 	}
@@ -29,6 +29,8 @@ uniform sampler2DRect quantitySampler;
 uniform sampler2DRect waterSampler;
 uniform float snowLine;
 uniform float snowMelt;
+uniform float stepSize;
+uniform sampler2DRect stepSizeSampler;
 
 void main()
 	{
@@ -47,8 +49,11 @@ void main()
 	/* Calculate the old water column height: */
 	float hOld=q.x-b;
 	
+	/* Limit the step size to the most recent maximum step size reduction, in the same way as the preceding integration step: */
+	float dt=min(stepSize,texture2DRect(stepSizeSampler,vec2(0.5,0.5)).r);
+	
 	/* Calculate the effective changes in water and snow level: */
-	float precip=texture2DRect(waterSampler,gl_FragCoord.xy).r;
+	float precip=texture2DRect(waterSampler,gl_FragCoord.xy).r*dt;
 	float dWater=precip;
 	float dSnow=precip*4.0; // Snow is four times fluffier than water
 	
@@ -61,9 +66,9 @@ void main()
 		}
 	
 	/* Melt snow into water: */
-	snowMelt=min(snowMelt,s);
-	dSnow=dSnow-snowMelt;
-	dWater=dWater+snowMelt/4.0; // Snow is four times fluffier than water
+	float melt=min(snowMelt*dt,s);
+	dSnow=dSnow-melt;
+	dWater=dWater+melt/4.0; // Snow is four times fluffier than water
 	
 	/* Update the snow height: */
 	s=max(s+dSnow,0.0);